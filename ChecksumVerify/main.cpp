@@ -4,35 +4,256 @@
 
 #include "../Client/rds_checksum.h"
 
+
+class checksumResult
+{
+public:
+    checksumResult()
+    {
+        filename="";
+        checksum="";
+        sidecarChecksum="";
+        size=0;
+        sidecarWritten=false;
+    }
+
+    QString filename;
+    QString checksum;
+    QString sidecarChecksum;
+    qint64  size;
+    bool    sidecarWritten;
+};
+
+
+// Calculates the checksum of one file. Several files are processed in parallel
+// by a dedicated thread pool (the global pool is used for the chunked hashes).
+class checksumTask : public QRunnable
+{
+public:
+    checksumTask(checksumResult* taskResult, int taskAlgorithm, bool taskWriteSidecar)
+    {
+        result=taskResult;
+        algorithm=taskAlgorithm;
+        writeSidecar=taskWriteSidecar;
+    }
+
+    void run()
+    {
+        result->size=QFileInfo(result->filename).size();
+        result->checksum=rdsChecksum::getChecksum(result->filename, algorithm);
+        result->sidecarChecksum=rdsChecksum::readSidecar(result->filename, algorithm);
+
+        if ((writeSidecar) && (!result->checksum.isEmpty()))
+        {
+            // An existing checksum file is never replaced. If it doesn't match, it is the
+            // evidence of the corruption and has to be kept.
+            if (result->sidecarChecksum.isEmpty())
+            {
+                result->sidecarWritten=rdsChecksum::writeSidecar(result->filename, result->checksum, algorithm);
+            }
+            else
+            {
+                result->sidecarWritten=(result->sidecarChecksum==result->checksum);
+            }
+        }
+    }
+
+    checksumResult* result;
+    int             algorithm;
+    bool            writeSidecar;
+};
+
+
+bool isSidecarFile(QString filename)
+{
+    for (int i=rdsChecksum::ALGORITHM_MD5; i<=rdsChecksum::ALGORITHM_XXH64_CHUNKED; i++)
+    {
+        if (filename.endsWith(rdsChecksum::getSidecarExtension(i), Qt::CaseInsensitive))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void printUsage()
+{
+    printf("Usage: ChecksumVerify [options] [filename.dat or directory] ...\n\n");
+    printf("Options:\n");
+    printf("  -a [algorithm]  md5 (default), xxh64, md5c, xxh64c\n");
+    printf("                  md5c/xxh64c hash chunks of %d MB in parallel\n", RDS_CHECKSUM_CHUNKSIZE/1048576);
+    printf("  -v              Verify against the checksum file next to each file\n");
+    printf("  -w              Write the checksum file next to each file (unless present)\n");
+    printf("  -j [count]      Number of files processed in parallel (default: %d)\n\n", QThread::idealThreadCount());
+}
+
+
 int main(int argc, char *argv[])
 {
     printf("\nYarra MD5 Checksum Verification\n");
     printf("-------------------------------\n\n");
 
-    if (argc != 2)
+    int  algorithm=rdsChecksum::ALGORITHM_MD5;
+    bool verify=false;
+    bool writeSidecar=false;
+    int  threads=QThread::idealThreadCount();
+
+    QStringList paths;
+
+    for (int i=1; i<argc; i++)
+    {
+        QString arg=QString::fromLocal8Bit(argv[i]);
+
+        if ((arg=="-a") && (i+1<argc))
+        {
+            i++;
+            algorithm=rdsChecksum::getAlgorithm(QString::fromLocal8Bit(argv[i]));
+
+            if (algorithm<0)
+            {
+                printf("Unknown algorithm (%s)\n\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (arg=="-v")
+        {
+            verify=true;
+        }
+        else if (arg=="-w")
+        {
+            writeSidecar=true;
+        }
+        else if ((arg=="-j") && (i+1<argc))
+        {
+            i++;
+            threads=qMax(1, atoi(argv[i]));
+        }
+        else
+        {
+            paths.append(arg);
+        }
+    }
+
+    if (paths.isEmpty())
     {
-        printf("Usage: ChecksumVerify [filename.dat]\n\n");
+        printUsage();
+        return 0;
     }
-    else
+
+    // Collect the files, including the content of directories
+    QList<checksumResult*> results;
+
+    for (int i=0; i<paths.count(); i++)
     {
-        QString filename=QString::fromLocal8Bit(argv[1]);
+        QFileInfo pathInfo(paths.at(i));
 
-        if (!QFile::exists(filename))
+        if (pathInfo.isDir())
         {
-            printf("File not found (%s)\n\n",qPrintable(filename));
+            QDirIterator it(paths.at(i), QDir::Files, QDirIterator::Subdirectories);
+
+            while (it.hasNext())
+            {
+                QString filename=it.next();
+
+                if (!isSidecarFile(filename))
+                {
+                    results.append(new checksumResult());
+                    results.last()->filename=filename;
+                }
+            }
         }
         else
         {
-            QTime t;
-            t.start();
+            if (!pathInfo.exists())
+            {
+                printf("File not found (%s)\n\n",qPrintable(paths.at(i)));
+                continue;
+            }
+
+            results.append(new checksumResult());
+            results.last()->filename=paths.at(i);
+        }
+    }
+
+    QTime t;
+    t.start();
 
-            QString checksum=rdsChecksum::getChecksum(filename);
-            printf("MD5 checksum is %s\n\n",qPrintable(checksum));
+    QThreadPool fileThreads;
+    fileThreads.setMaxThreadCount(threads);
 
-            qDebug("Time elapsed: %d ms", t.elapsed());
+    for (int i=0; i<results.count(); i++)
+    {
+        fileThreads.start(new checksumTask(results.at(i), algorithm, writeSidecar));
+    }
+
+    fileThreads.waitForDone();
 
+    int    errors=0;
+    qint64 totalSize=0;
+    QString algorithmName=rdsChecksum::getAlgorithmName(algorithm).toUpper();
+
+    for (int i=0; i<results.count(); i++)
+    {
+        checksumResult* result=results.at(i);
+        totalSize+=result->size;
+
+        if (result->checksum.isEmpty())
+        {
+            printf("ERROR: Unable to read file (%s)\n", qPrintable(result->filename));
+            errors++;
+            continue;
+        }
+
+        if (results.count()==1)
+        {
+            printf("%s checksum is %s\n\n", qPrintable(algorithmName), qPrintable(result->checksum));
+        }
+        else
+        {
+            printf("%s  %s\n", qPrintable(result->checksum), qPrintable(result->filename));
+        }
+
+        // Compare with the checksum recorded during the transfer (if available)
+        if (!result->sidecarChecksum.isEmpty())
+        {
+            if (result->sidecarChecksum==result->checksum)
+            {
+                printf("Checksum matches %s file\n", qPrintable(rdsChecksum::getSidecarExtension(algorithm)));
+            }
+            else
+            {
+                printf("ERROR: Checksum does not match %s file (%s)\n", qPrintable(rdsChecksum::getSidecarExtension(algorithm)), qPrintable(result->sidecarChecksum));
+                errors++;
+
+                if (writeSidecar)
+                {
+                    printf("ERROR: Existing %s file has been kept\n", qPrintable(rdsChecksum::getSidecarExtension(algorithm)));
+                }
+            }
+        }
+        else
+        {
+            if (verify)
+            {
+                printf("ERROR: No %s file found\n", qPrintable(rdsChecksum::getSidecarExtension(algorithm)));
+                errors++;
+            }
+        }
+
+        if ((writeSidecar) && (!result->sidecarWritten) && (result->sidecarChecksum.isEmpty()))
+        {
+            printf("ERROR: Unable to write %s file\n", qPrintable(rdsChecksum::getSidecarExtension(algorithm)));
+            errors++;
         }
     }
 
-    return 0;
+    int elapsed=qMax(t.elapsed(), 1);
+    printf("\n%d file(s), %lld MB, %d error(s)\n", results.count(), totalSize/1048576, errors);
+    qDebug("Time elapsed: %d ms (%.1f MB/s)", elapsed, double(totalSize)/1048576.0/(elapsed/1000.0));
+
+    qDeleteAll(results);
+    results.clear();
+
+    return (errors>0) ? 1 : 0;
 }
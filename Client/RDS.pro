@@ -24,8 +24,11 @@ SOURCES += main.cpp \
         rds_operationwindow.cpp \
         rds_configuration.cpp \
         rds_network.cpp \
+        rds_copyengine.cpp \
         rds_log.cpp \
         rds_raid.cpp \
+        rds_raidparser.cpp \
+        rds_raidindex.cpp \
         rds_processcontrol.cpp \
         rds_activitywindow.cpp \
         rds_debugwindow.cpp \
@@ -33,8 +36,11 @@ SOURCES += main.cpp \
         rds_copydialog.cpp \
         rds_checksum.cpp \
         ../NetLogger/netlogger.cpp \
+        ../NetLogger/netlog_sender.cpp \
+        ../CloudTools/yct_prepare/yct_twix_tagmatcher.cpp \
     rds_iconwindow.cpp \
     rds_exechelper.cpp \
+    rds_processrunner.cpp \
     rds_mailbox.cpp \
     rds_mailboxwindow.cpp \
     rds_mailboxmessage.cpp
@@ -45,8 +51,11 @@ HEADERS  += rds_configurationwindow.h \
             rds_operationwindow.h \
             rds_configuration.h \
             rds_network.h \
+            rds_copyengine.h \
             rds_log.h \
             rds_raid.h \
+            rds_raidparser.h \
+            rds_raidindex.h \
             rds_processcontrol.h \
             rds_activitywindow.h \
             rds_debugwindow.h \
@@ -56,8 +65,11 @@ HEADERS  += rds_configurationwindow.h \
             rds_checksum.h \
             ../NetLogger/netlogger.h \
             ../NetLogger/netlog_events.h \
+            ../NetLogger/netlog_sender.h \
+            ../CloudTools/yct_prepare/yct_twix_tagmatcher.h \
     rds_iconwindow.h \
     rds_exechelper.h \
+    rds_processrunner.h \
     rds_mailbox.h \
     rds_mailboxwindow.h \
     rds_mailboxmessage.h
@@ -1,10 +1,36 @@
 #include "rds_anonymizeVB17.h"
 #include "rds_global.h"
+#include "../CloudTools/yct_prepare/yct_twix_tagmatcher.h"
 
 
 #define MAX_LINE_LENGTH 1024
 
 
+// Tags searched by analyzeLine(). The order of the enum must match the pattern list.
+enum VB17Tag
+{
+    TAG_TPATIENTNAME = 0,
+    TAG_PATIENTNAME,
+    TAG_PATIENTSNAME,
+    TAG_PATIENTBIRTHDAY,
+    TAG_PATIENTID,
+    TAG_TPERFPHYSICIANSNAME,
+    TAG_COUNT
+};
+
+static const char* const vb17Tags[TAG_COUNT] =
+{
+    "<ParamString.\"tPatientName\">",
+    "<ParamString.\"PatientName\">",
+    "<ParamString.\"PatientsName\">",
+    "<ParamString.\"PatientBirthDay\">",
+    "<ParamString.\"PatientID\">",
+    "<ParamString.\"tPerfPhysiciansName\">"
+};
+
+Q_GLOBAL_STATIC_WITH_ARGS(yctTagMatcher, vb17TagMatcher, (vb17Tags, TAG_COUNT))
+
+
 rdsAnonymizeVB17::rdsAnonymizeVB17()
 {
 }
@@ -183,37 +209,45 @@ bool rdsAnonymizeVB17::anonymizeVB17(QString filename)
 
 int rdsAnonymizeVB17::analyzeLine(QByteArray* line)
 {
-    if (line->indexOf("<ParamString.\"tPatientName\">", 0) > 0)
+    // Search all tags in one pass. Tags are only considered if they do not start at
+    // the very beginning of the line (as with the previous indexOf checks).
+    int positions[TAG_COUNT];
+    if (vb17TagMatcher()->find(line, positions)==0)
+    {
+        return NO_SENSITIVE_INFORMATION;
+    }
+
+    if (positions[TAG_TPATIENTNAME] > 0)
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientName\">", 0) > 0)
+    if (positions[TAG_PATIENTNAME] > 0)
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientsName\">", 0) > 0)
+    if (positions[TAG_PATIENTSNAME] > 0)
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientBirthDay\">", 0) > 0)
+    if (positions[TAG_PATIENTBIRTHDAY] > 0)
     {
         expectedContent=CONTENT_BIRTHDAY;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientID\">", 0) > 0)
+    if (positions[TAG_PATIENTID] > 0)
     {
         expectedContent=CONTENT_ID;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"tPerfPhysiciansName\">", 0) > 0)
+    if (positions[TAG_TPERFPHYSICIANSNAME] > 0)
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
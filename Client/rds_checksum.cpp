@@ -1,8 +1,273 @@
 #include "rds_checksum.h"
 
+#include <QtEndian>
+
 #define RDS_CHECKSUM_BLOCKSIZE 1048576
 //#define RDS_CHECKSUM_BLOCKSIZE 8192
 
+#define RDS_XXH64_PRIME1 Q_UINT64_C(0x9E3779B185EBCA87)
+#define RDS_XXH64_PRIME2 Q_UINT64_C(0xC2B2AE3D27D4EB4F)
+#define RDS_XXH64_PRIME3 Q_UINT64_C(0x165667B19E3779F9)
+#define RDS_XXH64_PRIME4 Q_UINT64_C(0x85EBCA77C2B2AE63)
+#define RDS_XXH64_PRIME5 Q_UINT64_C(0x27D4EB2F165667C5)
+
+
+static inline quint64 xxhRotate(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64-bits));
+}
+
+
+static inline quint64 xxhRound(quint64 acc, quint64 input)
+{
+    acc+=input*RDS_XXH64_PRIME2;
+    acc=xxhRotate(acc, 31);
+    return acc*RDS_XXH64_PRIME1;
+}
+
+
+static inline quint64 xxhMergeRound(quint64 acc, quint64 value)
+{
+    acc^=xxhRound(0, value);
+    return acc*RDS_XXH64_PRIME1+RDS_XXH64_PRIME4;
+}
+
+
+
+rdsHash::rdsHash(int hashAlgorithm)
+{
+    algorithm=hashAlgorithm;
+    md5=0;
+
+    if ((algorithm==rdsChecksum::ALGORITHM_MD5) || (algorithm==rdsChecksum::ALGORITHM_MD5_CHUNKED))
+    {
+        md5=new QCryptographicHash(QCryptographicHash::Md5);
+    }
+
+    reset();
+}
+
+
+rdsHash::~rdsHash()
+{
+    if (md5!=0)
+    {
+        delete md5;
+        md5=0;
+    }
+}
+
+
+void rdsHash::reset()
+{
+    if (md5!=0)
+    {
+        md5->reset();
+    }
+
+    // XXH64 with seed 0
+    acc[0]=RDS_XXH64_PRIME1+RDS_XXH64_PRIME2;
+    acc[1]=RDS_XXH64_PRIME2;
+    acc[2]=0;
+    acc[3]=0-RDS_XXH64_PRIME1;
+    totalLength=0;
+    bufferLength=0;
+}
+
+
+void rdsHash::processStripe(const uchar* stripe)
+{
+    acc[0]=xxhRound(acc[0], qFromLittleEndian<quint64>(stripe));
+    acc[1]=xxhRound(acc[1], qFromLittleEndian<quint64>(stripe+8));
+    acc[2]=xxhRound(acc[2], qFromLittleEndian<quint64>(stripe+16));
+    acc[3]=xxhRound(acc[3], qFromLittleEndian<quint64>(stripe+24));
+}
+
+
+void rdsHash::addData(const char* data, qint64 length)
+{
+    if (md5!=0)
+    {
+        md5->addData(data, int(length));
+        return;
+    }
+
+    const uchar* input=(const uchar*) data;
+    totalLength+=length;
+
+    // Complete the stripe left over from the previous call
+    if (bufferLength>0)
+    {
+        int fill=int(qMin((qint64) (32-bufferLength), length));
+        memcpy(buffer+bufferLength, input, fill);
+        bufferLength+=fill;
+        input+=fill;
+        length-=fill;
+
+        if (bufferLength<32)
+        {
+            return;
+        }
+
+        processStripe(buffer);
+        bufferLength=0;
+    }
+
+    while (length>=32)
+    {
+        processStripe(input);
+        input+=32;
+        length-=32;
+    }
+
+    if (length>0)
+    {
+        memcpy(buffer, input, length);
+        bufferLength=int(length);
+    }
+}
+
+
+QByteArray rdsHash::result()
+{
+    if (md5!=0)
+    {
+        return md5->result();
+    }
+
+    quint64 h=0;
+
+    if (totalLength>=32)
+    {
+        h=xxhRotate(acc[0], 1)+xxhRotate(acc[1], 7)+xxhRotate(acc[2], 12)+xxhRotate(acc[3], 18);
+        h=xxhMergeRound(h, acc[0]);
+        h=xxhMergeRound(h, acc[1]);
+        h=xxhMergeRound(h, acc[2]);
+        h=xxhMergeRound(h, acc[3]);
+    }
+    else
+    {
+        h=acc[2]+RDS_XXH64_PRIME5;
+    }
+
+    h+=totalLength;
+
+    const uchar* p=buffer;
+    int remaining=bufferLength;
+
+    while (remaining>=8)
+    {
+        h^=xxhRound(0, qFromLittleEndian<quint64>(p));
+        h=xxhRotate(h, 27)*RDS_XXH64_PRIME1+RDS_XXH64_PRIME4;
+        p+=8;
+        remaining-=8;
+    }
+
+    if (remaining>=4)
+    {
+        h^=quint64(qFromLittleEndian<quint32>(p))*RDS_XXH64_PRIME1;
+        h=xxhRotate(h, 23)*RDS_XXH64_PRIME2+RDS_XXH64_PRIME3;
+        p+=4;
+        remaining-=4;
+    }
+
+    while (remaining>0)
+    {
+        h^=quint64(*p)*RDS_XXH64_PRIME5;
+        h=xxhRotate(h, 11)*RDS_XXH64_PRIME1;
+        p++;
+        remaining--;
+    }
+
+    h^=h >> 33;
+    h*=RDS_XXH64_PRIME2;
+    h^=h >> 29;
+    h*=RDS_XXH64_PRIME3;
+    h^=h >> 32;
+
+    // Canonical representation (big endian), as used by xxhsum
+    QByteArray digest(8, 0);
+    qToBigEndian<quint64>(h, (uchar*) digest.data());
+
+    return digest;
+}
+
+
+
+// Calculates the hash of one chunk of a file. Each task opens the file
+// separately, so that the chunks can be read in parallel.
+class rdsChecksumChunkTask : public QRunnable
+{
+public:
+    rdsChecksumChunkTask(QString chunkFilename, int chunkAlgorithm, qint64 chunkOffset, qint64 chunkLength,
+                         QByteArray* chunkDigest, QSemaphore* chunkDone);
+
+    void run();
+
+    QString     filename;
+    int         algorithm;
+    qint64      offset;
+    qint64      length;
+    QByteArray* digest;
+    QSemaphore* done;
+};
+
+
+rdsChecksumChunkTask::rdsChecksumChunkTask(QString chunkFilename, int chunkAlgorithm, qint64 chunkOffset, qint64 chunkLength,
+                                           QByteArray* chunkDigest, QSemaphore* chunkDone)
+{
+    filename=chunkFilename;
+    algorithm=chunkAlgorithm;
+    offset=chunkOffset;
+    length=chunkLength;
+    digest=chunkDigest;
+    done=chunkDone;
+}
+
+
+void rdsChecksumChunkTask::run()
+{
+    QFile file(filename);
+    bool success=false;
+
+    if ((file.open(QIODevice::ReadOnly)) && (file.seek(offset)))
+    {
+        rdsHash hash(algorithm);
+        QByteArray block(RDS_CHECKSUM_BLOCKSIZE, 0);
+        qint64 remaining=length;
+
+        success=true;
+
+        while (remaining>0)
+        {
+            qint64 blockLength=file.read(block.data(), qMin(remaining, (qint64) RDS_CHECKSUM_BLOCKSIZE));
+
+            if (blockLength<=0)
+            {
+                success=false;
+                break;
+            }
+
+            hash.addData(block.constData(), blockLength);
+            remaining-=blockLength;
+        }
+
+        if (success)
+        {
+            *digest=hash.result();
+        }
+    }
+
+    // An empty digest marks the chunk as failed
+    if (!success)
+    {
+        digest->clear();
+    }
+
+    done->release();
+}
+
+
 
 rdsChecksum::rdsChecksum()
 {
@@ -11,16 +276,164 @@ rdsChecksum::rdsChecksum()
 
 QString rdsChecksum::getChecksum(QString filename)
 {
-    QCryptographicHash crypto(QCryptographicHash::Md5);
+    return getChecksum(filename, ALGORITHM_MD5);
+}
+
+
+QString rdsChecksum::getChecksum(QString filename, int algorithm)
+{
+    if (algorithm==ALGORITHM_MD5_CHUNKED)
+    {
+        return getChunkedChecksum(filename, ALGORITHM_MD5);
+    }
+
+    if (algorithm==ALGORITHM_XXH64_CHUNKED)
+    {
+        return getChunkedChecksum(filename, ALGORITHM_XXH64);
+    }
 
     QFile file(filename);
 
-    file.open(QFile::ReadOnly);
-    while(!file.atEnd()){
-        crypto.addData(file.read(RDS_CHECKSUM_BLOCKSIZE));
+    if (!file.open(QFile::ReadOnly))
+    {
+        return "";
+    }
+
+    rdsHash hash(algorithm);
+    QByteArray block(RDS_CHECKSUM_BLOCKSIZE, 0);
+
+    while (!file.atEnd())
+    {
+        qint64 blockLength=file.read(block.data(), RDS_CHECKSUM_BLOCKSIZE);
+
+        if (blockLength<0)
+        {
+            return "";
+        }
+
+        hash.addData(block.constData(), blockLength);
+    }
+
+    return QString(hash.result().toHex());
+}
+
+
+QString rdsChecksum::getChunkedChecksum(QString filename, int baseAlgorithm)
+{
+    // The file is split into chunks of fixed size, which are hashed in parallel
+    // using the global thread pool (so this must not be called from a thread of
+    // the global pool). The checksum is the hash of the concatenated chunk hashes.
+    QFileInfo fileInfo(filename);
+
+    if (!fileInfo.exists())
+    {
+        return "";
+    }
+
+    qint64 fileSize=fileInfo.size();
+    int chunkCount=qMax(1, int((fileSize+RDS_CHECKSUM_CHUNKSIZE-1)/RDS_CHECKSUM_CHUNKSIZE));
+
+    QVector<QByteArray> digests(chunkCount);
+    QSemaphore done(0);
+
+    for (int i=0; i<chunkCount; i++)
+    {
+        qint64 offset=qint64(i)*RDS_CHECKSUM_CHUNKSIZE;
+        qint64 length=qMin((qint64) RDS_CHECKSUM_CHUNKSIZE, fileSize-offset);
+
+        QThreadPool::globalInstance()->start(new rdsChecksumChunkTask(filename, baseAlgorithm, offset, length, &digests[i], &done));
+    }
+
+    done.acquire(chunkCount);
+
+    rdsHash hash(baseAlgorithm);
+
+    for (int i=0; i<chunkCount; i++)
+    {
+        if (digests.at(i).isEmpty())
+        {
+            return "";
+        }
+
+        hash.addData(digests.at(i).constData(), digests.at(i).size());
+    }
+
+    return QString(hash.result().toHex());
+}
+
+
+QString rdsChecksum::getAlgorithmName(int algorithm)
+{
+    switch (algorithm)
+    {
+    case ALGORITHM_MD5:
+        return "md5";
+    case ALGORITHM_XXH64:
+        return "xxh64";
+    case ALGORITHM_MD5_CHUNKED:
+        return "md5c";
+    case ALGORITHM_XXH64_CHUNKED:
+        return "xxh64c";
+    default:
+        return "";
+    }
+}
+
+
+int rdsChecksum::getAlgorithm(QString name)
+{
+    for (int i=ALGORITHM_MD5; i<=ALGORITHM_XXH64_CHUNKED; i++)
+    {
+        if (name.toLower()==getAlgorithmName(i))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+QString rdsChecksum::getSidecarExtension(int algorithm)
+{
+    if (algorithm==ALGORITHM_MD5)
+    {
+        return RDS_CHECKSUM_EXT;
+    }
+
+    return "." + getAlgorithmName(algorithm);
+}
+
+
+bool rdsChecksum::writeSidecar(QString filename, QString checksum, int algorithm)
+{
+    QFile sidecarFile(filename + getSidecarExtension(algorithm));
+
+    if (!sidecarFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QString line=checksum + " *" + QFileInfo(filename).fileName() + "\n";
+    bool success=(sidecarFile.write(line.toUtf8())>0);
+    sidecarFile.close();
+
+    return success;
+}
+
+
+QString rdsChecksum::readSidecar(QString filename, int algorithm)
+{
+    QFile sidecarFile(filename + getSidecarExtension(algorithm));
+
+    if (!sidecarFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return "";
     }
 
-    QByteArray hash = crypto.result();
+    // The checksum is the first token of the line, followed by the file name
+    QString line=QString::fromUtf8(sidecarFile.readLine()).trimmed();
+    sidecarFile.close();
 
-    return QString(hash.toHex());
+    return line.section(' ', 0, 0).toLower();
 }
@@ -3,12 +3,64 @@
 
 #include <QtCore>
 
+#define RDS_CHECKSUM_EXT       ".md5"
+#define RDS_CHECKSUM_CHUNKSIZE 67108864
+
+
+// Incremental hash calculation for the algorithms supported by rdsChecksum
+class rdsHash
+{
+public:
+    rdsHash(int hashAlgorithm);
+    ~rdsHash();
+
+    void reset();
+    void addData(const char* data, qint64 length);
+    QByteArray result();
+
+protected:
+
+    void processStripe(const uchar* stripe);
+
+    int algorithm;
+    QCryptographicHash* md5;
+
+    // State of the XXH64 calculation
+    quint64 acc[4];
+    quint64 totalLength;
+    uchar   buffer[32];
+    int     bufferLength;
+};
+
+
 class rdsChecksum
 {
 public:
+    enum Algorithm
+    {
+        ALGORITHM_MD5          =0,
+        ALGORITHM_XXH64        =1,
+        ALGORITHM_MD5_CHUNKED  =2,
+        ALGORITHM_XXH64_CHUNKED=3
+    };
+
     rdsChecksum();
 
+    // Returns an empty string if the file cannot be read
     static QString getChecksum(QString filename);
+    static QString getChecksum(QString filename, int algorithm);
+
+    static QString getAlgorithmName(int algorithm);
+    static int     getAlgorithm(QString name);
+
+    // Sidecar file with the checksum next to the data file (md5sum format)
+    static QString getSidecarExtension(int algorithm=ALGORITHM_MD5);
+    static bool    writeSidecar(QString filename, QString checksum, int algorithm=ALGORITHM_MD5);
+    static QString readSidecar(QString filename, int algorithm=ALGORITHM_MD5);
+
+protected:
+
+    static QString getChunkedChecksum(QString filename, int baseAlgorithm);
 };
 
 #endif // RDS_CHECKSUM_H
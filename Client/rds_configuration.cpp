@@ -1,5 +1,6 @@
 #include "rds_configuration.h"
 #include "rds_global.h"
+#include "rds_copyengine.h"
 
 
 rdsConfiguration::rdsConfiguration()
@@ -65,6 +66,10 @@ void rdsConfiguration::loadConfiguration()
 
     infoRAIDTimeout        =settings.value("General/RAIDTimeout",          RDS_RAIDSTORE_TIMEOUT).toInt();
     infoCopyTimeout        =settings.value("General/CopyTimeout",          RDS_COPY_TIMEOUT).toInt();
+    infoPipelinedUpdate    =settings.value("General/PipelinedUpdate",      false).toBool();
+    infoCopyBufferSize     =settings.value("General/CopyBufferSize",       RDS_COPY_BUFFERSIZE/1048576).toInt();
+    infoCopyChecksum       =settings.value("General/CopyChecksum",         RDS_LOG_CHECKSUM).toBool();
+    infoCopyVerify         =settings.value("General/CopyVerify",           false).toBool();
 
     netMode                =settings.value("Network/Mode",                 NETWORKMODE_DRIVE).toInt();
     netDriveBasepath       =settings.value("Network/DriveBasepath",        "").toString();
@@ -55,6 +55,10 @@ public:
 
     int     infoRAIDTimeout;
     int     infoCopyTimeout;
+    bool    infoPipelinedUpdate;
+    int     infoCopyBufferSize;
+    bool    infoCopyChecksum;
+    bool    infoCopyVerify;
 
     int     netMode;
     QString netDriveBasepath;
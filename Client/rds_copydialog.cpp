@@ -1,5 +1,6 @@
 #include "rds_copydialog.h"
 #include "ui_rds_copydialog.h"
+#include "rds_copyengine.h"
 
 #include <QDesktopWidget>
 
@@ -21,9 +22,32 @@ rdsCopyDialog::rdsCopyDialog(QWidget *parent) :
 
     setGeometry(QStyle::alignedRect(Qt::LeftToRight, Qt::AlignRight | Qt::AlignBottom, size(), qApp->primaryScreen()->availableGeometry()));
 
+    // Show the progress of the copy operation running in the background
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    progressTimer.start(RDS_COPY_PROGRESSINTERVAL);
 }
 
 rdsCopyDialog::~rdsCopyDialog()
 {
     delete ui;
 }
+
+
+void rdsCopyDialog::updateProgress()
+{
+    int     permille=0;
+    QString progressText="";
+
+    // Show the busy indicator if no file is being copied at the moment
+    if (!rdsCopyEngine::getActiveProgress(permille, progressText))
+    {
+        ui->progressBar->setMaximum(0);
+        ui->progressBar->setTextVisible(false);
+        return;
+    }
+
+    ui->progressBar->setMaximum(1000);
+    ui->progressBar->setValue(permille);
+    ui->progressBar->setFormat(progressText);
+    ui->progressBar->setTextVisible(true);
+}
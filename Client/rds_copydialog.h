@@ -18,6 +18,11 @@ public:
 
 private:
     Ui::rdsCopyDialog *ui;
+
+    QTimer progressTimer;
+
+private slots:
+    void updateProgress();
 };
 
 #endif // RDS_COPYDIALOG_H
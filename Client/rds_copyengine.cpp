@@ -0,0 +1,509 @@
+#include "rds_copyengine.h"
+#include "rds_checksum.h"
+
+
+// Progress of the copy operation that is currently running. Only one file is copied
+// at a time, so that a single record is sufficient for the copy dialogs.
+class rdsCopyProgress
+{
+public:
+    rdsCopyProgress()
+    {
+        bytesCopied=0;
+        totalBytes=0;
+        throughput=0;
+    }
+
+    QMutex mutex;
+    qint64 bytesCopied;
+    qint64 totalBytes;
+    double throughput;
+};
+
+Q_GLOBAL_STATIC(rdsCopyProgress, activeProgress)
+
+
+// Reads the source file block by block into two alternating buffers. The
+// semaphores hand the buffers between the reader and the writing thread.
+class rdsCopyReader : public QThread
+{
+public:
+    rdsCopyReader(QFile* sourceFile, QByteArray* readBuffers, qint64 size);
+
+    void run();
+
+    QFile*      file;
+    QByteArray* buffers;
+    qint64      blockSize;
+    qint64      lengths[2];
+
+    QSemaphore  freeBuffers;
+    QSemaphore  usedBuffers;
+    QAtomicInt  abort;
+
+    QFile::FileError error;
+    QString          errorString;
+};
+
+
+rdsCopyReader::rdsCopyReader(QFile* sourceFile, QByteArray* readBuffers, qint64 size)
+    : QThread(), freeBuffers(2), usedBuffers(0), abort(0)
+{
+    file=sourceFile;
+    buffers=readBuffers;
+    blockSize=size;
+    lengths[0]=0;
+    lengths[1]=0;
+    error=QFile::NoError;
+    errorString="";
+}
+
+
+void rdsCopyReader::run()
+{
+    int index=0;
+
+    while (true)
+    {
+        freeBuffers.acquire();
+
+        if (abort.load())
+        {
+            return;
+        }
+
+        // A length of 0 indicates the end of the file, -1 a read error
+        qint64 length=file->read(buffers[index].data(), blockSize);
+
+        if (length<0)
+        {
+            error=file->error();
+            errorString=file->errorString();
+        }
+
+        lengths[index]=length;
+        usedBuffers.release();
+
+        if (length<=0)
+        {
+            return;
+        }
+
+        index=1-index;
+    }
+}
+
+
+
+rdsCopyEngine::rdsCopyEngine()
+    : hash(QCryptographicHash::Md5)
+{
+    bufferSize=RDS_COPY_BUFFERSIZE;
+    resume=true;
+    retries=RDS_COPY_RETRIES;
+    attempts=0;
+    checksum=false;
+    verify=false;
+    digest="";
+    sidecarWritten=false;
+
+    bytesCopied=0;
+    totalBytes=0;
+    resumedBytes=0;
+    streamedBytes=0;
+
+    error=QFile::NoError;
+    errorString="";
+
+    canceled=0;
+}
+
+
+void rdsCopyEngine::cancel()
+{
+    canceled.storeRelease(1);
+}
+
+
+bool rdsCopyEngine::copy(QString sourceName, QString destName)
+{
+    QString partName=destName+RDS_COPY_PARTIAL_EXT;
+
+    attempts=0;
+    error=QFile::NoError;
+    errorString="";
+    digest="";
+    sidecarWritten=false;
+
+    bool success=false;
+
+    while ((!success) && (attempts<retries) && (!canceled.loadAcquire()))
+    {
+        // If the network connection dropped, give it some time to recover
+        if (attempts>0)
+        {
+            QThread::msleep(RDS_COPY_RETRYDELAY);
+        }
+
+        // Repeated attempts always continue with the data written before
+        success=copyAttempt(sourceName, partName, (resume) || (attempts>0));
+        attempts++;
+    }
+
+    {
+        QMutexLocker locker(&activeProgress()->mutex);
+        activeProgress()->bytesCopied=0;
+        activeProgress()->totalBytes=0;
+        activeProgress()->throughput=0;
+    }
+
+    if (canceled.loadAcquire())
+    {
+        setError(QFile::AbortError, "Copy operation canceled");
+        return false;
+    }
+
+    if (!success)
+    {
+        return false;
+    }
+
+    // Make the file visible under the final name
+    if (!QFile::rename(partName, destName))
+    {
+        setError(QFile::RenameError, "Unable to rename partial file " + partName);
+        return false;
+    }
+
+    // Store the checksum next to the file, so that it can be verified later
+    // without reading the source again
+    if (checksum)
+    {
+        sidecarWritten=rdsChecksum::writeSidecar(destName, digest);
+    }
+
+    return true;
+}
+
+
+bool rdsCopyEngine::copyAttempt(QString sourceName, QString partName, bool resumePartial)
+{
+    // Unbuffered mode avoids that QFile splits the large blocks into small chunks
+    QFile sourceFile(sourceName);
+
+    if (!sourceFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        setError(sourceFile.error(), sourceFile.errorString());
+        return false;
+    }
+
+    QFile destFile(partName);
+    qint64 offset=0;
+
+    hash.reset();
+
+    if ((resumePartial) && (destFile.exists()))
+    {
+        if (!destFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+        {
+            setError(destFile.error(), destFile.errorString());
+            return false;
+        }
+
+        offset=findValidPrefix(&sourceFile, &destFile);
+
+        if (offset<0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (!destFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+        {
+            setError(destFile.error(), destFile.errorString());
+            return false;
+        }
+    }
+
+    // Discard everything behind the verified part of the partial file
+    if ((!destFile.resize(offset)) || (!sourceFile.seek(offset)) || (!destFile.seek(offset)))
+    {
+        setError(destFile.error(), destFile.errorString());
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&progressMutex);
+        totalBytes=sourceFile.size();
+        resumedBytes=offset;
+        bytesCopied=offset;
+        streamedBytes=0;
+        streamTimer.start();
+    }
+
+    bool success=streamData(&sourceFile, &destFile);
+    destFile.close();
+
+    if ((success) && (QFileInfo(partName).size()!=getTotalBytes()))
+    {
+        setError(QFile::WriteError, "Size of partial file does not match source");
+        success=false;
+    }
+
+    if ((success) && (checksum))
+    {
+        digest=QString(hash.result().toHex());
+
+        if (verify)
+        {
+            success=verifyCopy(partName);
+        }
+    }
+
+    return success;
+}
+
+
+bool rdsCopyEngine::verifyCopy(QString partName)
+{
+    // Read the written data back from the destination and compare with the
+    // checksum calculated while streaming
+    if (rdsChecksum::getChecksum(partName)==digest)
+    {
+        return true;
+    }
+
+    setError(QFile::ReadError, "Checksum of copied file does not match source");
+
+    // Start over with the next attempt, as it is unknown which part is corrupted
+    QFile::remove(partName);
+    digest="";
+
+    return false;
+}
+
+
+qint64 rdsCopyEngine::findValidPrefix(QFile* source, QFile* dest)
+{
+    qint64 length=qMin(source->size(), dest->size());
+    qint64 offset=0;
+
+    QByteArray sourceBuffer(bufferSize, 0);
+    QByteArray destBuffer(bufferSize, 0);
+
+    // Compare the partial file block by block and continue after the last block
+    // that matches the source
+    while (offset<length)
+    {
+        qint64 blockLength=qMin(bufferSize, length-offset);
+
+        if ((source->read(sourceBuffer.data(), blockLength)!=blockLength)
+            || (dest->read(destBuffer.data(), blockLength)!=blockLength))
+        {
+            setError(QFile::ReadError, "Unable to read partial file for resuming");
+            return -1;
+        }
+
+        if (memcmp(sourceBuffer.constData(), destBuffer.constData(), blockLength)!=0)
+        {
+            break;
+        }
+
+        if (checksum)
+        {
+            hash.addData(sourceBuffer.constData(), blockLength);
+        }
+
+        offset+=blockLength;
+    }
+
+    return offset;
+}
+
+
+bool rdsCopyEngine::streamData(QFile* source, QFile* dest)
+{
+    QByteArray buffers[2];
+    buffers[0].resize(bufferSize);
+    buffers[1].resize(bufferSize);
+
+    rdsCopyReader reader(source, buffers, bufferSize);
+    reader.start();
+
+    bool success=true;
+    int  index=0;
+
+    while (true)
+    {
+        reader.usedBuffers.acquire();
+        qint64 length=reader.lengths[index];
+
+        if (canceled.loadAcquire())
+        {
+            setError(QFile::AbortError, "Copy operation canceled");
+            success=false;
+            break;
+        }
+
+        if (length<0)
+        {
+            setError(reader.error, reader.errorString);
+            success=false;
+            break;
+        }
+
+        if (length==0)
+        {
+            break;
+        }
+
+        if (dest->write(buffers[index].constData(), length)!=length)
+        {
+            setError(dest->error(), dest->errorString());
+            success=false;
+            break;
+        }
+
+        if (checksum)
+        {
+            hash.addData(buffers[index].constData(), length);
+        }
+
+        updateProgress(length);
+
+        reader.freeBuffers.release();
+        index=1-index;
+    }
+
+    // Wake up the reader if it is waiting for a buffer
+    if (!success)
+    {
+        reader.abort.store(1);
+        reader.freeBuffers.release(2);
+    }
+
+    reader.wait();
+
+    return success;
+}
+
+
+void rdsCopyEngine::setError(QFile::FileError fileError, QString fileErrorString)
+{
+    error=fileError;
+    errorString=fileErrorString;
+}
+
+
+void rdsCopyEngine::updateProgress(qint64 bytes)
+{
+    qint64 copied=0;
+    qint64 total=0;
+    double rate=0;
+
+    {
+        QMutexLocker locker(&progressMutex);
+        bytesCopied+=bytes;
+        streamedBytes+=bytes;
+        copied=bytesCopied;
+        total=totalBytes;
+    }
+
+    rate=getThroughput();
+
+    QMutexLocker locker(&activeProgress()->mutex);
+    activeProgress()->bytesCopied=copied;
+    activeProgress()->totalBytes=total;
+    activeProgress()->throughput=rate;
+}
+
+
+qint64 rdsCopyEngine::getBytesCopied()
+{
+    QMutexLocker locker(&progressMutex);
+    return bytesCopied;
+}
+
+
+qint64 rdsCopyEngine::getTotalBytes()
+{
+    QMutexLocker locker(&progressMutex);
+    return totalBytes;
+}
+
+
+qint64 rdsCopyEngine::getResumedBytes()
+{
+    QMutexLocker locker(&progressMutex);
+    return resumedBytes;
+}
+
+
+double rdsCopyEngine::getThroughput()
+{
+    QMutexLocker locker(&progressMutex);
+
+    if (!streamTimer.isValid())
+    {
+        return 0;
+    }
+
+    // Bytes per second for the data streamed in the last attempt, without the resumed part
+    qint64 elapsed=qMax(streamTimer.elapsed(), (qint64) 1);
+    return double(streamedBytes)*1000.0/double(elapsed);
+}
+
+
+void rdsCopyEngine::getActiveProgress(qint64& bytesCopied, qint64& totalBytes, double& throughput)
+{
+    QMutexLocker locker(&activeProgress()->mutex);
+    bytesCopied=activeProgress()->bytesCopied;
+    totalBytes =activeProgress()->totalBytes;
+    throughput =activeProgress()->throughput;
+}
+
+
+bool rdsCopyEngine::getActiveProgress(int& permille, QString& progressText)
+{
+    qint64 bytesCopied=0;
+    qint64 totalBytes=0;
+    double throughput=0;
+
+    getActiveProgress(bytesCopied, totalBytes, throughput);
+
+    // No file is being copied at the moment
+    if (totalBytes<=0)
+    {
+        permille=0;
+        progressText="";
+        return false;
+    }
+
+    permille=int(bytesCopied*1000/totalBytes);
+    progressText="%p%  " + formatThroughput(throughput);
+    return true;
+}
+
+
+QString rdsCopyEngine::getTransferData()
+{
+    return formatTransferData(getTotalBytes(), getResumedBytes(), getAttempts(), getThroughput());
+}
+
+
+QString rdsCopyEngine::formatTransferData(qint64 size, qint64 resumedBytes, int attempts, double throughput)
+{
+    return QString("<data>") +
+         "<size>"       + QString::number(size)+"</size>" +
+         "<resumed>"    + QString::number(resumedBytes)+"</resumed>" +
+         "<attempts>"   + QString::number(attempts)+"</attempts>" +
+         "<throughput>" + QString::number(qint64(throughput))+"</throughput>" +
+         "</data>";
+}
+
+
+QString rdsCopyEngine::formatThroughput(double bytesPerSec)
+{
+    return QString::number(bytesPerSec/1048576.0, 'f', 1) + " MB/s";
+}
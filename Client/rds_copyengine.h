@@ -0,0 +1,153 @@
+#ifndef RDS_COPYENGINE_H
+#define RDS_COPYENGINE_H
+
+#include <QtCore>
+
+#define RDS_COPY_BUFFERSIZE  8388608
+#define RDS_COPY_RETRIES     3
+#define RDS_COPY_RETRYDELAY  5000
+#define RDS_COPY_PARTIAL_EXT ".part"
+#define RDS_COPY_PROGRESSINTERVAL 1000
+
+
+// Streaming file copy with two buffers, so that reading the next block from the
+// source overlaps with writing the current block to the destination. The data is
+// written into a partial file that is renamed when complete. If a partial file from
+// an earlier attempt exists, its content is compared with the source and the copy
+// continues after the last matching block. Optionally, the MD5 checksum is calculated
+// from the same data while streaming.
+class rdsCopyEngine
+{
+public:
+    rdsCopyEngine();
+
+    bool copy(QString sourceName, QString destName);
+
+    void setBufferSize(qint64 size);
+    void setResume(bool enabled);
+    void setRetries(int count);
+    void setChecksum(bool enabled);
+    void setVerify(bool enabled);
+
+    // Can be called from another thread to stop the copy operation. The partial
+    // file is kept, so that the transfer can be resumed later.
+    void cancel();
+
+    qint64 getBytesCopied();
+    qint64 getTotalBytes();
+    qint64 getResumedBytes();
+    double getThroughput();
+    int    getAttempts();
+
+    QString getChecksum();
+    bool    isSidecarWritten();
+
+    // Details of the finished copy operation for the log server
+    QString getTransferData();
+    static QString formatTransferData(qint64 size, qint64 resumedBytes, int attempts, double throughput);
+
+    QFile::FileError getError();
+    QString getErrorString();
+
+    // Progress of the copy operation that is currently running in the application
+    static void getActiveProgress(qint64& bytesCopied, qint64& totalBytes, double& throughput);
+    static bool getActiveProgress(int& permille, QString& progressText);
+    static QString formatThroughput(double bytesPerSec);
+
+protected:
+
+    bool copyAttempt(QString sourceName, QString partName, bool resumePartial);
+    qint64 findValidPrefix(QFile* source, QFile* dest);
+    bool streamData(QFile* source, QFile* dest);
+
+    bool verifyCopy(QString partName);
+
+    void setError(QFile::FileError error, QString errorString);
+    void updateProgress(qint64 bytes);
+
+    qint64 bufferSize;
+    bool   resume;
+    int    retries;
+    int    attempts;
+    bool   checksum;
+    bool   verify;
+
+    QCryptographicHash hash;
+    QString            digest;
+    bool               sidecarWritten;
+
+    QMutex        progressMutex;
+    qint64        bytesCopied;
+    qint64        totalBytes;
+    qint64        resumedBytes;
+    qint64        streamedBytes;
+    QElapsedTimer streamTimer;
+
+    QFile::FileError error;
+    QString errorString;
+
+    QAtomicInt canceled;
+};
+
+
+inline void rdsCopyEngine::setBufferSize(qint64 size)
+{
+    bufferSize=qMax(size, (qint64) 65536);
+}
+
+
+inline void rdsCopyEngine::setResume(bool enabled)
+{
+    resume=enabled;
+}
+
+
+inline void rdsCopyEngine::setRetries(int count)
+{
+    retries=qMax(count, 1);
+}
+
+
+inline void rdsCopyEngine::setChecksum(bool enabled)
+{
+    checksum=enabled;
+}
+
+
+inline void rdsCopyEngine::setVerify(bool enabled)
+{
+    verify=enabled;
+}
+
+
+inline int rdsCopyEngine::getAttempts()
+{
+    return attempts;
+}
+
+
+inline QString rdsCopyEngine::getChecksum()
+{
+    return digest;
+}
+
+
+inline bool rdsCopyEngine::isSidecarWritten()
+{
+    return sidecarWritten;
+}
+
+
+inline QFile::FileError rdsCopyEngine::getError()
+{
+    return error;
+}
+
+
+inline QString rdsCopyEngine::getErrorString()
+{
+    return errorString;
+}
+
+
+#endif // RDS_COPYENGINE_H
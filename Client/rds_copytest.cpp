@@ -0,0 +1,171 @@
+#include <QtCore>
+#include <stdio.h>
+
+#include "rds_copyengine.h"
+
+
+// Test of the copy engine behavior that the background transfer of the pipelined
+// update relies on: a copy that is canceled after a timeout must not appear under the
+// final name, and the partial file must be resumed when the file is transferred again.
+// The scan file is exported with the RaidSimulator, like in the simulation mode of RDS.
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+static bool exportScan(QString simulatorPath, QString filename)
+{
+    QProcess simulator;
+    simulator.start(simulatorPath, QStringList() << "-m" << "-o" << filename);
+
+    if ((!simulator.waitForFinished(60000)) || (!QFile::exists(filename)))
+    {
+        printf("Unable to export scan with %s\n", qPrintable(simulatorPath));
+        return false;
+    }
+
+    return true;
+}
+
+
+static bool sameContent(QString filenameA, QString filenameB)
+{
+    QFile fileA(filenameA);
+    QFile fileB(filenameB);
+
+    if ((!fileA.open(QIODevice::ReadOnly)) || (!fileB.open(QIODevice::ReadOnly)))
+    {
+        return false;
+    }
+
+    return (fileA.readAll()==fileB.readAll());
+}
+
+
+class rdsCopyTestThread : public QThread
+{
+public:
+    void run()
+    {
+        success=engine.copy(sourceName, destName);
+    }
+
+    QString       sourceName;
+    QString       destName;
+    bool          success;
+    rdsCopyEngine engine;
+};
+
+
+int testCanceledCopy(QString sourceName, QDir targetDir)
+{
+    printf("Canceled copy\n");
+
+    QString destName=targetDir.absoluteFilePath("canceled.dat");
+
+    rdsCopyTestThread copyThread;
+    copyThread.sourceName=sourceName;
+    copyThread.destName=destName;
+    copyThread.success=true;
+    copyThread.engine.setRetries(1);
+
+    // Cancel before the first block, as it happens when the timeout has passed
+    copyThread.engine.cancel();
+    copyThread.start();
+    copyThread.wait();
+
+    check(!copyThread.success,                             "Copy reports failure");
+    check(copyThread.engine.getError()==QFile::AbortError, "Error is abort");
+    check(!QFile::exists(destName),                        "No file under final name");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testResumedCopy(QString sourceName, QDir targetDir)
+{
+    printf("Resumed copy after timeout\n");
+
+    QString destName=targetDir.absoluteFilePath("resumed.dat");
+    QString partName=destName+RDS_COPY_PARTIAL_EXT;
+
+    // Partial file as left by the abandoned copy thread
+    QFile source(sourceName);
+    QFile part(partName);
+    source.open(QIODevice::ReadOnly);
+    part.open(QIODevice::WriteOnly);
+    part.write(source.read(source.size()/2));
+    part.close();
+    source.close();
+
+    rdsCopyEngine engine;
+    engine.setBufferSize(65536);
+    engine.setResume(true);
+
+    bool success=engine.copy(sourceName, destName);
+
+    check(success,                                "Copy succeeds");
+    check(engine.getResumedBytes()>0,             "Partial file has been resumed");
+    check(!QFile::exists(partName),               "Partial file has been renamed");
+    check(sameContent(sourceName, destName),      "Content matches exported scan");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    printf("\nYarra RDS - Copy Engine Test\n");
+    printf("----------------------------\n\n");
+
+    QString simulatorPath=QDir(app.applicationDirPath()).filePath("RaidSimulator");
+
+    if (argc>1)
+    {
+        simulatorPath=QString(argv[1]);
+    }
+
+    QTemporaryDir tempDir;
+
+    if (!tempDir.isValid())
+    {
+        printf("Unable to create temporary folder\n");
+        return 1;
+    }
+
+    QDir targetDir(tempDir.path());
+    targetDir.mkdir("network");
+    QString sourceName=targetDir.absoluteFilePath("meas_MID00300_FID05100.dat");
+
+    if (!exportScan(simulatorPath, sourceName))
+    {
+        return 1;
+    }
+
+    targetDir.cd("network");
+
+    testCanceledCopy(sourceName, targetDir);
+    testResumedCopy(sourceName, targetDir);
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Test of the copy engine with a scan exported by the RaidSimulator
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rds_copytest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += rds_copytest.cpp \
+    rds_copyengine.cpp \
+    rds_checksum.cpp
+
+HEADERS += \
+    rds_copyengine.h \
+    rds_checksum.h
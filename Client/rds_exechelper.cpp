@@ -1,14 +1,12 @@
 #include <QTimer>
 
 #include "rds_exechelper.h"
+#include "rds_processrunner.h"
 #include "rds_global.h"
 
 
 rdsExecHelper::rdsExecHelper()
 {
-    process.setReadChannel(QProcess::StandardOutput);
-    process.setProcessChannelMode(QProcess::MergedChannels);
-
     timeoutMs=RDS_PROC_TIMEOUT;
     output.clear();
 
@@ -17,7 +15,7 @@ rdsExecHelper::rdsExecHelper()
     monitorNetUseOutput  =false;
     detectedNetUseError  =false;
     detectedNetUseSuccess=false;
-    detectedNetUseError="";
+    detectedNetUseErrorMessage="";
 
     exitCode=1;
 }
@@ -35,112 +33,33 @@ bool rdsExecHelper::run(QString cmdLine, QString nativeArguments)
     output.clear();
     exitCode = 1;
 
-    QProcess *myProcess=new QProcess(0);
-    myProcess->setReadChannel(QProcess::StandardOutput);
-
-    bool success=false;
+    rdsProcessRunner runner;
+    runner.setTimeout(timeoutMs);
+    runner.setNativeArguments(nativeArguments);
 
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(timeoutMs);
-    QEventLoop q;
-    QObject::connect(myProcess, SIGNAL(finished(int, QProcess::ExitStatus)), &q, SLOT(quit()));
-    QObject::connect(&timeoutTimer, SIGNAL(timeout()), &q, SLOT(quit()));
+    // Collect the output lines while the process is running
+    runner.setLineHandler([this](const QByteArray& line)
+    {
+        output << QString::fromUtf8(line);
+        return true;
+    });
 
-    // Time measurement to diagnose RaidTool calling problems
-    QElapsedTimer ti;
-    ti.start();
-    timeoutTimer.start();
-    if (!nativeArguments.isEmpty()){
-        myProcess->setNativeArguments(nativeArguments);
-    }
-//    else {
-//        myProcess->start(cmdLine, arguments);
-//    }
-    myProcess->start(cmdLine);
+    bool success=runner.run(cmdLine);
 
-    if (myProcess->state()==QProcess::NotRunning)
+    if (runner.isStartError())
     {
-        delete myProcess;
-        myProcess=0;
         RTI->log("ERROR: Process did not start - '" + cmdLine + "'");
         return false;
     }
-    else
-    {
-        q.exec();
-    }
-
-    // Check for problems with the event loop: Sometimes it seems to return to quickly!
-    // In this case, start a second while loop to check when the process is really finished.
-    if ((timeoutTimer.isActive()) && (myProcess->state()==QProcess::Running))
-    {
-        timeoutTimer.stop();
-        RTI->log("Warning: QEventLoop returned too early. Starting secondary loop.");
-        while ((myProcess->state()==QProcess::Running) && (ti.elapsed()<timeoutMs))
-        {
-            RTI->processEvents();
-            Sleep(RDS_SLEEP_INTERVAL);
-        }
-
-        // If the process did not finish within the timeout duration
-        if (myProcess->state()==QProcess::Running)
-        {
-            RTI->log("Warning: Process is still active. Killing process.");
-            myProcess->kill();
-            success=false;
-        }
-        else
-        {
-            success=true;
-        }
-    }
-    else
-    {
-        // Normal timeout-handling if QEventLoop works normally
-        if (timeoutTimer.isActive())
-        {
-            success=true;
-            timeoutTimer.stop();
-        }
-        else
-        {
-            RTI->log("Warning: Process event loop timed out.");
-            RTI->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms");
-            success=false;
-            if (myProcess->state()==QProcess::Running)
-            {
-                RTI->log("Warning: Process is still active. Killing process.");
-                myProcess->kill();
-            }
-        }
-    }
 
-    exitCode = myProcess->exitCode();
+    exitCode = runner.getExitCode();
 
     if (!success)
     {
         // The process timeed out. Probably some error occured.
+        RTI->log("Warning: Duration since start "+QString::number(runner.getDuration())+" ms");
         RTI->log("ERROR: Timeout during cmd execution!");
     }
-    else
-    {
-        // Read the output lines from the process and store in string list
-        char buf[1024];
-        qint64 lineLength = -1;
-
-        do
-        {
-            lineLength=myProcess->readLine(buf, sizeof(buf));
-            if (lineLength != -1)
-            {
-                output << QString(buf);
-            }
-        } while (lineLength!=-1);
-    }
-
-    delete myProcess;
-    myProcess=0;
 
     return success;
 }
@@ -148,87 +67,42 @@ bool rdsExecHelper::run(QString cmdLine, QString nativeArguments)
 
 bool rdsExecHelper::callNetUseTimout(int timeoutMs)
 {
-    bool success=false;
     exitCode=1;
+    detectedNetUseError  =false;
+    detectedNetUseSuccess=false;
     detectedNetUseErrorMessage="";
 
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(timeoutMs);
-
-    QEventLoop q;
-    connect(&process, SIGNAL(finished(int , QProcess::ExitStatus)), &q, SLOT(quit()));
-    connect(&process, SIGNAL(error(QProcess::ProcessError)), &q, SLOT(quit()));
-    connect(&timeoutTimer, SIGNAL(timeout()), &q, SLOT(quit()));
+    rdsProcessRunner runner;
+    runner.setTimeout(timeoutMs);
+    runner.setMergedChannels();
 
     if (monitorNetUseOutput)
     {
-        connect(&process, SIGNAL(readyReadStandardOutput()), this, SLOT(readNetUseOutput()));
+        runner.setLineHandler([this](const QByteArray& line)
+        {
+            checkNetUseOutput(QString::fromLocal8Bit(line));
+            return true;
+        });
     }
 
-    // Time measurement to diagnose RaidTool calling problems
-    QElapsedTimer ti;
-    ti.start();
-    timeoutTimer.start();
-
     // Start the process. Note: The commandline and arguments need to be defined before.
-    process.start(cmdLine);
-    if (process.state()==QProcess::Running)
-    {
-        q.exec();
-    }
+    bool success=runner.run(cmdLine);
 
-    // Check for problems with the event loop: Sometimes it seems to return to quickly!
-    // In this case, start a second while loop to check when the process is really finished.
-    if ((timeoutTimer.isActive()) && (process.state()==QProcess::Running))
+    if (runner.isStartError())
     {
-        timeoutTimer.stop();
-        RTI->log("Warning: QEventLoop returned too early. Starting secondary loop.");
-        while ((process.state()==QProcess::Running) && (ti.elapsed()<timeoutMs))
-        {
-            RTI->processEvents();
-            Sleep(RDS_SLEEP_INTERVAL);
-        }
-
-        // If the process did not finish within the timeout duration
-        if (process.state()==QProcess::Running)
-        {
-            RTI->log("Warning: Process is still active. Killing process.");
-            process.kill();
-            success=false;
-        }
-        else
-        {
-            success=true;
-        }
+        RTI->log("ERROR: Process did not start - '" + cmdLine + "'");
+        return false;
     }
-    else
+
+    if (!success)
     {
-        // Normal timeout-handling if QEventLoop works normally
-        if (timeoutTimer.isActive())
-        {
-            success=true;
-            timeoutTimer.stop();
-        }
-        else
-        {
-            RTI->log("Warning: Process event loop timed out.");
-            RTI->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms");
-            success=false;
-            if (process.state()==QProcess::Running)
-            {
-                RTI->log("Warning: Process is still active. Killing process.");
-                process.kill();
-            }
-        }
+        RTI->log("Warning: Process timed out after "+QString::number(runner.getDuration())+" ms");
     }
 
-    exitCode=process.exitCode();
+    exitCode=runner.getExitCode();
 
     if (monitorNetUseOutput)
     {
-        readNetUseOutput();
-
         if (detectedNetUseSuccess)
         {
             success=true;
@@ -243,36 +117,30 @@ bool rdsExecHelper::callNetUseTimout(int timeoutMs)
 }
 
 
-void rdsExecHelper::readNetUseOutput()
+void rdsExecHelper::checkNetUseOutput(QString currentLine)
 {
-    detectedNetUseError  =false;
-    detectedNetUseSuccess=false;
+    // Restrict the maximum length to 512 chars to avoid infinite output (if a module
+    // starts outputting binary data)
+    currentLine.truncate(512);
 
-    while (process.canReadLine())
+    // Mapping or deletion sucessfull
+    if (currentLine.contains("successfully."))
     {
-        // Read the current line, but restrict the maximum length to 512 chars to
-        // avoid infinite output (if a module starts outputting binary data)
-        QString currentLine=process.readLine(512);
-
-        // Mapping or deletion sucessfull
-        if (currentLine.contains("successfully."))
-        {
-            detectedNetUseSuccess=true;
-        }
+        detectedNetUseSuccess=true;
+    }
 
-        // Deletion of non-existing mapping --> Treated as success
-        if (currentLine.contains("The network connection could not be found."))
-        {
-            detectedNetUseSuccess=true;
-        }
+    // Deletion of non-existing mapping --> Treated as success
+    if (currentLine.contains("The network connection could not be found."))
+    {
+        detectedNetUseSuccess=true;
+    }
 
-        // Error caused, either by mapping of deletion
-        if (currentLine.contains("System error"))
-        {
-            detectedNetUseError=true;
-            RTI->log("Error detected: "+currentLine);
-            detectedNetUseErrorMessage=currentLine;
-        }
+    // Error caused, either by mapping of deletion
+    if (currentLine.contains("System error"))
+    {
+        detectedNetUseError=true;
+        RTI->log("Error detected: "+currentLine);
+        detectedNetUseErrorMessage=currentLine;
     }
 }
 
@@ -31,8 +31,6 @@ public:
     int getExitCode();
 
 private:
-    QProcess process;
-
     int      timeoutMs;
     QString  cmdLine;
     int      exitCode;
@@ -42,8 +40,7 @@ private:
     bool detectedNetUseSuccess;
     QString detectedNetUseErrorMessage;
 
-public slots:
-    void readNetUseOutput();
+    void checkNetUseOutput(QString currentLine);
 
 };
 
@@ -11,7 +11,6 @@
 #include "rds_exechelper.h"
 
 #ifdef YARRA_APP_RDS
-    #include "rds_checksum.h"
     #include "rds_copydialog.h"
 #endif
 
@@ -26,11 +25,30 @@ rdsNetwork::rdsNetwork()
     currentTimeStamp="";
 
     connectionActive=false;
+
+    backgroundThread=0;
+    backgroundBytes=0;
+    backgroundFileSize=0;
 }
 
 
 rdsNetwork::~rdsNetwork()
 {
+    // Don't dispose the copy thread while it might still be writing
+    if (backgroundThread!=0)
+    {
+        backgroundThread->wait();
+        delete backgroundThread;
+        backgroundThread=0;
+    }
+
+    // Also wait for copy threads that have been abandoned after a timeout
+    while (!abandonedThreads.isEmpty())
+    {
+        rdsCopyThread* abandonedThread=abandonedThreads.takeFirst();
+        abandonedThread->wait();
+        delete abandonedThread;
+    }
 }
 
 
@@ -170,6 +188,13 @@ bool rdsNetwork::transferFiles()
     bool success=true;
     for (int i=0; i<fileList.count(); i++)
     {
+        // Don't touch files that are still being written by a timed-out copy thread
+        if (isCopyAbandoned(fileList.at(i)))
+        {
+            RTI->log("Skipping file with pending background copy: " + fileList.at(i));
+            continue;
+        }
+
         success=getFileToProcess(i);
 
         //RTI->log("DBG: Read file info");
@@ -182,32 +207,13 @@ bool rdsNetwork::transferFiles()
 
         //RTI->log("DBG: Copied file");
 
-        // If sucessfull, verify if copied correctly
-        if (success)
-        {
-            success=verifyTransfer();
-        }
-
-        //RTI->log("DBG: Verified");
-
-        // If sucessfull, remove file from queue directory
-        if (success)
-        {
-            success=removeFile();
-        }
-
-        //RTI->log("DBG: Deleted file");
-        QString temp_filename = currentFilename;
-        releaseFile();
+        // Verify and remove the file from the queue directory if successful
+        finishTransfer(success);
 
         //RTI->log("DBG: Released file");
 
         RTI->processEvents();
 
-        if (!success) {
-            RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
-                         "Error transferring a file", temp_filename);
-        }
         //RTI->log("DBG: Processed events");
     }
 
@@ -247,7 +253,13 @@ bool rdsNetwork::getFileToProcess(int index)
         return false;
     }
 
-    currentFilename=fileList.at(index);
+    return setFileToProcess(fileList.at(index));
+}
+
+
+bool rdsNetwork::setFileToProcess(QString filename)
+{
+    currentFilename=filename;
     RTI->log("Transfering file " + currentFilename + "...");
 
     if (!queueDir.exists(currentFilename))
@@ -281,87 +293,17 @@ bool rdsNetwork::copyFile()
 {
     if (RTI_CONFIG->isNetworkModeDrive())
     {
-        // Check if protocol directory exists
-        if (!networkDrive.exists(currentProt))
-        {
-            if (!networkDrive.mkdir(currentProt))
-            {
-                RTI->log("Error: Creating protocol directory not possible: " + currentProt);
-                RTI->setSevereErrors(true);
-                RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
-                             "Creating protocol directory not possible", currentProt);
-                return false;
-            }
-        }
-
-        QString sourceName=queueDir.absoluteFilePath(currentFilename);
-        QString destName=networkDrive.absolutePath() + "/" + currentProt + "/" + currentFilename;
-        currentTimeStamp="";
+        QString sourceName="";
+        QString destName="";
 
-        // Check free diskspace on the network drive
-        QFileInfo srcinfo(sourceName);
-        qint64 diskSpace=RTI->getFreeDiskSpace(networkDrive.absolutePath());
-        RTI->debug("Disk space on netdrive = " + QString::number(diskSpace));
-        RTI->log("Size of source file is " + QString::number(srcinfo.size()));
-
-        if (srcinfo.size() > diskSpace)
+        if (!prepareCopy(sourceName, destName))
         {
-            RTI->log("ERROR: Not enough diskspace on network drive to transfer file.");
-            RTI->log("ERROR: File size = " + QString::number(srcinfo.size()));
-            RTI->log("ERROR: Remaining disk space = " + QString::number(diskSpace));
-            RTI->log("Canceling transfer.");
-            RTI->setSevereErrors(true);
-            RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::LowDiskSpace,EventInfo::Severity::FatalError,
-                         "Insufficient disk space on network drive");
             return false;
         }
 
-        if (QFile::exists(destName))
-        {
-            RTI->log("WARNING: File already exists in target folder: " + destName);
-
-            // Create a time stamp for copying the file under a different name
-            currentTimeStamp="_"+QDateTime::currentDateTime().toString("ddMMyyhhmmss");
-
-            // If a file also exists with this name, append ms to the time stamp
-            if (QFile::exists(destName+currentTimeStamp))
-            {
-                 currentTimeStamp="_"+QDateTime::currentDateTime().toString("ddMMyyhhmmsszzz");
-            }
+        int timeout=getCopyTimeout();
 
-            // If also this file exists, something must be wrong
-            if (QFile::exists(destName+currentTimeStamp))
-            {
-                RTI->log("ERROR: Unable to create unique filename: " + destName);
-                RTI->log("Something must be wrong with the file system.");
-                RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::FatalError,
-                             "Unable to create unique filename",destName);
-
-                return false;
-            }
-
-            // Add the time stamp to the file name
-            destName=destName+currentTimeStamp;
-            RTI->log("Appending time stamp to filename: " + destName);
-        }
-
-        int timeout=RDS_COPY_TIMEOUT;
-
-#ifdef YARRA_APP_RDS
-        // Calculate the MD5 checksum prior to copying to diagnose sporadic file corruptions.
-        if (RDS_LOG_CHECKSUM)
-        {
-            QString checksum=rdsChecksum::getChecksum(sourceName);
-            RTI->log("Local MD5 checksum is " + checksum);
-        }
-
-        // Overwrite the default timeout for the copy operation with a user setting (if not defined,
-        // it will just use the default value)
-        timeout=RTI_CONFIG->infoCopyTimeout;
-#endif
-
-        bool copyError=false;
-        QString fileError;
+        bool copySuccess=false;
         // Use separate copy thread and local event loop to keep the application
         // responsive while the data is transferred. This is very important because
         // otherwise problems might arise if the qsingleapplication interface
@@ -371,6 +313,7 @@ bool rdsNetwork::copyFile()
             rdsCopyThread copyThread;
             copyThread.sourceName=sourceName;
             copyThread.destName=destName;
+            configureCopy(&copyThread);
 
             QEventLoop q;
             connect(&copyThread, SIGNAL(finished()), &q, SLOT(quit()));
@@ -396,45 +339,172 @@ bool rdsNetwork::copyFile()
                 if (!copyThread.finishedCopy)
                 {
                     RTI->log("Error: Second copy wait loop timed out! Copying file failed.");
-                    copyError=true;
                 }
             }
 
-            if (copyThread.lockError)
-            {
-                RTI->log("Warning: Problems while creating/removing lock file for "+destName);
-                RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Warning,
-                             "Problems while creating/removing lock file for", destName);
-            }
-
-            copyError=!copyThread.success;
-            fileError = copyThread.fileErrorString;
+            copySuccess=evaluateCopy(&copyThread);
         }
 
-        //copyError=!QFile::copy(sourceName,destName);
+        return copySuccess;
+    }
+
+    return true;
+}
+
+
+int rdsNetwork::getCopyTimeout()
+{
+    int timeout=RDS_COPY_TIMEOUT;
+
+#ifdef YARRA_APP_RDS
+    // Overwrite the default timeout for the copy operation with a user setting (if not defined,
+    // it will just use the default value)
+    timeout=RTI_CONFIG->infoCopyTimeout;
+#endif
+
+    return timeout;
+}
+
 
-        if (copyError)
+bool rdsNetwork::prepareCopy(QString& sourceName, QString& destName)
+{
+    // Check if protocol directory exists
+    if (!networkDrive.exists(currentProt))
+    {
+        if (!networkDrive.mkdir(currentProt))
         {
-            RTI->log("Error: Error copying the file!");
-            RTI->log("Error: Source = " + sourceName);
-            RTI->log("Error: Destination = " + destName);
+            RTI->log("Error: Creating protocol directory not possible: " + currentProt);
             RTI->setSevereErrors(true);
+            RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
+                         "Creating protocol directory not possible", currentProt);
+            return false;
+        }
+    }
 
-            QString dataString=QString("<data>") + \
-                 "<filename>"  + currentFilename+"</filename>" +
-                 "<sourceName>"+ sourceName+"</sourceName>" +
-                 "<destName>"  + destName  +"</destName>" +
-                 "<fileError>" + fileError +"</fileError>" +
-                 "</data>";
+    sourceName=queueDir.absoluteFilePath(currentFilename);
+    destName=networkDrive.absolutePath() + "/" + currentProt + "/" + currentFilename;
+    currentTimeStamp="";
+
+    // Check free diskspace on the network drive
+    QFileInfo srcinfo(sourceName);
+    qint64 diskSpace=RTI->getFreeDiskSpace(networkDrive.absolutePath());
+    RTI->debug("Disk space on netdrive = " + QString::number(diskSpace));
+    RTI->log("Size of source file is " + QString::number(srcinfo.size()));
+
+    if (srcinfo.size() > diskSpace)
+    {
+        RTI->log("ERROR: Not enough diskspace on network drive to transfer file.");
+        RTI->log("ERROR: File size = " + QString::number(srcinfo.size()));
+        RTI->log("ERROR: Remaining disk space = " + QString::number(diskSpace));
+        RTI->log("Canceling transfer.");
+        RTI->setSevereErrors(true);
+        RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::LowDiskSpace,EventInfo::Severity::FatalError,
+                     "Insufficient disk space on network drive");
+        return false;
+    }
+
+    if (QFile::exists(destName))
+    {
+        RTI->log("WARNING: File already exists in target folder: " + destName);
+
+        // Create a time stamp for copying the file under a different name
+        currentTimeStamp="_"+QDateTime::currentDateTime().toString("ddMMyyhhmmss");
+
+        // If a file also exists with this name, append ms to the time stamp
+        if (QFile::exists(destName+currentTimeStamp))
+        {
+             currentTimeStamp="_"+QDateTime::currentDateTime().toString("ddMMyyhhmmsszzz");
+        }
+
+        // If also this file exists, something must be wrong
+        if (QFile::exists(destName+currentTimeStamp))
+        {
+            RTI->log("ERROR: Unable to create unique filename: " + destName);
+            RTI->log("Something must be wrong with the file system.");
+            RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::FatalError,
+                         "Unable to create unique filename",destName);
 
-            RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
-                         "Error copying file", dataString);
             return false;
         }
-        RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Success,
-                     currentFilename);
+
+        // Add the time stamp to the file name
+        destName=destName+currentTimeStamp;
+        RTI->log("Appending time stamp to filename: " + destName);
+    }
+
+    return true;
+}
+
+
+void rdsNetwork::configureCopy(rdsCopyThread* copyThread)
+{
+#ifdef YARRA_APP_RDS
+    copyThread->engine.setBufferSize(qint64(RTI_CONFIG->infoCopyBufferSize)*1048576);
+
+    // Calculate the MD5 checksum while copying to diagnose sporadic file corruptions.
+    // Verifying reads the copied file again and compares the checksums.
+    copyThread->engine.setChecksum((RTI_CONFIG->infoCopyChecksum) || (RTI_CONFIG->infoCopyVerify));
+    copyThread->engine.setVerify(RTI_CONFIG->infoCopyVerify);
+#else
+    Q_UNUSED(copyThread);
+#endif
+}
+
+
+bool rdsNetwork::evaluateCopy(rdsCopyThread* copyThread)
+{
+    QString sourceName=copyThread->sourceName;
+    QString destName=copyThread->destName;
+    QString fileError=copyThread->fileErrorString;
+
+    if (copyThread->lockError)
+    {
+        RTI->log("Warning: Problems while creating/removing lock file for "+destName);
+        RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Warning,
+                     "Problems while creating/removing lock file for", destName);
+    }
+
+    if (!copyThread->success)
+    {
+        RTI->log("Error: Error copying the file!");
+        RTI->log("Error: Source = " + sourceName);
+        RTI->log("Error: Destination = " + destName);
+        RTI->setSevereErrors(true);
+
+        QString dataString=QString("<data>") + \
+             "<filename>"  + currentFilename+"</filename>" +
+             "<sourceName>"+ sourceName+"</sourceName>" +
+             "<destName>"  + destName  +"</destName>" +
+             "<fileError>" + fileError +"</fileError>" +
+             "</data>";
+
+        RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
+                     "Error copying file", dataString);
+        return false;
+    }
+
+    double throughput=copyThread->engine.getThroughput();
+    qint64 resumedBytes=copyThread->engine.getResumedBytes();
+
+    if (resumedBytes>0)
+    {
+        RTI->log("Resumed transfer of partial file after " + QString::number(resumedBytes) + " bytes");
+    }
+    RTI->log("Transfer rate: " + rdsCopyEngine::formatThroughput(throughput));
+
+    if (!copyThread->engine.getChecksum().isEmpty())
+    {
+        RTI->log("Local MD5 checksum is " + copyThread->engine.getChecksum());
+
+        if (!copyThread->engine.isSidecarWritten())
+        {
+            RTI->log("Warning: Unable to write checksum file for " + destName);
+        }
     }
 
+    RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Success,
+                 currentFilename, copyThread->engine.getTransferData());
+
     return true;
 }
 
@@ -508,6 +578,203 @@ void rdsNetwork::releaseFile()
 }
 
 
+void rdsNetwork::finishTransfer(bool success)
+{
+    // If sucessfull, verify if copied correctly
+    if (success)
+    {
+        success=verifyTransfer();
+    }
+
+    // If sucessfull, remove file from queue directory
+    if (success)
+    {
+        success=removeFile();
+    }
+
+    QString temp_filename = currentFilename;
+    releaseFile();
+
+    if (!success) {
+        RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
+                     "Error transferring a file", temp_filename);
+    }
+}
+
+
+void rdsNetwork::queueBackgroundTransfer(QStringList files)
+{
+    for (int i=0; i<files.count(); i++)
+    {
+        QFileInfo fileInfo(queueDir, files.at(i));
+        backgroundBytes+=fileInfo.size();
+        backgroundFiles.append(files.at(i));
+    }
+
+    // Start copying right away if the worker is idle. Otherwise, the files will be
+    // picked up when the current copy operation has finished.
+    if (backgroundThread==0)
+    {
+        startNextBackgroundCopy();
+    }
+}
+
+
+bool rdsNetwork::isBackgroundTransferActive()
+{
+    return ((backgroundThread!=0) || (!backgroundFiles.isEmpty()));
+}
+
+
+qint64 rdsNetwork::getBackgroundTransferSize()
+{
+    return backgroundBytes;
+}
+
+
+void rdsNetwork::waitForBackgroundTransfer()
+{
+    // The copy operations are chained via the finished signal of the copy thread,
+    // so it is sufficient to keep the event loop running until the queue is empty
+    while (isBackgroundTransferActive())
+    {
+        RTI->processEvents();
+        checkBackgroundTimeout();
+        Sleep(RDS_SLEEP_INTERVAL);
+    }
+}
+
+
+void rdsNetwork::checkBackgroundTimeout()
+{
+    if ((backgroundThread==0) || (backgroundTimer.elapsed()<getCopyTimeout()))
+    {
+        return;
+    }
+
+    RTI->log("Error: Background copy timed out! Copying file failed: " + currentFilename);
+    RTI_NETLOG.postEvent(EventInfo::Type::RawDataStorage,EventInfo::Detail::FileTransfer,EventInfo::Severity::Error,
+                 "Background copy timed out", currentFilename);
+
+    // Stop the copy operation. If the thread is blocked by the network drive, it is
+    // left running until it returns. The file stays in the queue directory, but it is
+    // skipped by transferFiles() as long as the thread is running. Once the thread has
+    // returned, the file is transferred by a later update (resuming the partial file).
+    rdsCopyThread* abandonedThread=backgroundThread;
+    backgroundThread=0;
+
+    abandonedThread->engine.cancel();
+    disconnect(abandonedThread, SIGNAL(finished()), this, SLOT(backgroundCopyFinished()));
+    abandonedThreads.append(abandonedThread);
+
+    releaseFile();
+    backgroundBytes-=backgroundFileSize;
+    backgroundFileSize=0;
+
+    startNextBackgroundCopy();
+}
+
+
+void rdsNetwork::startNextBackgroundCopy()
+{
+    while (!backgroundFiles.isEmpty())
+    {
+        QString filename=backgroundFiles.takeFirst();
+        QFileInfo fileInfo(queueDir, filename);
+        qint64 fileSize=fileInfo.size();
+
+        if (isCopyAbandoned(filename))
+        {
+            RTI->log("Skipping file with pending background copy: " + filename);
+            backgroundBytes-=fileSize;
+            continue;
+        }
+
+        bool success=setFileToProcess(filename);
+
+        if ((success) && (RTI_CONFIG->isNetworkModeDrive()))
+        {
+            QString sourceName="";
+            QString destName="";
+
+            success=prepareCopy(sourceName, destName);
+
+            if (success)
+            {
+                // Copy the file in the worker thread and return. The transfer will be
+                // completed in backgroundCopyFinished() on the main thread, which
+                // keeps the logging and the NetLogger calls out of the worker.
+                backgroundThread=new rdsCopyThread();
+                backgroundThread->sourceName=sourceName;
+                backgroundThread->destName=destName;
+                configureCopy(backgroundThread);
+                backgroundFileSize=fileSize;
+                connect(backgroundThread, SIGNAL(finished()), this, SLOT(backgroundCopyFinished()), Qt::QueuedConnection);
+                backgroundTimer.start();
+                backgroundThread->start();
+                return;
+            }
+        }
+
+        // Nothing to copy in the background. Complete the file right away.
+        finishTransfer(success);
+        backgroundBytes-=fileSize;
+    }
+}
+
+
+void rdsNetwork::backgroundCopyFinished()
+{
+    // The signal of a thread that has been abandoned after a timeout might still be queued
+    if ((backgroundThread==0) || (sender()!=backgroundThread))
+    {
+        return;
+    }
+
+    // The finished signal is emitted right before the thread terminates
+    backgroundThread->wait();
+
+    bool success=evaluateCopy(backgroundThread);
+
+    delete backgroundThread;
+    backgroundThread=0;
+
+    finishTransfer(success);
+    backgroundBytes-=backgroundFileSize;
+    backgroundFileSize=0;
+
+    startNextBackgroundCopy();
+}
+
+
+bool rdsNetwork::isCopyAbandoned(QString filename)
+{
+    QString sourceName=queueDir.absoluteFilePath(filename);
+    bool abandoned=false;
+
+    // Dispose the abandoned threads that have returned in the meantime
+    for (int i=abandonedThreads.count()-1; i>=0; i--)
+    {
+        rdsCopyThread* abandonedThread=abandonedThreads.at(i);
+
+        if (abandonedThread->isFinished())
+        {
+            abandonedThreads.removeAt(i);
+            delete abandonedThread;
+        }
+        else
+        {
+            if (abandonedThread->sourceName==sourceName)
+            {
+                abandoned=true;
+            }
+        }
+    }
+
+    return abandoned;
+}
+
+
 bool rdsNetwork::checkExistance(QString filename)
 {
     int sepPos=filename.indexOf(RTI_SEPT_CHAR);
@@ -735,12 +1002,10 @@ void rdsCopyThread::run()
         lockFile.close();
     }
 
-    // Copy file
-    QFile sourceFile(sourceName);
-
-    success=sourceFile.copy(destName);
-    fileError=sourceFile.error();
-    fileErrorString=sourceFile.errorString();
+    // Copy file (resumes a partial file left by an interrupted transfer)
+    success=engine.copy(sourceName, destName);
+    fileError=engine.getError();
+    fileErrorString=engine.getErrorString();
 
     // Remove lock file
     if (!lockFile.remove())
@@ -6,6 +6,11 @@
 
 #include <../NetLogger/netlogger.h>
 
+#include "rds_copyengine.h"
+
+
+class rdsCopyThread;
+
 
 class rdsNetwork : public QObject
 {
@@ -30,10 +35,19 @@ public:
     int getQueueCount();
 
     bool getFileToProcess(int index);
+    bool setFileToProcess(QString filename);
     bool copyFile();
     bool verifyTransfer();
     bool removeFile();
     void releaseFile();
+    void finishTransfer(bool success);
+
+    // Pipelined transfer (files are copied while the next scan is exported)
+    void   queueBackgroundTransfer(QStringList files);
+    bool   isBackgroundTransferActive();
+    qint64 getBackgroundTransferSize();
+    void   waitForBackgroundTransfer();
+    void   checkBackgroundTimeout();
 
     QString getConfigFileData();
     QString getLogFileData(int lines);
@@ -46,8 +60,18 @@ public:
 
     NetLogger netLogger;
 
+protected slots:
+    void backgroundCopyFinished();
+
 private:
 
+    int  getCopyTimeout();
+    bool prepareCopy(QString& sourceName, QString& destName);
+    void configureCopy(rdsCopyThread* copyThread);
+    bool evaluateCopy(rdsCopyThread* copyThread);
+    void startNextBackgroundCopy();
+    bool isCopyAbandoned(QString filename);
+
     QDir queueDir;
     bool connectionActive;
 
@@ -59,6 +83,14 @@ private:
     QString currentTimeStamp;
 
     QDir networkDrive;
+
+    QStringList    backgroundFiles;
+    qint64         backgroundBytes;
+    qint64         backgroundFileSize;
+    rdsCopyThread* backgroundThread;
+    QElapsedTimer  backgroundTimer;
+
+    QList<rdsCopyThread*> abandonedThreads;
 };
 
 
@@ -84,6 +116,8 @@ public:
     bool finishedCopy;
     QFile::FileError fileError;
     QString fileErrorString;
+
+    rdsCopyEngine engine;
 };
 
 
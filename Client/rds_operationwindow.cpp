@@ -1,5 +1,6 @@
 #include "rds_operationwindow.h"
 #include "rds_configurationwindow.h"
+#include "rds_copyengine.h"
 #include "ui_rds_operationwindow.h"
 
 #include "rds_global.h"
@@ -163,6 +164,18 @@ rdsOperationWindow::rdsOperationWindow(QWidget *parent, bool isFirstRun) :
         {
             log.log("Using custom timeout for network copy: "+QString::number(RTI_CONFIG->infoCopyTimeout)+" ms");
         }
+        if (RTI_CONFIG->infoCopyBufferSize!=RDS_COPY_BUFFERSIZE/1048576)
+        {
+            log.log("Using custom buffer size for network copy: "+QString::number(RTI_CONFIG->infoCopyBufferSize)+" MB");
+        }
+        if (RTI_CONFIG->infoCopyVerify)
+        {
+            log.log("Verifying checksum of copied files");
+        }
+        if (RTI_CONFIG->infoPipelinedUpdate)
+        {
+            log.log("Using pipelined update mode");
+        }
 
         if ((isFirstRun) && (!RTI_CONFIG->startCmds.isEmpty()))
         {            
@@ -268,7 +281,8 @@ void rdsOperationWindow::callShutDown()
     {
         log.log("Shutdown on user request.");
         log.flush();
-        // Send event in non-async mode
+        // Send pending events and the shutdown event in non-async mode
+        RTI_NETLOG.flushEvents(5000);
 
         QNetworkReply::NetworkError networkError;
         int networkStatusCode=0;
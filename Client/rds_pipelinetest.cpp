@@ -0,0 +1,278 @@
+#include <QtWidgets>
+#include <stdio.h>
+
+#include "rds_global.h"
+#include "rds_configuration.h"
+#include "rds_raid.h"
+#include "rds_network.h"
+#include "rds_processcontrol.h"
+
+
+// Test of the pipelined update. The scans are listed and exported by the RaidSimulator,
+// which has to be placed next to the test binary (like for the simulation mode of RDS),
+// and a local folder stands in for the network drive.
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+class rdsPipelineTestControl : public rdsProcessControl
+{
+public:
+    bool runPipelinedTransfer(qint64 diskSpace)
+    {
+        return performPipelinedTransfer(diskSpace);
+    }
+};
+
+
+static void configure(rdsConfiguration& config, QString networkPath)
+{
+    config.loadConfiguration();
+    config.infoName="PipelineTest";
+    config.netMode=rdsConfiguration::NETWORKMODE_DRIVE;
+    config.netDriveBasepath=networkPath;
+    config.netDriveCreateBasepath=true;
+    config.netDriveReconnectCmd="";
+    config.netDriveDisconnectCmd="";
+    config.infoPipelinedUpdate=true;
+    config.infoCopyChecksum=false;
+    config.infoCopyVerify=false;
+    config.addProtocol("GRASP", "GRASP", false, false, false, false);
+}
+
+
+static int countExpectedScans(rdsRaid& raid)
+{
+    int count=0;
+
+    for (int i=0; i<raid.raidList.count(); i++)
+    {
+        if ((raid.raidList.at(i)->protName.contains("GRASP")) && (raid.raidList.at(i)->size > RDS_FILESIZE_FILTER))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+static void checkTransferredScans(QString networkPath, int expectedCount)
+{
+    int scanCount=0;
+    int partialCount=0;
+    int renamedCount=0;
+    bool sizesMatch=true;
+
+    QDirIterator it(networkPath, QDir::Files, QDirIterator::Subdirectories);
+
+    while (it.hasNext())
+    {
+        QFileInfo fileInfo(it.next());
+
+        if (fileInfo.fileName().endsWith(RDS_COPY_PARTIAL_EXT))
+        {
+            partialCount++;
+        }
+        else
+        {
+            // A time stamp is appended if a file with the same name has been transferred before
+            if (!fileInfo.fileName().endsWith(".dat"))
+            {
+                renamedCount++;
+            }
+
+            if (fileInfo.size()!=10240000)
+            {
+                sizesMatch=false;
+            }
+
+            scanCount++;
+        }
+    }
+
+    printf("  Transferred %d of %d scans\n", scanCount, expectedCount);
+
+    check(scanCount==expectedCount, "All scans transferred");
+    check(renamedCount==0,          "No scan transferred twice");
+    check(partialCount==0,          "No partial files left");
+    check(sizesMatch,               "Sizes match exported scans");
+}
+
+
+static bool readRaid(rdsRaid& raid)
+{
+    // Export all scans of the listing again
+    QFile::remove(RTI->getLpfiPath());
+    raid.setIgnoreLPFI();
+
+    if (!raid.readRaidList())
+    {
+        printf("  Unable to read RAID listing from the RaidSimulator\n");
+        return false;
+    }
+
+    return raid.createExportList();
+}
+
+
+int testPipelinedUpdate(QDir tempDir, QString name, qint64 diskSpace)
+{
+    printf("%s\n", qPrintable(name));
+
+    QString networkPath=tempDir.absoluteFilePath(name.replace(" ", ""));
+
+    rdsConfiguration config;
+    configure(config, networkPath);
+    config.infoCopyTimeout=RDS_COPY_TIMEOUT;
+    RTI->setConfigInstance(&config);
+
+    rdsNetwork network;
+    RTI->setNetworkInstance(&network);
+
+    rdsRaid raid;
+    RTI->setRaidInstance(&raid);
+
+    rdsPipelineTestControl control;
+    RTI->setControlInstance(&control);
+
+    if ((!readRaid(raid)) || (!network.openConnection()))
+    {
+        check(false, "Update prepared");
+        return 1;
+    }
+
+    int expectedCount=countExpectedScans(raid);
+
+    bool exportSuccessful=control.runPipelinedTransfer(diskSpace);
+    network.transferFiles();
+
+    check(exportSuccessful,        "Export successful");
+    check(network.isQueueEmpty(),  "Queue directory empty");
+    checkTransferredScans(networkPath, expectedCount);
+
+    printf("\n");
+    return 0;
+}
+
+
+int testTimedOutCopies(QDir tempDir)
+{
+    printf("Timed-out background copies\n");
+
+    QString networkPath=tempDir.absoluteFilePath("TimedOut");
+
+    rdsConfiguration config;
+    configure(config, networkPath);
+    RTI->setConfigInstance(&config);
+
+    rdsPipelineTestControl control;
+    RTI->setControlInstance(&control);
+
+    int expectedCount=0;
+
+    {
+        rdsNetwork network;
+        RTI->setNetworkInstance(&network);
+
+        rdsRaid raid;
+        RTI->setRaidInstance(&raid);
+
+        if ((!readRaid(raid)) || (!network.openConnection()))
+        {
+            check(false, "Update prepared");
+            return 1;
+        }
+
+        expectedCount=countExpectedScans(raid);
+
+        // Every background copy times out right away, so the copy threads might still
+        // be running when the queue directory is cleaned up like in performUpdate()
+        config.infoCopyTimeout=0;
+        control.runPipelinedTransfer(qint64(RDS_DISKLIMIT_WARNING)*2);
+        network.transferFiles();
+
+        // The destructor waits for the abandoned copy threads
+        RTI->setRaidInstance(0);
+    }
+
+    // Transfer the skipped files with the next update
+    config.infoCopyTimeout=RDS_COPY_TIMEOUT;
+
+    rdsNetwork network;
+    RTI->setNetworkInstance(&network);
+
+    if (!network.openConnection())
+    {
+        check(false, "Connection reopened");
+        return 1;
+    }
+
+    network.transferFiles();
+
+    check(network.isQueueEmpty(), "Queue directory empty");
+    checkTransferredScans(networkPath, expectedCount);
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    printf("\nYarra RDS - Pipelined Update Test\n");
+    printf("---------------------------------\n\n");
+
+    RTI->prepare();
+
+    if ((!RTI->isSimulation()) || (RTI->isInvalidEnvironment()))
+    {
+        printf("RaidSimulator not found next to test binary\n");
+        return 1;
+    }
+
+    if (!RTI->prepareEnvironment())
+    {
+        printf("Unable to prepare queue directory\n");
+        return 1;
+    }
+
+    QTemporaryDir tempDir;
+
+    if (!tempDir.isValid())
+    {
+        printf("Unable to create temporary folder\n");
+        return 1;
+    }
+
+    QDir testDir(tempDir.path());
+
+    // Enough buffer space for all scans, and space for a single scan only (the export
+    // then waits for the transfer of the previous scan)
+    testPipelinedUpdate(testDir, "Pipelined update", qint64(RDS_DISKLIMIT_WARNING)*2);
+    testPipelinedUpdate(testDir, "Pipelined update with small buffer", qint64(RDS_DISKLIMIT_WARNING)+1);
+    testTimedOutCopies(testDir);
+
+    QFile::remove(RTI->getLpfiPath());
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
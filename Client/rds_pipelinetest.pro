@@ -0,0 +1,81 @@
+#-------------------------------------------------
+#
+# Test of the pipelined update with the RaidSimulator
+#
+#-------------------------------------------------
+
+QT += core widgets gui xml svg network
+
+DEFINES += YARRA_APP_RDS
+
+TARGET    = rds_pipelinetest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE  = app
+RESOURCES = rds.qrc
+
+
+SOURCES += rds_pipelinetest.cpp \
+        rds_configurationwindow.cpp \
+        rds_runtimeinformation.cpp \
+        rds_global.cpp \
+        rds_operationwindow.cpp \
+        rds_configuration.cpp \
+        rds_network.cpp \
+        rds_copyengine.cpp \
+        rds_log.cpp \
+        rds_raid.cpp \
+        rds_raidparser.cpp \
+        rds_raidindex.cpp \
+        rds_processcontrol.cpp \
+        rds_activitywindow.cpp \
+        rds_debugwindow.cpp \
+        rds_anonymizeVB17.cpp \
+        rds_copydialog.cpp \
+        rds_checksum.cpp \
+        ../NetLogger/netlogger.cpp \
+        ../NetLogger/netlog_sender.cpp \
+        ../CloudTools/yct_prepare/yct_twix_tagmatcher.cpp \
+    rds_iconwindow.cpp \
+    rds_exechelper.cpp \
+    rds_processrunner.cpp \
+    rds_mailbox.cpp \
+    rds_mailboxwindow.cpp \
+    rds_mailboxmessage.cpp
+
+HEADERS  += rds_configurationwindow.h \
+            rds_runtimeinformation.h \
+            rds_global.h \
+            rds_operationwindow.h \
+            rds_configuration.h \
+            rds_network.h \
+            rds_copyengine.h \
+            rds_log.h \
+            rds_raid.h \
+            rds_raidparser.h \
+            rds_raidindex.h \
+            rds_processcontrol.h \
+            rds_activitywindow.h \
+            rds_debugwindow.h \
+            rds_anonymizeVB17.h \
+            rds_copydialog.h \
+            rds_checksum.h \
+            ../NetLogger/netlogger.h \
+            ../NetLogger/netlog_events.h \
+            ../NetLogger/netlog_sender.h \
+            ../CloudTools/yct_prepare/yct_twix_tagmatcher.h \
+    rds_iconwindow.h \
+    rds_exechelper.h \
+    rds_processrunner.h \
+    rds_mailbox.h \
+    rds_mailboxwindow.h \
+    rds_mailboxmessage.h
+
+FORMS    += rds_configurationwindow.ui \
+            rds_operationwindow.ui \
+            rds_activitywindow.ui \
+            rds_debugwindow.ui \
+            rds_copydialog.ui \
+    rds_iconwindow.ui \
+    rds_mailboxwindow.ui
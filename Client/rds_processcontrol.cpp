@@ -103,6 +103,53 @@ bool rdsProcessControl::isUpdateNeeded()
 }
 
 
+bool rdsProcessControl::performPipelinedTransfer(qint64 diskSpace)
+{
+    // Limit the amount of exported data that waits for the transfer, so that the
+    // local buffer never drops below the disk space warning level
+    qint64 bufferLimit=diskSpace-qint64(RDS_DISKLIMIT_WARNING);
+    bool exportSuccessful=true;
+
+    RTI->debug("Buffer limit for pipelined update = " + QString::number(bufferLimit));
+
+    while ((exportSuccessful) && (!RTI->isPostponementRequested()) && (RTI_RAID->exportsAvailable()))
+    {
+        // Wait until enough of the queued files have been transferred. If the limit
+        // is too small, this falls back to exporting and transferring one by one.
+        qint64 nextSize=RTI_RAID->getNextExportSize();
+
+        while ((RTI_NETWORK->isBackgroundTransferActive())
+               && (RTI_NETWORK->getBackgroundTransferSize()+nextSize > bufferLimit))
+        {
+            RTI->processEvents();
+            RTI_NETWORK->checkBackgroundTimeout();
+            Sleep(RDS_SLEEP_INTERVAL);
+        }
+
+        // Save one file to the queue directory. The copy worker continues with
+        // the files of the previous scan in the meantime.
+        setState(STATE_RAIDTRANSFER);
+        exportSuccessful=RTI_RAID->processExportListEntry();
+
+        RTI_NETWORK->queueBackgroundTransfer(RTI_RAID->takeExportedFiles());
+        RTI->processEvents();
+    }
+
+    if (RTI->isPostponementRequested())
+    {
+        RTI->log("Received postponement request. Stopping update.");
+    }
+
+    // All scans have been exported, so it is safe to scan while the last
+    // files are copied
+    setState(STATE_NETWORKTRANSFER);
+    RTI->updateInfoUI();
+    RTI_NETWORK->waitForBackgroundTransfer();
+
+    return exportSuccessful;
+}
+
+
 void rdsProcessControl::performUpdate()
 {
     RTI->setIconWindowAnim(true);   
@@ -147,7 +194,9 @@ void rdsProcessControl::performUpdate()
     // scanner
     // TODO: Resolve compiler warning
 
-    if (diskSpace < qint64(RDS_DISKLIMIT_ALTERNATING))
+    // In the pipelined mode, the amount of buffered data is limited based on
+    // the disk space instead, so that the alternating mode is not needed
+    if ((diskSpace < qint64(RDS_DISKLIMIT_ALTERNATING)) && (!RTI_CONFIG->infoPipelinedUpdate))
     {
         alternatingUpdate=true;
         RTI->log("Using alternating update mode due to low disk space.");
@@ -269,7 +318,12 @@ void rdsProcessControl::performUpdate()
 
             // Decide if files should be exported and transfered at once
             // of if the files should be exported and transfered one by one.
-            if (alternatingUpdate)
+            if (RTI_CONFIG->infoPipelinedUpdate)
+            {
+                // Transfer the exported files while the next scan is exported
+                exportSuccessful=performPipelinedTransfer(diskSpace);
+            }
+            else if (alternatingUpdate)
             {
                 // Loop over all scans scheduled for the export
                 while ((exportSuccessful) && (!RTI->isPostponementRequested()) && (RTI_RAID->exportsAvailable()))
@@ -541,11 +595,11 @@ void rdsProcessControl::sendScanInfoToLogServer()
     }
 
     // If the transfer was not successful or the connection could not be validated,
-    // store the scan info locally in a temporary file and resend later
+    // store the scan info in the spool of the log server events and resend later
     if (storeScanInfo)
     {
         RTI->log("WARNING: Storing scan info locally.");
-        storeScanInfoOnDisk(data);
+        RTI_NETLOG.spoolData(data, NETLOG_ENDPT_RAIDLOG);
     }
 
     // Store the fileID of the newest RAID entry processed, so that
@@ -555,59 +609,29 @@ void rdsProcessControl::sendScanInfoToLogServer()
 }
 
 
-void rdsProcessControl::storeScanInfoOnDisk(QUrlQuery& data)
+void rdsProcessControl::resendScanInfoFromDisk()
 {
-    // Generate a unique file name for temporarily storing the scan info
-    QString timeStamp=QDateTime::currentDateTime().toString("MMddyy_HHmmss_zzz");
-    QString fileName=RTI->getAppPath()+"/"+timeStamp+RDS_SCANINFO_EXT;
-
-    // Check if filename exists. If so, add random number until non-existent filename is reached.
-    int tries=0;
-    while (QFile::exists(fileName))
-    {
-        fileName=RTI->getAppPath()+"/"+timeStamp+"_"+QString::number(qrand() % 1000)+RDS_SCANINFO_EXT;
-
-        // Abort after some tries (very very unlikely, so something else must be wrong)
-        tries++;
-        if (tries>20)
-        {
-            RTI->log(QString("ERROR: Unable to generate unique filename for storing scan info (%1).").arg(fileName));
-            return;
-        }
-    }
-
-    QFile bufferFile(fileName);
-
-    if (!bufferFile.open(QIODevice::ReadWrite | QIODevice::Text))
+    // Make sure that the configuration to the log server has been validated
+    if (RTI_NETLOG.isConfigurationError())
     {
-        RTI->log(QString("ERROR: Unable to create file for storing scan info (%1).").arg(fileName));
         return;
     }
 
-    QTextStream stream(&bufferFile);
+    importScanInfoFiles();
 
-    stream << RDS_SCANINFO_HEADER << endl;
-    stream << data.queryItems().count() << endl;
-
-    // Write data information
-    for (int i=0; i<data.queryItems().count(); i++)
+    // Send the stored scan info and events before the new scan info, so that the
+    // server receives the scans in the right order
+    if (!RTI_NETLOG.flushEvents(NETLOG_POST_TIMEOUT))
     {
-        stream << data.queryItems().at(i).first  << endl;
-        stream << data.queryItems().at(i).second << endl;
+        RTI->log("WARNING: Stored data could not be sent completely. Retrying later.");
     }
-
-    bufferFile.flush();
-    bufferFile.close();
 }
 
 
-void rdsProcessControl::resendScanInfoFromDisk()
+void rdsProcessControl::importScanInfoFiles()
 {
-    // Make sure that the configuration to the log server has been validated
-    if (RTI_NETLOG.isConfigurationError())
-    {
-        return;
-    }
+    // Scan info that could not be sent used to be stored in individual files. Move
+    // these files into the spool of the log server events, from where they are sent.
 
     // Search for all files with extension .ylb in the application folder. Sort the list
     // by date so that the oldest scans are getting pushed first
@@ -622,7 +646,7 @@ void rdsProcessControl::resendScanInfoFromDisk()
     }
 
     RTI->log("WARNING: Scan info from previous update found.");
-    RTI->log("Resending stored data to server.");
+    RTI->log("Moving stored data into spool.");
     RTI_NETLOG.postEvent(EventInfo::Type::ScanInfo,EventInfo::Detail::Information,EventInfo::Severity::Warning,"Resend data found");
 
     for (int i=0; i<bufferFiles.count(); i++)
@@ -717,36 +741,14 @@ void rdsProcessControl::resendScanInfoFromDisk()
         // Close file
         bufferFile.close();
 
-        // Send data to server
-        QNetworkReply::NetworkError error;
-        int http_status=0;
-        QString errorString="";
-
-        bool success=RTI_NETWORK->netLogger.postData(query, NETLOG_ENDPT_RAIDLOG, error, http_status, errorString);
-
-        if (!success)
+        // Keep the file if the data could not be moved
+        if (!RTI_NETLOG.spoolData(query, NETLOG_ENDPT_RAIDLOG))
         {
-            if (http_status)
-            {
-                RTI->log(QString("ERROR: Transfer to log server failed (HTTP Error %1).").arg(http_status));
-                QString httpError="HTTP Error "+QString::number(http_status);
-                RTI_NETLOG.postEvent(EventInfo::Type::ScanInfo,EventInfo::Detail::Push,EventInfo::Severity::Error,"Resend error: "+httpError);
-            }
-            else
-            {
-                RTI->log(QString("ERROR: Transfer to log server failed (%1).").arg(errorString));
-                RTI_NETLOG.postEvent(EventInfo::Type::ScanInfo,EventInfo::Detail::Push,EventInfo::Severity::Error,"Resend error: "+errorString);
-            }
-
-            // Server transfer seems still to have problems. So stop here and continue during the next update
+            RTI->log(QString("ERROR: Unable to spool scan-info file (%1).").arg(fileName));
             break;
         }
-        else
-        {
-            // Transfer sucessful, delete file
-            bufferFile.remove();
-            RTI_NETLOG.postEvent(EventInfo::Type::ScanInfo,EventInfo::Detail::Push,EventInfo::Severity::Success,"Resend successful");
-        }
+
+        bufferFile.remove();
     }
 }
 
@@ -62,8 +62,10 @@ protected:
     void setState(int newState);
     void setNextPeriodicUpdate();
 
-    void storeScanInfoOnDisk(QUrlQuery& data);
+    bool performPipelinedTransfer(qint64 diskSpace);
+
     void resendScanInfoFromDisk();
+    void importScanInfoFiles();
 
 };
 
@@ -0,0 +1,252 @@
+#include "rds_processrunner.h"
+
+#define RDS_PROCESSRUNNER_KILLWAIT 5000
+
+
+rdsProcessRunner::rdsProcessRunner()
+    : QObject()
+{
+    process=0;
+    eventLoop=0;
+
+    timeoutMs=30000;
+    lineHandler=nullptr;
+    lineHandlerActive=false;
+    keepOutput=false;
+    mergedChannels=false;
+    customEnvironment=false;
+    nativeArguments="";
+
+    startError=false;
+    timeout=false;
+    exitCode=-1;
+    normalExit=false;
+    duration=0;
+    errorString="";
+}
+
+
+bool rdsProcessRunner::run(QString program, QStringList arguments)
+{
+    return execute(program, arguments, false);
+}
+
+
+bool rdsProcessRunner::run(QString commandLine)
+{
+    return execute(commandLine, QStringList(), true);
+}
+
+
+bool rdsProcessRunner::execute(QString program, QStringList arguments, bool useCommandLine)
+{
+    output.clear();
+    pendingLine.clear();
+    lineHandlerActive=bool(lineHandler);
+
+    startError=false;
+    timeout=false;
+    exitCode=-1;
+    normalExit=false;
+    duration=0;
+    errorString="";
+
+    QProcess myProcess;
+    myProcess.setReadChannel(QProcess::StandardOutput);
+
+    if (mergedChannels)
+    {
+        myProcess.setProcessChannelMode(QProcess::MergedChannels);
+    }
+
+    if (customEnvironment)
+    {
+        myProcess.setProcessEnvironment(processEnvironment);
+    }
+
+#ifdef Q_OS_WIN
+    if (!nativeArguments.isEmpty())
+    {
+        myProcess.setNativeArguments(nativeArguments);
+    }
+#endif
+
+    QEventLoop loop;
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+    timeoutTimer.setInterval(timeoutMs);
+
+    process=&myProcess;
+    eventLoop=&loop;
+
+    connect(&myProcess,    SIGNAL(readyReadStandardOutput()),            this, SLOT(readOutput()));
+    connect(&myProcess,    SIGNAL(finished(int, QProcess::ExitStatus)),  this, SLOT(processFinished()));
+    connect(&myProcess,    SIGNAL(error(QProcess::ProcessError)),        this, SLOT(processFinished()));
+    connect(&timeoutTimer, SIGNAL(timeout()),                            this, SLOT(processTimeout()));
+
+    QElapsedTimer ti;
+    ti.start();
+
+    if (useCommandLine)
+    {
+        myProcess.start(program);
+    }
+    else
+    {
+        myProcess.start(program, arguments);
+    }
+
+    timeoutTimer.start();
+
+    // The loop is only quit when the process has finished, failed, or timed out. If it
+    // returns for any other reason, it is simply entered again. Starting the process is
+    // also awaited in the loop, so that the GUI stays responsive while it starts.
+    while ((myProcess.state()!=QProcess::NotRunning) && (!timeout))
+    {
+        loop.exec();
+    }
+
+    timeoutTimer.stop();
+
+    // Report a missing or broken binary right away instead of waiting for the timeout
+    if ((!timeout) && (myProcess.error()==QProcess::FailedToStart))
+    {
+        startError=true;
+        errorString=myProcess.errorString();
+        duration=ti.elapsed();
+
+        process=0;
+        eventLoop=0;
+        return false;
+    }
+
+    if (timeout)
+    {
+        myProcess.kill();
+        myProcess.waitForFinished(RDS_PROCESSRUNNER_KILLWAIT);
+        errorString="Process timed out after " + QString::number(ti.elapsed()) + " ms";
+    }
+
+    // Read what is left in the pipe, including a last line without line break
+    readOutput();
+    processLines(true);
+
+    duration=ti.elapsed();
+    normalExit=(!timeout) && (myProcess.exitStatus()==QProcess::NormalExit);
+    exitCode=myProcess.exitCode();
+
+    if ((!timeout) && (!normalExit))
+    {
+        errorString=myProcess.errorString();
+    }
+
+    process=0;
+    eventLoop=0;
+
+    return !timeout;
+}
+
+
+void rdsProcessRunner::readOutput()
+{
+    if (process==0)
+    {
+        return;
+    }
+
+    QByteArray data=process->readAllStandardOutput();
+
+    if (data.isEmpty())
+    {
+        return;
+    }
+
+    if (keepOutput)
+    {
+        output.append(data);
+    }
+
+    if (lineHandlerActive)
+    {
+        pendingLine.append(data);
+        processLines(false);
+    }
+}
+
+
+void rdsProcessRunner::processLines(bool flush)
+{
+    if (!lineHandlerActive)
+    {
+        pendingLine.clear();
+        return;
+    }
+
+    const char* data=pendingLine.constData();
+    const int   length=pendingLine.size();
+    int         start=0;
+
+    while ((lineHandlerActive) && (start<length))
+    {
+        const char* lineBreak=(const char*) memchr(data+start, '\n', length-start);
+        int end=0;
+        int next=0;
+
+        if (lineBreak==0)
+        {
+            // Keep the incomplete line until more data arrives
+            if (!flush)
+            {
+                break;
+            }
+
+            end=length;
+            next=length;
+        }
+        else
+        {
+            end=int(lineBreak-data);
+            next=end+1;
+        }
+
+        if ((end>start) && (data[end-1]=='\r'))
+        {
+            end--;
+        }
+
+        if (!lineHandler(QByteArray::fromRawData(data+start, end-start)))
+        {
+            lineHandlerActive=false;
+        }
+
+        start=next;
+    }
+
+    if (!lineHandlerActive)
+    {
+        pendingLine.clear();
+        return;
+    }
+
+    pendingLine.remove(0, start);
+}
+
+
+void rdsProcessRunner::processFinished()
+{
+    if (eventLoop!=0)
+    {
+        eventLoop->quit();
+    }
+}
+
+
+void rdsProcessRunner::processTimeout()
+{
+    timeout=true;
+
+    if (eventLoop!=0)
+    {
+        eventLoop->quit();
+    }
+}
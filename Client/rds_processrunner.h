@@ -0,0 +1,154 @@
+#ifndef RDS_PROCESSRUNNER_H
+#define RDS_PROCESSRUNNER_H
+
+#include <QtCore>
+#include <functional>
+
+
+// Runs an external program and reads its output while the program is running, so that
+// the pipe never fills up and stalls the program. Complete lines are passed to the line
+// handler as they arrive. The handler receives the line without the line break. The data
+// is only valid during the call, and returning false skips all further lines (the output
+// is still drained until the program exits).
+class rdsProcessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<bool(const QByteArray& line)> LineHandler;
+
+    rdsProcessRunner();
+
+    void setTimeout(int ms);
+    void setLineHandler(LineHandler handler);
+    void setKeepOutput(bool enabled=true);
+    void setMergedChannels(bool enabled=true);
+    void setEnvironment(const QProcessEnvironment& environment);
+    void setNativeArguments(QString arguments);
+
+    bool run(QString program, QStringList arguments);
+    bool run(QString commandLine);
+
+    bool isStartError();
+    bool isTimeout();
+    int  getExitCode();
+    bool isNormalExit();
+    qint64 getDuration();
+
+    const QByteArray& getOutput();
+    QString getErrorString();
+
+protected slots:
+    void readOutput();
+    void processFinished();
+    void processTimeout();
+
+protected:
+    bool execute(QString program, QStringList arguments, bool useCommandLine);
+    void processLines(bool flush);
+
+    QProcess*   process;
+    QEventLoop* eventLoop;
+
+    int         timeoutMs;
+    LineHandler lineHandler;
+    bool        lineHandlerActive;
+    bool        keepOutput;
+    bool        mergedChannels;
+    bool        customEnvironment;
+
+    QProcessEnvironment processEnvironment;
+    QString             nativeArguments;
+
+    QByteArray output;
+    QByteArray pendingLine;
+
+    bool    startError;
+    bool    timeout;
+    int     exitCode;
+    bool    normalExit;
+    qint64  duration;
+    QString errorString;
+};
+
+
+inline void rdsProcessRunner::setTimeout(int ms)
+{
+    timeoutMs=ms;
+}
+
+
+inline void rdsProcessRunner::setLineHandler(LineHandler handler)
+{
+    lineHandler=handler;
+}
+
+
+inline void rdsProcessRunner::setKeepOutput(bool enabled)
+{
+    keepOutput=enabled;
+}
+
+
+inline void rdsProcessRunner::setMergedChannels(bool enabled)
+{
+    mergedChannels=enabled;
+}
+
+
+inline void rdsProcessRunner::setEnvironment(const QProcessEnvironment& environment)
+{
+    processEnvironment=environment;
+    customEnvironment=true;
+}
+
+
+inline void rdsProcessRunner::setNativeArguments(QString arguments)
+{
+    nativeArguments=arguments;
+}
+
+
+inline bool rdsProcessRunner::isStartError()
+{
+    return startError;
+}
+
+
+inline bool rdsProcessRunner::isTimeout()
+{
+    return timeout;
+}
+
+
+inline int rdsProcessRunner::getExitCode()
+{
+    return exitCode;
+}
+
+
+inline bool rdsProcessRunner::isNormalExit()
+{
+    return normalExit;
+}
+
+
+inline qint64 rdsProcessRunner::getDuration()
+{
+    return duration;
+}
+
+
+inline const QByteArray& rdsProcessRunner::getOutput()
+{
+    return output;
+}
+
+
+inline QString rdsProcessRunner::getErrorString()
+{
+    return errorString;
+}
+
+
+#endif // RDS_PROCESSRUNNER_H
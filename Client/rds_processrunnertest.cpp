@@ -0,0 +1,227 @@
+#include <QtCore>
+#include <stdio.h>
+
+#include "rds_processrunner.h"
+
+
+// Test of the process runner. The directory listing of the RaidSimulator is read while
+// the simulator writes it slowly, and the test binary itself stands in for a program
+// that writes parts of lines or hangs (started with "-write" or "-hang").
+
+#define TEST_LISTINGLINES 40
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+// Writes lines in pieces, so that the line breaks fall into different reads
+static int runSlowWriter(bool hang)
+{
+    const char* pieces[]={ "first ", "line\r", "\nsecond line\n", "thi", "rd line\n", "last line without break" };
+
+    for (unsigned int i=0; i<sizeof(pieces)/sizeof(pieces[0]); i++)
+    {
+        fputs(pieces[i], stdout);
+        fflush(stdout);
+        QThread::msleep(100);
+    }
+
+    if (hang)
+    {
+        QThread::msleep(60000);
+    }
+
+    return 3;
+}
+
+
+int testSplitLines(QString writerPath)
+{
+    printf("Lines split across reads\n");
+
+    QList<QByteArray> lines;
+
+    rdsProcessRunner runner;
+    runner.setLineHandler([&lines](const QByteArray& line)
+    {
+        // The data is only valid during the call
+        lines.append(QByteArray(line.constData(), line.size()));
+        return true;
+    });
+
+    bool success=runner.run(writerPath, QStringList() << "-write");
+
+    check(success,                               "Process finished");
+    check(runner.isNormalExit(),                 "Normal exit");
+    check(runner.getExitCode()==3,               "Exit code passed on");
+    check(lines.count()==4,                      "Four lines received");
+    check(lines.value(0)=="first line",          "Line break split from carriage return");
+    check(lines.value(1)=="second line",         "Line following in same read");
+    check(lines.value(2)=="third line",          "Line split within text");
+    check(lines.value(3)=="last line without break", "Last line without break");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testSimulatorListing(QString simulatorPath)
+{
+    printf("Slow RaidSimulator listing\n");
+
+    int        lineCount=0;
+    int        entryCount=0;
+    QByteArray lastLine;
+
+    rdsProcessRunner runner;
+    runner.setKeepOutput();
+    runner.setLineHandler([&](const QByteArray& line)
+    {
+        lineCount++;
+
+        // All entries of the listing have the status "cld"
+        if (line.contains("cld"))
+        {
+            entryCount++;
+        }
+
+        lastLine=QByteArray(line.constData(), line.size());
+        return true;
+    });
+
+    bool success=runner.run(simulatorPath, QStringList() << "-d" << "-n" << QString::number(TEST_LISTINGLINES) << "-w" << "5");
+
+    QList<QByteArray> outputLines=runner.getOutput().split('\n');
+
+    // The output ends with a line break, so split() adds an empty entry
+    if ((!outputLines.isEmpty()) && (outputLines.last().isEmpty()))
+    {
+        outputLines.removeLast();
+    }
+
+    check(success,                              "Process finished");
+    check(lineCount==outputLines.count(),       "Same lines as in complete output");
+    check(entryCount==TEST_LISTINGLINES,        "All entries received");
+    check(!lastLine.contains('\n'),             "No line breaks in lines");
+
+    // Skipping the remaining lines still drains the output until the program exits
+    int handledLines=0;
+
+    rdsProcessRunner skippingRunner;
+    skippingRunner.setLineHandler([&handledLines](const QByteArray&)
+    {
+        handledLines++;
+        return (handledLines<3);
+    });
+
+    success=skippingRunner.run(simulatorPath, QStringList() << "-d" << "-n" << QString::number(TEST_LISTINGLINES) << "-w" << "5");
+
+    check(success && skippingRunner.isNormalExit(), "Process finished after skipping lines");
+    check(handledLines==3,                          "No lines after handler returned false");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testTimeout(QString writerPath)
+{
+    printf("Timeout\n");
+
+    int lineCount=0;
+
+    rdsProcessRunner runner;
+    runner.setTimeout(1000);
+    runner.setLineHandler([&lineCount](const QByteArray&)
+    {
+        lineCount++;
+        return true;
+    });
+
+    bool success=runner.run(writerPath, QStringList() << "-hang");
+
+    printf("  Returned after %lld ms\n", runner.getDuration());
+
+    check(!success,                  "Run reports failure");
+    check(runner.isTimeout(),        "Timeout reported");
+    check(!runner.isStartError(),    "No start error reported");
+    check(!runner.isNormalExit(),    "No normal exit reported");
+    check(runner.getDuration()<6000, "Process killed after timeout");
+    check(lineCount==4,              "Output before timeout received");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testStartError()
+{
+    printf("Start error\n");
+
+    rdsProcessRunner runner;
+    runner.setTimeout(10000);
+
+    bool success=runner.run(QDir::temp().absoluteFilePath("yarra_missing_binary_1234"), QStringList());
+
+    printf("  Returned after %lld ms: %s\n", runner.getDuration(), qPrintable(runner.getErrorString()));
+
+    check(!success,                     "Run reports failure");
+    check(runner.isStartError(),        "Start error reported");
+    check(!runner.isTimeout(),          "No timeout reported");
+    check(runner.getDuration()<5000,    "Returned without waiting for timeout");
+    check(!runner.getErrorString().isEmpty(), "Error string set");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if ((argc>1) && (QString(argv[1])=="-write"))
+    {
+        return runSlowWriter(false);
+    }
+
+    if ((argc>1) && (QString(argv[1])=="-hang"))
+    {
+        return runSlowWriter(true);
+    }
+
+    QCoreApplication app(argc, argv);
+
+    printf("\nYarra RDS - Process Runner Test\n");
+    printf("-------------------------------\n\n");
+
+    QString simulatorPath=QDir(app.applicationDirPath()).filePath("RaidSimulator");
+
+    if (argc>1)
+    {
+        simulatorPath=QString(argv[1]);
+    }
+
+    QString writerPath=app.applicationFilePath();
+
+    testSplitLines(writerPath);
+    testSimulatorListing(simulatorPath);
+    testTimeout(writerPath);
+    testStartError();
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Test of the process runner with the RaidSimulator
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rds_processrunnertest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += rds_processrunnertest.cpp \
+    rds_processrunner.cpp
+
+HEADERS += \
+    rds_processrunner.h
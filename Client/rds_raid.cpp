@@ -3,6 +3,7 @@
 #include "rds_network.h"
 #include "rds_processcontrol.h"
 #include "rds_anonymizeVB17.h"
+#include "rds_processrunner.h"
 
 #ifdef YARRA_APP_ORT
     #include "ort_global.h"
@@ -127,6 +128,8 @@ rdsRaid::rdsRaid()
     lastProcessedFileID=-1;
     lastProcessedFileIDScaninfo=-1;
     ignoreLPFID=false;
+    useRaidIndex=false;
+    raidIndexLoaded=false;
     ortMissingDiskspace=false;
     scanActive=false;
 
@@ -178,9 +181,6 @@ bool rdsRaid::callRaidTool(QStringList command, QStringList options, int timeout
     // Clear the output buffer
     raidToolOutput.clear();
 
-    QProcess *myProcess = new QProcess(0);
-    myProcess->setReadChannel(QProcess::StandardOutput);
-
     QStringList args;
     args << command;
     args << raidToolIP;
@@ -194,94 +194,35 @@ bool rdsRaid::callRaidTool(QStringList command, QStringList options, int timeout
     args.clear();
     args << argLine.split(" ");
 
-    bool success=false;
-
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(timeout);
-    QEventLoop q;
-    connect(myProcess, SIGNAL(finished(int , QProcess::ExitStatus)), &q, SLOT(quit()));
-    connect(&timeoutTimer, SIGNAL(timeout()), &q, SLOT(quit()));
-
-    // Time measurement to diagnose RaidTool calling problems
-    QElapsedTimer ti;
-    ti.start();
-    timeoutTimer.start();
-    myProcess->start(raidToolCmd, args);
-    q.exec();
-
-    // Check for problems with the event loop: Sometimes it seems to return to quickly!
-    // In this case, start a second while loop to check when the process is really finished.
-    if ((timeoutTimer.isActive()) && (myProcess->state()==QProcess::Running))
-    {
-        timeoutTimer.stop();
-        RTI->log("Warning: QEventLoop returned too early. Starting secondary loop.");
-        while ((myProcess->state()==QProcess::Running) && (ti.elapsed()<timeout))
-        {
-            RTI->processEvents();
-            Sleep(RDS_SLEEP_INTERVAL);
-        }
+    // The output is collected while the RaidTool is running, so that the pipe does not
+    // fill up for long directory listings
+    rdsProcessRunner runner;
+    runner.setTimeout(timeout);
+    runner.setKeepOutput();
 
-        // If the process did not finish within the timeout duration
-        if (myProcess->state()==QProcess::Running)
-        {
-            RTI->log("Warning: Process is still active. Killing process.");
-            myProcess->kill();
-            success=false;
-        }
-        else
-        {
-            success=true;
-        }
-    }
-    else
+    bool success=runner.run(raidToolCmd, args);
+
+    if (runner.isStartError())
     {
-        // Normal timeout-handling if QEventLoop works normally
-        if (timeoutTimer.isActive())
-        {
-            success=true;
-            timeoutTimer.stop();
-        }
-        else
-        {
-            RTI->log("Warning: Process event loop timed out.");
-            RTI->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms");
-            success=false;
-            if (myProcess->state()==QProcess::Running)
-            {
-                RTI->log("Warning: Process is still active. Killing process.");
-                myProcess->kill();
-            }
-        }
+        RTI->log("ERROR: Unable to start RaidTool (" + runner.getErrorString() + ")");
+        RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Unable to start RaidTool");
+        return false;
     }
 
     if (!success)
     {
         // The process timeed out. Probably some error occurred.
+        RTI->log("Warning: Duration since start "+QString::number(runner.getDuration())+" ms");
         RTI->log("ERROR: Timeout during call of RaidTool!");
         RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Process timeout during RaidTool call");
     }
     else
     {
-        // Read the output lines from the process and store in string list
-        // for parsing
-        char buf[1024];
-        qint64 lineLength = -1;
-
-        do
-        {
-            lineLength=myProcess->readLine(buf, sizeof(buf));
-            if (lineLength != -1)
-            {
-                //RTI->debug("Read line!");
-                raidToolOutput << QString(buf);
-            }
-        } while (lineLength!=-1);
+        // Keep the raw output of the process for parsing. The lines are not split
+        // into strings, as the directory listing can contain many thousand entries.
+        raidToolOutput=runner.getOutput();
     }
 
-    delete myProcess;
-    myProcess=0;
-
     return success;
 }
 
@@ -404,18 +345,21 @@ bool rdsRaid::parseOutputFileExport()
 {
     bool isSuccess=false;
 
-    RTI->debug("Received " + QString::number(raidToolOutput.count()) + " lines from the RAID tool.");
+    rdsRaidParser parser;
+    parser.setData(raidToolOutput);
+
+    RTI->debug("Received " + QString::number(parser.getLineCount()) + " lines from the RAID tool.");
 
     // Parse all text output lines received from the RaidTool
-    for (int i=0; i<raidToolOutput.count(); i++)
+    while (parser.nextLine())
     {
-        if (raidToolOutput.at(i).contains(RDS_RAID_SUCCESS))
+        if (parser.lineContains(RDS_RAID_SUCCESS))
         {
             isSuccess=true;
             break;
         }
 
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_INIT))
+        if (parser.lineContains(RDS_RAID_ERROR_INIT))
         {
             RTI->log("Error initializing RAID access.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error initializing RAID access");
@@ -423,7 +367,7 @@ bool rdsRaid::parseOutputFileExport()
             break;
         }
 
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_FILE))
+        if (parser.lineContains(RDS_RAID_ERROR_FILE))
         {
             RTI->log("Error finding file on RAID.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error finding file on RAID");
@@ -431,7 +375,7 @@ bool rdsRaid::parseOutputFileExport()
             break;
         }
 
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_DIR))
+        if (parser.lineContains(RDS_RAID_ERROR_DIR))
         {
             RTI->log("Error reading RAID directory.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error reading RAID directory");
@@ -439,7 +383,7 @@ bool rdsRaid::parseOutputFileExport()
             break;
         }
 
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_COPY))
+        if (parser.lineContains(RDS_RAID_ERROR_COPY))
         {
             RTI->log("Error copying RAID file.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error copying RAID file");
@@ -520,9 +464,26 @@ bool rdsRaid::parseOutputDirectory()
 
     QString unknownVerboseAttributeFound="";
 
-    RTI->debug("Received " + QString::number(raidToolOutput.count()) + " lines from the RAID tool.");
+    // The parser works on the raw output of the RaidTool without splitting it into strings
+    rdsRaidParser parser;
+    parser.setData(raidToolOutput);
+
+    RTI->debug("Received " + QString::number(parser.getLineCount()) + " lines from the RAID tool.");
 
-    QString dirHead=RDS_RAID_DIRHEAD;
+    // Position of the first cached entry that continues the directory (if the RAID index is used)
+    int  raidIndexPosition=-1;
+    bool raidIndexChecked=false;
+
+    if ((useRaidIndex) && (!raidIndexLoaded))
+    {
+        if (raidIndex.load(getRaidIndexPath()))
+        {
+            RTI->debug("Loaded RAID index with " + QString::number(raidIndex.getCount()) + " entries.");
+        }
+        raidIndexLoaded=true;
+    }
+
+    const char* dirHead=RDS_RAID_DIRHEAD;
 
     // Some of the software versions have a different header format
 
@@ -542,12 +503,20 @@ bool rdsRaid::parseOutputDirectory()
         dirHead=RDS_RAID_DIRHEAD_VB13;
     }
 
-    for (int i=0; i<raidToolOutput.count(); i++)
+    // For RDS the patient name should not be trimmed as this might confuse the
+    // exam aggregation mechanism of the log server backend
+#ifdef YARRA_APP_RDS
+    bool trimPatName=false;
+#else
+    bool trimPatName=true;
+#endif
+
+    while (parser.nextLine())
     {
         lineProcessed=false;
 
         // Check for error codes
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_INIT))
+        if (parser.lineContains(RDS_RAID_ERROR_INIT))
         {
             RTI->log("Error initializing RAID access.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error initializing RAID access");
@@ -555,7 +524,7 @@ bool rdsRaid::parseOutputDirectory()
             break;
         }
 
-        if (raidToolOutput.at(i).contains(RDS_RAID_ERROR_DIR))
+        if (parser.lineContains(RDS_RAID_ERROR_DIR))
         {
             RTI->log("Error reading RAID directory.");
             RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Error reading RAID directory");
@@ -565,7 +534,7 @@ bool rdsRaid::parseOutputDirectory()
 
         // Check if current line is the header of the RAID index. If so, we can
         // start parsing for raid entries from the next line.
-        if (raidToolOutput.at(i).contains(dirHead))
+        if (parser.lineContains(dirHead))
         {
             if (dirHeadFound)
             {
@@ -584,39 +553,28 @@ bool rdsRaid::parseOutputDirectory()
         // which should be skipped here
         if ((RTI->getRaidToolFormat()==rdsRuntimeInformation::RDS_RAIDTOOL_VD11) && (dirHeadFound))
         {
-            QString raidLine=raidToolOutput.at(i);
-
-            if ((!lineProcessed) && (raidLine.contains(RDS_RAID_VD_IGNORE1)))
+            if ((!lineProcessed) && (parser.lineContains(RDS_RAID_VD_IGNORE1)))
             {
                 // Detected line of type "dependent file:", skip further processing
                 lineProcessed=true;
             }
-            if ((!lineProcessed) && (raidLine.contains(RDS_RAID_VD_IGNORE2)))
+            if ((!lineProcessed) && (parser.lineContains(RDS_RAID_VD_IGNORE2)))
             {
                 // Detected line of type "measID:", skip further processing
                 lineProcessed=true;
             }
         }
 
-        if ((!lineProcessed) && (dirHeadFound) && (raidToolOutput.at(i).length() > 2))
+        if ((!lineProcessed) && (dirHeadFound) && (parser.getLineLength() > 0))
         {
             rdsRaidEntry raidEntry;
             raidEntry.attribute=RDS_SCANATTRIBUTE_OK;
 
-            bool res=true;
             bool skipEntry=false;
 
-            // Parse raid line
-            QString raidLine=raidToolOutput.at(i);
-
-            // Remove the CR+LF at the end
-            raidLine.chop(2);
-
-            QString origLine=raidLine;
-
             if (useVerboseMode)
             {
-                chopDependingIDsVerbose(raidLine, raidEntry.attribute, unknownVerboseAttributeFound);
+                parser.chopDependingIDsVerbose(raidEntry.attribute, unknownVerboseAttributeFound, missingVerboseData);
             }
             else
             {
@@ -624,30 +582,20 @@ bool rdsRaid::parseOutputDirectory()
                 if ((RTI->getRaidToolFormat()==rdsRuntimeInformation::RDS_RAIDTOOL_VD13C)
                     || (RTI->getRaidToolFormat()==rdsRuntimeInformation::RDS_RAIDTOOL_VE))
                 {
-                    chopDependingIDs(raidLine);
+                    parser.chopDependingIDs();
                 }
             }
 
-            QString temp="";
-
             // NOTE: Format of the raid entries is %7u%11u%32s%32s%9s%13I64u%13I64u%22s%22s
             // NOTE: On VB13 and VB15, the format is different (no patient name is printed, protocol has 16 chars).
             //       Format is should be %7u%11u%16s%9s%13I64u%13I64u%22s%22s
 
             // ## FileID
-            // Read the FileID from the front and remove from raidLine
-            temp=raidLine.left(7);
-            raidLine.remove(0,7);
-
-            // Remove preceeding " " characters
-            temp.remove(" ");
-            raidEntry.fileID=temp.toInt(&res);
-
-            if (!res)
+            if (!parser.readNumber(7, raidEntry.fileID))
             {
                 RTI->log("ERROR: Parsing the RAID directory was not successful.");
-                RTI->log("ERROR: Conversion error for fileID: " + temp);
-                RTI->log("ERROR: Original line: " + origLine);
+                RTI->log("ERROR: Conversion error for fileID: " + parser.getLastField());
+                RTI->log("ERROR: Original line: " + parser.getLine());
                 RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Unable to parse RAID succesfully");
                 return false;
             }
@@ -684,20 +632,48 @@ bool rdsRaid::parseOutputDirectory()
 #endif
             }
 
-            // ## MeasID
-            temp=raidLine.left(11);
-            raidLine.remove(0,11);
-            temp.remove(" ");
-            raidEntry.measID=temp.toInt(&res);
+            // ## Evaluate the RAID index
+            if ((useRaidIndex) && (!raidIndexChecked) && (!raidIndex.isEmpty()))
+            {
+                raidIndexChecked=true;
+
+                if (raidEntry.fileID<raidIndex.getNewestFileID())
+                {
+                    // Same as for the LPFI: If the latest file on the RAID has a smaller fileID
+                    // than the latest cached file, the RAID has been reset or an overlap of the
+                    // fileID has occurred. Therefore, the index cannot be used.
+                    RTI->log("RAID index is outdated (FileID reset). Reading complete directory.");
+                    raidIndex.clear();
+                }
+            }
 
-            if (!res)
+            // ## MeasID
+            if (!parser.readNumber(11, raidEntry.measID))
             {
                 RTI->log("ERROR: Parsing the RAID directory was not successful.");
-                RTI->log("ERROR: Conversion error for measID: " + temp);
+                RTI->log("ERROR: Conversion error for measID: " + parser.getLastField());
                 RTI_NETLOG.postEvent(EventInfo::Type::Update, EventInfo::Detail::Information, EventInfo::Severity::Error, "Unable to parse RAID (conv error measID)");
                 return false;
             }
 
+            if ((useRaidIndex) && (raidEntry.fileID<=raidIndex.getNewestFileID()))
+            {
+                int position=raidIndex.indexOf(raidEntry.fileID);
+
+                if (position>=0)
+                {
+                    if (raidIndex.getEntry(position)->measID==raidEntry.measID)
+                    {
+                        // This and all older scans are known from the index. We can stop here
+                        raidIndexPosition=position;
+                        break;
+                    }
+
+                    RTI->log("RAID index does not match RAID directory. Reading complete directory.");
+                    raidIndex.clear();
+                }
+            }
+
             if (raidEntry.measID >= 3000000)
             {
                 // Measurement is a retrorecon. These data sets should not be saved.
@@ -705,79 +681,26 @@ bool rdsRaid::parseOutputDirectory()
             else
             {
                 // VB13 and VB15 have a different format (no patient name) and require
-                // a different processing (encapsulated in helper function)
+                // a different processing
                 if (RTI->getRaidToolFormat()==rdsRuntimeInformation::RDS_RAIDTOOL_VB15)
                 {
-                    parseVB15Line(raidLine, &raidEntry);
+                    parser.readColumnsVB15(&raidEntry);
                 }
                 else
                 {
                     // Parse the line for all other software versions
-
-                    // ## protName
-
-                    // The next 32 chars will be definitely the protocol. NOTE: The protocol name
-                    // can be longer than 32 characters as well as the patient name. Therefore, it
-                    // is not possible to separate both entries for lengths > 32 because both values
-                    // can contain space characters.
-                    temp=raidLine.left(32);
-                    raidLine.remove(0,32);
-                    removePrecedingSpace(temp);
-                    raidEntry.protName=temp;
-
-                    // Now start evaluating the string from the back because we do not know how long
-                    // the combination of protName + patName is (these can be longer than 32 characters)
-
-                    // ## Closing date
-                    temp=raidLine.right(22);
-                    raidLine.chop(22);
-                    removePrecedingSpace(temp);
-                    raidEntry.closingTime=QDateTime::fromString(temp,"dd.MM.yyyy HH:mm:ss");
-
-                    // ## Creation date
-                    temp=raidLine.right(22);
-                    raidLine.chop(22);
-                    removePrecedingSpace(temp);
-                    raidEntry.creationTime=QDateTime::fromString(temp,"dd.MM.yyyy HH:mm:ss");
-
-                    // ## Size on disk
-                    temp=raidLine.right(13);
-                    raidLine.chop(13);
-                    removePrecedingSpace(temp);
-                    raidEntry.sizeOnDisk=temp.toLongLong();
-
-                    // ## Size
-                    temp=raidLine.right(13);
-                    raidLine.chop(13);
-                    removePrecedingSpace(temp);
-                    raidEntry.size=temp.toLongLong();
+                    parser.readColumns(&raidEntry, skipEntry, trimPatName);
 
                     // TODO: On VB17, exclude these weird preceding files with small size and identical protocol name
                     //       Check if these files always have the same size, so that they can be identified based on the size.
 
-                    // Check the status information for active scans
-                    temp=raidLine.right(9);
-                    if (temp.contains("wip"))
+                    if (skipEntry)
                     {
                         // Scan is not closed. This can only be the case for the first
                         // file on raid. This means, scanning is active. Raw data storate
                         // should be postponed. Scan info transfer can take place.
                         scanActive=true;
-                        skipEntry=true;
                     }
-                    raidLine.chop(9);                    
-
-                    // ## PatName
-                    // The remaining part should be the patient name
-                    temp=raidLine;
-
-                    // For RDS the patient name should not be trimmed as this might confuse the
-                    // exam aggregation mechanism of the log server backend
-                #ifndef YARRA_APP_RDS
-                    removePrecedingSpace(temp);
-                #endif
-
-                    raidEntry.patName=temp;
 
                     //TODO: The patient name might still contain the date of birth.
                     //      In this case, the format is patname,YYYYMMDD
@@ -792,6 +715,21 @@ bool rdsRaid::parseOutputDirectory()
         }
     }
 
+    if ((useRaidIndex) && (isSuccess) && (dirHeadFound))
+    {
+        if (raidIndexPosition>=0)
+        {
+            mergeRaidIndex(raidIndexPosition, parser);
+        }
+
+        raidIndex.setEntries(raidList);
+
+        if (!raidIndex.save(getRaidIndexPath()))
+        {
+            RTI->log("WARNING: Unable to save RAID index " + getRaidIndexPath());
+        }
+    }
+
     if (!dirHeadFound)
     {
         RTI->log("ERROR: Could not receive RAID directory.");
@@ -819,50 +757,60 @@ bool rdsRaid::parseOutputDirectory()
 }
 
 
-bool rdsRaid::parseVB15Line(QString line, rdsRaidEntry* entry)
+void rdsRaid::mergeRaidIndex(int position, rdsRaidParser& parser)
 {
-    // Format is should be %7u%11u%16s%9s%13I64u%13I64u%22s%22s
-
-    // Start evaluating the string from the back because we do not know how long
-    // the protName is (can be longer than 16 characters)
-
-    // ## Closing date
-    QString temp=line.right(22);
-    line.chop(22);
-    removePrecedingSpace(temp);
-    entry->closingTime=QDateTime::fromString(temp,"dd.MM.yyyy HH:mm:ss");
-
-    // ## Creation date
-    temp=line.right(22);
-    line.chop(22);
-    removePrecedingSpace(temp);
-    entry->creationTime=QDateTime::fromString(temp,"dd.MM.yyyy HH:mm:ss");
-
-    // ## Size on disk
-    temp=line.right(13);
-    line.chop(13);
-    removePrecedingSpace(temp);
-    entry->sizeOnDisk=temp.toLongLong();
-
-    // ## Size
-    temp=line.right(13);
-    line.chop(13);
-    removePrecedingSpace(temp);
-    entry->size=temp.toLongLong();
-
-    // The Status information is not evaluated
-    line.chop(9);
-
-    // ## ProtName
-    // The remaining part should be the protocol name
-    temp=line;
-    removePrecedingSpace(temp);
-    entry->protName=temp;
-
-    // Patient name is not available from the VB15/13 RaidTool
-    entry->patName="Not available";
+    // Scans can also be deleted from the middle of the RAID (e.g., by the user), so only
+    // cached entries that are still listed in the directory can be taken. Parsing has
+    // stopped at the first known entry, so collect the fileIDs of the remaining lines.
+    // Only the fileID column is read for these lines, which is cheap.
+    QSet<int> listedFileIDs;
+    listedFileIDs.insert(raidIndex.getEntry(position)->fileID);
 
-    return true;
+    while (parser.nextLine())
+    {
+        if ((parser.getLineLength()==0)
+            || (parser.lineContains(RDS_RAID_VD_IGNORE1)) || (parser.lineContains(RDS_RAID_VD_IGNORE2)))
+        {
+            continue;
+        }
+
+        int fileID=0;
+
+        if (parser.readNumber(7, fileID))
+        {
+            listedFileIDs.insert(fileID);
+        }
+    }
+
+    int newCount=raidList.count();
+    int droppedCount=0;
+
+    for (int i=position; i<raidIndex.getCount(); i++)
+    {
+        rdsRaidEntry* entry=raidIndex.getEntry(i);
+
+        if (!listedFileIDs.contains(entry->fileID))
+        {
+            // Scan has been deleted from the RAID. The entry is also removed from the
+            // index, as the index is written from the RAID list afterwards
+            droppedCount++;
+            continue;
+        }
+
+#ifdef YARRA_APP_ORT
+        // Same limit as for parsing the directory
+        if (raidList.count()>ORT_RAID_MAXPARSECOUNT)
+        {
+            break;
+        }
+#endif
+
+        addRaidEntry(entry);
+    }
+
+    RTI->debug("Parsed " + QString::number(newCount) + " new entries, "
+               + QString::number(raidList.count()-newCount) + " entries taken from RAID index, "
+               + QString::number(droppedCount) + " deleted entries dropped.");
 }
 
 
@@ -870,6 +818,10 @@ bool rdsRaid::createExportList()
 {   
     exportList.clear();
 
+    // The exported files are only taken by the pipelined update, so discard the files
+    // of the previous update (otherwise, the list would grow in the other modes)
+    exportedFiles.clear();
+
     int raidCount=raidList.count();
     int raidIndex=0;  
 
@@ -1008,6 +960,35 @@ bool rdsRaid::exportsAvailable()
 }
 
 
+qint64 rdsRaid::getNextExportSize()
+{
+    if (exportList.count()==0)
+    {
+        return 0;
+    }
+
+    rdsRaidEntry* entry=getRaidEntry(getFirstExportEntry()->raidIndex);
+
+    if (entry==0)
+    {
+        return 0;
+    }
+
+    return entry->size;
+}
+
+
+QStringList rdsRaid::takeExportedFiles()
+{
+    // Returns the files that have been completely written to the queue directory
+    // since the last call, so that they can be transferred while the next scan is
+    // exported
+    QStringList files=exportedFiles;
+    exportedFiles.clear();
+    return files;
+}
+
+
 bool rdsRaid::exportScanFromList()
 {
     if (exportList.count()==0)
@@ -1076,6 +1057,8 @@ bool rdsRaid::exportScanFromList()
         RDS_RETONERR( anonymizeCurrentFile() );
     }
 
+    exportedFiles.append(currentFilename);
+
     // Fetch the depending adjustment scans, but only for VB line.
     // The VD line provides the option to store adjustment data
     // automatically.
@@ -1095,6 +1078,8 @@ bool rdsRaid::exportScanFromList()
             {
                 RDS_RETONERR( anonymizeCurrentFile() );
             }
+
+            exportedFiles.append(currentFilename);
         }
     }
 
@@ -1224,15 +1209,19 @@ void rdsRaid::dumpRaidToolOutput(QString filename)
     }
     dumpFile.open(QIODevice::ReadWrite | QIODevice::Text);
 
-    QString line = QString(RDS_RAID_DEBUG_HEADER) + QString::number(raidToolOutput.count());
+    rdsRaidParser parser;
+    parser.setData(raidToolOutput);
+
+    QString line = QString(RDS_RAID_DEBUG_HEADER) + QString::number(parser.getLineCount());
     dumpFile.write(line.toLatin1());
     line="\n";
     dumpFile.write(line.toLatin1());
 
-    for (int i=0; i < raidToolOutput.count(); i++)
+    dumpFile.write(raidToolOutput);
+
+    if ((!raidToolOutput.isEmpty()) && (!raidToolOutput.endsWith('\n')))
     {
-        line=raidToolOutput.at(i);
-        dumpFile.write(line.toLatin1());
+        dumpFile.write("\n");
     }
 
     line=QString(RDS_RAID_DEBUG_FOOTER)+"\n";
@@ -1409,7 +1398,8 @@ bool rdsRaid::debugReadTestFile(QString filename)
         {
             continue;
         }
-        raidToolOutput.append(input);
+        raidToolOutput.append(input.toUtf8());
+        raidToolOutput.append("\n");
         i++;
     }
     RTI->debug("Lines read from test file: "+QString::number(i));
@@ -4,34 +4,8 @@
 #include <QtWidgets>
 
 #include "rds_global.h"
-
-
-#define RDS_SCANATTRIBUTE_UNKNOWN      -1
-#define RDS_SCANATTRIBUTE_ERROR         0
-#define RDS_SCANATTRIBUTE_OK            1
-#define RDS_SCANATTRIBUTE_USERCANCEL    3
-
-
-#define RDS_VERBOSEATTRIBUTE_ERROR      "0000"
-#define RDS_VERBOSEATTRIBUTE_OK         "0001"
-#define RDS_VERBOSEATTRIBUTE_USERCANCEL "0003"
-
-
-class rdsRaidEntry
-{
-public:
-    int       fileID;
-    int       measID;
-    QString   protName;
-    QString   patName;
-    qint64    size;
-    qint64    sizeOnDisk;
-    QDateTime creationTime;
-    QDateTime closingTime;
-    int       attribute;
-
-    void addToUrlQuery(QUrlQuery& query);
-};
+#include "rds_raidparser.h"
+#include "rds_raidindex.h"
 
 
 class rdsExportEntry
@@ -57,13 +31,12 @@ public:
     bool processTotalExportList();
     bool processExportListEntry();
     bool exportsAvailable();
+    qint64 getNextExportSize();
+    QStringList takeExportedFiles();
 
     void dumpRaidList(QString filename);
     void dumpRaidToolOutput(QString filename);
 
-    void chopDependingIDs(QString& text);
-    void chopDependingIDsVerbose(QString& text, int& scanAttribute, QString& unknownAttribute);
-
     bool isPatchedRaidToolMissing();
 
     bool readRaidList();
@@ -80,6 +53,7 @@ public:
     QString currentFilename;
 
     void setIgnoreLPFI();
+    void setUseRaidIndex();
 
     // For ORT-use only
     bool saveSingleFile(int fileID,  bool saveAdjustments, QString modeID,
@@ -107,9 +81,9 @@ public:
 
 protected:
 
-    bool parseVB15Line(QString line, rdsRaidEntry* entry);
     bool parseOutputDirectory();
     bool parseOutputFileExport();
+    void mergeRaidIndex(int position, rdsRaidParser& parser);
     bool exportScanFromList();
 
     bool setCurrentFileID();
@@ -122,12 +96,13 @@ protected:
 
     bool callRaidTool(QStringList command, QStringList options, int timeout=RDS_PROC_TIMEOUT);
 
-    QStringList raidToolOutput;
+    QByteArray raidToolOutput;
 
     QString raidToolCmd;
     QString raidToolIP;
 
     QList<rdsExportEntry*> exportList;
+    QStringList exportedFiles;
 
     int lastProcessedFileID;
     int lastProcessedFileIDScaninfo;
@@ -143,12 +118,16 @@ protected:
     void addRaidEntry(int fileID, int measID, QString protName, QString patName, qint64 size, qint64 sizeOnDisk, QDateTime creationTime, int attribute=RDS_SCANATTRIBUTE_OK);
     void addRaidEntry(rdsRaidEntry* source);
 
-    void removePrecedingSpace(QString& text);
-
     bool usePatchedRaidTool;
     bool patchedRaidToolMissing;
 
     bool ignoreLPFID;
+
+    bool         useRaidIndex;
+    bool         raidIndexLoaded;
+    rdsRaidIndex raidIndex;
+
+    QString getRaidIndexPath();
     bool scanActive;
 
     bool useVerboseMode;
@@ -291,99 +270,28 @@ inline void rdsRaid::addRaidEntry(rdsRaidEntry* source)
 }
 
 
-inline void rdsRaid::removePrecedingSpace(QString& text)
-{
-    while ((text.length()!=0) && (text.at(0)==' '))
-    {
-        text.remove(0,1);
-    }
-}
-
-
-inline void rdsRaid::chopDependingIDs(QString& text)
+inline bool rdsRaid::isPatchedRaidToolMissing()
 {
-    int length=text.length();
-
-    if (length==0)
-    {
-        return;
-    }    
-
-    int colon=text.lastIndexOf(":");
-
-    if (colon != length-3)
-    {
-        text.chop(length-(colon+3));
-    }
+    return patchedRaidToolMissing;
 }
 
 
-inline void rdsRaid::chopDependingIDsVerbose(QString& text, int& scanAttribute, QString& unknownAttribute)
+inline void rdsRaid::setIgnoreLPFI()
 {
-    scanAttribute=RDS_SCANATTRIBUTE_OK;
-
-    int length=text.length();
-    int colonPos =text.lastIndexOf(":");
-    int attribPos=colonPos+20;
-
-    if ((length==0) || (colonPos==-1))
-    {
-        return;
-    }
-
-    // Check if the line has the verbose format
-    if (text.length()>attribPos)
-    {
-        QString attrSubString=text.mid(colonPos+5,16);
-
-        // Check for OK first. This will apply to most entry and avoids
-        // running two compares.
-        if (attrSubString.endsWith(RDS_VERBOSEATTRIBUTE_OK))
-        {
-            scanAttribute=RDS_SCANATTRIBUTE_OK;
-        }
-        else
-        {
-            if (attrSubString.endsWith(RDS_VERBOSEATTRIBUTE_ERROR))
-            {
-                scanAttribute=RDS_SCANATTRIBUTE_ERROR;
-            }
-            else
-            {
-                if (attrSubString.endsWith(RDS_VERBOSEATTRIBUTE_USERCANCEL))
-                {
-                    scanAttribute=RDS_SCANATTRIBUTE_USERCANCEL;
-                }
-                else
-                {
-                    scanAttribute=RDS_SCANATTRIBUTE_UNKNOWN;
-                    unknownAttribute=attrSubString;
-                }
-            }
-        }
-    }
-    else
-    {
-        missingVerboseData=true;
-    }
-
-    // Chop of the tail of the entry 3 chars after the last ":" of the closing date
-    if (colonPos != length-3)
-    {
-        text.chop(length-(colonPos+3));
-    }
+    ignoreLPFID=true;
 }
 
 
-inline bool rdsRaid::isPatchedRaidToolMissing()
+inline void rdsRaid::setUseRaidIndex()
 {
-    return patchedRaidToolMissing;
+    useRaidIndex=true;
 }
 
 
-inline void rdsRaid::setIgnoreLPFI()
+inline QString rdsRaid::getRaidIndexPath()
 {
-    ignoreLPFID=true;
+    // The index is stored next to the LPFI file
+    return QFileInfo(RTI->getLpfiPath()).absolutePath() + RDS_RAIDINDEX_NAME;
 }
 
 
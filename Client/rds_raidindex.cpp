@@ -0,0 +1,158 @@
+#include "rds_raidindex.h"
+
+
+rdsRaidIndex::rdsRaidIndex()
+{
+}
+
+
+rdsRaidIndex::~rdsRaidIndex()
+{
+    clear();
+}
+
+
+void rdsRaidIndex::clear()
+{
+    while (!entries.isEmpty())
+    {
+        delete entries.takeFirst();
+    }
+}
+
+
+bool rdsRaidIndex::load(QString filename)
+{
+    clear();
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic=0;
+    quint32 version=0;
+    qint32  count=0;
+
+    stream >> magic >> version >> count;
+
+    if ((magic!=RDS_RAIDINDEX_MAGIC) || (version!=RDS_RAIDINDEX_VERSION) || (count<0))
+    {
+        return false;
+    }
+
+    for (int i=0; i<count; i++)
+    {
+        rdsRaidEntry* entry=new rdsRaidEntry;
+
+        qint32 fileID=0;
+        qint32 measID=0;
+        qint32 attribute=0;
+
+        stream >> fileID >> measID >> entry->protName >> entry->patName
+               >> entry->size >> entry->sizeOnDisk >> entry->creationTime >> entry->closingTime
+               >> attribute;
+
+        entry->fileID=fileID;
+        entry->measID=measID;
+        entry->attribute=attribute;
+
+        entries.append(entry);
+    }
+
+    // Don't use a truncated or otherwise damaged file
+    if (stream.status()!=QDataStream::Ok)
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool rdsRaidIndex::save(QString filename)
+{
+    // Write into a temporary file first, so that the index is never left incomplete
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << quint32(RDS_RAIDINDEX_MAGIC) << quint32(RDS_RAIDINDEX_VERSION) << qint32(entries.count());
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        const rdsRaidEntry* entry=entries.at(i);
+
+        stream << qint32(entry->fileID) << qint32(entry->measID) << entry->protName << entry->patName
+               << entry->size << entry->sizeOnDisk << entry->creationTime << entry->closingTime
+               << qint32(entry->attribute);
+    }
+
+    if (stream.status()!=QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+
+int rdsRaidIndex::indexOf(int fileID)
+{
+    // The entries are sorted by decreasing FileID
+    int low=0;
+    int high=entries.count()-1;
+
+    while (low<=high)
+    {
+        int middle=(low+high)/2;
+        int middleID=entries.at(middle)->fileID;
+
+        if (middleID==fileID)
+        {
+            return middle;
+        }
+
+        if (middleID>fileID)
+        {
+            low=middle+1;
+        }
+        else
+        {
+            high=middle-1;
+        }
+    }
+
+    return -1;
+}
+
+
+void rdsRaidIndex::setEntries(const QList<rdsRaidEntry*>& list)
+{
+    clear();
+
+    for (int i=0; i<list.count(); i++)
+    {
+        // If the FileID wrapped around within the list, only the part after the
+        // wrap is kept, so that the FileIDs remain decreasing
+        if ((i>0) && (list.at(i)->fileID>=list.at(i-1)->fileID))
+        {
+            break;
+        }
+
+        entries.append(new rdsRaidEntry(*list.at(i)));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef RDS_RAIDINDEX_H
+#define RDS_RAIDINDEX_H
+
+#include <QtCore>
+
+#include "rds_raidparser.h"
+
+#define RDS_RAIDINDEX_NAME    "/raidindex.dat"
+#define RDS_RAIDINDEX_MAGIC   0x52444958
+#define RDS_RAIDINDEX_VERSION 1
+
+
+// Snapshot of the parsed RAID directory that is stored on the disk. As the FileIDs
+// on the RAID are increasing, only entries with a FileID above the highest cached
+// FileID need to be parsed when the directory is read again. The entries are
+// stored in the order of the RAID directory (newest first) with decreasing FileIDs.
+class rdsRaidIndex
+{
+public:
+    rdsRaidIndex();
+    ~rdsRaidIndex();
+
+    bool load(QString filename);
+    bool save(QString filename);
+    void clear();
+
+    bool isEmpty();
+    int  getCount();
+    int  getNewestFileID();
+
+    int  indexOf(int fileID);
+    rdsRaidEntry* getEntry(int index);
+
+    void setEntries(const QList<rdsRaidEntry*>& list);
+
+protected:
+    QList<rdsRaidEntry*> entries;
+};
+
+
+inline bool rdsRaidIndex::isEmpty()
+{
+    return entries.isEmpty();
+}
+
+
+inline int rdsRaidIndex::getCount()
+{
+    return entries.count();
+}
+
+
+inline int rdsRaidIndex::getNewestFileID()
+{
+    if (entries.isEmpty())
+    {
+        return -1;
+    }
+
+    return entries.at(0)->fileID;
+}
+
+
+inline rdsRaidEntry* rdsRaidIndex::getEntry(int index)
+{
+    if ((index<0) || (index>=entries.count()))
+    {
+        return 0;
+    }
+
+    return entries.at(index);
+}
+
+
+#endif // RDS_RAIDINDEX_H
@@ -0,0 +1,442 @@
+#include "rds_raidparser.h"
+
+#include <limits.h>
+
+
+static bool rangeContains(const char* begin, const char* end, const char* pattern)
+{
+    const int patternLength=int(strlen(pattern));
+
+    if (patternLength==0)
+    {
+        return true;
+    }
+
+    const char* last=end-patternLength;
+
+    if (end-begin < patternLength)
+    {
+        return false;
+    }
+
+    // Jump to the candidates with memchr and only compare there
+    const char* pos=begin;
+
+    while (pos<=last)
+    {
+        pos=(const char*) memchr(pos, pattern[0], last-pos+1);
+
+        if (pos==0)
+        {
+            return false;
+        }
+
+        if (memcmp(pos, pattern, patternLength)==0)
+        {
+            return true;
+        }
+
+        pos++;
+    }
+
+    return false;
+}
+
+
+static inline void skipSpaces(const char*& begin, const char* end)
+{
+    while ((begin<end) && (*begin==' '))
+    {
+        begin++;
+    }
+}
+
+
+static bool parseInteger(const char* begin, const char* end, qint64& value)
+{
+    value=0;
+
+    // Leading and trailing white space is ignored (as for QString::toLongLong)
+    while ((begin<end) && ((*begin==' ') || (*begin=='\t')))
+    {
+        begin++;
+    }
+    while ((end>begin) && ((*(end-1)==' ') || (*(end-1)=='\t')))
+    {
+        end--;
+    }
+
+    bool negative=false;
+
+    if ((begin<end) && ((*begin=='-') || (*begin=='+')))
+    {
+        negative=(*begin=='-');
+        begin++;
+    }
+
+    if ((begin==end) || (end-begin>18))
+    {
+        return false;
+    }
+
+    qint64 result=0;
+
+    for (const char* c=begin; c<end; c++)
+    {
+        if ((*c<'0') || (*c>'9'))
+        {
+            return false;
+        }
+        result=result*10+(*c-'0');
+    }
+
+    value=negative ? -result : result;
+    return true;
+}
+
+
+static inline int parseDigits(const char* text, int count)
+{
+    int result=0;
+
+    for (int i=0; i<count; i++)
+    {
+        result=result*10+(text[i]-'0');
+    }
+
+    return result;
+}
+
+
+static QDateTime parseDateTime(const char* begin, const char* end)
+{
+    // Equivalent to QDateTime::fromString(text, "dd.MM.yyyy HH:mm:ss") after removing
+    // the preceding spaces
+    static const char layout[]="00.00.0000 00:00:00";
+    const int layoutLength=sizeof(layout)-1;
+
+    skipSpaces(begin, end);
+
+    if (end-begin!=layoutLength)
+    {
+        return QDateTime();
+    }
+
+    for (int i=0; i<layoutLength; i++)
+    {
+        if (layout[i]=='0')
+        {
+            if ((begin[i]<'0') || (begin[i]>'9'))
+            {
+                return QDateTime();
+            }
+        }
+        else
+        {
+            if (begin[i]!=layout[i])
+            {
+                return QDateTime();
+            }
+        }
+    }
+
+    QDate date(parseDigits(begin+6, 4), parseDigits(begin+3, 2), parseDigits(begin, 2));
+    QTime time(parseDigits(begin+11, 2), parseDigits(begin+14, 2), parseDigits(begin+17, 2));
+
+    if ((!date.isValid()) || (!time.isValid()))
+    {
+        return QDateTime();
+    }
+
+    return QDateTime(date, time);
+}
+
+
+
+rdsRaidParser::rdsRaidParser()
+{
+    setData(QByteArray());
+}
+
+
+void rdsRaidParser::setData(const QByteArray& data)
+{
+    // Keeps a shallow copy, so that the data stays valid while parsing
+    buffer=data;
+
+    nextLineBegin=buffer.constData();
+    dataEnd=nextLineBegin+buffer.size();
+
+    lineBegin=nextLineBegin;
+    lineEnd=nextLineBegin;
+    front=nextLineBegin;
+    back=nextLineBegin;
+    fieldBegin=nextLineBegin;
+    fieldEnd=nextLineBegin;
+}
+
+
+int rdsRaidParser::getLineCount() const
+{
+    const char* pos=buffer.constData();
+    int count=0;
+
+    while (pos<dataEnd)
+    {
+        const char* lineBreak=(const char*) memchr(pos, '\n', dataEnd-pos);
+        count++;
+
+        if (lineBreak==0)
+        {
+            break;
+        }
+        pos=lineBreak+1;
+    }
+
+    return count;
+}
+
+
+bool rdsRaidParser::nextLine()
+{
+    if (nextLineBegin>=dataEnd)
+    {
+        return false;
+    }
+
+    lineBegin=nextLineBegin;
+
+    const char* lineBreak=(const char*) memchr(lineBegin, '\n', dataEnd-lineBegin);
+
+    if (lineBreak==0)
+    {
+        lineEnd=dataEnd;
+        nextLineBegin=dataEnd;
+    }
+    else
+    {
+        lineEnd=lineBreak;
+        nextLineBegin=lineBreak+1;
+    }
+
+    // Remove the CR at the end
+    while ((lineEnd>lineBegin) && (*(lineEnd-1)=='\r'))
+    {
+        lineEnd--;
+    }
+
+    front=lineBegin;
+    back=lineEnd;
+    fieldBegin=lineBegin;
+    fieldEnd=lineBegin;
+
+    return true;
+}
+
+
+bool rdsRaidParser::lineContains(const char* pattern) const
+{
+    return rangeContains(lineBegin, lineEnd, pattern);
+}
+
+
+void rdsRaidParser::chopDependingIDs()
+{
+    // For the VD13+ format, chop the IDs of the depending scans from the end of the line,
+    // 3 chars after the last ":" of the closing date
+    const int length=int(back-front);
+    const int colon=findLastColon();
+
+    if (length==0)
+    {
+        return;
+    }
+
+    if (colon+3 < length)
+    {
+        back=front+colon+3;
+    }
+}
+
+
+void rdsRaidParser::chopDependingIDsVerbose(int& scanAttribute, QString& unknownAttribute, bool& missingData)
+{
+    scanAttribute=RDS_SCANATTRIBUTE_OK;
+
+    const int length=int(back-front);
+    const int colon=findLastColon();
+
+    if ((length==0) || (colon==-1))
+    {
+        return;
+    }
+
+    // Check if the line has the verbose format. The attribute is given by the last
+    // 4 chars of the 16 chars that follow 5 chars after the colon.
+    if (length > colon+20)
+    {
+        const char* attribute=front+colon+17;
+
+        // Check for OK first. This will apply to most entry and avoids
+        // running two compares.
+        if (memcmp(attribute, RDS_VERBOSEATTRIBUTE_OK, 4)==0)
+        {
+            scanAttribute=RDS_SCANATTRIBUTE_OK;
+        }
+        else
+        {
+            if (memcmp(attribute, RDS_VERBOSEATTRIBUTE_ERROR, 4)==0)
+            {
+                scanAttribute=RDS_SCANATTRIBUTE_ERROR;
+            }
+            else
+            {
+                if (memcmp(attribute, RDS_VERBOSEATTRIBUTE_USERCANCEL, 4)==0)
+                {
+                    scanAttribute=RDS_SCANATTRIBUTE_USERCANCEL;
+                }
+                else
+                {
+                    scanAttribute=RDS_SCANATTRIBUTE_UNKNOWN;
+                    unknownAttribute=QString::fromUtf8(front+colon+5, 16);
+                }
+            }
+        }
+    }
+    else
+    {
+        missingData=true;
+    }
+
+    // Chop of the tail of the entry 3 chars after the last ":" of the closing date
+    if (colon+3 < length)
+    {
+        back=front+colon+3;
+    }
+}
+
+
+int rdsRaidParser::findLastColon() const
+{
+    // Position of the last ":" in the unconsumed part of the line, or -1
+    for (const char* pos=back; pos>front; pos--)
+    {
+        if (*(pos-1)==':')
+        {
+            return int(pos-1-front);
+        }
+    }
+
+    return -1;
+}
+
+
+bool rdsRaidParser::readNumber(int width, int& value)
+{
+    takeLeft(width);
+
+    qint64 number=0;
+
+    if ((!parseInteger(fieldBegin, fieldEnd, number)) || (number<INT_MIN) || (number>INT_MAX))
+    {
+        value=0;
+        return false;
+    }
+
+    value=int(number);
+    return true;
+}
+
+
+void rdsRaidParser::readColumns(rdsRaidEntry* entry, bool& scanOpen, bool trimPatName)
+{
+    qint64 number=0;
+    scanOpen=false;
+
+    // ## protName
+    // The next 32 chars will be definitely the protocol. NOTE: The protocol name
+    // can be longer than 32 characters as well as the patient name. Therefore, it
+    // is not possible to separate both entries for lengths > 32 because both values
+    // can contain space characters.
+    takeLeft(32);
+    skipSpaces(fieldBegin, fieldEnd);
+    entry->protName=QString::fromUtf8(fieldBegin, int(fieldEnd-fieldBegin));
+
+    // Now start evaluating the line from the back because we do not know how long
+    // the combination of protName + patName is
+
+    // ## Closing date
+    takeRight(22);
+    entry->closingTime=parseDateTime(fieldBegin, fieldEnd);
+
+    // ## Creation date
+    takeRight(22);
+    entry->creationTime=parseDateTime(fieldBegin, fieldEnd);
+
+    // ## Size on disk
+    takeRight(13);
+    parseInteger(fieldBegin, fieldEnd, number);
+    entry->sizeOnDisk=number;
+
+    // ## Size
+    takeRight(13);
+    parseInteger(fieldBegin, fieldEnd, number);
+    entry->size=number;
+
+    // Check the status information for active scans
+    takeRight(9);
+    scanOpen=rangeContains(fieldBegin, fieldEnd, "wip");
+
+    // ## PatName
+    // The remaining part should be the patient name
+    fieldBegin=front;
+    fieldEnd=back;
+
+    if (trimPatName)
+    {
+        skipSpaces(fieldBegin, fieldEnd);
+    }
+
+    entry->patName=QString::fromUtf8(fieldBegin, int(fieldEnd-fieldBegin));
+}
+
+
+void rdsRaidParser::readColumnsVB15(rdsRaidEntry* entry)
+{
+    // Format is should be %7u%11u%16s%9s%13I64u%13I64u%22s%22s
+    qint64 number=0;
+
+    // Start evaluating the line from the back because we do not know how long
+    // the protName is (can be longer than 16 characters)
+
+    // ## Closing date
+    takeRight(22);
+    entry->closingTime=parseDateTime(fieldBegin, fieldEnd);
+
+    // ## Creation date
+    takeRight(22);
+    entry->creationTime=parseDateTime(fieldBegin, fieldEnd);
+
+    // ## Size on disk
+    takeRight(13);
+    parseInteger(fieldBegin, fieldEnd, number);
+    entry->sizeOnDisk=number;
+
+    // ## Size
+    takeRight(13);
+    parseInteger(fieldBegin, fieldEnd, number);
+    entry->size=number;
+
+    // The Status information is not evaluated
+    takeRight(9);
+
+    // ## ProtName
+    // The remaining part should be the protocol name
+    fieldBegin=front;
+    fieldEnd=back;
+    skipSpaces(fieldBegin, fieldEnd);
+    entry->protName=QString::fromUtf8(fieldBegin, int(fieldEnd-fieldBegin));
+
+    // Patient name is not available from the VB15/13 RaidTool
+    entry->patName="Not available";
+}
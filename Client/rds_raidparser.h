@@ -0,0 +1,123 @@
+#ifndef RDS_RAIDPARSER_H
+#define RDS_RAIDPARSER_H
+
+#include <QtCore>
+
+
+#define RDS_SCANATTRIBUTE_UNKNOWN      -1
+#define RDS_SCANATTRIBUTE_ERROR         0
+#define RDS_SCANATTRIBUTE_OK            1
+#define RDS_SCANATTRIBUTE_USERCANCEL    3
+
+
+#define RDS_VERBOSEATTRIBUTE_ERROR      "0000"
+#define RDS_VERBOSEATTRIBUTE_OK         "0001"
+#define RDS_VERBOSEATTRIBUTE_USERCANCEL "0003"
+
+
+class rdsRaidEntry
+{
+public:
+    int       fileID;
+    int       measID;
+    QString   protName;
+    QString   patName;
+    qint64    size;
+    qint64    sizeOnDisk;
+    QDateTime creationTime;
+    QDateTime closingTime;
+    int       attribute;
+
+    void addToUrlQuery(QUrlQuery& query);
+};
+
+
+// Parser for the directory listing of the RaidTool. It works directly on the raw
+// bytes of the process output and uses the fixed column widths of the listing
+// (%7u%11u%32s%32s%9s%13I64u%13I64u%22s%22s). The lines are not copied; strings
+// are only created for the protocol and patient name of each entry.
+//
+// Each line is consumed column by column: Columns are taken from the front of the
+// line with readNumber(), and readColumns() evaluates the remaining part from the
+// back, because protocol and patient name can exceed their column width.
+class rdsRaidParser
+{
+public:
+    rdsRaidParser();
+
+    void setData(const QByteArray& data);
+    int  getLineCount() const;
+
+    bool nextLine();
+    bool lineContains(const char* pattern) const;
+    int  getLineLength() const;
+    QString getLine() const;
+
+    void chopDependingIDs();
+    void chopDependingIDsVerbose(int& scanAttribute, QString& unknownAttribute, bool& missingData);
+
+    bool readNumber(int width, int& value);
+    void readColumns(rdsRaidEntry* entry, bool& scanOpen, bool trimPatName=true);
+    void readColumnsVB15(rdsRaidEntry* entry);
+
+    QString getLastField() const;
+
+protected:
+
+    void takeLeft(int width);
+    void takeRight(int width);
+    int  findLastColon() const;
+
+    QByteArray  buffer;
+    const char* dataEnd;
+    const char* nextLineBegin;
+
+    // Current line without the line break
+    const char* lineBegin;
+    const char* lineEnd;
+
+    // Part of the current line that has not been consumed yet
+    const char* front;
+    const char* back;
+
+    // Column that has been taken last
+    const char* fieldBegin;
+    const char* fieldEnd;
+};
+
+
+inline int rdsRaidParser::getLineLength() const
+{
+    return int(lineEnd-lineBegin);
+}
+
+
+inline QString rdsRaidParser::getLine() const
+{
+    return QString::fromUtf8(lineBegin, int(lineEnd-lineBegin));
+}
+
+
+inline QString rdsRaidParser::getLastField() const
+{
+    return QString::fromUtf8(fieldBegin, int(fieldEnd-fieldBegin));
+}
+
+
+inline void rdsRaidParser::takeLeft(int width)
+{
+    fieldBegin=front;
+    fieldEnd=(back-front > width) ? front+width : back;
+    front=fieldEnd;
+}
+
+
+inline void rdsRaidParser::takeRight(int width)
+{
+    fieldEnd=back;
+    fieldBegin=(back-front > width) ? back-width : front;
+    back=fieldBegin;
+}
+
+
+#endif // RDS_RAIDPARSER_H
@@ -22,11 +22,18 @@ SOURCES += main.cpp\
     ../CloudTools/yct_configuration.cpp \
     ../CloudTools/yct_aws/qtawsqnam.cpp \
     ../CloudTools/yct_aws/qtaws.cpp \
+    ../CloudTools/yct_aws/qtawss3.cpp \
     yca_transferindicator.cpp \
     ../CloudTools/yct_api.cpp \
+    ../CloudTools/yct_dicompatcher.cpp \
+    ../Client/rds_processrunner.cpp \
     yca_task.cpp \
     yca_threadlog.cpp \
-    yca_detailsdialog.cpp
+    yca_detailsdialog.cpp \
+    yca_workerpool.cpp \
+    yca_taskregistry.cpp \
+    yca_archivestore.cpp \
+    yca_taskjournal.cpp
 
 HEADERS  += yca_mainwindow.h \
     main.h \
@@ -36,11 +43,18 @@ HEADERS  += yca_mainwindow.h \
     ../CloudTools/yct_configuration.h \
     ../CloudTools/yct_aws/qtawsqnam.h \
     ../CloudTools/yct_aws/qtaws.h \
+    ../CloudTools/yct_aws/qtawss3.h \
     ../CloudTools/yct_api.h \
+    ../CloudTools/yct_dicompatcher.h \
+    ../Client/rds_processrunner.h \
     yca_transferindicator.h \
     yca_task.h \
     yca_threadlog.h \
-    yca_detailsdialog.h
+    yca_detailsdialog.h \
+    yca_workerpool.h \
+    yca_taskregistry.h \
+    yca_archivestore.h \
+    yca_taskjournal.h
 
 FORMS    += yca_mainwindow.ui \
     yca_transferindicator.ui \
@@ -0,0 +1,389 @@
+#include "yca_archivestore.h"
+#include "yca_threadlog.h"
+
+
+ycaArchiveStore::ycaArchiveStore()
+{
+    folderPath="";
+    filename="";
+    obsoleteRecords=0;
+}
+
+
+bool ycaArchiveStore::open(QString folder)
+{
+    QMutexLocker locker(&mutex);
+
+    folderPath=folder;
+    filename=folder+YCA_ARCHIVESTORE_NAME;
+
+    if (!load())
+    {
+        return false;
+    }
+
+    // Rewrite the file if most records have been replaced by newer ones
+    if (obsoleteRecords>tasks.count())
+    {
+        if (!compact())
+        {
+            YTL->log("Unable to compact archive store: "+filename,YTL_WARNING,YTL_MID);
+        }
+    }
+
+    int imported=importPHIFiles();
+
+    if (imported>0)
+    {
+        YTL->log("Imported "+QString::number(imported)+" PHI files into archive store",YTL_INFO,YTL_HIGH);
+    }
+
+    return true;
+}
+
+
+bool ycaArchiveStore::load()
+{
+    tasks.clear();
+    searchKeys.clear();
+    uuidIndex.clear();
+    obsoleteRecords=0;
+
+    QFile file(filename);
+
+    if (!file.exists())
+    {
+        // Create an empty store
+        return appendRecords(QList<ycaTask>());
+    }
+
+    // Like a record, the header can be cut off if the agent stopped while the store was
+    // created. No record can follow in this case, so the store is created again and the
+    // tasks are imported from the PHI files afterwards.
+    if (file.size()<qint64(2*sizeof(quint32)))
+    {
+        YTL->log("Recreating archive store with incomplete header: "+filename,YTL_WARNING,YTL_HIGH);
+
+        if (!file.resize(0))
+        {
+            YTL->log("Unable to reset archive store: "+filename,YTL_ERROR,YTL_HIGH);
+            return false;
+        }
+
+        return appendRecords(QList<ycaTask>());
+    }
+
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        YTL->log("Unable to open archive store: "+filename,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic=0;
+    quint32 version=0;
+    stream >> magic >> version;
+
+    if ((magic!=YCA_ARCHIVESTORE_MAGIC) || (version!=YCA_ARCHIVESTORE_VERSION))
+    {
+        YTL->log("Invalid archive store: "+filename,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    qint64 validSize=file.pos();
+
+    while (!stream.atEnd())
+    {
+        quint32    recordMagic=0;
+        QByteArray payload;
+        quint16    checksum=0;
+
+        stream >> recordMagic >> payload >> checksum;
+
+        if ((stream.status()!=QDataStream::Ok) || (recordMagic!=YCA_ARCHIVESTORE_RECORD)
+            || (checksum!=qChecksum(payload.constData(), payload.size())))
+        {
+            break;
+        }
+
+        ycaTask task;
+        if (!deserializeTask(payload, task))
+        {
+            break;
+        }
+
+        insertTask(task);
+        validSize=file.pos();
+    }
+
+    // Drop a record that has been cut off while it was written
+    if (validSize<file.size())
+    {
+        YTL->log("Removing incomplete record from archive store: "+filename,YTL_WARNING,YTL_HIGH);
+        file.resize(validSize);
+    }
+
+    return true;
+}
+
+
+bool ycaArchiveStore::appendRecords(const QList<ycaTask>& newTasks)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        YTL->log("Unable to write archive store: "+filename,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    if (file.size()==0)
+    {
+        stream << quint32(YCA_ARCHIVESTORE_MAGIC) << quint32(YCA_ARCHIVESTORE_VERSION);
+    }
+
+    for (int i=0; i<newTasks.count(); i++)
+    {
+        QByteArray payload=serializeTask(newTasks.at(i));
+        stream << quint32(YCA_ARCHIVESTORE_RECORD) << payload << quint16(qChecksum(payload.constData(), payload.size()));
+    }
+
+    file.flush();
+
+    return (stream.status()==QDataStream::Ok);
+}
+
+
+bool ycaArchiveStore::compact()
+{
+    // Write into a temporary file first, so that the store is never left incomplete
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << quint32(YCA_ARCHIVESTORE_MAGIC) << quint32(YCA_ARCHIVESTORE_VERSION);
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        QByteArray payload=serializeTask(tasks.at(i));
+        stream << quint32(YCA_ARCHIVESTORE_RECORD) << payload << quint16(qChecksum(payload.constData(), payload.size()));
+    }
+
+    if (stream.status()!=QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    obsoleteRecords=0;
+    return true;
+}
+
+
+int ycaArchiveStore::importPHIFiles()
+{
+    QDir archiveDir(folderPath);
+    QStringList fileList=archiveDir.entryList(QStringList("*.phi"),QDir::Files,QDir::Time | QDir::Reversed);
+
+    QList<ycaTask> importedTasks;
+
+    for (int i=0; i<fileList.count(); i++)
+    {
+        QString uuid=QFileInfo(fileList.at(i)).baseName();
+
+        if (uuidIndex.contains(uuid))
+        {
+            continue;
+        }
+
+        ycaTask task;
+        task.uuid=uuid;
+        task.status=ycaTask::tsArchived;
+
+        if (!taskHelper.readPHIData(archiveDir.absoluteFilePath(fileList.at(i)),&task))
+        {
+            YTL->log("Unable to import PHI file: "+fileList.at(i),YTL_ERROR,YTL_HIGH);
+            continue;
+        }
+
+        importedTasks.append(task);
+        insertTask(task);
+    }
+
+    if ((!importedTasks.isEmpty()) && (!appendRecords(importedTasks)))
+    {
+        return 0;
+    }
+
+    return importedTasks.count();
+}
+
+
+void ycaArchiveStore::insertTask(const ycaTask& task)
+{
+    if (uuidIndex.contains(task.uuid))
+    {
+        int index=uuidIndex.value(task.uuid);
+        tasks[index]=task;
+        searchKeys[index]=createSearchKey(task);
+        obsoleteRecords++;
+        return;
+    }
+
+    uuidIndex.insert(task.uuid, tasks.count());
+    tasks.append(task);
+    searchKeys.append(createSearchKey(task));
+}
+
+
+bool ycaArchiveStore::addTask(const ycaTask& task)
+{
+    QMutexLocker locker(&mutex);
+
+    ycaTask archivedTask=task;
+    archivedTask.status=ycaTask::tsArchived;
+
+    if (!appendRecords(QList<ycaTask>() << archivedTask))
+    {
+        return false;
+    }
+
+    insertTask(archivedTask);
+    return true;
+}
+
+
+bool ycaArchiveStore::contains(QString uuid)
+{
+    QMutexLocker locker(&mutex);
+    return uuidIndex.contains(uuid);
+}
+
+
+bool ycaArchiveStore::getTask(QString uuid, ycaTask& task)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!uuidIndex.contains(uuid))
+    {
+        return false;
+    }
+
+    task=tasks.at(uuidIndex.value(uuid));
+    return true;
+}
+
+
+int ycaArchiveStore::getCount()
+{
+    QMutexLocker locker(&mutex);
+    return tasks.count();
+}
+
+
+void ycaArchiveStore::getTasks(ycaTaskList& taskList)
+{
+    QMutexLocker locker(&mutex);
+
+    for (int i=tasks.count()-1; i>=0; i--)
+    {
+        taskList.append(new ycaTask(tasks.at(i)));
+    }
+}
+
+
+void ycaArchiveStore::search(QString text, ycaTaskList& taskList)
+{
+    QString searchText=text.trimmed().toLower();
+
+    if (searchText.isEmpty())
+    {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+
+    for (int i=tasks.count()-1; i>=0; i--)
+    {
+        if (searchKeys.at(i).contains(searchText))
+        {
+            taskList.append(new ycaTask(tasks.at(i)));
+        }
+    }
+}
+
+
+QString ycaArchiveStore::createSearchKey(const ycaTask& task)
+{
+    // The fields are separated by a character that cannot be entered in the search field
+    QStringList fields;
+    fields << task.patientName << task.mrn << task.acc << task.uuid << task.shortcode;
+
+    return fields.join(QChar('\n')).toLower();
+}
+
+
+QByteArray ycaArchiveStore::serializeTask(const ycaTask& task)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << task.uuid << task.patientName << task.mrn << task.dob << task.acc << task.taskID
+           << task.reconMode << task.shortcode << qint32(task.result) << task.cost << qint32(task.datasize)
+           << qint32(task.uploadRetry) << qint32(task.downloadRetry) << qint32(task.storageRetry)
+           << task.timeptCreated << task.timeptCompleted
+           << task.timeptUploadBegin << task.timeptUploadEnd
+           << task.timeptProcessingCreated << task.timeptProcessingBegin << task.timeptProcessingEnd
+           << task.timeptDownloadBegin << task.timeptDownloadEnd
+           << task.timeptStorageBegin << task.timeptStorageEnd;
+
+    return data;
+}
+
+
+bool ycaArchiveStore::deserializeTask(const QByteArray& data, ycaTask& task)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    qint32 result=0;
+    qint32 datasize=0;
+    qint32 uploadRetry=0;
+    qint32 downloadRetry=0;
+    qint32 storageRetry=0;
+
+    stream >> task.uuid >> task.patientName >> task.mrn >> task.dob >> task.acc >> task.taskID
+           >> task.reconMode >> task.shortcode >> result >> task.cost >> datasize
+           >> uploadRetry >> downloadRetry >> storageRetry
+           >> task.timeptCreated >> task.timeptCompleted
+           >> task.timeptUploadBegin >> task.timeptUploadEnd
+           >> task.timeptProcessingCreated >> task.timeptProcessingBegin >> task.timeptProcessingEnd
+           >> task.timeptDownloadBegin >> task.timeptDownloadEnd
+           >> task.timeptStorageBegin >> task.timeptStorageEnd;
+
+    task.status       =ycaTask::tsArchived;
+    task.result       =ycaTask::TaskResult(result);
+    task.datasize     =datasize;
+    task.uploadRetry  =uploadRetry;
+    task.downloadRetry=downloadRetry;
+    task.storageRetry =storageRetry;
+
+    return (stream.status()==QDataStream::Ok) && (!task.uuid.isEmpty());
+}
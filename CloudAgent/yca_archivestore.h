@@ -0,0 +1,67 @@
+#ifndef YCA_ARCHIVESTORE_H
+#define YCA_ARCHIVESTORE_H
+
+#include <QtCore>
+
+#include "yca_task.h"
+
+#define YCA_ARCHIVESTORE_NAME     "/archive.yas"
+#define YCA_ARCHIVESTORE_MAGIC    0x59434153
+#define YCA_ARCHIVESTORE_RECORD   0x59435244
+#define YCA_ARCHIVESTORE_VERSION  1
+
+
+// Store for the archived tasks. The tasks are kept in one append-only file in the
+// archive folder: Each archived task adds one checksummed record, and a record that
+// has been cut off by a crash is dropped when the file is opened again. The store is
+// loaded into memory once, with an index by UUID and a prepared search key for each
+// task, so that listing and searching the archive doesn't access the disk.
+//
+// The PHI files are still moved into the archive folder. PHI files that are not in
+// the store yet (e.g., from previous versions) are imported when the store is opened,
+// so the store can be rebuilt from the PHI files by deleting it.
+class ycaArchiveStore
+{
+public:
+    ycaArchiveStore();
+
+    bool open(QString folder);
+    bool addTask(const ycaTask& task);
+
+    bool contains(QString uuid);
+    bool getTask(QString uuid, ycaTask& task);
+    int  getCount();
+
+    // Appends copies of the tasks to the list (most recently archived first). The caller
+    // owns the copies.
+    void getTasks(ycaTaskList& taskList);
+    void search(QString text, ycaTaskList& taskList);
+
+    // Lowercase text of the searchable fields (name, MRN, ACC, UUID and shortcode)
+    static QString createSearchKey(const ycaTask& task);
+
+protected:
+    bool load();
+    bool appendRecords(const QList<ycaTask>& newTasks);
+    bool compact();
+    int  importPHIFiles();
+
+    void insertTask(const ycaTask& task);
+
+    static QByteArray serializeTask(const ycaTask& task);
+    static bool       deserializeTask(const QByteArray& data, ycaTask& task);
+
+    QMutex  mutex;
+    QString folderPath;
+    QString filename;
+
+    QVector<ycaTask>   tasks;
+    QVector<QString>   searchKeys;
+    QHash<QString,int> uuidIndex;
+    int                obsoleteRecords;
+
+    ycaTaskHelper taskHelper;
+};
+
+
+#endif // YCA_ARCHIVESTORE_H
@@ -9,6 +9,7 @@
 #include "../CloudTools/yct_common.h"
 #include "../CloudTools/yct_aws/qtaws.h"
 #include "yca_detailsdialog.h"
+#include "yca_workerpool.h"
 
 #include <iostream>
 
@@ -17,9 +18,13 @@ ycaWorker::ycaWorker()
 {
     processingActive=false;
     processingPaused=false;
-    currentProcess=ycaTask::wpIdle;
-    currentTaskID="";
     userInvalidShown=false;
+    parent=0;
+
+    // The signals of the pool are emitted from the job threads and are
+    // delivered into the worker thread
+    pool=new ycaWorkerPool();
+    connect(pool, SIGNAL(taskFinished(int,bool)), this, SLOT(jobFinished(int,bool)), Qt::QueuedConnection);
 
     moveToThread(&transferThread);
     transferTimer.moveToThread(&transferThread);
@@ -27,9 +32,20 @@ ycaWorker::ycaWorker()
 }
 
 
+ycaWorker::~ycaWorker()
+{
+    finish();
+}
+
+
 void ycaWorker::setParent(ycaMainWindow* myParent)
 {
     parent=myParent;
+
+    pool->setConfiguration(&parent->config, &parent->mutex, parent);
+    pool->setRegistry(&parent->registry);
+    pool->setConcurrency(parent->config.uploadWorkers, parent->config.downloadWorkers, parent->config.storageWorkers);
+
     QMetaObject::invokeMethod(this, "startTimer", Qt::QueuedConnection);
 }
 
@@ -40,6 +56,31 @@ void ycaWorker::shutdown()
 }
 
 
+void ycaWorker::finish()
+{
+    if (pool==0)
+    {
+        return;
+    }
+
+    transferThread.quit();
+    transferThread.wait(YCA_WORKERPOOL_SHUTDOWNWAIT);
+
+    // Running transfers are not interrupted. If they don't finish in time, the pool
+    // is left alive because the jobs still access it. The incomplete downloads are
+    // removed when the agent is started the next time.
+    if (pool->shutdown())
+    {
+        delete pool;
+    }
+    else
+    {
+        YTL->log("Transfers still running during shutdown",YTL_ERROR,YTL_HIGH);
+    }
+    pool=0;
+}
+
+
 void ycaWorker::trigger()
 {
     if (!processingActive)
@@ -49,6 +90,17 @@ void ycaWorker::trigger()
 }
 
 
+ycaActiveTaskMap ycaWorker::getActiveTasks()
+{
+    if (pool==0)
+    {
+        return ycaActiveTaskMap();
+    }
+
+    return pool->getActiveTasks();
+}
+
+
 void ycaWorker::startTimer()
 {
     this->connect(&transferTimer, SIGNAL(timeout()), SLOT(timerCall()), Qt::DirectConnection);
@@ -69,7 +121,7 @@ void ycaWorker::stopTimer()
 
 void ycaWorker::timerCall()
 {
-    if (processingPaused)
+    if ((processingPaused) || (pool==0))
     {
         return;
     }
@@ -79,18 +131,45 @@ void ycaWorker::timerCall()
 
     YTL->log("(Started worker update)",YTL_INFO,YTL_MID);
 
-    if (!parent->taskHelper.removeIncompleteDownloads())
+    // The transfers are executed by the lanes of the pool. The timer call only
+    // hands the tasks over and doesn't wait for them, so that a long upload
+    // doesn't delay the download and storage of other tasks.
+    ycaActiveTaskMap activeTasks=pool->getActiveTasks();
+
+    if (!parent->taskHelper.removeIncompleteDownloads(activeTasks))
     {
         YTL->log("Error while removing incomplete downloads",YTL_ERROR,YTL_HIGH);
         // TODO: Error handing
     }
 
+    ycaTaskList scheduledTasks;
+    parent->taskHelper.getScheduledTasks(scheduledTasks);
+    dropActiveTasks(scheduledTasks, activeTasks);
+
+    // The user status is only needed for uploads. The query runs while the job
+    // status is requested below.
+    QSharedPointer<QtAWSPendingReply> userStatus;
+
+    if (!scheduledTasks.empty())
+    {
+        userStatus=parent->cloud.requestUserStatus();
+    }
+
     ycaTaskList taskList;
-    parent->taskHelper.getScheduledTasks(taskList);
+    parent->mutex.lock();
+    parent->taskHelper.getProcessingTasks(taskList);
+    dropActiveTasks(taskList, activeTasks);
+    if (parent->cloud.getJobStatus(&taskList))
+    {
+        // Keep the status for the UI, so that it doesn't need to query the cloud
+        parent->registry.updateJobStatus(taskList);
+    }
+    // TODO: Get error status
+    parent->mutex.unlock();
 
-    if (!taskList.empty())
+    if (!scheduledTasks.empty())
     {
-        if (!parent->cloud.validateUser(&transferInformation))
+        if (!parent->cloud.readUserStatus(userStatus, &transferInformation))
         {
             YTL->log("Unable to validate user account",YTL_ERROR,YTL_HIGH);
 
@@ -104,50 +183,11 @@ void ycaWorker::timerCall()
         }
         else
         {
-            QMetaObject::invokeMethod(parent, "showIndicator", Qt::QueuedConnection);
-
-            currentProcess=ycaTask::wpUpload;
-            updateParentStatus();
-
             YTL->log("(Now uploading cases)",YTL_INFO,YTL_MID);
-
-            // Only upload 10 cases per time, then first download the recon
-            int uploadCount=0;
-
-            while ((!taskList.isEmpty()) && (uploadCount<10))
-            {
-                parent->mutex.lock();
-                currentTaskID=taskList.first()->uuid;
-                parent->mutex.unlock();
-
-                ycaTask* currentTask=taskList.takeFirst();
-                parent->taskHelper.saveTimepoint(currentTask,YCT_TIMEPT_UPLOAD_BEGIN,&parent->mutex);
-
-                if (!parent->cloud.uploadCase(currentTask, &transferInformation, &parent->mutex))
-                {
-                    YTL->log("Error while uploading case "+currentTaskID,YTL_ERROR,YTL_HIGH);
-                    // TODO: Error handling
-                }
-                else
-                {
-                    parent->taskHelper.saveTimepoint(currentTask,YCT_TIMEPT_UPLOAD_END,&parent->mutex);
-                }
-                uploadCount++;
-
-                parent->mutex.lock();
-                currentTaskID="";
-                parent->mutex.unlock();
-            }
-
-            QMetaObject::invokeMethod(parent, "hideIndicator", Qt::QueuedConnection);
+            startTasks(scheduledTasks, ycaTask::wpUpload);
         }
     }
-
-    parent->mutex.lock();
-    parent->taskHelper.getProcessingTasks(taskList);
-    parent->cloud.getJobStatus(&taskList);
-    // TODO: Get error status
-    parent->mutex.unlock();
+    parent->taskHelper.clearTaskList(scheduledTasks);
 
     ycaTaskList jobsToArchive;
     ycaTaskList jobsToDownload;
@@ -158,8 +198,16 @@ void ycaWorker::timerCall()
     parent->mutex.lock();
     parent->taskHelper.saveCostsToPHI(jobsToDownload);
     parent->taskHelper.saveCostsToPHI(jobsToArchive);
+    parent->taskHelper.commitPHIUpdates();
     parent->mutex.unlock();
 
+    // The download list shares the tasks with the task list. The downloads are
+    // handed to the pool, so take them out of the task list.
+    for (int i=0; i<jobsToDownload.count(); i++)
+    {
+        taskList.removeOne(jobsToDownload.at(i));
+    }
+
     if (!jobsToDownload.empty())
     {
         YTL->log("(Now downloading cases)",YTL_INFO,YTL_MID);
@@ -182,52 +230,14 @@ void ycaWorker::timerCall()
 
         if (transferInformation.userAllowed)
         {
-            QMetaObject::invokeMethod(parent, "showIndicator", Qt::QueuedConnection);
-
-            currentProcess=ycaTask::wpDownload;
-            updateParentStatus();
-
-            while (!jobsToDownload.isEmpty())
-            {
-                parent->mutex.lock();
-                ycaTask* currentTask=jobsToDownload.takeFirst();
-                currentTaskID=currentTask->uuid;
-                parent->mutex.unlock();
-
-                parent->taskHelper.saveTimepoint(currentTask,YCT_TIMEPT_DOWNLOAD_BEGIN,&parent->mutex);
-
-                if (!parent->cloud.downloadCase(currentTask, &transferInformation, &parent->mutex))
-                {
-                    YTL->log("Error while downloading case "+currentTaskID,YTL_ERROR,YTL_HIGH);
-                    // TODO: Error handling
-                }
-                else
-                {
-                    parent->taskHelper.saveTimepoint(currentTask,YCT_TIMEPT_DOWNLOAD_END,&parent->mutex);
-                }
-
-                parent->mutex.lock();
-                currentTaskID="";
-                parent->mutex.unlock();
-            }
-
-            // Don't hide the indicator here, because if jobs have been downloaded,
-            // a storage operation will follow
+            startTasks(jobsToDownload, ycaTask::wpDownload);
         }
     }
+    parent->taskHelper.clearTaskList(jobsToDownload);
 
-    currentProcess=ycaTask::wpStorage;
-    updateParentStatus();  
-
-    YTL->log("(Now storing cases)",YTL_INFO,YTL_MID);
-
-    // Retrieve storage location for each job and push downloaded jobs to destination
-    if (!parent->taskHelper.storeTasks(jobsToArchive,&parent->mutex,parent))
-    {
-        YTL->log("Error while storing cases",YTL_ERROR,YTL_HIGH);
-        // TODO: Error handling
-    }
+    dispatchStorage();
 
+    // Jobs that failed during the processing are archived right away
     if (!jobsToArchive.empty())
     {
         YTL->log("(Now archiving cases)",YTL_INFO,YTL_MID);
@@ -248,12 +258,11 @@ void ycaWorker::timerCall()
             QMetaObject::invokeMethod(parent, "showNotification", Qt::QueuedConnection, Q_ARG(QString, successNotification));
         }
     }
-
-    QMetaObject::invokeMethod(parent, "hideIndicator", Qt::QueuedConnection);
+    jobsToArchive.clear();
+    parent->taskHelper.clearTaskList(taskList);
 
     YTL->log("(Completed worker update)",YTL_INFO,YTL_MID);
 
-    currentProcess=ycaTask::wpIdle;
     updateParentStatus();
     transferTimer.start();
     processingActive=false;
@@ -265,25 +274,108 @@ void ycaWorker::timerCall()
 }
 
 
+void ycaWorker::dispatchStorage()
+{
+    ycaTaskList storageList;
+
+    if (!parent->taskHelper.getStorageTasks(storageList))
+    {
+        YTL->log("Error while searching cases for storage",YTL_ERROR,YTL_HIGH);
+        // TODO: Error handling
+        return;
+    }
+
+    if (!storageList.empty())
+    {
+        YTL->log("(Now storing cases)",YTL_INFO,YTL_MID);
+        startTasks(storageList, ycaTask::wpStorage);
+    }
+}
+
+
+void ycaWorker::startTasks(ycaTaskList& taskList, ycaTask::WorkerProcess process)
+{
+    while (!taskList.isEmpty())
+    {
+        ycaTask* currentTask=taskList.takeFirst();
+
+        // The pool takes the ownership of the task if it has been started
+        if (!pool->start(currentTask, process, transferInformation))
+        {
+            delete currentTask;
+            currentTask=0;
+        }
+    }
+
+    if (pool->getActiveCount()>0)
+    {
+        QMetaObject::invokeMethod(parent, "showIndicator", Qt::QueuedConnection);
+    }
+
+    updateParentStatus();
+}
+
+
+void ycaWorker::dropActiveTasks(ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks)
+{
+    for (int i=taskList.count()-1; i>=0; i--)
+    {
+        if (activeTasks.contains(taskList.at(i)->uuid))
+        {
+            delete taskList.takeAt(i);
+        }
+    }
+}
+
+
+void ycaWorker::jobFinished(int process, bool success)
+{
+    // Store the results right after the download, instead of waiting for the next timer call
+    if ((process==ycaTask::wpDownload) && (success) && (!processingPaused))
+    {
+        dispatchStorage();
+    }
+
+    if (pool->getActiveCount()==0)
+    {
+        QMetaObject::invokeMethod(parent, "hideIndicator", Qt::QueuedConnection);
+    }
+
+    updateParentStatus();
+
+    if (parent->isVisible())
+    {
+        QMetaObject::invokeMethod(parent, "updateUIWorker", Qt::QueuedConnection);
+    }
+}
+
+
 void ycaWorker::updateParentStatus()
 {
-    QString text="Unknown";
+    QString text="<span style=\" font-weight:600; color:#E0A526;\">Idle</span>";
+
+    int uploads  =pool->getActiveCount(ycaTask::wpUpload);
+    int downloads=pool->getActiveCount(ycaTask::wpDownload);
+    int storage  =pool->getActiveCount(ycaTask::wpStorage);
 
-    switch (currentProcess)
+    if (uploads+downloads+storage>0)
     {
-    default:
-    case ycaTask::wpIdle:
-        text="<span style=\" font-weight:600; color:#E0A526;\">Idle</span>";
-        break;
-    case ycaTask::wpUpload:
-        text="<span style=\" font-weight:600; color:#580f8b;\">Uploading tasks...</span>";
-        break;
-    case ycaTask::wpDownload:
-        text="<span style=\" font-weight:600; color:#580f8b;\">Downloading results...</span>";
-        break;
-    case ycaTask::wpStorage:
-        text="<span style=\" font-weight:600; color:#580f8b;\">Storing results...</span>";
-        break;
+        QStringList lanes;
+
+        if (uploads>0)
+        {
+            lanes.append("Uploading "+QString::number(uploads));
+        }
+        if (downloads>0)
+        {
+            lanes.append("Downloading "+QString::number(downloads));
+        }
+        if (storage>0)
+        {
+            lanes.append("Storing "+QString::number(storage));
+        }
+
+        text="<span style=\" font-weight:600; color:#580f8b;\">"+lanes.join(", ")+"...</span>";
     }
 
     QMetaObject::invokeMethod(parent, "showStatus", Qt::QueuedConnection,  Q_ARG(QString, text));
@@ -399,6 +491,11 @@ ycaMainWindow::ycaMainWindow(QWidget *parent) :
         return;
     }
 
+    // The tasks are read from the folders once. Afterwards, the registry is
+    // updated by the file system events and the workers.
+    registry.start(&cloud);
+    taskHelper.setRegistry(&registry);
+
     transferWorker.setParent(this);
     taskHelper.clearTaskList(taskList);
 
@@ -443,6 +540,10 @@ ycaMainWindow::ycaMainWindow(QWidget *parent) :
 
 ycaMainWindow::~ycaMainWindow()
 {
+    // Stop the workers before the configuration and folder mutex are destroyed
+    transferWorker.finish();
+    registry.stop();
+
     delete ui;
 }
 
@@ -538,9 +639,8 @@ void ycaMainWindow::on_statusRefreshButton_clicked()
 
     YTL->log("Refreshing UI status",YTL_INFO,YTL_LOW);
 
-    mutex.lock();
-    taskHelper.getAllTasks(taskList, true, false);
-    mutex.unlock();
+    // The tasks are taken from the registry, so the folder mutex isn't needed
+    taskHelper.getAllTasks(taskList, true, false, transferWorker.getActiveTasks());
 
     ui->activeTasksTable->clearContents();
     qApp->processEvents();
@@ -732,9 +832,7 @@ void ycaMainWindow::on_refreshArchiveButton_clicked()
 {
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
-    mutex.lock();
     taskHelper.getAllTasks(archiveList, false, true);
-    mutex.unlock();
 
     ui->archiveTasksTable->clearContents();
     qApp->processEvents();
@@ -810,22 +908,8 @@ void ycaMainWindow::on_searchButton_clicked()
     ui->searchTable->clearContents();
     taskHelper.clearTaskList(taskList);
 
-    ycaTaskList searchList;
-    taskHelper.getAllTasks(searchList,true,true);
-
-    while (!searchList.empty())
-    {
-        ycaTask* task=searchList.takeFirst();
-        if ((!ui->searchEdit->text().isEmpty()) && (task->patientName.contains(ui->searchEdit->text(),Qt::CaseInsensitive)))
-        {
-            taskList.append(task);
-        }
-        else
-        {
-            delete task;
-            task=0;
-        }
-    }
+    // Searches the current tasks and the archive store (name, MRN, ACC and ID)
+    taskHelper.searchTasks(ui->searchEdit->text(),taskList,transferWorker.getActiveTasks());
 
     if (taskList.empty())
     {
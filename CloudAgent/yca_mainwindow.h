@@ -9,6 +9,7 @@
 #include "../CloudTools/yct_configuration.h"
 #include "yca_transferindicator.h"
 #include "yca_task.h"
+#include "yca_taskregistry.h"
 #include "../CloudTools/yct_api.h"
 
 
@@ -19,6 +20,7 @@ namespace Ui
 
 
 class ycaMainWindow;
+class ycaWorkerPool;
 
 class ycaWorker : public QObject
 {
@@ -26,21 +28,24 @@ class ycaWorker : public QObject
 
 public:
     ycaWorker();
+    ~ycaWorker();
     void setParent(ycaMainWindow* myParent);
 
     void shutdown();
+    void finish();
     void trigger();
 
+    ycaActiveTaskMap getActiveTasks();
+
     bool                   processingActive;
     bool                   processingPaused;
-    ycaTask::WorkerProcess currentProcess;
-    QString                currentTaskID;
 
 
 public slots:
     void startTimer();
     void stopTimer();
     void timerCall();
+    void jobFinished(int process, bool success);
 
 private:
     QThread transferThread;
@@ -50,7 +55,11 @@ private:
     bool                   userInvalidShown;
 
     ycaMainWindow* parent;
+    ycaWorkerPool* pool;
 
+    void dispatchStorage();
+    void startTasks(ycaTaskList& taskList, ycaTask::WorkerProcess process);
+    void dropActiveTasks(ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks);
     void updateParentStatus();
 
 };
@@ -125,6 +134,7 @@ private:
 public:
     yctConfiguration     config;
     ycaTaskHelper        taskHelper;
+    ycaTaskRegistry      registry;
     yctAPI               cloud;
     QMutex               mutex;
     bool                 shuttingDown;
@@ -1,8 +1,10 @@
 #include "yca_task.h"
+#include "yca_taskregistry.h"
 #include "yca_threadlog.h"
 
 #include "../CloudTools/yct_api.h"
 #include "../CloudTools/yct_common.h"
+#include "../CloudTools/yct_aws/qtawss3.h"
 
 
 ycaTask::ycaTask()
@@ -107,6 +109,7 @@ QString ycaTask::getResult()
 ycaTaskHelper::ycaTaskHelper()
 {
     cloud=0;
+    registry=0;
 }
 
 
@@ -116,10 +119,30 @@ void ycaTaskHelper::setCloudInstance(yctAPI* apiInstance)
 }
 
 
+void ycaTaskHelper::setRegistry(ycaTaskRegistry* taskRegistry)
+{
+    registry=taskRegistry;
+}
+
+
+void ycaTaskHelper::refreshRegistry(QString uuid)
+{
+    if (registry!=0)
+    {
+        registry->refreshTask(uuid);
+    }
+}
+
+
 bool ycaTaskHelper::getScheduledTasks(ycaTaskList& taskList)
 {
     clearTaskList(taskList);
 
+    if (registry!=0)
+    {
+        return getRegisteredScheduledTasks(taskList);
+    }
+
     QString outPath=cloud->getCloudPath(YCT_CLOUDFOLDER_OUT);
     QDir outDir(outPath);
     if (!outDir.exists())
@@ -186,6 +209,11 @@ bool ycaTaskHelper::getProcessingTasks(ycaTaskList& taskList)
 {
     clearTaskList(taskList);
 
+    if (registry!=0)
+    {
+        return getRegisteredProcessingTasks(taskList);
+    }
+
     QString outPath=cloud->getCloudPath(YCT_CLOUDFOLDER_OUT);
     QDir outDir(outPath);
     if (!outDir.exists())
@@ -252,10 +280,17 @@ void ycaTaskHelper::clearTaskList(ycaTaskList& list)
 }
 
 
-bool ycaTaskHelper::getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool includeArchive, QString workerJobID, ycaTask::WorkerProcess workerOperation)
+bool ycaTaskHelper::getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool includeArchive, const ycaActiveTaskMap& activeTasks)
 {
     clearTaskList(taskList);
 
+    if (registry!=0)
+    {
+        getRegisteredTasks(taskList, includeCurrent, includeArchive);
+        updateTaskStatus(taskList, activeTasks);
+        return true;
+    }
+
     QString phiPath=cloud->getCloudPath(YCT_CLOUDFOLDER_PHI);
     QDir phiDir(phiPath);
     if (!phiDir.exists())
@@ -352,16 +387,24 @@ bool ycaTaskHelper::getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool
         }
     }
 
+    updateTaskStatus(taskList, activeTasks);
+
+    return true;
+}
+
+
+void ycaTaskHelper::updateTaskStatus(ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks)
+{
     // Now fetch the status of the jobs that are living in the cloud currently
     ycaTaskList processingTasks;
     for (int i=0; i<taskList.count(); i++)
     {
-        if (taskList.at(i)->status==ycaTask::tsProcessing)
+        if ((taskList.at(i)->status==ycaTask::tsProcessing) || (taskList.at(i)->status==ycaTask::tsScheduled))
         {
-            if (workerJobID==taskList.at(i)->uuid)
+            if (activeTasks.contains(taskList.at(i)->uuid))
             {
-                // If the worker thread is currently uploading/downloading the job
-                switch (workerOperation)
+                // If a worker is currently uploading/downloading the job
+                switch (activeTasks.value(taskList.at(i)->uuid))
                 {
                 case ycaTask::wpUpload:
                     taskList.at(i)->status=ycaTask::tsUploading;
@@ -378,14 +421,242 @@ bool ycaTaskHelper::getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool
             }
             else
             {
-                processingTasks.append(taskList.at(i));
+                if (taskList.at(i)->status==ycaTask::tsProcessing)
+                {
+                    // Use the status from the last query of the worker, so that
+                    // refreshing the UI doesn't have to wait for the cloud
+                    ycaTaskEntry entry;
+
+                    if ((registry!=0) && (registry->getEntry(taskList.at(i)->uuid,entry))
+                        && (entry.cloudStatus!=ycaTask::tsInvalid))
+                    {
+                        taskList.at(i)->status=entry.cloudStatus;
+                        taskList.at(i)->cost  =entry.cloudCost;
+
+                        if (!entry.cloudShortcode.isEmpty())
+                        {
+                            taskList.at(i)->shortcode=entry.cloudShortcode;
+                        }
+                    }
+                    else
+                    {
+                        processingTasks.append(taskList.at(i));
+                    }
+                }
             }
         }
     }
 
     if (!processingTasks.isEmpty())
     {
-        cloud->getJobStatus(&processingTasks);
+        if ((cloud->getJobStatus(&processingTasks)) && (registry!=0))
+        {
+            registry->updateJobStatus(processingTasks);
+        }
+    }
+}
+
+
+bool ycaTaskHelper::getRegisteredScheduledTasks(ycaTaskList& taskList)
+{
+    QDir outDir(cloud->getCloudPath(YCT_CLOUDFOLDER_OUT));
+
+    QList<ycaTaskEntry> entries=registry->getEntries(ycaTaskRegistry::selScheduled);
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        QString uuid=entries.at(i).task.uuid;
+
+        // The lock file might not have been reported yet
+        if (outDir.exists(uuid+".lock"))
+        {
+            continue;
+        }
+
+        if (!entries.at(i).phiFile)
+        {
+            // PHI file is missing! Something must be wrong.
+            YTL->log("Missing PHI file: "+QString(uuid+".phi"),YTL_WARNING,YTL_HIGH);
+            // TODO: Error reporting
+            continue;
+        }
+
+        ycaTask* task=new ycaTask();
+        task->uuid=uuid;
+        task->taskFilename=uuid+".task";
+
+        if (!checkScanfiles(uuid,task))
+        {
+            // Scan files are missing! Something must be wrong.
+            YTL->log("Missing scan files: "+task->taskFilename,YTL_WARNING,YTL_HIGH);
+            // TODO: Error reporting
+
+            delete task;
+            task=0;
+            continue;
+        }
+
+        taskList.append(task);
+    }
+
+    return true;
+}
+
+
+bool ycaTaskHelper::getRegisteredProcessingTasks(ycaTaskList& taskList)
+{
+    QString inPath=cloud->getCloudPath(YCT_CLOUDFOLDER_IN);
+
+    QList<ycaTaskEntry> entries=registry->getEntries(ycaTaskRegistry::selProcessing);
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        QString uuid=entries.at(i).task.uuid;
+
+        // Finished downloads update the registry, but make sure that
+        // a case is never downloaded twice
+        QDir inTaskDir(inPath+"/"+uuid);
+        if (inTaskDir.exists())
+        {
+            continue;
+        }
+
+        ycaTask* task=new ycaTask();
+        task->uuid=uuid;
+        task->taskFilename=uuid+".task";
+        task->phiFilename=uuid+".phi";
+        task->status=ycaTask::tsProcessing;
+        taskList.append(task);
+    }
+
+    return true;
+}
+
+
+bool ycaTaskHelper::getRegisteredStorageTasks(ycaTaskList& taskList)
+{
+    QString inPath=cloud->getCloudPath(YCT_CLOUDFOLDER_IN);
+    QString phiPath=cloud->getCloudPath(YCT_CLOUDFOLDER_PHI);
+
+    QList<ycaTaskEntry> entries=registry->getEntries(ycaTaskRegistry::selStorage);
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        QString uuid=entries.at(i).task.uuid;
+
+        if (QFile::exists(inPath+"/"+uuid+"/"+YCT_INCOMPLETE_FILE))
+        {
+            // INCOMPLETE file found, so the download is still running or has been interrupted
+            continue;
+        }
+
+        if (!entries.at(i).phiFile)
+        {
+            YTL->log("Unable to find PHI file. Can't store task: "+phiPath+"/"+uuid+".phi",YTL_ERROR,YTL_HIGH);
+
+            // Corresponding file with PHI information not found. Can't store task.
+            // TODO: Error handling
+            continue;
+        }
+
+        // The PHI information has been read by the registry
+        taskList.append(new ycaTask(entries.at(i).task));
+    }
+
+    return true;
+}
+
+
+bool ycaTaskHelper::getRegisteredTasks(ycaTaskList& taskList, bool includeCurrent, bool includeArchive)
+{
+    if (includeCurrent)
+    {
+        QList<ycaTaskEntry> entries=registry->getEntries(ycaTaskRegistry::selCurrent);
+
+        for (int i=0; i<entries.count(); i++)
+        {
+            const ycaTaskEntry& entry=entries.at(i);
+            ycaTask* task=0;
+
+            if (entry.lockFile)
+            {
+                // File is currently being written. So ignore it for now.
+                task=new ycaTask();
+                task->uuid=entry.task.uuid;
+                task->status=ycaTask::tsPreparing;
+                taskList.append(task);
+                continue;
+            }
+
+            task=new ycaTask(entry.task);
+
+            if (entry.taskFile)
+            {
+                task->status=ycaTask::tsScheduled;
+            }
+            else
+            {
+                if (entry.inFolder)
+                {
+                    // Case has already been downloaded
+                    task->status=ycaTask::tsStorage;
+                }
+                else
+                {
+                    // Case must be in the cloud or on its way in/out there
+                    task->status=ycaTask::tsProcessing;
+                }
+            }
+
+            taskList.append(task);
+        }
+    }
+
+    if (includeArchive)
+    {
+        registry->getArchive()->getTasks(taskList);
+    }
+
+    return true;
+}
+
+
+bool ycaTaskHelper::searchTasks(QString text, ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks)
+{
+    clearTaskList(taskList);
+
+    QString searchText=text.trimmed().toLower();
+
+    if (searchText.isEmpty())
+    {
+        return true;
+    }
+
+    ycaTaskList currentList;
+
+    if (!getAllTasks(currentList, true, registry==0, activeTasks))
+    {
+        return false;
+    }
+
+    while (!currentList.isEmpty())
+    {
+        ycaTask* task=currentList.takeFirst();
+
+        if (ycaArchiveStore::createSearchKey(*task).contains(searchText))
+        {
+            taskList.append(task);
+        }
+        else
+        {
+            delete task;
+            task=0;
+        }
+    }
+
+    if (registry!=0)
+    {
+        registry->getArchive()->search(searchText, taskList);
     }
 
     return true;
@@ -518,6 +789,17 @@ bool ycaTaskHelper::readPHIData(QString filepath, ycaTask* task)
 
 bool ycaTaskHelper::saveResultToPHI(QString filepath, ycaTask::TaskResult result)
 {
+    if (registry!=0)
+    {
+        // Write the result together with the values collected for the task
+        QString uuid=QFileInfo(filepath).baseName();
+
+        registry->getJournal()->setValue(uuid,"STATUS/RESULT",result);
+        registry->getJournal()->setValue(uuid,"LOG/COMPLETED",QDateTime::currentDateTime().toString(Qt::ISODate));
+
+        return commitPHIUpdates(uuid);
+    }
+
     QSettings phiFile(filepath, QSettings::IniFormat);
 
     if (phiFile.value("PHI/UUID","").toString().isEmpty())
@@ -536,6 +818,21 @@ bool ycaTaskHelper::saveResultToPHI(QString filepath, ycaTask::TaskResult result
 
 bool ycaTaskHelper::saveCostsToPHI(ycaTaskList& taskList)
 {
+    if (registry!=0)
+    {
+        for (int i=0; i<taskList.count(); i++)
+        {
+            registry->getJournal()->setValue(taskList.at(i)->uuid,"STATS/COST",taskList.at(i)->cost);
+
+            if (!taskList.at(i)->shortcode.isEmpty())
+            {
+                registry->getJournal()->setValue(taskList.at(i)->uuid,"STATS/SHORTCODE",taskList.at(i)->shortcode);
+            }
+        }
+
+        return true;
+    }
+
     for (int i=0; i<taskList.count(); i++)
     {
         ycaTask* task=taskList.at(i);
@@ -570,6 +867,21 @@ bool ycaTaskHelper::saveCostsToPHI(ycaTaskList& taskList)
 
 bool ycaTaskHelper::saveTimepoint(ycaTask* task, QString timepointID, QMutex* mutex)
 {
+    if (registry!=0)
+    {
+        // The journal is thread-safe, so the mutex isn't needed
+        registry->getJournal()->setValue(task->uuid,timepointID,QDateTime::currentDateTime().toString(Qt::ISODate));
+
+        // When saving the UPLOAD_BEGIN timepoint, also store the size of the data files.
+        // This has been calculated when checking the task for existance of all files.
+        if (timepointID==YCT_TIMEPT_UPLOAD_BEGIN)
+        {
+            registry->getJournal()->setValue(task->uuid,"STATS/DATASIZE_MB",task->datasize);
+        }
+
+        return true;
+    }
+
     QString  filepath=cloud->getCloudPath(YCT_CLOUDFOLDER_PHI)+"/"+task->uuid+".phi";
 
     if (!QFile::exists(filepath))
@@ -579,10 +891,7 @@ bool ycaTaskHelper::saveTimepoint(ycaTask* task, QString timepointID, QMutex* mu
     }
 
     {
-        if (mutex!=0)
-        {
-            mutex->lock();
-        }
+        QMutexLocker locker(mutex);
 
         QSettings phiFile(filepath, QSettings::IniFormat);
 
@@ -601,17 +910,30 @@ bool ycaTaskHelper::saveTimepoint(ycaTask* task, QString timepointID, QMutex* mu
         {
             phiFile.setValue("STATS/DATASIZE_MB",task->datasize);
         }
-
-        if (mutex!=0)
-        {
-            mutex->unlock();
-        }
     }
 
     return true;
 }
 
 
+bool ycaTaskHelper::commitPHIUpdates(QString uuid)
+{
+    if (registry==0)
+    {
+        return true;
+    }
+
+    QStringList committed=registry->getJournal()->commit(uuid);
+
+    for (int i=0; i<committed.count(); i++)
+    {
+        refreshRegistry(committed.at(i));
+    }
+
+    return !registry->getJournal()->hasPendingValues(uuid);
+}
+
+
 void ycaTaskHelper::getTasksForDownloadArchive(ycaTaskList& taskList, ycaTaskList& downloadList, ycaTaskList& archiveList)
 {
     clearTaskList(downloadList);
@@ -718,13 +1040,28 @@ bool ycaTaskHelper::archiveTasks(ycaTaskList& archiveList, QString& notification
         YTL->log("Archived task "+currentTask->uuid+" with result "+currentTask->getResult(),YTL_INFO,YTL_HIGH);
 
         currentTask->status=ycaTask::tsArchived;
+        refreshRegistry(currentTask->uuid);
+
+        if (registry!=0)
+        {
+            // The task passed in might only contain the UUID, so take the information
+            // from the updated PHI file
+            ycaTask archivedTask;
+            archivedTask.uuid=currentTask->uuid;
+
+            if ((!readPHIData(archivePath+"/"+currentTask->phiFilename, &archivedTask))
+                || (!registry->getArchive()->addTask(archivedTask)))
+            {
+                YTL->log("Unable to add task to archive store: "+currentTask->uuid,YTL_ERROR,YTL_HIGH);
+            }
+        }
     }
 
     return true;
 }
 
 
-bool ycaTaskHelper::removeIncompleteDownloads()
+bool ycaTaskHelper::removeIncompleteDownloads(const ycaActiveTaskMap& activeTasks)
 {
     QString inPath=cloud->getCloudPath(YCT_CLOUDFOLDER_IN);
     QDir inDir(inPath);
@@ -739,8 +1076,23 @@ bool ycaTaskHelper::removeIncompleteDownloads()
 
     for (int i=0; i<dirList.count(); i++)
     {
+        // Skip the downloads that are currently running
+        if (activeTasks.contains(dirList.at(i).fileName()))
+        {
+            continue;
+        }
+
         if (QFile::exists(dirList.at(i).filePath()+"/"+YCT_INCOMPLETE_FILE))
         {
+            // Interrupted native downloads keep their completed parts and continue
+            // during the next attempt
+            QDirIterator manifests(dirList.at(i).filePath(), QStringList("*" QTAWS_S3_MANIFEST_EXT), QDir::Files, QDirIterator::Subdirectories);
+            if (manifests.hasNext())
+            {
+                YTL->log("Resumable download found: "+dirList.at(i).filePath(),YTL_INFO,YTL_MID);
+                continue;
+            }
+
             YTL->log("Incomplete download found: "+dirList.at(i).filePath(),YTL_WARNING,YTL_HIGH);
 
             // INCOMPLETE file found, so folder is from incomplete download.
@@ -751,6 +1103,8 @@ bool ycaTaskHelper::removeIncompleteDownloads()
                 YTL->log("Unable to remove incomplete download: "+dirList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
                 // TODO: Error handling!
             }
+
+            refreshRegistry(dirList.at(i).fileName());
         }
     }
 
@@ -758,8 +1112,15 @@ bool ycaTaskHelper::removeIncompleteDownloads()
 }
 
 
-bool ycaTaskHelper::storeTasks(ycaTaskList& archiveList, QMutex* mutex, QObject* notificationWidget)
+bool ycaTaskHelper::getStorageTasks(ycaTaskList& taskList)
 {
+    clearTaskList(taskList);
+
+    if (registry!=0)
+    {
+        return getRegisteredStorageTasks(taskList);
+    }
+
     QString inPath=cloud->getCloudPath(YCT_CLOUDFOLDER_IN);
     QDir inDir(inPath);
     if (!inDir.exists())
@@ -780,20 +1141,13 @@ bool ycaTaskHelper::storeTasks(ycaTaskList& archiveList, QMutex* mutex, QObject*
 
     QFileInfoList dirList=inDir.entryInfoList(QStringList("*"),QDir::Dirs|QDir::NoDotAndDotDot,QDir::Time);
 
-    if ((notificationWidget!=0) && (!dirList.isEmpty()))
-    {
-        QMetaObject::invokeMethod(notificationWidget, "showIndicator", Qt::QueuedConnection);
-    }
-
     for (int i=0; i<dirList.count(); i++)
     {
         QString incompleteFile=dirList.at(i).filePath()+"/"+YCT_INCOMPLETE_FILE;
 
         if (QFile::exists(incompleteFile))
         {
-            YTL->log("INCOMPLETE download. Skipping storage: "+dirList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
-
-            // INCOMPLETE file found, so folder is from incomplete download.
+            // INCOMPLETE file found, so the download is still running or has been interrupted
             continue;
         }
 
@@ -811,7 +1165,7 @@ bool ycaTaskHelper::storeTasks(ycaTaskList& archiveList, QMutex* mutex, QObject*
         currentTask->uuid=dirList.at(i).fileName();
 
         if (!readPHIData(phiFile, currentTask))
-        {            
+        {
             YTL->log("Unable to read PHI: "+phiFile,YTL_ERROR,YTL_HIGH);
 
             delete currentTask;
@@ -819,53 +1173,54 @@ bool ycaTaskHelper::storeTasks(ycaTaskList& archiveList, QMutex* mutex, QObject*
             continue;
         }
 
-        YTL->log("Storing task: "+currentTask->uuid,YTL_INFO,YTL_HIGH);
-        saveTimepoint(currentTask,YCT_TIMEPT_STORAGE_BEGIN,mutex);
+        taskList.append(currentTask);
+    }
 
-        YTL->log("Inserting PHI",YTL_INFO,YTL_LOW);
-        if (!cloud->insertPHI(dirList.at(i).filePath(),currentTask))
-        {
-            YTL->log("Unable to insert PHI. Skipping storage: "+dirList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
-            // TODO: Error reporting
-            delete currentTask;
-            currentTask=0;
-            continue;
-        }
+    return true;
+}
 
-        YTL->log("Push to destinations",YTL_INFO,YTL_LOW);
-        if (!cloud->pushToDestinations(dirList.at(i).filePath(),currentTask))
-        {
-            YTL->log("Unable to store results: "+dirList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
 
-            // TODO: Error handling
-            delete currentTask;
-            currentTask=0;
+bool ycaTaskHelper::storeTask(ycaTask* task, QMutex* mutex)
+{
+    QString taskPath=cloud->getCloudPath(YCT_CLOUDFOLDER_IN)+"/"+task->uuid;
 
-            // If an error occurred during transfer to one of the destinations,
-            // don't delete the folder and try again next time
-            continue;
-        }
+    YTL->log("Storing task: "+task->uuid,YTL_INFO,YTL_HIGH);
+    saveTimepoint(task,YCT_TIMEPT_STORAGE_BEGIN,mutex);
 
-        //qDebug() << "Storage successful, cleaning up";
+    YTL->log("Inserting PHI",YTL_INFO,YTL_LOW);
+    if (!cloud->insertPHI(taskPath,task))
+    {
+        YTL->log("Unable to insert PHI. Skipping storage: "+taskPath,YTL_ERROR,YTL_HIGH);
+        // TODO: Error reporting
+        return false;
+    }
 
-        YTL->log("Folder cleanup",YTL_INFO,YTL_LOW);
-        QDir removeDir(dirList.at(i).filePath());
-        if (!removeDir.removeRecursively())
-        {
-            YTL->log("Unable to clean folder: "+dirList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
-            // TODO: Error handling
-        }
+    YTL->log("Push to destinations",YTL_INFO,YTL_LOW);
+    if (!cloud->pushToDestinations(taskPath,task))
+    {
+        YTL->log("Unable to store results: "+taskPath,YTL_ERROR,YTL_HIGH);
+
+        // TODO: Error handling
 
-        saveTimepoint(currentTask,YCT_TIMEPT_STORAGE_END,mutex);
+        // If an error occurred during transfer to one of the destinations,
+        // don't delete the folder and try again next time
+        return false;
+    }
 
-        currentTask->status=ycaTask::tsStorage;
-        currentTask->result=ycaTask::trSuccess;
-        archiveList.append(currentTask);
+    //qDebug() << "Storage successful, cleaning up";
 
-        //qInfo() << "Name:";        
-        //qInfo() << dirList.at(i).fileName();
+    YTL->log("Folder cleanup",YTL_INFO,YTL_LOW);
+    QDir removeDir(taskPath);
+    if (!removeDir.removeRecursively())
+    {
+        YTL->log("Unable to clean folder: "+taskPath,YTL_ERROR,YTL_HIGH);
+        // TODO: Error handling
     }
 
+    saveTimepoint(task,YCT_TIMEPT_STORAGE_END,mutex);
+
+    task->status=ycaTask::tsStorage;
+    task->result=ycaTask::trSuccess;
+
     return true;
 }
-
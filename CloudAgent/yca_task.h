@@ -4,9 +4,11 @@
 #include <QWidget>
 #include <QDateTime>
 #include <QMutex>
+#include <QMap>
 
 
 class yctAPI;
+class ycaTaskRegistry;
 
 class ycaTask
 {    
@@ -90,6 +92,7 @@ public:
 };
 
 typedef QList<ycaTask*> ycaTaskList;
+typedef QMap<QString, ycaTask::WorkerProcess> ycaActiveTaskMap;
 
 
 class ycaTaskHelper
@@ -100,22 +103,41 @@ public:
     void setCloudInstance(yctAPI* apiInstance);
     yctAPI* cloud;
 
+    // If set, the task lists are taken from the registry instead of reading the
+    // folders, and the registry is updated when the helper changes task files
+    void setRegistry(ycaTaskRegistry* taskRegistry);
+    ycaTaskRegistry* registry;
+
     bool getScheduledTasks(ycaTaskList& taskList);
     bool getProcessingTasks(ycaTaskList& taskList);
-    bool getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool includeArchive, QString workerJobID="", ycaTask::WorkerProcess workerOperation=ycaTask::wpIdle);
+    bool getAllTasks(ycaTaskList& taskList, bool includeCurrent, bool includeArchive, const ycaActiveTaskMap& activeTasks=ycaActiveTaskMap());
+    bool searchTasks(QString text, ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks=ycaActiveTaskMap());
     bool checkScanfiles(QString taskID, ycaTask* task);    
     bool readPHIData(QString filepath, ycaTask* task);
     bool saveResultToPHI(QString filepath, ycaTask::TaskResult result);
     bool saveCostsToPHI(ycaTaskList& taskList);
     bool saveTimepoint(ycaTask* task, QString timepointID, QMutex* mutex=0);
 
+    // With a registry, the PHI updates above are collected in the task journal
+    // and only written to the PHI files when they are committed
+    bool commitPHIUpdates(QString uuid="");
+
     void getTasksForDownloadArchive(ycaTaskList& taskList, ycaTaskList& downloadList, ycaTaskList& archiveList);
     bool archiveTasks(ycaTaskList& archiveList, QString& notificationString);
     void clearTaskList(ycaTaskList& list);
 
-    bool storeTasks(ycaTaskList& archiveList, QMutex* mutex, QObject* notificationWidget=0);
+    bool getStorageTasks(ycaTaskList& taskList);
+    bool storeTask(ycaTask* task, QMutex* mutex=0);
+
+    bool removeIncompleteDownloads(const ycaActiveTaskMap& activeTasks=ycaActiveTaskMap());
 
-    bool removeIncompleteDownloads();
+protected:
+    bool getRegisteredScheduledTasks (ycaTaskList& taskList);
+    bool getRegisteredProcessingTasks(ycaTaskList& taskList);
+    bool getRegisteredStorageTasks   (ycaTaskList& taskList);
+    bool getRegisteredTasks          (ycaTaskList& taskList, bool includeCurrent, bool includeArchive);
+    void updateTaskStatus(ycaTaskList& taskList, const ycaActiveTaskMap& activeTasks);
+    void refreshRegistry(QString uuid);
 
 };
 
@@ -0,0 +1,311 @@
+#include "yca_taskjournal.h"
+#include "yca_threadlog.h"
+
+
+ycaTaskJournal::ycaTaskJournal()
+{
+    phiPath="";
+    archivePath="";
+    filename="";
+}
+
+
+bool ycaTaskJournal::open(QString phiFolder, QString archiveFolder)
+{
+    {
+        QMutexLocker locker(&mutex);
+
+        phiPath    =phiFolder;
+        archivePath=archiveFolder;
+        pendingValues.clear();
+
+        // The journal is kept next to the archive store and not in the PHI folder. The PHI
+        // folder is watched by the task registry, so that every appended record would
+        // cause a rescan of all PHI files.
+        QDir().mkpath(archiveFolder);
+        filename=archiveFolder+YCA_TASKJOURNAL_NAME;
+
+        if (!load())
+        {
+            return false;
+        }
+    }
+
+    if (!pendingValues.isEmpty())
+    {
+        YTL->log("Recovering PHI updates of "+QString::number(pendingValues.count())+" tasks from task journal",YTL_INFO,YTL_HIGH);
+        commit();
+    }
+
+    return true;
+}
+
+
+bool ycaTaskJournal::load()
+{
+    QFile file(filename);
+
+    if ((!file.exists()) || (file.size()==0))
+    {
+        return true;
+    }
+
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        YTL->log("Unable to open task journal: "+filename,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic=0;
+    quint32 version=0;
+    stream >> magic >> version;
+
+    if ((magic!=YCA_TASKJOURNAL_MAGIC) || (version!=YCA_TASKJOURNAL_VERSION))
+    {
+        YTL->log("Invalid task journal: "+filename,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    qint64 validSize=file.pos();
+
+    while (!stream.atEnd())
+    {
+        quint32    recordMagic=0;
+        QByteArray payload;
+        quint16    checksum=0;
+
+        stream >> recordMagic >> payload >> checksum;
+
+        if ((stream.status()!=QDataStream::Ok) || (recordMagic!=YCA_TASKJOURNAL_RECORD)
+            || (checksum!=qChecksum(payload.constData(), payload.size())))
+        {
+            break;
+        }
+
+        QDataStream recordStream(payload);
+        recordStream.setVersion(QDataStream::Qt_5_0);
+
+        QString  uuid;
+        QString  key;
+        QVariant value;
+        recordStream >> uuid >> key >> value;
+
+        if ((recordStream.status()!=QDataStream::Ok) || (uuid.isEmpty()))
+        {
+            break;
+        }
+
+        pendingValues[uuid].insert(key, value);
+        validSize=file.pos();
+    }
+
+    // Drop a record that has been cut off while it was appended
+    if (validSize<file.size())
+    {
+        YTL->log("Removing incomplete record from task journal: "+filename,YTL_WARNING,YTL_HIGH);
+        file.resize(validSize);
+    }
+
+    return true;
+}
+
+
+void ycaTaskJournal::setValue(QString uuid, QString key, QVariant value)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!appendRecord(uuid, key, value))
+    {
+        YTL->log("Unable to write task journal: "+filename,YTL_ERROR,YTL_HIGH);
+    }
+
+    // The value is kept even if it couldn't be journaled, so that it's written with the next commit
+    pendingValues[uuid].insert(key, value);
+}
+
+
+bool ycaTaskJournal::hasPendingValues(QString uuid)
+{
+    QMutexLocker locker(&mutex);
+
+    if (uuid.isEmpty())
+    {
+        return !pendingValues.isEmpty();
+    }
+
+    return pendingValues.contains(uuid);
+}
+
+
+QStringList ycaTaskJournal::commit(QString uuid)
+{
+    QMutexLocker locker(&mutex);
+
+    QStringList uuidList;
+
+    if (uuid.isEmpty())
+    {
+        uuidList=pendingValues.keys();
+    }
+    else
+    {
+        if (pendingValues.contains(uuid))
+        {
+            uuidList.append(uuid);
+        }
+    }
+
+    if (uuidList.isEmpty())
+    {
+        return QStringList();
+    }
+
+    QStringList committed;
+
+    for (int i=0; i<uuidList.count(); i++)
+    {
+        if (writePHIFile(uuidList.at(i), pendingValues.value(uuidList.at(i))))
+        {
+            committed.append(uuidList.at(i));
+            pendingValues.remove(uuidList.at(i));
+        }
+    }
+
+    if (!writeJournal())
+    {
+        YTL->log("Unable to update task journal: "+filename,YTL_ERROR,YTL_HIGH);
+    }
+
+    return committed;
+}
+
+
+bool ycaTaskJournal::writePHIFile(QString uuid, const QVariantMap& values)
+{
+    // The PHI file might have been archived after the values were set
+    QString filepath=phiPath+"/"+uuid+".phi";
+
+    if (!QFile::exists(filepath))
+    {
+        filepath=archivePath+"/"+uuid+".phi";
+
+        if (!QFile::exists(filepath))
+        {
+            // The task doesn't exist anymore, so the values are dropped
+            YTL->log("Missing PHI file for journaled values: "+uuid,YTL_WARNING,YTL_HIGH);
+            return true;
+        }
+    }
+
+    QSettings phiFile(filepath, QSettings::IniFormat);
+
+    if (phiFile.value("PHI/UUID","").toString()!=uuid)
+    {
+        // UUID is missing. PHI file seems invalid or unable to read.
+        YTL->log("Invalid UUID in PHI file: "+filepath,YTL_ERROR,YTL_HIGH);
+        return true;
+    }
+
+    QMapIterator<QString, QVariant> i(values);
+    while (i.hasNext())
+    {
+        i.next();
+        phiFile.setValue(i.key(), i.value());
+    }
+
+    phiFile.sync();
+
+    if (phiFile.status()!=QSettings::NoError)
+    {
+        // Keep the values and try again with the next commit
+        YTL->log("Unable to write PHI file: "+filepath,YTL_ERROR,YTL_HIGH);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool ycaTaskJournal::appendRecord(QString uuid, QString key, const QVariant& value)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    if (file.size()==0)
+    {
+        stream << quint32(YCA_TASKJOURNAL_MAGIC) << quint32(YCA_TASKJOURNAL_VERSION);
+    }
+
+    writeRecord(stream, uuid, key, value);
+    file.flush();
+
+    return (stream.status()==QDataStream::Ok);
+}
+
+
+bool ycaTaskJournal::writeJournal()
+{
+    if (pendingValues.isEmpty())
+    {
+        // All values have been written to the PHI files
+        QFile file(filename);
+        return (!file.exists()) || (file.resize(0));
+    }
+
+    // Only keep the values that couldn't be written yet
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << quint32(YCA_TASKJOURNAL_MAGIC) << quint32(YCA_TASKJOURNAL_VERSION);
+
+    QMapIterator<QString, QVariantMap> i(pendingValues);
+    while (i.hasNext())
+    {
+        i.next();
+
+        QMapIterator<QString, QVariant> j(i.value());
+        while (j.hasNext())
+        {
+            j.next();
+            writeRecord(stream, i.key(), j.key(), j.value());
+        }
+    }
+
+    if (stream.status()!=QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+
+void ycaTaskJournal::writeRecord(QDataStream& stream, QString uuid, QString key, const QVariant& value)
+{
+    QByteArray payload;
+    {
+        QDataStream recordStream(&payload, QIODevice::WriteOnly);
+        recordStream.setVersion(QDataStream::Qt_5_0);
+        recordStream << uuid << key << value;
+    }
+
+    stream << quint32(YCA_TASKJOURNAL_RECORD) << payload << quint16(qChecksum(payload.constData(), payload.size()));
+}
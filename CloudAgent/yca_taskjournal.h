@@ -0,0 +1,55 @@
+#ifndef YCA_TASKJOURNAL_H
+#define YCA_TASKJOURNAL_H
+
+#include <QtCore>
+
+#define YCA_TASKJOURNAL_NAME     "/tasks.journal"
+#define YCA_TASKJOURNAL_MAGIC    0x59434A4C
+#define YCA_TASKJOURNAL_RECORD   0x59434A52
+#define YCA_TASKJOURNAL_VERSION  1
+
+
+// Journal for the updates of the PHI files (timepoints, costs, results). Instead of
+// rewriting the PHI file for every value, the values are appended to the journal file
+// and collected per task. When the updates are committed (once per worker job or timer
+// cycle), each PHI file is written once with all collected values. QSettings replaces
+// the file atomically, so a PHI file is never left half-written.
+//
+// The journal file is stored in the archive folder, which isn't watched by the task registry.
+// The journal file is only cleared after the PHI files have been written. If the agent
+// stops before (e.g., crash or power loss), the values are read from the journal file
+// when it is opened again and written to the PHI files. A record that has been cut off
+// while it was appended is dropped.
+class ycaTaskJournal
+{
+public:
+    ycaTaskJournal();
+
+    bool open(QString phiFolder, QString archiveFolder);
+
+    void setValue(QString uuid, QString key, QVariant value);
+
+    // Writes the collected values of one task (or of all tasks if the UUID is empty)
+    // into the PHI files. Returns the UUIDs of the tasks that have been written.
+    QStringList commit(QString uuid="");
+
+    bool hasPendingValues(QString uuid="");
+
+protected:
+    bool load();
+    bool appendRecord(QString uuid, QString key, const QVariant& value);
+    bool writeJournal();
+    bool writePHIFile(QString uuid, const QVariantMap& values);
+
+    static void writeRecord(QDataStream& stream, QString uuid, QString key, const QVariant& value);
+
+    QMutex  mutex;
+    QString phiPath;
+    QString archivePath;
+    QString filename;
+
+    QMap<QString, QVariantMap> pendingValues;
+};
+
+
+#endif // YCA_TASKJOURNAL_H
@@ -0,0 +1,542 @@
+#include "yca_taskregistry.h"
+#include "yca_threadlog.h"
+
+#include "../CloudTools/yct_api.h"
+#include "../CloudTools/yct_common.h"
+
+#include <algorithm>
+
+
+ycaTaskEntry::ycaTaskEntry()
+{
+    phiFile=false;
+    taskFile=false;
+    lockFile=false;
+    inFolder=false;
+    incomplete=false;
+
+    cloudStatus=ycaTask::tsInvalid;
+    cloudCost=-1;
+    cloudShortcode="";
+}
+
+
+bool ycaTaskEntry::isEmpty() const
+{
+    return (!phiFile) && (!taskFile) && (!lockFile) && (!inFolder);
+}
+
+
+static bool ycaNewerPHIFile(const ycaTaskEntry& a, const ycaTaskEntry& b)
+{
+    return a.phiModified > b.phiModified;
+}
+
+
+static bool ycaNewerTaskFile(const ycaTaskEntry& a, const ycaTaskEntry& b)
+{
+    return a.taskModified > b.taskModified;
+}
+
+
+ycaTaskRegistry::ycaTaskRegistry()
+    : QObject()
+{
+    started=false;
+
+    watcher=new QFileSystemWatcher(this);
+    connect(watcher, SIGNAL(directoryChanged(QString)), this, SLOT(folderChanged(QString)));
+
+    // Events come in bursts when the ORT/SAC write a task, so they are collected
+    // before the folders are read
+    scanTimer.setSingleShot(true);
+    scanTimer.setInterval(YCA_REGISTRY_DELAY);
+    connect(&scanTimer, SIGNAL(timeout()), this, SLOT(scanChangedFolders()));
+
+    resyncTimer.setInterval(YCA_REGISTRY_RESYNC);
+    connect(&resyncTimer, SIGNAL(timeout()), this, SLOT(resync()));
+
+    moveToThread(&registryThread);
+    scanTimer.moveToThread(&registryThread);
+    resyncTimer.moveToThread(&registryThread);
+}
+
+
+ycaTaskRegistry::~ycaTaskRegistry()
+{
+    stop();
+}
+
+
+void ycaTaskRegistry::start(yctAPI* apiInstance)
+{
+    if (started)
+    {
+        return;
+    }
+
+    outPath    =apiInstance->getCloudPath(YCT_CLOUDFOLDER_OUT);
+    inPath     =apiInstance->getCloudPath(YCT_CLOUDFOLDER_IN);
+    phiPath    =apiInstance->getCloudPath(YCT_CLOUDFOLDER_PHI);
+    archivePath=apiInstance->getCloudPath(YCT_CLOUDFOLDER_ARCHIVE);
+
+    // Write the PHI updates that were journaled but not committed before the last stop
+    if (!journal.open(phiPath, archivePath))
+    {
+        YTL->log("Unable to open task journal. PHI updates are not recovered.",YTL_ERROR,YTL_HIGH);
+    }
+
+    if (!archive.open(archivePath))
+    {
+        YTL->log("Unable to open archive store. Archived tasks are not available.",YTL_ERROR,YTL_HIGH);
+    }
+
+    // Initial load in the calling thread, so that the registry is complete
+    // before the worker and UI use it
+    resync();
+    YTL->log("Task registry loaded with "+QString::number(getCount())+" tasks",YTL_INFO,YTL_MID);
+
+    started=true;
+    registryThread.start();
+    QMetaObject::invokeMethod(this, "startWatching", Qt::QueuedConnection);
+}
+
+
+void ycaTaskRegistry::stop()
+{
+    journal.commit();
+
+    if (!started)
+    {
+        return;
+    }
+
+    QMetaObject::invokeMethod(this, "stopWatching", Qt::BlockingQueuedConnection);
+    registryThread.quit();
+    registryThread.wait();
+    started=false;
+}
+
+
+void ycaTaskRegistry::startWatching()
+{
+    QStringList folders;
+    folders << outPath << inPath << phiPath;
+
+    watcher->addPaths(folders);
+
+    if (watcher->directories().count()!=folders.count())
+    {
+        YTL->log("Unable to watch all cloud folders. Changes are detected with delay.",YTL_WARNING,YTL_HIGH);
+    }
+
+    resyncTimer.start();
+}
+
+
+void ycaTaskRegistry::stopWatching()
+{
+    scanTimer.stop();
+    resyncTimer.stop();
+
+    if (!watcher->directories().isEmpty())
+    {
+        watcher->removePaths(watcher->directories());
+    }
+}
+
+
+void ycaTaskRegistry::folderChanged(QString path)
+{
+    changedFolders.insert(path);
+
+    if (!scanTimer.isActive())
+    {
+        scanTimer.start();
+    }
+}
+
+
+void ycaTaskRegistry::scanChangedFolders()
+{
+    foreach (QString folder, changedFolders)
+    {
+        if (folder==outPath)
+        {
+            scanOut();
+        }
+        else
+        {
+            if (folder==inPath)
+            {
+                scanIn();
+            }
+            else
+            {
+                if (folder==phiPath)
+                {
+                    scanPHI();
+                }
+            }
+        }
+    }
+    changedFolders.clear();
+
+    pruneEntries();
+}
+
+
+void ycaTaskRegistry::resync()
+{
+    scanOut();
+    scanIn();
+    scanPHI();
+    pruneEntries();
+}
+
+
+void ycaTaskRegistry::scanOut()
+{
+    QDir outDir(outPath);
+    if (!outDir.exists())
+    {
+        YTL->log("Unable to find cloud folder OUT: "+outPath,YTL_ERROR,YTL_HIGH);
+        return;
+    }
+
+    QFileInfoList fileList=outDir.entryInfoList(QStringList() << "*.task" << "*.lock",QDir::Files);
+
+    QHash<QString, QDateTime> taskFiles;
+    QSet<QString>             lockFiles;
+
+    for (int i=0; i<fileList.count(); i++)
+    {
+        if (fileList.at(i).suffix()=="lock")
+        {
+            lockFiles.insert(fileList.at(i).baseName());
+        }
+        else
+        {
+            taskFiles.insert(fileList.at(i).baseName(), fileList.at(i).lastModified());
+        }
+    }
+
+    QMutexLocker locker(&entriesMutex);
+
+    QMutableHashIterator<QString, ycaTaskEntry> i(entries);
+    while (i.hasNext())
+    {
+        i.next();
+        i.value().taskFile    =taskFiles.contains(i.key());
+        i.value().taskModified=taskFiles.value(i.key());
+        i.value().lockFile    =lockFiles.contains(i.key());
+    }
+
+    foreach (QString uuid, taskFiles.keys()+lockFiles.toList())
+    {
+        if (!entries.contains(uuid))
+        {
+            ycaTaskEntry& entry=entries[uuid];
+            entry.task.uuid   =uuid;
+            entry.taskFile    =taskFiles.contains(uuid);
+            entry.taskModified=taskFiles.value(uuid);
+            entry.lockFile    =lockFiles.contains(uuid);
+        }
+    }
+}
+
+
+void ycaTaskRegistry::scanIn()
+{
+    QDir inDir(inPath);
+    if (!inDir.exists())
+    {
+        YTL->log("Unable to find cloud folder IN: "+inPath,YTL_ERROR,YTL_HIGH);
+        return;
+    }
+
+    // The IN folder only contains the few cases that are currently downloaded or stored
+    QFileInfoList        dirList=inDir.entryInfoList(QStringList("*"),QDir::Dirs|QDir::NoDotAndDotDot);
+    QHash<QString, bool> folders;
+
+    for (int i=0; i<dirList.count(); i++)
+    {
+        folders.insert(dirList.at(i).fileName(), QFile::exists(dirList.at(i).filePath()+"/"+YCT_INCOMPLETE_FILE));
+    }
+
+    QMutexLocker locker(&entriesMutex);
+
+    QMutableHashIterator<QString, ycaTaskEntry> i(entries);
+    while (i.hasNext())
+    {
+        i.next();
+        i.value().inFolder  =folders.contains(i.key());
+        i.value().incomplete=folders.value(i.key(), false);
+    }
+
+    foreach (QString uuid, folders.keys())
+    {
+        if (!entries.contains(uuid))
+        {
+            ycaTaskEntry& entry=entries[uuid];
+            entry.task.uuid =uuid;
+            entry.inFolder  =true;
+            entry.incomplete=folders.value(uuid);
+        }
+    }
+}
+
+
+void ycaTaskRegistry::scanPHI()
+{
+    QDir phiDir(phiPath);
+    if (!phiDir.exists())
+    {
+        YTL->log("Unable to find cloud folder PHI: "+phiPath,YTL_ERROR,YTL_HIGH);
+        return;
+    }
+
+    QFileInfoList fileList=phiDir.entryInfoList(QStringList("*.phi"),QDir::Files);
+
+    // Find the PHI files that have been read before and haven't changed since
+    QHash<QString, QDateTime> knownFiles;
+    {
+        QMutexLocker locker(&entriesMutex);
+
+        QHashIterator<QString, ycaTaskEntry> i(entries);
+        while (i.hasNext())
+        {
+            i.next();
+
+            if (i.value().phiFile)
+            {
+                knownFiles.insert(i.key(), i.value().phiModified);
+            }
+        }
+    }
+
+    QHash<QString, QDateTime> listedFiles;
+    QHash<QString, ycaTask>   readTasks;
+
+    for (int i=0; i<fileList.count(); i++)
+    {
+        QString   uuid    =fileList.at(i).baseName();
+        QDateTime modified=fileList.at(i).lastModified();
+        listedFiles.insert(uuid, modified);
+
+        if ((knownFiles.contains(uuid)) && (knownFiles.value(uuid)==modified))
+        {
+            continue;
+        }
+
+        ycaTask task;
+        task.uuid=uuid;
+
+        if (!taskHelper.readPHIData(fileList.at(i).absoluteFilePath(),&task))
+        {
+            YTL->log("Unable to read PHI file: "+fileList.at(i).filePath(),YTL_ERROR,YTL_HIGH);
+        }
+
+        readTasks.insert(uuid, task);
+    }
+
+    QMutexLocker locker(&entriesMutex);
+
+    QMutableHashIterator<QString, ycaTaskEntry> i(entries);
+    while (i.hasNext())
+    {
+        i.next();
+        i.value().phiFile=listedFiles.contains(i.key());
+    }
+
+    QHashIterator<QString, ycaTask> j(readTasks);
+    while (j.hasNext())
+    {
+        j.next();
+
+        ycaTaskEntry& entry=entries[j.key()];
+        entry.task       =j.value();
+        entry.phiModified=listedFiles.value(j.key());
+        entry.phiFile    =true;
+    }
+}
+
+
+void ycaTaskRegistry::pruneEntries()
+{
+    QMutexLocker locker(&entriesMutex);
+
+    QMutableHashIterator<QString, ycaTaskEntry> i(entries);
+    while (i.hasNext())
+    {
+        i.next();
+
+        if (i.value().isEmpty())
+        {
+            i.remove();
+        }
+    }
+}
+
+
+void ycaTaskRegistry::refreshTask(QString uuid)
+{
+    if (uuid.isEmpty())
+    {
+        return;
+    }
+
+    ycaTaskEntry entry;
+    entry.task.uuid=uuid;
+
+    QFileInfo taskInfo(outPath+"/"+uuid+".task");
+    entry.taskFile    =taskInfo.exists();
+    entry.taskModified=taskInfo.lastModified();
+    entry.lockFile    =QFile::exists(outPath+"/"+uuid+".lock");
+
+    entry.inFolder    =QDir(inPath+"/"+uuid).exists();
+    entry.incomplete  =(entry.inFolder) && (QFile::exists(inPath+"/"+uuid+"/"+YCT_INCOMPLETE_FILE));
+
+    QFileInfo phiInfo(phiPath+"/"+uuid+".phi");
+    entry.phiFile=phiInfo.exists();
+
+    if (entry.phiFile)
+    {
+        entry.phiModified=phiInfo.lastModified();
+
+        if (!taskHelper.readPHIData(phiInfo.absoluteFilePath(),&entry.task))
+        {
+            YTL->log("Unable to read PHI file: "+phiInfo.filePath(),YTL_ERROR,YTL_HIGH);
+        }
+    }
+
+    QMutexLocker locker(&entriesMutex);
+
+    if (entry.isEmpty())
+    {
+        entries.remove(uuid);
+        return;
+    }
+
+    // The status reported by the cloud is kept until the next update
+    if (entries.contains(uuid))
+    {
+        const ycaTaskEntry& previous=entries[uuid];
+        entry.cloudStatus   =previous.cloudStatus;
+        entry.cloudCost     =previous.cloudCost;
+        entry.cloudShortcode=previous.cloudShortcode;
+    }
+
+    entries.insert(uuid, entry);
+}
+
+
+void ycaTaskRegistry::updateJobStatus(const ycaTaskList& taskList)
+{
+    QMutexLocker locker(&entriesMutex);
+
+    for (int i=0; i<taskList.count(); i++)
+    {
+        QHash<QString, ycaTaskEntry>::iterator entry=entries.find(taskList.at(i)->uuid);
+
+        if (entry!=entries.end())
+        {
+            entry->cloudStatus   =taskList.at(i)->status;
+            entry->cloudCost     =taskList.at(i)->cost;
+            entry->cloudShortcode=taskList.at(i)->shortcode;
+        }
+    }
+}
+
+
+void ycaTaskRegistry::reportJobError(QString uuid, ycaTask::TaskStatus errorStatus)
+{
+    QMutexLocker locker(&entriesMutex);
+
+    QHash<QString, ycaTaskEntry>::iterator entry=entries.find(uuid);
+
+    if (entry!=entries.end())
+    {
+        entry->cloudStatus=errorStatus;
+    }
+}
+
+
+QList<ycaTaskEntry> ycaTaskRegistry::getEntries(Selection selection)
+{
+    QList<ycaTaskEntry> list;
+
+    {
+        QMutexLocker locker(&entriesMutex);
+
+        QHashIterator<QString, ycaTaskEntry> i(entries);
+        while (i.hasNext())
+        {
+            i.next();
+            const ycaTaskEntry& entry=i.value();
+            bool selected=false;
+
+            switch (selection)
+            {
+            case selScheduled:
+                selected=(entry.taskFile) && (!entry.lockFile);
+                break;
+            case selProcessing:
+                selected=(entry.phiFile) && (!entry.lockFile) && (!entry.taskFile) && (!entry.inFolder);
+                break;
+            case selStorage:
+                selected=(entry.inFolder) && (!entry.incomplete);
+                break;
+            case selCurrent:
+                selected=entry.phiFile;
+                break;
+            default:
+                break;
+            }
+
+            if (selected)
+            {
+                list.append(entry);
+            }
+        }
+    }
+
+    std::sort(list.begin(), list.end(), (selection==selScheduled) ? ycaNewerTaskFile : ycaNewerPHIFile);
+
+    return list;
+}
+
+
+bool ycaTaskRegistry::getEntry(QString uuid, ycaTaskEntry& entry)
+{
+    QMutexLocker locker(&entriesMutex);
+
+    QHash<QString, ycaTaskEntry>::const_iterator i=entries.constFind(uuid);
+
+    if (i==entries.constEnd())
+    {
+        return false;
+    }
+
+    entry=i.value();
+    return true;
+}
+
+
+int ycaTaskRegistry::getCount()
+{
+    QMutexLocker locker(&entriesMutex);
+    return entries.count();
+}
+
+
+ycaArchiveStore* ycaTaskRegistry::getArchive()
+{
+    return &archive;
+}
+
+
+ycaTaskJournal* ycaTaskRegistry::getJournal()
+{
+    return &journal;
+}
@@ -0,0 +1,121 @@
+#ifndef YCA_TASKREGISTRY_H
+#define YCA_TASKREGISTRY_H
+
+#include <QtCore>
+
+#include "yca_task.h"
+#include "yca_archivestore.h"
+#include "yca_taskjournal.h"
+
+#define YCA_REGISTRY_RESYNC  300000
+#define YCA_REGISTRY_DELAY   250
+
+
+// State of one task in the cloud folders
+class ycaTaskEntry
+{
+public:
+    ycaTaskEntry();
+
+    ycaTask   task;            // Information from the PHI file
+    bool      phiFile;         // PHI file in the PHI folder
+    QDateTime phiModified;
+
+    bool      taskFile;        // Task file in the OUT folder
+    bool      lockFile;        // Task is currently written by the ORT/SAC
+    QDateTime taskModified;
+
+    bool      inFolder;        // Results in the IN folder
+    bool      incomplete;      // Download has not been completed
+
+    // Last status reported by the cloud (tsInvalid if unknown)
+    ycaTask::TaskStatus cloudStatus;
+    double              cloudCost;
+    QString             cloudShortcode;
+
+    bool isEmpty() const;
+};
+
+
+// In-memory index of the tasks in the cloud folders. The folders are read once when the
+// registry is started. Afterwards, only the folders reported by the file system watcher
+// are listed again, and a PHI file is only parsed if it has been modified since it was
+// read. The workers update the tasks that they have changed right away, and all folders
+// are re-synced periodically in case that events have been missed. The watcher and the
+// re-sync run on the registry's own thread, so that reading the task lists (e.g., for
+// refreshing the UI) doesn't access the disk. Archived tasks are kept in the archive
+// store instead of being listed from the archive folder.
+class ycaTaskRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Selection
+    {
+        selScheduled=0,    // Task file written, waiting for upload
+        selProcessing,     // Uploaded, results not downloaded yet
+        selStorage,        // Results downloaded completely
+        selCurrent         // All tasks with PHI file in the PHI folder
+    };
+
+    ycaTaskRegistry();
+    ~ycaTaskRegistry();
+
+    void start(yctAPI* apiInstance);
+    void stop();
+
+    // Returns copies of the matching entries, most recent first
+    QList<ycaTaskEntry> getEntries(Selection selection);
+    bool getEntry(QString uuid, ycaTaskEntry& entry);
+    int  getCount();
+
+    ycaArchiveStore* getArchive();
+    ycaTaskJournal*  getJournal();
+
+    // Reads the files of one task again. Called by the workers after changing the files.
+    void refreshTask(QString uuid);
+    void updateJobStatus(const ycaTaskList& taskList);
+
+    // Shows the error of a failed worker job until the next status query of the cloud
+    void reportJobError(QString uuid, ycaTask::TaskStatus errorStatus);
+
+public slots:
+    void resync();
+
+protected slots:
+    void startWatching();
+    void stopWatching();
+    void folderChanged(QString path);
+    void scanChangedFolders();
+
+protected:
+    void scanOut();
+    void scanIn();
+    void scanPHI();
+    void pruneEntries();
+
+    QThread             registryThread;
+    QFileSystemWatcher* watcher;
+    QTimer              scanTimer;
+    QTimer              resyncTimer;
+    QSet<QString>       changedFolders;
+    bool                started;
+
+    QString outPath;
+    QString inPath;
+    QString phiPath;
+    QString archivePath;
+
+    QMutex                       entriesMutex;
+    QHash<QString, ycaTaskEntry> entries;
+
+    ycaArchiveStore archive;
+    ycaTaskJournal  journal;
+
+    // Only used for parsing the PHI files
+    ycaTaskHelper taskHelper;
+};
+
+
+#endif // YCA_TASKREGISTRY_H
@@ -0,0 +1,315 @@
+#include "yca_workerpool.h"
+#include "yca_threadlog.h"
+
+#include "../CloudTools/yct_common.h"
+
+
+ycaWorkerJob::ycaWorkerJob(ycaWorkerPool* workerPool, ycaTask* workerTask, ycaTask::WorkerProcess workerProcess,
+                           const yctTransferInformation& information)
+{
+    pool=workerPool;
+    task=workerTask;
+    process=workerProcess;
+    transferInformation=information;
+}
+
+
+ycaWorkerJob::~ycaWorkerJob()
+{
+    if (task!=0)
+    {
+        delete task;
+        task=0;
+    }
+}
+
+
+void ycaWorkerJob::run()
+{
+    yctAPI cloud;
+    cloud.setConfiguration(pool->getConfiguration());
+
+    ycaTaskHelper taskHelper;
+    taskHelper.setCloudInstance(&cloud);
+    taskHelper.setRegistry(pool->getRegistry());
+
+    bool success=false;
+
+    switch (process)
+    {
+    case ycaTask::wpUpload:
+        success=upload(cloud, taskHelper);
+        break;
+    case ycaTask::wpDownload:
+        success=download(cloud, taskHelper);
+        break;
+    case ycaTask::wpStorage:
+        success=store(cloud, taskHelper);
+        break;
+    default:
+        break;
+    }
+
+    // Write the timepoints of the job into the PHI file at once
+    taskHelper.commitPHIUpdates(task->uuid);
+
+    pool->jobFinished(task->uuid, process, success);
+}
+
+
+bool ycaWorkerJob::upload(yctAPI& cloud, ycaTaskHelper& taskHelper)
+{
+    // The task is claimed by this job, so the PHI file can be written without the folder mutex
+    taskHelper.saveTimepoint(task,YCT_TIMEPT_UPLOAD_BEGIN);
+
+    if (!cloud.uploadCase(task, &transferInformation, pool->getFolderMutex()))
+    {
+        reportError(cloud, "Error while uploading case "+task->uuid, ycaTask::tsErrorTransfer);
+        return false;
+    }
+
+    taskHelper.saveTimepoint(task,YCT_TIMEPT_UPLOAD_END);
+
+    return true;
+}
+
+
+bool ycaWorkerJob::download(yctAPI& cloud, ycaTaskHelper& taskHelper)
+{
+    taskHelper.saveTimepoint(task,YCT_TIMEPT_DOWNLOAD_BEGIN);
+
+    if (!cloud.downloadCase(task, &transferInformation, pool->getFolderMutex()))
+    {
+        reportError(cloud, "Error while downloading case "+task->uuid, ycaTask::tsErrorTransfer);
+        return false;
+    }
+
+    taskHelper.saveTimepoint(task,YCT_TIMEPT_DOWNLOAD_END);
+
+    return true;
+}
+
+
+bool ycaWorkerJob::store(yctAPI& cloud, ycaTaskHelper& taskHelper)
+{
+    if (!taskHelper.storeTask(task))
+    {
+        reportError(cloud, "Error while storing case "+task->uuid, ycaTask::tsErrorStorage);
+        return false;
+    }
+
+    YTL->log("(Now archiving case)",YTL_INFO,YTL_MID);
+
+    // Moving the PHI file changes the folder that is read by the UI
+    QString     successNotification="";
+    ycaTaskList archiveList;
+    archiveList.append(task);
+
+    pool->getFolderMutex()->lock();
+    if (!taskHelper.archiveTasks(archiveList,successNotification))
+    {
+        // The results have been stored already, so the job itself has succeeded
+        YTL->log("Error while archiving task "+task->uuid,YTL_ERROR,YTL_HIGH);
+    }
+    pool->getFolderMutex()->unlock();
+
+    if ((pool->getConfiguration()->showNotifications) && (!successNotification.isEmpty())
+        && (pool->getNotificationWidget()!=0))
+    {
+        successNotification="Task has been completed: \n"+successNotification;
+        QMetaObject::invokeMethod(pool->getNotificationWidget(), "showNotification", Qt::QueuedConnection, Q_ARG(QString, successNotification));
+    }
+
+    return true;
+}
+
+
+void ycaWorkerJob::reportError(yctAPI& cloud, QString message, ycaTask::TaskStatus errorStatus)
+{
+    if (!cloud.errorReason.isEmpty())
+    {
+        message+=" ("+cloud.errorReason+")";
+    }
+
+    YTL->log(message,YTL_ERROR,YTL_HIGH);
+
+    // The job is retried with the next update, but the UI shows the error until then
+    task->status=errorStatus;
+
+    if (pool->getRegistry()!=0)
+    {
+        pool->getRegistry()->reportJobError(task->uuid, errorStatus);
+    }
+}
+
+
+ycaWorkerPool::ycaWorkerPool()
+    : QObject()
+{
+    config=0;
+    mutex=0;
+    notificationReceiver=0;
+    registry=0;
+    stopping=false;
+
+    setConcurrency(YCT_WORKERS_UPLOAD, YCT_WORKERS_DOWNLOAD, YCT_WORKERS_STORAGE);
+}
+
+
+ycaWorkerPool::~ycaWorkerPool()
+{
+    shutdown();
+}
+
+
+void ycaWorkerPool::setConfiguration(yctConfiguration* configuration, QMutex* folderMutex, QObject* notificationWidget)
+{
+    config=configuration;
+    mutex=folderMutex;
+    notificationReceiver=notificationWidget;
+}
+
+
+void ycaWorkerPool::setRegistry(ycaTaskRegistry* taskRegistry)
+{
+    registry=taskRegistry;
+}
+
+
+void ycaWorkerPool::setConcurrency(int uploads, int downloads, int storage)
+{
+    uploadLane.setMaxThreadCount  (qBound(1, uploads,   YCT_WORKERS_MAX));
+    downloadLane.setMaxThreadCount(qBound(1, downloads, YCT_WORKERS_MAX));
+    storageLane.setMaxThreadCount (qBound(1, storage,   YCT_WORKERS_MAX));
+}
+
+
+QThreadPool* ycaWorkerPool::getLane(ycaTask::WorkerProcess process)
+{
+    switch (process)
+    {
+    case ycaTask::wpUpload:
+        return &uploadLane;
+    case ycaTask::wpDownload:
+        return &downloadLane;
+    case ycaTask::wpStorage:
+        return &storageLane;
+    default:
+        return 0;
+    }
+}
+
+
+bool ycaWorkerPool::start(ycaTask* task, ycaTask::WorkerProcess process, const yctTransferInformation& transferInformation)
+{
+    QThreadPool* lane=getLane(process);
+
+    if ((task==0) || (lane==0))
+    {
+        return false;
+    }
+
+    // If the task is already processed by a job (or queued), the caller keeps
+    // the ownership of the task
+    claimMutex.lock();
+
+    if ((stopping) || (claimedTasks.contains(task->uuid)))
+    {
+        claimMutex.unlock();
+        return false;
+    }
+
+    claimedTasks.insert(task->uuid, process);
+    claimMutex.unlock();
+
+    // The job takes the ownership of the task
+    lane->start(createJob(task, process, transferInformation));
+
+    return true;
+}
+
+
+ycaWorkerJob* ycaWorkerPool::createJob(ycaTask* task, ycaTask::WorkerProcess process, const yctTransferInformation& transferInformation)
+{
+    return new ycaWorkerJob(this, task, process, transferInformation);
+}
+
+
+void ycaWorkerPool::jobFinished(QString uuid, ycaTask::WorkerProcess process, bool success)
+{
+    // Update the task before it is released, so that the next dispatch
+    // sees the files that have been changed by the job
+    if (registry!=0)
+    {
+        registry->refreshTask(uuid);
+    }
+
+    claimMutex.lock();
+    claimedTasks.remove(uuid);
+    claimMutex.unlock();
+
+    emit taskFinished((int) process, success);
+}
+
+
+bool ycaWorkerPool::isActive(QString uuid)
+{
+    QMutexLocker locker(&claimMutex);
+    return claimedTasks.contains(uuid);
+}
+
+
+int ycaWorkerPool::getActiveCount(ycaTask::WorkerProcess process)
+{
+    QMutexLocker locker(&claimMutex);
+
+    if (process==ycaTask::wpIdle)
+    {
+        return claimedTasks.count();
+    }
+
+    int count=0;
+
+    QMapIterator<QString, ycaTask::WorkerProcess> i(claimedTasks);
+    while (i.hasNext())
+    {
+        i.next();
+
+        if (i.value()==process)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+QMap<QString, ycaTask::WorkerProcess> ycaWorkerPool::getActiveTasks()
+{
+    QMutexLocker locker(&claimMutex);
+    return claimedTasks;
+}
+
+
+bool ycaWorkerPool::shutdown(int waitMsec)
+{
+    claimMutex.lock();
+    stopping=true;
+    claimMutex.unlock();
+
+    // Drop the jobs that have not been started yet. They are picked up again
+    // when the agent is started the next time.
+    uploadLane.clear();
+    downloadLane.clear();
+    storageLane.clear();
+
+    QElapsedTimer ti;
+    ti.start();
+
+    bool finished=storageLane.waitForDone(waitMsec);
+    finished=downloadLane.waitForDone(qMax(0, int(waitMsec-ti.elapsed()))) && finished;
+    finished=uploadLane.waitForDone  (qMax(0, int(waitMsec-ti.elapsed()))) && finished;
+
+    return finished;
+}
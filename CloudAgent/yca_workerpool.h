@@ -0,0 +1,123 @@
+#ifndef YCA_WORKERPOOL_H
+#define YCA_WORKERPOOL_H
+
+#include <QtCore>
+
+#include "yca_task.h"
+#include "yca_taskregistry.h"
+#include "../CloudTools/yct_api.h"
+#include "../CloudTools/yct_configuration.h"
+
+#define YCA_WORKERPOOL_SHUTDOWNWAIT 10000
+
+
+class ycaWorkerPool;
+
+
+// Single upload, download or storage operation for one task. The job runs on a
+// thread of the lane's pool and uses its own API instance, because the helper
+// output and error reason are stored in the instance.
+class ycaWorkerJob : public QRunnable
+{
+public:
+    ycaWorkerJob(ycaWorkerPool* workerPool, ycaTask* workerTask, ycaTask::WorkerProcess workerProcess,
+                 const yctTransferInformation& information);
+    ~ycaWorkerJob();
+
+    void run();
+
+protected:
+    bool upload  (yctAPI& cloud, ycaTaskHelper& taskHelper);
+    bool download(yctAPI& cloud, ycaTaskHelper& taskHelper);
+    bool store   (yctAPI& cloud, ycaTaskHelper& taskHelper);
+
+    void reportError(yctAPI& cloud, QString message, ycaTask::TaskStatus errorStatus);
+
+    ycaWorkerPool*         pool;
+    ycaTask*               task;
+    ycaTask::WorkerProcess process;
+    yctTransferInformation transferInformation;
+};
+
+
+// Thread pools for the upload, download and storage lanes. A task is claimed by
+// a lane when its job is started and released when the job has finished, so that
+// each task is only processed by one job at a time. The claims replace the global
+// mutex for the operations on the task's files. Long uploads therefore don't block
+// the download and storage of other tasks.
+class ycaWorkerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    ycaWorkerPool();
+    ~ycaWorkerPool();
+
+    void setConfiguration(yctConfiguration* configuration, QMutex* folderMutex, QObject* notificationWidget);
+    void setRegistry(ycaTaskRegistry* taskRegistry);
+    void setConcurrency(int uploads, int downloads, int storage);
+
+    bool start(ycaTask* task, ycaTask::WorkerProcess process, const yctTransferInformation& transferInformation);
+    bool isActive(QString uuid);
+    int  getActiveCount(ycaTask::WorkerProcess process=ycaTask::wpIdle);
+    QMap<QString, ycaTask::WorkerProcess> getActiveTasks();
+
+    bool shutdown(int waitMsec=YCA_WORKERPOOL_SHUTDOWNWAIT);
+
+    yctConfiguration* getConfiguration();
+    QMutex*           getFolderMutex();
+    QObject*          getNotificationWidget();
+    ycaTaskRegistry*  getRegistry();
+
+    void jobFinished(QString uuid, ycaTask::WorkerProcess process, bool success);
+
+signals:
+    void taskFinished(int process, bool success);
+
+protected:
+    QThreadPool* getLane(ycaTask::WorkerProcess process);
+
+    // Creates the job that processes the task on the lane. Replaced by the test of the
+    // pool with a stand-in job, which doesn't transfer any data.
+    virtual ycaWorkerJob* createJob(ycaTask* task, ycaTask::WorkerProcess process, const yctTransferInformation& transferInformation);
+
+    QThreadPool uploadLane;
+    QThreadPool downloadLane;
+    QThreadPool storageLane;
+
+    QMutex                                claimMutex;
+    QMap<QString, ycaTask::WorkerProcess> claimedTasks;
+    bool                                  stopping;
+
+    yctConfiguration* config;
+    QMutex*           mutex;
+    QObject*          notificationReceiver;
+    ycaTaskRegistry*  registry;
+};
+
+
+inline yctConfiguration* ycaWorkerPool::getConfiguration()
+{
+    return config;
+}
+
+
+inline QMutex* ycaWorkerPool::getFolderMutex()
+{
+    return mutex;
+}
+
+
+inline QObject* ycaWorkerPool::getNotificationWidget()
+{
+    return notificationReceiver;
+}
+
+
+inline ycaTaskRegistry* ycaWorkerPool::getRegistry()
+{
+    return registry;
+}
+
+
+#endif // YCA_WORKERPOOL_H
@@ -0,0 +1,254 @@
+#include <QtCore>
+#include <stdio.h>
+
+#include "yca_workerpool.h"
+
+
+// Test of the lanes of the worker pool. The jobs are replaced by stand-ins that sleep
+// instead of calling the helper and the API, so that the test doesn't need a cloud
+// account. Tasks with a uuid starting with "long" stand for large uploads.
+
+#define TEST_SHORTJOB 200
+#define TEST_LONGJOB  3000
+#define TEST_TIMEOUT  30000
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+// Number of jobs per lane that run at the same time, and the finished jobs
+static QMutex      statsMutex;
+static int         runningJobs[4];
+static int         maxRunningJobs[4];
+static QStringList finishedJobs;
+
+
+static void resetStats()
+{
+    QMutexLocker locker(&statsMutex);
+
+    for (int i=0; i<4; i++)
+    {
+        runningJobs[i]=0;
+        maxRunningJobs[i]=0;
+    }
+    finishedJobs.clear();
+}
+
+
+class ycaTestJob : public ycaWorkerJob
+{
+public:
+    ycaTestJob(ycaWorkerPool* workerPool, ycaTask* workerTask, ycaTask::WorkerProcess workerProcess,
+               const yctTransferInformation& information)
+        : ycaWorkerJob(workerPool, workerTask, workerProcess, information)
+    {
+    }
+
+    void run()
+    {
+        statsMutex.lock();
+        runningJobs[process]++;
+        maxRunningJobs[process]=qMax(maxRunningJobs[process], runningJobs[process]);
+        statsMutex.unlock();
+
+        QThread::msleep(task->uuid.startsWith("long") ? TEST_LONGJOB : TEST_SHORTJOB);
+
+        statsMutex.lock();
+        runningJobs[process]--;
+        finishedJobs.append(task->uuid + "/" + QString::number(process));
+        statsMutex.unlock();
+
+        pool->jobFinished(task->uuid, process, true);
+    }
+};
+
+
+class ycaTestPool : public ycaWorkerPool
+{
+protected:
+    ycaWorkerJob* createJob(ycaTask* task, ycaTask::WorkerProcess process, const yctTransferInformation& transferInformation)
+    {
+        return new ycaTestJob(this, task, process, transferInformation);
+    }
+};
+
+
+static ycaTask* createTask(QString uuid)
+{
+    ycaTask* task=new ycaTask();
+    task->uuid=uuid;
+    return task;
+}
+
+
+static bool waitForTask(ycaWorkerPool& pool, QString uuid)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while ((pool.isActive(uuid)) && (timer.elapsed()<TEST_TIMEOUT))
+    {
+        QThread::msleep(10);
+    }
+
+    return !pool.isActive(uuid);
+}
+
+
+static bool waitForPool(ycaWorkerPool& pool)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while ((pool.getActiveCount()>0) && (timer.elapsed()<TEST_TIMEOUT))
+    {
+        QThread::msleep(10);
+    }
+
+    return (pool.getActiveCount()==0);
+}
+
+
+int testStorageDuringUpload()
+{
+    printf("Storage during long upload\n");
+
+    resetStats();
+
+    ycaTestPool pool;
+    pool.setConcurrency(1, 1, 1);
+
+    yctTransferInformation information;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pool.start(createTask("long-upload"), ycaTask::wpUpload, information);
+
+    // The results of another task are downloaded and stored while the upload runs
+    bool downloaded=pool.start(createTask("short"), ycaTask::wpDownload, information) && waitForTask(pool, "short");
+    bool stored    =pool.start(createTask("short"), ycaTask::wpStorage,  information) && waitForTask(pool, "short");
+    qint64 storedAfter=timer.elapsed();
+
+    printf("  Short task stored after %lld ms\n", storedAfter);
+
+    check(downloaded && stored,                           "Short task downloaded and stored");
+    check(storedAfter<TEST_LONGJOB,                       "Storage not blocked by upload");
+    check(pool.isActive("long-upload"),                   "Upload still running");
+    check(pool.getActiveCount(ycaTask::wpUpload)==1,      "Upload lane busy");
+
+    // A claimed task isn't started by another lane, and the caller keeps the task
+    ycaTask* duplicate=createTask("long-upload");
+    check(!pool.start(duplicate, ycaTask::wpStorage, information), "Claimed task not started again");
+    delete duplicate;
+
+    check(waitForTask(pool, "long-upload"),               "Upload finished");
+    check(finishedJobs==(QStringList() << "short/2" << "short/3" << "long-upload/1"), "Jobs finished in expected order");
+
+    pool.shutdown();
+
+    printf("\n");
+    return 0;
+}
+
+
+int testConcurrencyLimits()
+{
+    printf("Concurrency per lane\n");
+
+    resetStats();
+
+    ycaTestPool pool;
+    pool.setConcurrency(2, 1, 3);
+
+    yctTransferInformation information;
+
+    for (int i=0; i<6; i++)
+    {
+        pool.start(createTask("upload"   + QString::number(i)), ycaTask::wpUpload,   information);
+        pool.start(createTask("download" + QString::number(i)), ycaTask::wpDownload, information);
+        pool.start(createTask("storage"  + QString::number(i)), ycaTask::wpStorage,  information);
+    }
+
+    // Queued jobs count as active, so that the tasks aren't dispatched again
+    check(pool.getActiveCount(ycaTask::wpDownload)==6, "Queued jobs claim their tasks");
+    check(waitForPool(pool),                           "All jobs finished");
+
+    printf("  Concurrent jobs: %d uploads, %d downloads, %d storage\n",
+           maxRunningJobs[ycaTask::wpUpload], maxRunningJobs[ycaTask::wpDownload], maxRunningJobs[ycaTask::wpStorage]);
+
+    check(finishedJobs.count()==18,                    "All jobs run");
+    check(maxRunningJobs[ycaTask::wpUpload]==2,        "Upload lane limited to 2 jobs");
+    check(maxRunningJobs[ycaTask::wpDownload]==1,      "Download lane limited to 1 job");
+    check(maxRunningJobs[ycaTask::wpStorage]==3,       "Storage lane limited to 3 jobs");
+
+    pool.shutdown();
+
+    printf("\n");
+    return 0;
+}
+
+
+int testShutdown()
+{
+    printf("Shutdown\n");
+
+    resetStats();
+
+    ycaTestPool pool;
+    pool.setConcurrency(1, 1, 1);
+
+    yctTransferInformation information;
+
+    for (int i=0; i<3; i++)
+    {
+        pool.start(createTask("upload" + QString::number(i)), ycaTask::wpUpload, information);
+    }
+
+    // Wait until the first job is running, so that the others are queued
+    QThread::msleep(TEST_SHORTJOB/2);
+
+    bool finished=pool.shutdown();
+
+    check(finished,                 "Running job finished");
+    check(finishedJobs.count()==1,  "Queued jobs dropped");
+
+    ycaTask* lateTask=createTask("late");
+    check(!pool.start(lateTask, ycaTask::wpUpload, information), "No jobs started after shutdown");
+    delete lateTask;
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    printf("\nYarra Cloud Agent - Worker Pool Test\n");
+    printf("------------------------------------\n\n");
+
+    testStorageDuringUpload();
+    testConcurrencyLimits();
+    testShutdown();
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# Test of the worker pool lanes with stand-in jobs
+#
+#-------------------------------------------------
+
+QT += core widgets gui xml svg network
+
+DEFINES += YARRA_APP_YCA
+
+TARGET    = yca_workerpool_test
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE  = app
+
+
+SOURCES += yca_workerpool_test.cpp \
+    ../Client/rds_runtimeinformation.cpp \
+    ../CloudTools/yct_configuration.cpp \
+    ../CloudTools/yct_aws/qtawsqnam.cpp \
+    ../CloudTools/yct_aws/qtaws.cpp \
+    ../CloudTools/yct_aws/qtawss3.cpp \
+    ../CloudTools/yct_api.cpp \
+    ../CloudTools/yct_dicompatcher.cpp \
+    ../Client/rds_processrunner.cpp \
+    yca_task.cpp \
+    yca_threadlog.cpp \
+    yca_workerpool.cpp \
+    yca_taskregistry.cpp \
+    yca_archivestore.cpp \
+    yca_taskjournal.cpp
+
+HEADERS += \
+    ../Client/rds_runtimeinformation.h \
+    yca_global.h \
+    ../CloudTools/yct_common.h \
+    ../CloudTools/yct_configuration.h \
+    ../CloudTools/yct_aws/qtawsqnam.h \
+    ../CloudTools/yct_aws/qtaws.h \
+    ../CloudTools/yct_aws/qtawss3.h \
+    ../CloudTools/yct_api.h \
+    ../CloudTools/yct_dicompatcher.h \
+    ../Client/rds_processrunner.h \
+    yca_task.h \
+    yca_threadlog.h \
+    yca_workerpool.h \
+    yca_taskregistry.h \
+    yca_archivestore.h \
+    yca_taskjournal.h
@@ -10,10 +10,12 @@ CONFIG -= app_bundle
 TEMPLATE = app
 
 SOURCES += main.cpp \
-           ../yct_prepare/yct_twix_anonymizer.cpp
+           ../yct_prepare/yct_twix_anonymizer.cpp \
+           ../yct_prepare/yct_twix_tagmatcher.cpp
 
 HEADERS += \
     ../yct_prepare/yct_twix_anonymizer.h \
+    ../yct_prepare/yct_twix_tagmatcher.h \
     ../yct_prepare/yct_twix_header.h
 
 
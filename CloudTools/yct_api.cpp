@@ -1,12 +1,15 @@
 #include "yct_api.h"
 #include "yct_configuration.h"
+#include "yct_dicompatcher.h"
 #include "yct_aws/qtaws.h"
+#include "yct_aws/qtawss3.h"
 #include "../CloudAgent/yca_threadlog.h"
 #include "../CloudAgent/yca_global.h"
 #include "../CloudAgent/yca_task.h"
 
 #include "../OfflineReconClient/ort_modelist.h"
 #include "../Client/rds_global.h"
+#include "../Client/rds_processrunner.h"
 
 
 #if defined(Q_OS_WIN)
@@ -45,6 +48,69 @@ yctStorageInformation::yctStorageInformation()
 }
 
 
+QString yctStorageInformation::getKey() const
+{
+    if (method==yctPACS)
+    {
+        return "PACS:"+name+":"+pacsAEC+"@"+pacsIP+":"+pacsPort;
+    }
+
+    return "Drive:"+name+":"+driveLocation;
+}
+
+
+// Runnable for delivering the results to one destination
+class yctDestinationTask : public QRunnable
+{
+public:
+
+    yctDestinationTask(yctAPI* apiInstance, QString taskPath, ycaTask* deliveryTask, yctStorageInformation* storageDestination)
+    {
+        api        =apiInstance;
+        path       =taskPath;
+        task       =deliveryTask;
+        destination=storageDestination;
+        result     =false;
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        result=api->pushToDestination(path, task, destination);
+    }
+
+    yctAPI*                api;
+    QString                path;
+    ycaTask*               task;
+    yctStorageInformation* destination;
+    bool                   result;
+};
+
+
+// Runnable for copying one file to a drive destination
+class yctFileCopyTask : public QRunnable
+{
+public:
+
+    yctFileCopyTask(QString source, QString target)
+    {
+        sourceFilename=source;
+        targetFilename=target;
+        result=false;
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        result=QFile::copy(sourceFilename, targetFilename);
+    }
+
+    QString sourceFilename;
+    QString targetFilename;
+    bool    result;
+};
+
+
 yctAPI::yctAPI()
 {
     config=0;
@@ -60,11 +126,33 @@ void yctAPI::setConfiguration(yctConfiguration* configuration)
 }
 
 
+// Returns the client that is shared by all API instances with the same credentials, so
+// that the connection to the API and the signing keys are reused between the calls
+QSharedPointer<QtAWSClient> yctAPI::getClient()
+{
+    return QtAWSClient::shared(config->key, config->secret);
+}
+
+
 bool yctAPI::validateUser(yctTransferInformation* transferInformation)
 {
-    QtAWSRequest awsRequest(config->key, config->secret);
-    QtAWSReply reply=awsRequest.sendRequest("POST", "api.yarracloud.com", "v1/user_status",
-                                            QByteArray(), YCT_API_REGION, QByteArray(), QStringList());
+    return readUserStatus(requestUserStatus(), transferInformation);
+}
+
+
+// Sends the user status query without waiting for the reply, so that other
+// API calls can be made while the query is running
+QSharedPointer<QtAWSPendingReply> yctAPI::requestUserStatus()
+{
+    return getClient()->sendAsync("POST", "api.yarracloud.com", "v1/user_status",
+                                  QByteArray(), YCT_API_REGION, QByteArray(), QStringList());
+}
+
+
+bool yctAPI::readUserStatus(QSharedPointer<QtAWSPendingReply> pendingReply, yctTransferInformation* transferInformation)
+{
+    pendingReply->waitForFinished();
+    QtAWSReply reply=pendingReply->reply();
 
     if (!reply.isSuccess())
     {
@@ -141,9 +229,8 @@ int yctAPI::readModeList(ortModeList* modeList)
         return 0;
     }
 
-    QtAWSRequest awsRequest(config->key, config->secret);
-    QtAWSReply reply=awsRequest.sendRequest("POST", "api.yarracloud.com", "v1/modes",
-                                            QByteArray(), YCT_API_REGION, QByteArray(), QStringList());
+    QtAWSReply reply=getClient()->sendRequest("POST", "api.yarracloud.com", "v1/modes",
+                                              QByteArray(), YCT_API_REGION, QByteArray(), QStringList());
 
     if (!reply.isSuccess())
     {
@@ -364,9 +451,8 @@ bool yctAPI::getJobStatus(ycaTaskList* taskList)
 
     QByteArray content=runningTasks.toUtf8();
 
-    QtAWSRequest awsRequest(config->key, config->secret);
-    QtAWSReply reply=awsRequest.sendRequest("POST", "api.yarracloud.com", "v1/jobs",
-                                            QByteArray(), YCT_API_REGION, content, QStringList());
+    QtAWSReply reply=getClient()->sendRequest("POST", "api.yarracloud.com", "v1/jobs",
+                                              QByteArray(), YCT_API_REGION, content, QStringList());
 
     if (!reply.isSuccess())
     {
@@ -446,44 +532,58 @@ bool yctAPI::uploadCase(ycaTask* task, yctTransferInformation* setup, QMutex* mu
 
     YTL->log("Uploading case "+task->uuid,YTL_INFO,YTL_HIGH);
 
-    // Compose the command line for the help app
-    QString cmdLine=setup->username + " " + config->key + " " + config->secret +" " +
-                    setup->region + " " + setup->inBucket + " " + task->uuid + " upload ";
-
     QString path=getCloudPath(YCT_CLOUDFOLDER_OUT)+"/";
 
-    for (int i=0; i<task->twixFilenames.count(); i++)
+    if (config->nativeTransfer)
     {
-        YTL->log("Including file "+task->twixFilenames.at(i),YTL_INFO,YTL_LOW);
-        cmdLine += path+task->twixFilenames.at(i)+" ";
+        QStringList files;
+
+        for (int i=0; i<task->twixFilenames.count(); i++)
+        {
+            files.append(path+task->twixFilenames.at(i));
+        }
+        files.append(path+task->taskFilename);
+
+        success=uploadFilesNative(task, setup, files);
     }
+    else
+    {
+        // Compose the command line for the help app
+        QString cmdLine=setup->username + " " + config->key + " " + config->secret +" " +
+                        setup->region + " " + setup->inBucket + " " + task->uuid + " upload ";
 
-    cmdLine += path+task->taskFilename;    
-    qInfo() << cmdLine;
+        for (int i=0; i<task->twixFilenames.count(); i++)
+        {
+            YTL->log("Including file "+task->twixFilenames.at(i),YTL_INFO,YTL_LOW);
+            cmdLine += path+task->twixFilenames.at(i)+" ";
+        }
 
-    // TODO: Batch call if commandline is too long
+        cmdLine += path+task->taskFilename;
 
-    // Execute the helper app to perform the multi-part upload
-    YTL->log("Calling upload helper",YTL_INFO,YTL_LOW);
-    int exitcode=callHelperApp(YCT_HELPER_APP,cmdLine,YCT_HELPER_TIMEOUT_TRANSFER);
-    YTL->log("Upload helper finished",YTL_INFO,YTL_LOW);
+        // TODO: Batch call if commandline is too long
 
-    YTL->log("(Helper output begin)",YTL_INFO,YTL_LOW);
-    for (int i=0; i<helperAppOutput.count(); i++)
-    {
-        YTL->log(helperAppOutput.at(i),YTL_INFO,YTL_LOW);
-    }
-    YTL->log("(Helper output end)",YTL_INFO,YTL_LOW);
+        // Execute the helper app to perform the multi-part upload
+        YTL->log("Calling upload helper",YTL_INFO,YTL_LOW);
+        int exitcode=callHelperApp(YCT_HELPER_APP,cmdLine,YCT_HELPER_TIMEOUT_TRANSFER);
+        YTL->log("Upload helper finished",YTL_INFO,YTL_LOW);
 
-    if (exitcode==0)
-    {
-        success=true;
-    }
-    else
-    {
-        YTL->log("Upload helper reported error",YTL_ERROR,YTL_MID);
-        success=false;
-        // TODO: Error handling        
+        YTL->log("(Helper output begin)",YTL_INFO,YTL_LOW);
+        for (int i=0; i<helperAppOutput.count(); i++)
+        {
+            YTL->log(helperAppOutput.at(i),YTL_INFO,YTL_LOW);
+        }
+        YTL->log("(Helper output end)",YTL_INFO,YTL_LOW);
+
+        if (exitcode==0)
+        {
+            success=true;
+        }
+        else
+        {
+            YTL->log("Upload helper reported error",YTL_ERROR,YTL_MID);
+            success=false;
+            // TODO: Error handling
+        }
     }
 
     if (success)
@@ -493,9 +593,8 @@ bool yctAPI::uploadCase(ycaTask* task, yctTransferInformation* setup, QMutex* mu
 
         QString      jsonText="{\"name\":\""+ task->uuid +"\", \"task_file_name\": \"" + task->taskFilename +"\", \"recon_mode\":\"" + task->reconMode + "\"}";
         QByteArray   jsonString=jsonText.toUtf8();
-        QtAWSRequest awsRequest(config->key, config->secret);
-        QtAWSReply   reply=awsRequest.sendRequest("POST", "api.yarracloud.com", "v1/job_submit",
-                                                  QByteArray(), YCT_API_REGION, jsonString, QStringList());
+        QtAWSReply   reply=getClient()->sendRequest("POST", "api.yarracloud.com", "v1/job_submit",
+                                                    QByteArray(), YCT_API_REGION, jsonString, QStringList());
 
         if (!reply.isSuccess())
         {
@@ -552,10 +651,6 @@ bool yctAPI::downloadCase(ycaTask* task, yctTransferInformation* setup, QMutex*
 
     QString path=getCloudPath(YCT_CLOUDFOLDER_IN)+"/"+task->uuid;
 
-    QString cmdLine=setup->username + " " + config->key + " " + config->secret +" " +
-                    setup->region + " " + setup->outBucket + " " + task->uuid + " download " + getCloudPath(YCT_CLOUDFOLDER_IN);
-    //qDebug() << cmdLine;
-
     QDir dir(getCloudPath(YCT_CLOUDFOLDER_IN));
     if (!dir.mkpath(path))
     {
@@ -573,16 +668,29 @@ bool yctAPI::downloadCase(ycaTask* task, yctTransferInformation* setup, QMutex*
 
     // TODO: Check available disk space
 
-    YTL->log("Calling download helper",YTL_INFO,YTL_LOW);
-    int exitcode=callHelperApp(YCT_HELPER_APP,cmdLine,YCT_HELPER_TIMEOUT_TRANSFER);
-    YTL->log("Download helper finished",YTL_INFO,YTL_LOW);
+    int exitcode=-1;
 
-    YTL->log("(Helper output begin)",YTL_INFO,YTL_LOW);
-    for (int i=0; i<helperAppOutput.count(); i++)
+    if (config->nativeTransfer)
     {
-        YTL->log(helperAppOutput.at(i),YTL_INFO,YTL_LOW);
+        exitcode=downloadFilesNative(task, setup, path) ? 0 : 1;
+    }
+    else
+    {
+        QString cmdLine=setup->username + " " + config->key + " " + config->secret +" " +
+                        setup->region + " " + setup->outBucket + " " + task->uuid + " download " + getCloudPath(YCT_CLOUDFOLDER_IN);
+        //qDebug() << cmdLine;
+
+        YTL->log("Calling download helper",YTL_INFO,YTL_LOW);
+        exitcode=callHelperApp(YCT_HELPER_APP,cmdLine,YCT_HELPER_TIMEOUT_TRANSFER);
+        YTL->log("Download helper finished",YTL_INFO,YTL_LOW);
+
+        YTL->log("(Helper output begin)",YTL_INFO,YTL_LOW);
+        for (int i=0; i<helperAppOutput.count(); i++)
+        {
+            YTL->log(helperAppOutput.at(i),YTL_INFO,YTL_LOW);
+        }
+        YTL->log("(Helper output end)",YTL_INFO,YTL_LOW);
     }
-    YTL->log("(Helper output end)",YTL_INFO,YTL_LOW);
 
     if (exitcode==0)
     {
@@ -606,6 +714,118 @@ bool yctAPI::downloadCase(ycaTask* task, yctTransferInformation* setup, QMutex*
 }
 
 
+void yctAPI::configureTransfer(QtAWSS3Transfer& transfer)
+{
+    // A custom endpoint allows testing with an S3-compatible server
+    if (!config->transferEndpoint.isEmpty())
+    {
+        transfer.setEndpoint(QUrl(config->transferEndpoint));
+    }
+
+    transfer.setParallelParts(qBound(1, config->transferParts, YCT_WORKERS_MAX));
+
+    transfer.setProgressHandler([](qint64 transferred, qint64 total)
+    {
+        YTL->log("Transferred "+QString::number(transferred/(1024*1024))+" of "+QString::number(total/(1024*1024))+" MB",YTL_INFO,YTL_LOW);
+    });
+
+    transfer.setLogHandler([](const QString& message)
+    {
+        YTL->log(message,YTL_WARNING,YTL_MID);
+    });
+}
+
+
+bool yctAPI::uploadFilesNative(ycaTask* task, yctTransferInformation* setup, QStringList files)
+{
+    // The files are stored as <user>/<task uuid>/<filename> in the inbound bucket
+    QtAWSS3Transfer transfer(config->key, config->secret, setup->region.toLatin1());
+    configureTransfer(transfer);
+
+    for (int i=0; i<files.count(); i++)
+    {
+        QString key=setup->username+"/"+task->uuid+"/"+QFileInfo(files.at(i)).fileName();
+
+        YTL->log("Uploading file "+files.at(i),YTL_INFO,YTL_LOW);
+
+        if (!transfer.uploadFile(files.at(i), setup->inBucket.toLatin1(), key))
+        {
+            errorReason=transfer.errorString();
+            YTL->log("Upload failed. Reason: "+errorReason,YTL_ERROR,YTL_MID);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool yctAPI::downloadFilesNative(ycaTask* task, yctTransferInformation* setup, QString path)
+{
+    // All objects below <user>/<task uuid>/ in the outbound bucket are downloaded into
+    // the task folder, keeping the relative paths
+    QtAWSS3Transfer transfer(config->key, config->secret, setup->region.toLatin1());
+    configureTransfer(transfer);
+
+    QString     prefix=setup->username+"/"+task->uuid+"/";
+    QStringList keys;
+
+    if (!transfer.listObjects(setup->outBucket.toLatin1(), prefix, keys))
+    {
+        errorReason=transfer.errorString();
+        YTL->log("Unable to list results. Reason: "+errorReason,YTL_ERROR,YTL_MID);
+        return false;
+    }
+
+    if (keys.isEmpty())
+    {
+        YTL->log("No results found for case "+task->uuid,YTL_ERROR,YTL_MID);
+        return false;
+    }
+
+    QString basePath=QDir::cleanPath(path)+"/";
+
+    for (int i=0; i<keys.count(); i++)
+    {
+        QString relativePath=keys.at(i).mid(prefix.length());
+
+        // Skip folder placeholders
+        if ((relativePath.isEmpty()) || (relativePath.endsWith("/")))
+        {
+            continue;
+        }
+
+        // The keys are chosen by the server. Don't write outside of the task folder if
+        // a key contains ".." segments, an absolute path, or a drive letter.
+        QString filename=QDir::cleanPath(path+"/"+relativePath);
+
+        if ((QDir::isAbsolutePath(relativePath)) || (relativePath.contains(":")) || (!filename.startsWith(basePath)))
+        {
+            errorReason="Invalid file name in results: "+relativePath;
+            YTL->log("Rejecting result file outside of task folder: "+keys.at(i),YTL_ERROR,YTL_MID);
+            return false;
+        }
+
+        if (!QDir().mkpath(QFileInfo(filename).absolutePath()))
+        {
+            YTL->log("Unable to create folder for "+filename,YTL_ERROR,YTL_MID);
+            return false;
+        }
+
+        YTL->log("Downloading file "+relativePath,YTL_INFO,YTL_LOW);
+
+        if (!transfer.downloadFile(setup->outBucket.toLatin1(), keys.at(i), filename))
+        {
+            errorReason=transfer.errorString();
+            YTL->log("Download failed. Reason: "+errorReason,YTL_ERROR,YTL_MID);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 bool yctAPI::insertPHI(QString path, ycaTask* task)
 {
     QDir tarDir(path+"/output_files");
@@ -624,6 +844,34 @@ bool yctAPI::insertPHI(QString path, ycaTask* task)
         return false;
     }
 
+    // If the storage is retried, the PHI has already been inserted by the first attempt
+    QSettings deliveredFile(path+"/"+YCT_DELIVERED_FILE, QSettings::IniFormat);
+
+    if (deliveredFile.value("Delivery/PHIInserted",false).toBool())
+    {
+        YTL->log("PHI already inserted",YTL_INFO,YTL_LOW);
+        return true;
+    }
+
+    // Write the patient information directly into the files. If this fails (e.g., for
+    // unsupported transfer syntaxes), the files are modified with dcmodify instead.
+    yctDICOMPatcher patcher;
+    patcher.setValue(0x0010,0x0010,"PN",task->patientName);
+    patcher.setValue(0x0010,0x0020,"LO",task->mrn);
+    patcher.setValue(0x0010,0x0030,"DA",task->dob);
+    patcher.setValue(0x0008,0x0050,"SH",task->acc);
+    patcher.setValue(0x0010,0x4000,"LT",task->uuid);
+
+    if (patcher.patchFolder(tarDir.absolutePath(),QStringList("*.dcm")))
+    {
+        deliveredFile.setValue("Delivery/PHIInserted",true);
+        deliveredFile.sync();
+        return true;
+    }
+
+    YTL->log("Unable to insert PHI directly into "+QString::number(patcher.failedFiles.count())+" files: "+patcher.errorReason,YTL_WARNING,YTL_MID);
+    YTL->log("Inserting PHI with dcmodify",YTL_INFO,YTL_MID);
+
     QString dicomPath=QDir::toNativeSeparators(tarDir.absolutePath()+"/*.dcm")+" ";
 
     QString cmd="";
@@ -654,6 +902,9 @@ bool yctAPI::insertPHI(QString path, ycaTask* task)
 
     // TODO: Search helper output for error messages
 
+    deliveredFile.setValue("Delivery/PHIInserted",true);
+    deliveredFile.sync();
+
     return true;
 }
 
@@ -662,12 +913,16 @@ int yctAPI::callHelperApp(QString binary, QString parameters, int execTimeout)
 {
     // Clear the output buffer
     helperAppOutput.clear();
+
+    return callHelperApp(binary, parameters, helperAppOutput, execTimeout);
+}
+
+
+int yctAPI::callHelperApp(QString binary, QString parameters, QStringList& output, int execTimeout)
+{
     int exitcode=-1;
     bool success=false;
 
-    QProcess *myProcess = new QProcess(0);
-    myProcess->setReadChannel(QProcess::StandardOutput);
-    myProcess->setProcessChannelMode(QProcess::MergedChannels);
     QString helperCmd=qApp->applicationDirPath()+"/"+binary+" "+parameters;
 
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
@@ -695,111 +950,51 @@ int yctAPI::callHelperApp(QString binary, QString parameters, int execTimeout)
         YTL->log("Using Proxy "+proxyString,YTL_INFO,YTL_LOW);
     }
 
-    myProcess->setProcessEnvironment(env);
-
     //qDebug() << "Calling helper tool: " + helperCmd;
 
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(execTimeout);
-    QEventLoop q;
-    connect(myProcess, SIGNAL(finished(int , QProcess::ExitStatus)), &q, SLOT(quit()));
-    connect(&timeoutTimer, SIGNAL(timeout()), &q, SLOT(quit()));
-
-    QTime ti;
-    ti.start();
-    timeoutTimer.start();
-    myProcess->start(helperCmd);
-    q.exec();
-
-    // Check for problems with the event loop: Sometimes it seems to return to quickly!
-    // In this case, start a second while loop to check when the process is really finished.
-    if ((timeoutTimer.isActive()) && (myProcess->state()==QProcess::Running))
+    // Collect the output lines while the helper is running. The transfers can
+    // take long and produce a lot of progress output.
+    rdsProcessRunner runner;
+    runner.setTimeout(execTimeout);
+    runner.setMergedChannels();
+    runner.setEnvironment(env);
+    runner.setLineHandler([&output](const QByteArray& line)
     {
-        timeoutTimer.stop();
-        RTI->log("Warning: QEventLoop returned too early. Starting secondary loop.");
-        YTL->log("Warning: QEventLoop returned too early. Starting secondary loop.",YTL_WARNING,YTL_MID);
+        output << QString::fromUtf8(line).trimmed();
+        return true;
+    });
 
-        while ((myProcess->state()==QProcess::Running) && (ti.elapsed()<execTimeout))
-        {
-            RTI->processEvents();
-            Sleep(RDS_SLEEP_INTERVAL);
-        }
+    success=runner.run(helperCmd);
 
-        // If the process did not finish within the timeout duration
-        if (myProcess->state()==QProcess::Running)
-        {
-            RTI->log("Warning: Process is still active. Killing process.");
-            YTL->log("Warning: Process is still active. Killing process.",YTL_WARNING,YTL_MID);
+    if (runner.isStartError())
+    {
+        RTI->log("ERROR: Unable to start YCA helper (" + runner.getErrorString() + ")");
+        YTL->log("ERROR: Unable to start YCA helper (" + runner.getErrorString() + ")",YTL_ERROR,YTL_MID);
 
-            myProcess->kill();
-            success=false;
-        }
-        else
-        {
-            success=true;
-        }
+        exitcode=-1;
     }
     else
     {
-        // Normal timeout-handling if QEventLoop works normally
-        if (timeoutTimer.isActive())
-        {
-            success=true;
-            timeoutTimer.stop();
-        }
-        else
+        if (!success)
         {
-            RTI->log("Warning: Process event loop timed out.");
-            YTL->log("Warning: Process event loop timed out.",YTL_WARNING,YTL_MID);
+            // The process timeed out. Probably some error occured.
+            RTI->log("Warning: Duration since start "+QString::number(runner.getDuration())+" ms");
+            YTL->log("Warning: Duration since start "+QString::number(runner.getDuration())+" ms",YTL_WARNING,YTL_MID);
 
-            RTI->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms");
-            YTL->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms",YTL_WARNING,YTL_MID);
+            RTI->log("ERROR: Timeout during call of YCA helper!");
+            YTL->log("ERROR: Timeout during call of YCA helper!",YTL_ERROR,YTL_MID);
 
-            success=false;
-            if (myProcess->state()==QProcess::Running)
-            {
-                RTI->log("Warning: Process is still active. Killing process.");
-                YTL->log("Warning: Process is still active. Killing process.",YTL_WARNING,YTL_MID);
-
-                myProcess->kill();
-            }
+            exitcode=-1;
         }
-    }
-
-    if (!success)
-    {
-        // The process timeed out. Probably some error occured.
-        RTI->log("ERROR: Timeout during call of YCA helper!");
-        YTL->log("ERROR: Timeout during call of YCA helper!",YTL_ERROR,YTL_MID);
-
-        exitcode=-1;
-    }
-    else
-    {
-        // Read the output lines from the process and store in string list
-        // for parsing
-        char buf[1024];
-        qint64 lineLength = -1;
-
-        do
+        else
         {
-            lineLength=myProcess->readLine(buf, sizeof(buf));
-            if (lineLength != -1)
+            if (runner.isNormalExit())
             {
-                helperAppOutput << QString(buf).trimmed();
+                exitcode=runner.getExitCode();
             }
-        } while (lineLength!=-1);
-
-        if (myProcess->exitStatus()==QProcess::NormalExit)
-        {
-            exitcode=myProcess->exitCode();
         }
     }
 
-    delete myProcess;
-    myProcess=0;
-
     YTL->log("Process exitcode: "+QString::number(exitcode),YTL_INFO,YTL_LOW);
     return exitcode;
 }
@@ -811,9 +1006,8 @@ bool yctAPI::pushToDestinations(QString path, ycaTask* task)
     QString reqString="{ \"recon_mode\": \"" + task->reconMode + "\" }";
     QByteArray content=reqString.toUtf8();
 
-    QtAWSRequest awsRequest(config->key, config->secret);
-    QtAWSReply reply=awsRequest.sendRequest("POST", "api.yarracloud.com", "v1/mode_destinations",
-                                            QByteArray(), YCT_API_REGION, content, QStringList());
+    QtAWSReply reply=getClient()->sendRequest("POST", "api.yarracloud.com", "v1/mode_destinations",
+                                              QByteArray(), YCT_API_REGION, content, QStringList());
     if (!reply.isSuccess())
     {
         // TODO: Error handling
@@ -866,35 +1060,61 @@ bool yctAPI::pushToDestinations(QString path, ycaTask* task)
         destination->name=jsonObject["name"].toString();
     }
 
-    int failedTransfers=0;
+    // The destinations that have received the results in a previous attempt are
+    // recorded in the task folder, so that only the failed destinations are retried
+    QSettings deliveredFile(path+"/"+YCT_DELIVERED_FILE, QSettings::IniFormat);
+    QStringList delivered=deliveredFile.value("Delivery/Destinations",QStringList()).toStringList();
+
+    // Deliver to all destinations in parallel, so that a slow destination doesn't
+    // delay the others
+    QList<yctDestinationTask*> deliveryTasks;
 
     while (!storageList.isEmpty())
     {
         yctStorageInformation* destination=storageList.takeFirst();
 
-        if (destination->method==yctStorageInformation::yctDrive)
+        if (delivered.contains(destination->getKey()))
         {
-            if (!pushToDrive(path, task, destination))
-            {
-                // TODO: Error handling
-                YTL->log("Drive transfer failed to "+ destination->name,YTL_ERROR,YTL_HIGH);
-                failedTransfers++;
-            }
+            YTL->log("Results already delivered to "+destination->name,YTL_INFO,YTL_MID);
+            delete destination;
+            destination=0;
+            continue;
         }
 
-        if (destination->method==yctStorageInformation::yctPACS)
+        deliveryTasks.append(new yctDestinationTask(this, path, task, destination));
+    }
+
+    QThreadPool deliveryPool;
+    deliveryPool.setMaxThreadCount(qMax(deliveryTasks.count(), 1));
+
+    for (int i=0; i<deliveryTasks.count(); i++)
+    {
+        deliveryPool.start(deliveryTasks.at(i));
+    }
+    deliveryPool.waitForDone();
+
+    int failedTransfers=0;
+
+    for (int i=0; i<deliveryTasks.count(); i++)
+    {
+        yctDestinationTask* deliveryTask=deliveryTasks.at(i);
+
+        if (deliveryTask->result)
         {
-            if (!pushToPACS(path, task, destination))
-            {
-                // TODO: Error handling
-                YTL->log("PACS transfer failed to "+ destination->name,YTL_ERROR,YTL_HIGH);
-                failedTransfers++;
-            }
+            delivered.append(deliveryTask->destination->getKey());
+        }
+        else
+        {
+            failedTransfers++;
         }
 
-        delete destination;
-        destination=0;
+        delete deliveryTask->destination;
+        delete deliveryTask;
     }
+    deliveryTasks.clear();
+
+    deliveredFile.setValue("Delivery/Destinations",delivered);
+    deliveredFile.sync();
 
     if (failedTransfers>0)
     {
@@ -905,6 +1125,32 @@ bool yctAPI::pushToDestinations(QString path, ycaTask* task)
 }
 
 
+bool yctAPI::pushToDestination(QString path, ycaTask* task, yctStorageInformation* destination)
+{
+    if (destination->method==yctStorageInformation::yctDrive)
+    {
+        if (!pushToDrive(path, task, destination))
+        {
+            // TODO: Error handling
+            YTL->log("Drive transfer failed to "+ destination->name,YTL_ERROR,YTL_HIGH);
+            return false;
+        }
+    }
+
+    if (destination->method==yctStorageInformation::yctPACS)
+    {
+        if (!pushToPACS(path, task, destination))
+        {
+            // TODO: Error handling
+            YTL->log("PACS transfer failed to "+ destination->name,YTL_ERROR,YTL_HIGH);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 bool yctAPI::pushToPACS (QString path, ycaTask* task, yctStorageInformation* destination)
 {
     qDebug() << "Pushing to PACS destination " << destination->name;
@@ -940,7 +1186,10 @@ bool yctAPI::pushToPACS (QString path, ycaTask* task, yctStorageInformation* des
 
     bool success=true;
 
-    if (callHelperApp(YCT_DCMTK_STORESCU,cmd)!=0)
+    // The destinations are served in parallel, so the output is collected separately
+    QStringList output;
+
+    if (callHelperApp(YCT_DCMTK_STORESCU,cmd,output)!=0)
     {
         // TODO: Error handling
         YTL->log("Error executing storescu",YTL_ERROR,YTL_MID);
@@ -950,9 +1199,9 @@ bool yctAPI::pushToPACS (QString path, ycaTask* task, yctStorageInformation* des
     // TODO: Search helper output for error messages
 
     YTL->log("(Helper output begin)",YTL_INFO,YTL_LOW);
-    for (int i=0; i<helperAppOutput.count(); i++)
+    for (int i=0; i<output.count(); i++)
     {
-        YTL->log(helperAppOutput.at(i),YTL_INFO,YTL_LOW);
+        YTL->log(output.at(i),YTL_INFO,YTL_LOW);
     }
     YTL->log("(Helper output end)",YTL_INFO,YTL_LOW);
 
@@ -969,47 +1218,137 @@ bool yctAPI::pushToDrive(QString path, ycaTask* task, yctStorageInformation* des
         return false;
     }
 
-    QString fullPath=destination->driveLocation+"/"+task->taskID;
+    // Collect the files, including the subfolders
+    QStringList files;
+    qint64      totalSize=0;
+
+    QDirIterator iterator(sourceDir.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+    while (iterator.hasNext())
+    {
+        iterator.next();
+        files.append(sourceDir.relativeFilePath(iterator.filePath()));
+        totalSize+=iterator.fileInfo().size();
+    }
+
+    // Check the disk space before anything is created at the destination
+    QStorageInfo storage(destination->driveLocation);
+    if ((storage.isValid()) && (storage.bytesAvailable()<totalSize))
+    {
+        YTL->log("Not enough disk space at destination: "+destination->driveLocation,YTL_ERROR,YTL_MID);
+        return false;
+    }
 
     QDir dir;
-    if (dir.exists(fullPath))
+    if (!dir.mkpath(destination->driveLocation))
+    {
+        YTL->log("Can't create destination path: "+destination->driveLocation,YTL_ERROR,YTL_MID);
+        return false;
+    }
+
+    // Create the task folder. The destinations are served in parallel and might point to
+    // the same location, so a name is only used if the folder could be created (mkdir
+    // fails if the folder exists already).
+    QDir    locationDir(destination->driveLocation);
+    QString folderName=task->taskID;
+    QString timeStamp=QDateTime::currentDateTime().toString("ddMMyyHHmmsszzz");
+
+    bool    folderCreated=false;
+
+    for (int i=0; (i<YCT_DRIVE_FOLDER_RETRIES) && (!folderCreated); i++)
     {
-        QString timeStamp=QDateTime::currentDateTime().toString("ddMMyyHHmmsszzz");
-        fullPath=fullPath+"_"+timeStamp;
+        if (i>0)
+        {
+            folderName=task->taskID+"_"+timeStamp;
+        }
+        if (i>1)
+        {
+            folderName+="_"+QString::number(i);
+        }
+
+        folderCreated=locationDir.mkdir(folderName);
 
-        if (dir.exists(fullPath))
+        if ((!folderCreated) && (!locationDir.exists(folderName)))
         {
-            YTL->log("Can't create unique folder for TaskID",YTL_ERROR,YTL_MID);
+            YTL->log("Can't create destination path: "+locationDir.absoluteFilePath(folderName),YTL_ERROR,YTL_MID);
             return false;
         }
     }
 
-    if (!dir.mkpath(fullPath))
+    if (!folderCreated)
     {
-        YTL->log("Can't create destination path: "+fullPath,YTL_ERROR,YTL_MID);
-        // TODO: Error handling
+        YTL->log("Can't create unique folder for TaskID",YTL_ERROR,YTL_MID);
         return false;
     }
 
-    // TODO: Check for disk space
-    // TODO: Recursively copy also folders
-    QStringList files=sourceDir.entryList(QStringList("*"),QDir::Files,QDir::Name);
+    QString fullPath=locationDir.absoluteFilePath(folderName);
+    QDir    createdDir(fullPath);
+
+    QList<yctFileCopyTask*> copyTasks;
 
     for (int i=0; i<files.count(); i++)
     {
-        if (!QFile::copy(sourceDir.absoluteFilePath(files.at(i)),fullPath+"/"+files.at(i)))
+        QString targetFilename=fullPath+"/"+files.at(i);
+
+        if (!dir.mkpath(QFileInfo(targetFilename).absolutePath()))
         {
-            YTL->log("Error copying file: "+files.at(i),YTL_ERROR,YTL_MID);
+            YTL->log("Can't create destination path: "+QFileInfo(targetFilename).absolutePath(),YTL_ERROR,YTL_MID);
+            qDeleteAll(copyTasks);
+            createdDir.removeRecursively();
             return false;
         }
+
+        copyTasks.append(new yctFileCopyTask(sourceDir.absoluteFilePath(files.at(i)), targetFilename));
     }
 
-    return true;
+    // Copy several files at once, as network drives are mostly limited by the latency
+    QThreadPool copyPool;
+    copyPool.setMaxThreadCount(YCT_DRIVE_COPY_FILES);
+
+    for (int i=0; i<copyTasks.count(); i++)
+    {
+        copyPool.start(copyTasks.at(i));
+    }
+    copyPool.waitForDone();
+
+    bool success=true;
+
+    for (int i=0; i<copyTasks.count(); i++)
+    {
+        if (!copyTasks.at(i)->result)
+        {
+            YTL->log("Error copying file: "+copyTasks.at(i)->sourceFilename,YTL_ERROR,YTL_MID);
+            success=false;
+        }
+    }
+    qDeleteAll(copyTasks);
+    copyTasks.clear();
+
+    // Don't leave an incomplete folder behind, as the next attempt creates a new one
+    if (!success)
+    {
+        createdDir.removeRecursively();
+    }
+
+    return success;
 }
 
 
 bool yctAPI::loadCertificate()
 {
+    // The certificate is added to the default SSL configuration of the process, so
+    // it only needs to be loaded once (the YCA workers create an instance per task)
+    static QMutex certificateMutex;
+    static bool   certificateLoaded=false;
+
+    QMutexLocker locker(&certificateMutex);
+
+    if (certificateLoaded)
+    {
+        return true;
+    }
+
+    certificateLoaded=true;
+
     // Read certificate from external file
     QFile certificateFile(qApp->applicationDirPath() + "/yarracloud.crt");
 
@@ -11,6 +11,9 @@
 class yctConfiguration;
 class ortModeList;
 class ycaTask;
+class QtAWSS3Transfer;
+class QtAWSClient;
+class QtAWSPendingReply;
 
 
 class yctTransferInformation
@@ -49,6 +52,8 @@ public:
 
     QString driveLocation;
 
+    // Identifies the destination when recording the delivered destinations of a task
+    QString getKey() const;
 };
 
 typedef QList<yctStorageInformation*> yctStorageList;
@@ -68,6 +73,8 @@ public:
 #endif
     bool    createCloudFolders();
     bool    validateUser(yctTransferInformation* transferInformation=0);
+    bool    readUserStatus(QSharedPointer<QtAWSPendingReply> pendingReply, yctTransferInformation* transferInformation=0);
+    QSharedPointer<QtAWSPendingReply> requestUserStatus();
     QString getCloudPath(QString folder);
     QString createUUID();
 
@@ -79,6 +86,7 @@ public:
     bool    pushToDestinations(QString path, ycaTask* task);
     bool    pushToPACS (QString path, ycaTask* task, yctStorageInformation* destination);
     bool    pushToDrive(QString path, ycaTask* task, yctStorageInformation* destination);
+    bool    pushToDestination(QString path, ycaTask* task, yctStorageInformation* destination);
 
     bool    loadCertificate();
 
@@ -88,8 +96,15 @@ protected:
 
     yctConfiguration* config;
 
+    QSharedPointer<QtAWSClient> getClient();
+
     QStringList helperAppOutput;
     int callHelperApp(QString binary, QString parameters, int execTimeout=YCT_HELPER_TIMEOUT);
+    int callHelperApp(QString binary, QString parameters, QStringList& output, int execTimeout=YCT_HELPER_TIMEOUT);
+
+    void configureTransfer  (QtAWSS3Transfer& transfer);
+    bool uploadFilesNative  (ycaTask* task, yctTransferInformation* setup, QStringList files);
+    bool downloadFilesNative(ycaTask* task, yctTransferInformation* setup, QString path);
 
 };
 
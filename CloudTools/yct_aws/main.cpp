@@ -1,9 +1,286 @@
 
 #include <QtCore>
+#include <QtNetwork>
 #include <iostream>
 #include <stdio.h>
 
 #include <qtaws.h>
+#include <qtawss3.h>
+
+
+// Round trip through an S3-compatible server (e.g. a local MinIO instance). The test
+// file is uploaded in several parts, downloaded again, and compared.
+int testS3Transfer(QSettings& settings, QString accessKey, QString secretKey, QString region)
+{
+    QString    endpoint=settings.value("S3/Endpoint","http://127.0.0.1:9000").toString();
+    QByteArray bucket  =settings.value("S3/Bucket","yarra-test").toString().toLatin1();
+    int        sizeMB  =settings.value("S3/TestSizeMB",23).toInt();
+
+    printf("Testing S3 transfer with %s, bucket %s\n\n", qPrintable(endpoint), bucket.constData());
+
+    QString uploadFile  =QDir::temp().filePath("qtaws_s3_upload.dat");
+    QString downloadFile=QDir::temp().filePath("qtaws_s3_download.dat");
+
+    // Create test data that is not a multiple of the part size
+    QFile file(uploadFile);
+    file.open(QIODevice::WriteOnly);
+    QByteArray block(1024*1024, 0);
+    for (int i=0; i<sizeMB; i++)
+    {
+        for (int j=0; j<block.size(); j++)
+        {
+            block[j]=char((i*31+j*7) & 0xFF);
+        }
+        file.write(block);
+    }
+    file.write("tail");
+    file.close();
+
+    QtAWSS3Transfer transfer(accessKey, secretKey, region.toLatin1());
+    transfer.setEndpoint(QUrl(endpoint));
+    transfer.setPartSize(QTAWS_S3_MINPARTSIZE);
+    transfer.setProgressHandler([](qint64 transferred, qint64 total)
+    {
+        printf("  %lld / %lld bytes\n", transferred, total);
+    });
+
+    // Leave a manifest of an upload that the server doesn't know, as after an aborted or
+    // expired upload. The transfer has to start over instead of failing.
+    QFileInfo uploadInfo(uploadFile);
+    QtAWSS3Manifest staleManifest;
+    staleManifest.type    ="upload";
+    staleManifest.bucket  =bucket;
+    staleManifest.key     ="qtaws-test/upload.dat";
+    staleManifest.uploadId="expired-upload-id";
+    staleManifest.size    =uploadInfo.size();
+    staleManifest.modified=uploadInfo.lastModified().toMSecsSinceEpoch();
+    staleManifest.partSize=QTAWS_S3_MINPARTSIZE;
+    staleManifest.save(uploadFile+QTAWS_S3_MANIFEST_EXT);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!transfer.uploadFile(uploadFile, bucket, "qtaws-test/upload.dat"))
+    {
+        printf("Upload failed: %s\n", qPrintable(transfer.errorString()));
+        return 1;
+    }
+    printf("Upload finished after %lld ms\n\n", timer.restart());
+
+    if (QFile::exists(uploadFile+QTAWS_S3_MANIFEST_EXT))
+    {
+        printf("ERROR: Transfer manifest has not been removed\n");
+        return 1;
+    }
+
+    QStringList keys;
+    if ((!transfer.listObjects(bucket, "qtaws-test/", keys)) || (!keys.contains("qtaws-test/upload.dat")))
+    {
+        printf("Listing failed: %s\n", qPrintable(transfer.errorString()));
+        return 1;
+    }
+
+    if (!transfer.downloadFile(bucket, "qtaws-test/upload.dat", downloadFile))
+    {
+        printf("Download failed: %s\n", qPrintable(transfer.errorString()));
+        return 1;
+    }
+    printf("Download finished after %lld ms\n\n", timer.restart());
+
+    QFile source(uploadFile);
+    QFile target(downloadFile);
+    source.open(QIODevice::ReadOnly);
+    target.open(QIODevice::ReadOnly);
+
+    QCryptographicHash sourceHash(QCryptographicHash::Sha256);
+    QCryptographicHash targetHash(QCryptographicHash::Sha256);
+    sourceHash.addData(&source);
+    targetHash.addData(&target);
+
+    if (sourceHash.result()!=targetHash.result())
+    {
+        printf("ERROR: Downloaded file differs from uploaded file\n");
+        return 1;
+    }
+
+    printf("Transferred file is identical\n");
+    return 0;
+}
+
+
+// Minimal HTTP server that answers every request with an empty JSON object. It is used
+// as local stand-in for the API, so that the overhead of the client can be measured
+// without the latency of the internet connection.
+class BenchmarkServer : public QThread
+{
+public:
+    BenchmarkServer()
+    {
+        port=0;
+    }
+
+    quint16    port;
+    QAtomicInt connections;
+    QSemaphore ready;
+
+protected:
+    void run()
+    {
+        QTcpServer server;
+
+        if (server.listen(QHostAddress::LocalHost, 0))
+        {
+            port=server.serverPort();
+        }
+
+        QObject::connect(&server, &QTcpServer::newConnection, &server, [this, &server]()
+        {
+            while (server.hasPendingConnections())
+            {
+                QTcpSocket* socket=server.nextPendingConnection();
+                connections.ref();
+
+                QSharedPointer<QByteArray> buffer(new QByteArray);
+
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, buffer]()
+                {
+                    buffer->append(socket->readAll());
+
+                    // Answer all complete requests. The connection is kept open.
+                    while (true)
+                    {
+                        int headerEnd=buffer->indexOf("\r\n\r\n");
+                        if (headerEnd<0)
+                        {
+                            return;
+                        }
+
+                        int contentLength=0;
+                        foreach (QByteArray line, buffer->left(headerEnd).split('\n'))
+                        {
+                            if (line.toLower().startsWith("content-length:"))
+                            {
+                                contentLength=line.mid(15).trimmed().toInt();
+                            }
+                        }
+
+                        if (buffer->size() < headerEnd+4+contentLength)
+                        {
+                            return;
+                        }
+
+                        buffer->remove(0, headerEnd+4+contentLength);
+                        socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}");
+                    }
+                });
+
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+
+        ready.release();
+
+        if (port!=0)
+        {
+            exec();
+        }
+    }
+};
+
+
+void printBenchmark(QString name, int requests, int failed, qint64 msec, int connections)
+{
+    printf("%-40s %6d requests  %5d failed  %7lld ms  %8.1f req/s  %5d connections\n",
+           qPrintable(name), requests, failed, msec,
+           (msec>0) ? (1000.0*requests/msec) : 0.0, connections);
+}
+
+
+// Measures the requests per second against the local stand-in: With a new client for
+// every request (like the API calls used to work), with one shared client that sends
+// the requests one after another, and with the shared client and several requests
+// in flight.
+int benchmarkRequests(int count, int parallel)
+{
+    BenchmarkServer server;
+    server.start();
+    server.ready.acquire();
+
+    if (server.port==0)
+    {
+        printf("Unable to start the local HTTP server\n");
+        return 1;
+    }
+
+    QUrl endpoint(QString("http://127.0.0.1:%1").arg(server.port));
+    QByteArray content="{\"recon_mode\":\"benchmark\"}";
+
+    printf("Benchmark with %d requests against %s\n\n", count, qPrintable(endpoint.toString()));
+
+    QElapsedTimer timer;
+    int connections=0;
+    int failed=0;
+
+    // New client per request: new network thread, connection and signing key
+    timer.start();
+    for (int i=0; i<count; i++)
+    {
+        QtAWSClient client("benchmark", "benchmark");
+        client.setEndpoint(endpoint);
+
+        if (!client.sendRequest("POST", "api.yarracloud.com", "v1/jobs", QByteArray(), "us-east-1",
+                                content, QStringList()).isSuccess())
+        {
+            failed++;
+        }
+    }
+    printBenchmark("New client per request", count, failed, timer.elapsed(), server.connections.load()-connections);
+
+    QtAWSClient client("benchmark", "benchmark", parallel);
+    client.setEndpoint(endpoint);
+
+    // Shared client, blocking calls
+    connections=server.connections.load();
+    failed=0;
+    timer.restart();
+    for (int i=0; i<count; i++)
+    {
+        if (!client.sendRequest("POST", "api.yarracloud.com", "v1/jobs", QByteArray(), "us-east-1",
+                                content, QStringList()).isSuccess())
+        {
+            failed++;
+        }
+    }
+    printBenchmark("Shared client, sequential", count, failed, timer.elapsed(), server.connections.load()-connections);
+
+    // Shared client, all requests queued at once
+    connections=server.connections.load();
+    QAtomicInt failedAsync;
+    QList<QtAWSFuture> pendingReplies;
+    timer.restart();
+    for (int i=0; i<count; i++)
+    {
+        pendingReplies.append(client.sendAsync("POST", "api.yarracloud.com", "v1/jobs", QByteArray(), "us-east-1",
+                                               content, QStringList(), [&failedAsync](QtAWSReply reply)
+        {
+            if (!reply.isSuccess())
+            {
+                failedAsync.ref();
+            }
+        }));
+    }
+    foreach (QtAWSFuture pendingReply, pendingReplies)
+    {
+        pendingReply->waitForFinished();
+    }
+    printBenchmark(QString("Shared client, %1 in flight").arg(parallel), count, failedAsync.load(),
+                   timer.elapsed(), server.connections.load()-connections);
+
+    server.quit();
+    server.wait();
+
+    return 0;
+}
 
 
 int main(int argc, char *argv[])
@@ -19,6 +296,19 @@ int main(int argc, char *argv[])
     printf("\nYarra CloudTools - AWS Signing Test\n");
     printf("-------------------------------------\n\n");
 
+    if ((argc>1) && (QString(argv[1])=="s3"))
+    {
+        return testS3Transfer(settings, accessKey, secretKey, region);
+    }
+
+    if ((argc>1) && (QString(argv[1])=="bench"))
+    {
+        int count   =(argc>2) ? QString(argv[2]).toInt() : 500;
+        int parallel=(argc>3) ? QString(argv[3]).toInt() : QTAWS_MAX_REQUESTS;
+
+        return benchmarkRequests(qMax(1, count), qMax(1, parallel));
+    }
+
     QtAWSRequest awsRequest(accessKey, secretKey);
 
     int ct=0;
@@ -74,6 +74,208 @@ QtAWSReply QtAWSRequest::sendRequest(const QByteArray &verb,    const QByteArray
 }
 
 
+QtAWSReply QtAWSRequest::sendRequest(const QByteArray &verb,    const QByteArray  &host,
+                                      const QByteArray &path,    const QByteArray &query,
+                                      const QByteArray &region,
+                                      QIODevice *body, qint64 length, const QStringList &headers,
+                                      bool unsignedPayload)
+{
+    return QtAWSReply(d->sendAWSRequest(verb,host,path,query,region,body,length,unsignedPayload,headers));
+}
+
+
+
+QtAWSPendingReply::QtAWSPendingReply(std::function<void(QtAWSReply)> callback)
+    : m_finished(false),
+      m_reply(new QtAWSReplyPrivate(QtAWSReply::InternalError, "Request has not finished.")),
+      m_callback(callback)
+{
+}
+
+
+bool QtAWSPendingReply::isFinished()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_finished;
+}
+
+
+bool QtAWSPendingReply::waitForFinished(int timeoutMsec)
+{
+    QMutexLocker lock(&m_mutex);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!m_finished)
+    {
+        if (timeoutMsec < 0)
+        {
+            m_finishedCondition.wait(&m_mutex);
+        }
+        else
+        {
+            const qint64 remaining = timeoutMsec - timer.elapsed();
+
+            if ((remaining <= 0) || (!m_finishedCondition.wait(&m_mutex, remaining)))
+            {
+                return m_finished;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+QtAWSReply QtAWSPendingReply::reply()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_reply;
+}
+
+
+void QtAWSPendingReply::finish(QtAWSReplyPrivate *replyPrivate)
+{
+    QtAWSReply finishedReply(replyPrivate);
+
+    if (m_callback)
+    {
+        m_callback(finishedReply);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_reply = finishedReply;
+    m_finished = true;
+    m_finishedCondition.wakeAll();
+}
+
+
+
+static QMutex                                       sharedClientsLock;
+static QHash<QString, QSharedPointer<QtAWSClient> > sharedClients;
+
+
+static void releaseSharedClients()
+{
+    QMutexLocker lock(&sharedClientsLock);
+    sharedClients.clear();
+}
+
+
+QtAWSClient::QtAWSClient(const QString &accessKeyId, const QString &secretAccessKey, int maxRequests)
+    : d(new QtAWSPrivate(accessKeyId.toLatin1(), secretAccessKey.toLatin1())),
+      m_networkAccessManager(new AsyncNetworkAccessManager(maxRequests)),
+      m_timeout(QTAWS_REQUEST_TIMEOUT)
+{
+}
+
+
+QSharedPointer<QtAWSClient> QtAWSClient::shared(const QString &accessKeyId, const QString &secretAccessKey)
+{
+    QMutexLocker lock(&sharedClientsLock);
+
+    const QString clientKey = accessKeyId + "\n" + secretAccessKey;
+    QSharedPointer<QtAWSClient> client = sharedClients.value(clientKey);
+
+    if (client.isNull())
+    {
+        // The network threads have to be stopped before the application object is deleted
+        if (sharedClients.isEmpty())
+        {
+            qAddPostRoutine(releaseSharedClients);
+        }
+
+        client = QSharedPointer<QtAWSClient>(new QtAWSClient(accessKeyId, secretAccessKey));
+        sharedClients.insert(clientKey, client);
+    }
+
+    return client;
+}
+
+
+void QtAWSClient::setEndpoint(const QUrl &endpoint)
+{
+    m_endpoint = endpoint;
+}
+
+
+void QtAWSClient::setTimeout(int timeoutMsec)
+{
+    m_timeout = timeoutMsec;
+}
+
+
+void QtAWSClient::setMaxRequests(int maxRequests)
+{
+    m_networkAccessManager->setMaxRequests(maxRequests);
+}
+
+
+QtAWSFuture QtAWSClient::sendAsync(const QByteArray &verb,    const QByteArray  &host,
+                                   const QByteArray &path,    const QByteArray &query,
+                                   const QByteArray &region,
+                                   const QByteArray &content, const QStringList &headers,
+                                   std::function<void(QtAWSReply)> callback)
+{
+    QtAWSFuture pendingReply(new QtAWSPendingReply(callback));
+
+    QByteArray server = "https://" + host;
+
+    if (m_endpoint.isValid())
+    {
+        server = m_endpoint.toString(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::StripTrailingSlash).toLatin1();
+    }
+
+    const QByteArray url = server + "/" + path + (query.isEmpty() ? "" : "?" + query);
+
+    // The signing key of the region is only derived for the first request
+    QNetworkRequest *signedRequest = d->createSignedRequest(verb, QUrl(url), QtAWSPrivate::parseHeaderList(headers),
+                                                            host, content, region);
+
+    AsyncNetworkRequest *request = new AsyncNetworkRequest;
+    request->request     = *signedRequest;
+    request->verb        = verb;
+    request->payload     = content;
+    request->timeoutMsec = m_timeout;
+    request->completionHandler = [pendingReply](QNetworkReply *networkReply)
+    {
+        QtAWSReplyPrivate *awsReply = new QtAWSReplyPrivate;
+        QtAWSPrivate::processNetworkReplyState(awsReply, networkReply);
+        pendingReply->finish(awsReply);
+    };
+    delete signedRequest;
+
+    m_networkAccessManager->send(request);
+
+    return pendingReply;
+}
+
+
+QtAWSReply QtAWSClient::sendRequest(const QByteArray &verb,    const QByteArray  &host,
+                                    const QByteArray &path,    const QByteArray &query,
+                                    const QByteArray &region,
+                                    const QByteArray &content, const QStringList &headers)
+{
+    QtAWSFuture pendingReply = sendAsync(verb, host, path, query, region, content, headers);
+    pendingReply->waitForFinished();
+
+    return pendingReply->reply();
+}
+
+
+int QtAWSClient::pendingRequests()
+{
+    return m_networkAccessManager->pendingRequests();
+}
+
+
+void QtAWSClient::clearCaches()
+{
+    d->clearCaches();
+}
+
+
 
 QtAWSPrivate::QtAWSPrivate()
 {
@@ -87,6 +289,7 @@ QtAWSPrivate::QtAWSPrivate(QByteArray accessKeyId, QByteArray secretAccessKey)
     m_accessKeyIdProvider = [accessKeyId](){ return accessKeyId; };
     m_secretAccessKeyProvider = [secretAccessKey](){ return secretAccessKey; };
     m_service=QByteArray("");
+    m_networkAccessManager=0;
 
     init();
 }
@@ -98,6 +301,7 @@ QtAWSPrivate::QtAWSPrivate(std::function<QByteArray()> accessKeyIdProvider,
       m_secretAccessKeyProvider(secretAccessKeyProvider)
 {
     m_service="";
+    m_networkAccessManager=0;
 
     init();
 }
@@ -139,6 +343,38 @@ QByteArray QtAWSPrivate::hash(const QByteArray &data)
 }
 
 
+// SHA256 of the next length bytes of the device, read block by block. The device
+// is positioned at the start of the data again afterwards, so that it can be sent.
+QByteArray QtAWSPrivate::hashDevice(QIODevice *device, qint64 length)
+{
+    const qint64 start = device->pos();
+
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    QByteArray block(int(qMin(qint64(QTAWS_HASH_BLOCKSIZE), qMax(length, qint64(1)))), 0);
+    qint64 remaining = length;
+
+    while (remaining > 0)
+    {
+        const qint64 bytesRead = device->read(block.data(), qMin(remaining, qint64(block.size())));
+
+        if (bytesRead <= 0)
+        {
+            return QByteArray();
+        }
+
+        hasher.addData(block.constData(), int(bytesRead));
+        remaining -= bytesRead;
+    }
+
+    if (!device->seek(start))
+    {
+        return QByteArray();
+    }
+
+    return hasher.result();
+}
+
+
 // HMAC_SHA256.
 QByteArray QtAWSPrivate::sign(const QByteArray &key, const QByteArray &data)
 {
@@ -341,12 +577,11 @@ QByteArray QtAWSPrivate::formatCanonicalRequest(const QByteArray &method, const
 
 QByteArray QtAWSPrivate::signRequestData(const QHash<QByteArray, QByteArray> headers,
                                          const QByteArray &verb, const QByteArray &url,
-                                         const QByteArray &queryString, const QByteArray &payload,
+                                         const QByteArray &queryString, const QByteArray &payloadHash,
                                          const QByteArray &signingKey, const QDateTime &dateTime,
                                          const QByteArray &region, const QByteArray &service)
 {
     // create canonical request representation and hash
-    QByteArray payloadHash = hash(payload).toHex();
     QByteArray canonicalRequest =
         formatCanonicalRequest(verb, url, queryString, headers, payloadHash);
     QByteArray canonialRequestHash = hash(canonicalRequest).toHex();
@@ -361,12 +596,12 @@ QByteArray QtAWSPrivate::signRequestData(const QHash<QByteArray, QByteArray> hea
 
 QByteArray QtAWSPrivate::createAuthorizationHeader(
     const QHash<QByteArray, QByteArray> headers, const QByteArray &verb, const QByteArray &url,
-    const QByteArray &queryString, const QByteArray &payload, const QByteArray &accessKeyId,
+    const QByteArray &queryString, const QByteArray &payloadHash, const QByteArray &accessKeyId,
     const QByteArray &signingKey, const QDateTime &dateTime, const QByteArray &region,
     const QByteArray &service)
 {
     // sign request
-    QByteArray signature = signRequestData(headers, verb, url, queryString, payload, signingKey,
+    QByteArray signature = signRequestData(headers, verb, url, queryString, payloadHash, signingKey,
                                            dateTime, region, service);
 
     // crate Authorization header;
@@ -394,20 +629,21 @@ void QtAWSPrivate::setRequestAttributes(QNetworkRequest *request, const QUrl &ur
 
 // Signs an aws request by adding an authorization header
 void QtAWSPrivate::signRequest(QNetworkRequest *request, const QByteArray &verb,
-                               const QByteArray &payload, const QByteArray accessKeyId,
+                               const QByteArray &payloadHash, const QByteArray accessKeyId,
                                const QByteArray &signingKey, const QDateTime &dateTime,
                                const QByteArray &region, const QByteArray &service)
 {
-    QByteArray payloadHash = hash(payload).toHex();
     request->setRawHeader("x-amz-content-sha256", payloadHash);
 
     // get headers from request
     QHash<QByteArray, QByteArray> headers = requestHeaders(request);
     QUrl url = request->url();
-    // create authorization header (value)
+    // create authorization header (value). The path is used in encoded form, because
+    // S3 object keys can contain characters that need to be escaped.
     QByteArray authHeaderValue
-        = createAuthorizationHeader(headers, verb, url.path().toLatin1(), url.query().toLatin1(),
-                                    payload, accessKeyId, signingKey, dateTime, region, service);
+        = createAuthorizationHeader(headers, verb, url.path(QUrl::FullyEncoded).toLatin1(),
+                                    url.query(QUrl::FullyEncoded).toLatin1(),
+                                    payloadHash, accessKeyId, signingKey, dateTime, region, service);
     // add authorization header to request
     request->setRawHeader("Authorization", authHeaderValue);
 }
@@ -419,12 +655,6 @@ void QtAWSPrivate::signRequest(QNetworkRequest *request, const QByteArray &verb,
 
 void QtAWSPrivate::init()
 {
-    // The current design multiplexes requests from several QtAWS request threads
-    // to one QNetworkAccessManager on a network thread. This limits the number
-    // of concurrent network requests to the QNetworkAccessManager internal limit
-    // (rumored to be 6).
-    m_networkAccessManager = new ThreadsafeBlockingNetworkAccesManager();
-
     if (m_accessKeyIdProvider().isEmpty())
     {
         qWarning() << "access key id not specified";
@@ -442,6 +672,33 @@ void QtAWSPrivate::init()
 }
 
 
+// The current design multiplexes requests from several QtAWS request threads
+// to one QNetworkAccessManager on a network thread. This limits the number
+// of concurrent network requests to the QNetworkAccessManager internal limit
+// (rumored to be 6). The QtAWSClient uses its own non-blocking manager, so the
+// network thread is only started when a blocking request is sent.
+ThreadsafeBlockingNetworkAccesManager* QtAWSPrivate::networkAccessManager()
+{
+    QMutexLocker lock(&m_networkAccessManagerLock);
+
+    if (m_networkAccessManager == 0)
+    {
+        m_networkAccessManager = new ThreadsafeBlockingNetworkAccesManager();
+    }
+
+    return m_networkAccessManager;
+}
+
+
+void QtAWSPrivate::setService(const QByteArray &service)
+{
+    m_service = service;
+
+    // The signing keys are derived for the service
+    clearCaches();
+}
+
+
 void QtAWSPrivate::checkGenerateAWSSigningKey(const QByteArray &region)
 {
     QDateTime now = QDateTime::currentDateTimeUtc();
@@ -454,7 +711,8 @@ void QtAWSPrivate::checkGenerateAWSSigningKey(const QByteArray &region)
 QNetworkRequest *QtAWSPrivate::createSignedRequest(const QByteArray &verb, const QUrl &url,
                                                    const QHash<QByteArray, QByteArray> &headers,
                                                    const QByteArray &host, const QByteArray &payload,
-                                                   const QByteArray &region)
+                                                   const QByteArray &region,
+                                                   const QByteArray &payloadHash)
 {
     checkGenerateAWSSigningKey(region);
     QDateTime requestTime = QDateTime::currentDateTimeUtc();
@@ -469,7 +727,8 @@ QNetworkRequest *QtAWSPrivate::createSignedRequest(const QByteArray &verb, const
     m_signingKeysLock.lockForRead();
     QByteArray key = m_signingKeys.value(region).key;
     m_signingKeysLock.unlock();
-    signRequest(request, verb, payload, m_accessKeyIdProvider(), key, requestTime, region, m_service);
+    signRequest(request, verb, payloadHash.isEmpty() ? hash(payload).toHex() : payloadHash,
+                m_accessKeyIdProvider(), key, requestTime, region, m_service);
     return request;
 }
 
@@ -484,7 +743,7 @@ QNetworkReply *QtAWSPrivate::sendRequest(const QByteArray &verb, const QNetworkR
     }
 
     // Send request
-    QNetworkReply *reply = m_networkAccessManager->sendCustomRequest(
+    QNetworkReply *reply = networkAccessManager()->sendCustomRequest(
         request, verb, payload.isEmpty() ? nullptr : &payloadBuffer);
 
     return reply;
@@ -523,10 +782,12 @@ QHash<QByteArray, QByteArray> QtAWSPrivate::getErrorComponents(const QByteArray
 
 void QtAWSPrivate::processNetworkReplyState(QtAWSReplyPrivate *awsReply, QNetworkReply *networkReply)
 {
-    awsReply->m_networkReply=networkReply;
-
     // Read the reply content
-    awsReply->m_byteArrayData = networkReply->readAll();
+    awsReply->m_byteArrayData      = networkReply->readAll();
+    awsReply->m_networkError       = networkReply->error();
+    awsReply->m_networkErrorString = networkReply->errorString();
+    awsReply->m_httpStatus         = networkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    awsReply->m_headers            = networkReply->rawHeaderPairs();
 
     // No error
     if (networkReply->error()==QNetworkReply::NoError)
@@ -571,11 +832,98 @@ QtAWSReplyPrivate* QtAWSPrivate::sendAWSRequest(const QByteArray &verb,    const
     QNetworkReply*   networkReply=sendRequest(verb, *request, content);
 
     processNetworkReplyState(awsReply, networkReply);
+    delete request;
+
+    // The reply lives on the network thread
+    networkReply->deleteLater();
 
     return awsReply;
 }
 
 
+QtAWSReplyPrivate* QtAWSPrivate::sendAWSRequest(const QByteArray &verb,    const QByteArray  &host,
+                                                const QByteArray &path,    const QByteArray &query,
+                                                const QByteArray &region,
+                                                QIODevice *body, qint64 length, bool unsignedPayload,
+                                                const QStringList &headers)
+{
+    const QByteArray url="https://" + host + "/" + path + (query.isEmpty() ? "" : "?" + query);
+
+    QNetworkReply* networkReply=sendStreamingRequest(verb, QUrl(url), host, region, parseHeaderList(headers),
+                                                     body, length, unsignedPayload);
+
+    if (networkReply==0)
+    {
+        return new QtAWSReplyPrivate(QtAWSReply::InternalSignatureError, "Unable to read request body");
+    }
+
+    QtAWSReplyPrivate *awsReply=new QtAWSReplyPrivate;
+    processNetworkReplyState(awsReply, networkReply);
+    networkReply->deleteLater();
+
+    return awsReply;
+}
+
+
+QNetworkReply *QtAWSPrivate::sendStreamingRequest(const QByteArray &verb, const QUrl &url,
+                                                  const QByteArray &host, const QByteArray &region,
+                                                  const QHash<QByteArray, QByteArray> &headers,
+                                                  QIODevice *body, qint64 length, bool unsignedPayload,
+                                                  int timeoutMsec)
+{
+    QByteArray payloadHash;
+
+    if (body == 0)
+    {
+        payloadHash = hash(QByteArray()).toHex();
+    }
+    else
+    {
+        if (unsignedPayload)
+        {
+            payloadHash = QTAWS_UNSIGNED_PAYLOAD;
+        }
+        else
+        {
+            // Sequential devices can't be rewound after hashing
+            if (body->isSequential())
+            {
+                qWarning() << "Signed streaming request requires a random-access device";
+                return 0;
+            }
+
+            QByteArray bodyHash = hashDevice(body, length);
+
+            if (bodyHash.isEmpty())
+            {
+                return 0;
+            }
+
+            payloadHash = bodyHash.toHex();
+        }
+    }
+
+    QHash<QByteArray, QByteArray> requestHeaders = headers;
+
+    if (body != 0)
+    {
+        requestHeaders.insert("Content-Length", QByteArray::number(length));
+    }
+
+    QNetworkRequest *request = createSignedRequest(verb, url, requestHeaders, host, QByteArray(),
+                                                   region, payloadHash);
+
+    // Without this attribute, the network stack reads the complete body into memory
+    // before it is sent if the device is sequential
+    request->setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+
+    QNetworkReply *reply = networkAccessManager()->sendCustomRequest(*request, verb, body, timeoutMsec);
+    delete request;
+
+    return reply;
+}
+
+
 void QtAWSPrivate::clearCaches()
 {
     m_signingKeysLock.lockForWrite();
@@ -597,27 +945,35 @@ QByteArray QtAWSPrivate::secretAccessKey()
 
 
 QtAWSReplyPrivate::QtAWSReplyPrivate()
-    : m_networkReply(0), m_awsError(QtAWSReply::InternalReplyInitializationError),
+    : m_networkError(QNetworkReply::NoError), m_httpStatus(0),
+      m_awsError(QtAWSReply::InternalReplyInitializationError),
       m_awsErrorString("Internal error: un-initianlized QtAWSReply.")
 {
 }
 
 
 QtAWSReplyPrivate::QtAWSReplyPrivate(QtAWSReply::AWSError error, QString errorString)
-    : m_networkReply(0), m_awsError(error), m_awsErrorString(errorString)
+    : m_networkError(QNetworkReply::NoError), m_httpStatus(0),
+      m_awsError(error), m_awsErrorString(errorString)
 {
 }
 
 
 QNetworkReply::NetworkError QtAWSReplyPrivate::networkError()
 {
-    return m_networkReply ? m_networkReply->error() : QNetworkReply::NoError;
+    return m_networkError;
 }
 
 
 QString QtAWSReplyPrivate::networkErrorString()
 {
-    return m_networkReply ? m_networkReply->errorString() : QString();
+    return m_networkError == QNetworkReply::NoError ? QString() : m_networkErrorString;
+}
+
+
+int QtAWSReplyPrivate::httpStatus()
+{
+    return m_httpStatus;
 }
 
 
@@ -650,16 +1006,10 @@ void QtAWSReplyPrivate::prettyPrintReply()
     qDebug() << "Reply:                   :" << this;
     qDebug() << "Reply Error State        :" << awsError() << awsErrorString();
 
-    if (m_networkReply == 0)
-    {
-        qDebug() << "m_networkReply is null";
-        return;
-    }
-
-    qDebug() << "NetworkReply Error State :" << m_networkReply->error()
-             << m_networkReply->errorString();
+    qDebug() << "NetworkReply Error State :" << networkError() << networkErrorString();
+    qDebug() << "NetworkReply HTTP Status :" << httpStatus();
     qDebug() << "NetworkReply Headers:";
-    foreach (auto pair, m_networkReply->rawHeaderPairs())
+    foreach (auto pair, m_headers)
     {
         qDebug() << "   " << pair.first << pair.second;
     }
@@ -669,12 +1019,15 @@ void QtAWSReplyPrivate::prettyPrintReply()
 
 QByteArray QtAWSReplyPrivate::headerValue(const QByteArray &headerName)
 {
-    if (!m_networkReply)
+    foreach (auto pair, m_headers)
     {
-        return QByteArray();
+        if (qstricmp(pair.first.constData(), headerName.constData()) == 0)
+        {
+            return pair.second;
+        }
     }
 
-    return m_networkReply->rawHeader(headerName);
+    return QByteArray();
 }
 
 
@@ -714,6 +1067,12 @@ QString QtAWSReply::networkErrorString()
 }
 
 
+int QtAWSReply::httpStatus()
+{
+    return d->httpStatus();
+}
+
+
 QtAWSReply::AWSError QtAWSReply::awsError()
 {
     return d->awsError();
@@ -20,6 +20,10 @@
 #include <functional>
 
 
+#define QTAWS_UNSIGNED_PAYLOAD "UNSIGNED-PAYLOAD"
+#define QTAWS_HASH_BLOCKSIZE   (1024*1024)
+
+
 class QtAWSReply;
 class QtAWSReplyPrivate;
 
@@ -38,12 +42,14 @@ public:
         UnknownError,
     };
 
+    // Takes ownership of the reply state, which is shared by all copies of the reply
     QtAWSReply(QtAWSReplyPrivate *replyPrivate);
 
     // error handling
     bool isSuccess();
     QNetworkReply::NetworkError networkError();
     QString  networkErrorString();
+    int      httpStatus();
     AWSError awsError();
     QString  awsErrorString();
     QString  anyErrorString();
@@ -54,11 +60,13 @@ public:
     QByteArray replyData();
 
 protected:
-    QtAWSReplyPrivate *d; // ### should be explicitly shared.
+    QSharedPointer<QtAWSReplyPrivate> d;
 };
 
 
 
+// State of a finished reply. The state is copied from the QNetworkReply, so that the
+// network reply can be deleted right away.
 class QtAWSReplyPrivate
 {
 public:
@@ -66,13 +74,17 @@ public:
     QtAWSReplyPrivate(QtAWSReply::AWSError, QString errorString);
 
     QByteArray                  m_byteArrayData;
-    QNetworkReply*              m_networkReply;
+    QNetworkReply::NetworkError m_networkError;
+    QString                     m_networkErrorString;
+    int                         m_httpStatus;
+    QList<QNetworkReply::RawHeaderPair> m_headers;
     QtAWSReply::AWSError        m_awsError;
     QString                     m_awsErrorString;
 
     bool isSuccess();
     QNetworkReply::NetworkError networkError();
     QString                     networkErrorString();
+    int                         httpStatus();
     QtAWSReply::AWSError        awsError();
     QString                     awsErrorString();
     QString                     anyErrorString();
@@ -96,7 +108,11 @@ public:
     std::function<QByteArray()> m_accessKeyIdProvider;
     std::function<QByteArray()> m_secretAccessKeyProvider;
     QByteArray m_service;
+
+    // Created with the first blocking request
     ThreadsafeBlockingNetworkAccesManager* m_networkAccessManager;
+    QMutex                                 m_networkAccessManagerLock;
+    ThreadsafeBlockingNetworkAccesManager* networkAccessManager();
 
     class AWSKeyStruct
     {
@@ -108,6 +124,7 @@ public:
     QReadWriteLock                  m_signingKeysLock;
 
     static QByteArray hash(const QByteArray &data);
+    static QByteArray hashDevice(QIODevice *device, qint64 length);
     static QByteArray sign(const QByteArray &key, const QByteArray &data);
 
     static QByteArray deriveSigningKey(const QByteArray &secretAccessKey,
@@ -138,14 +155,14 @@ public:
 
     static QByteArray signRequestData(const QHash<QByteArray, QByteArray> headers,
                                       const QByteArray &verb, const QByteArray &url,
-                                      const QByteArray &queryString, const QByteArray &payload,
+                                      const QByteArray &queryString, const QByteArray &payloadHash,
                                       const QByteArray &signingKey, const QDateTime &dateTime,
                                       const QByteArray &m_region, const QByteArray &m_service);
 
     static QByteArray
     createAuthorizationHeader(const QHash<QByteArray, QByteArray> headers, const QByteArray &verb,
                               const QByteArray &url, const QByteArray &queryString,
-                              const QByteArray &payload, const QByteArray &accessKeyId,
+                              const QByteArray &payloadHash, const QByteArray &accessKeyId,
                               const QByteArray &signingKey, const QDateTime &dateTime,
                               const QByteArray &m_region, const QByteArray &m_service);
 
@@ -163,7 +180,7 @@ public:
                                      const QDateTime &timeStamp, const QByteArray &m_host);
 
     static void signRequest(QNetworkRequest *request, const QByteArray &verb,
-                            const QByteArray &payload, const QByteArray accessKeyId,
+                            const QByteArray &payloadHash, const QByteArray accessKeyId,
                             const QByteArray &signingKey, const QDateTime &dateTime,
                             const QByteArray &m_region, const QByteArray &m_service);
 
@@ -172,22 +189,43 @@ public:
 
     // Top-level stateful functions. These read object state and may/will modify it in a thread-safe way.
     void init();
+    void setService(const QByteArray &service);
     void checkGenerateAWSSigningKey(const QByteArray &region);
 
+    // If payloadHash is given, it is used instead of hashing the payload (e.g. "UNSIGNED-PAYLOAD"
+    // for S3 requests that stream the body from a file)
     QNetworkRequest* createSignedRequest(const QByteArray &verb, const QUrl &url,
                                          const QHash<QByteArray, QByteArray> &headers,
                                          const QByteArray &host, const QByteArray &payload,
-                                         const QByteArray &region);
+                                         const QByteArray &region,
+                                         const QByteArray &payloadHash = QByteArray());
 
     QNetworkReply* sendRequest(const QByteArray &verb, const QNetworkRequest &request,
                                const QByteArray &payload);
 
+    // Signs and sends a request with a body that is read from the device while it is sent.
+    // The body is hashed incrementally (which requires a random-access device), or not at
+    // all if unsignedPayload is set. The caller keeps the device open until the reply has
+    // finished and deletes the reply.
+    QNetworkReply* sendStreamingRequest(const QByteArray &verb, const QUrl &url,
+                                        const QByteArray &host, const QByteArray &region,
+                                        const QHash<QByteArray, QByteArray> &headers,
+                                        QIODevice *body, qint64 length, bool unsignedPayload,
+                                        int timeoutMsec = 0);
+
     QtAWSReplyPrivate* sendAWSRequest(const QByteArray &verb,    const QByteArray  &host,
                                       const QByteArray &path,    const QByteArray &query,
                                       const QByteArray &region,
                                       const QByteArray &content, const QStringList &headers);
 
-    void processNetworkReplyState(QtAWSReplyPrivate *awsReply, QNetworkReply *networkReply);
+    QtAWSReplyPrivate* sendAWSRequest(const QByteArray &verb,    const QByteArray  &host,
+                                      const QByteArray &path,    const QByteArray &query,
+                                      const QByteArray &region,
+                                      QIODevice *body, qint64 length, bool unsignedPayload,
+                                      const QStringList &headers);
+
+    // Copies the state of the finished network reply. The caller deletes the network reply.
+    static void processNetworkReplyState(QtAWSReplyPrivate *awsReply, QNetworkReply *networkReply);
 
     void clearCaches();
     QByteArray accessKeyId();
@@ -208,6 +246,13 @@ public:
                            const QByteArray &region,
                            const QByteArray &content, const QStringList &headers);
 
+    // Streams the body from the device. Memory use doesn't depend on the size of the body.
+    QtAWSReply sendRequest(const QByteArray &verb,    const QByteArray  &host,
+                           const QByteArray &path,    const QByteArray &query,
+                           const QByteArray &region,
+                           QIODevice *body, qint64 length, const QStringList &headers,
+                           bool unsignedPayload = false);
+
     void clearCaches();
     QByteArray accessKeyId();
     QByteArray secretAccessKey();
@@ -218,4 +263,83 @@ private:
 };
 
 
+
+// Result of an asynchronous request. The reply is set on the network thread when the request
+// has finished, and can be waited for from any other thread.
+class QtAWSPendingReply
+{
+public:
+    QtAWSPendingReply(std::function<void(QtAWSReply)> callback);
+
+    bool isFinished();
+
+    // Must not be called from a callback, because the callbacks run on the network thread.
+    // Returns false if the reply didn't finish within the timeout.
+    bool waitForFinished(int timeoutMsec = -1);
+
+    // Returns an error reply if the request hasn't finished yet
+    QtAWSReply reply();
+
+    void finish(QtAWSReplyPrivate *replyPrivate);
+
+private:
+    QMutex         m_mutex;
+    QWaitCondition m_finishedCondition;
+    bool           m_finished;
+    QtAWSReply     m_reply;
+
+    std::function<void(QtAWSReply)> m_callback;
+};
+
+
+typedef QSharedPointer<QtAWSPendingReply> QtAWSFuture;
+
+
+
+// Long-lived client for the API requests. Unlike QtAWSRequest, the client doesn't block
+// a thread per request: The requests are queued on a shared network thread, which keeps
+// the connections alive between requests and limits the number of requests in flight.
+// The signing keys are derived once per region and day, and are reused by all requests
+// of the client. The client can be used from several threads at the same time.
+class QtAWSClient
+{
+public:
+    QtAWSClient(const QString &accessKeyId, const QString &secretAccessKey,
+                int maxRequests = QTAWS_MAX_REQUESTS);
+
+    // Returns the client that is shared by all callers with the same credentials. The
+    // shared clients are deleted when the application exits.
+    static QSharedPointer<QtAWSClient> shared(const QString &accessKeyId, const QString &secretAccessKey);
+
+    // Sends the requests to a different server (scheme, host and port), e.g. for tests.
+    // Must be set before the first request is sent.
+    void setEndpoint(const QUrl &endpoint);
+    void setTimeout(int timeoutMsec);
+    void setMaxRequests(int maxRequests);
+
+    // Returns immediately. If given, the callback is called on the network thread with
+    // the reply, before waiting threads are woken.
+    QtAWSFuture sendAsync(const QByteArray &verb,    const QByteArray  &host,
+                          const QByteArray &path,    const QByteArray &query,
+                          const QByteArray &region,
+                          const QByteArray &content, const QStringList &headers,
+                          std::function<void(QtAWSReply)> callback = nullptr);
+
+    // Blocks until the reply has finished
+    QtAWSReply sendRequest(const QByteArray &verb,    const QByteArray  &host,
+                           const QByteArray &path,    const QByteArray &query,
+                           const QByteArray &region,
+                           const QByteArray &content, const QStringList &headers);
+
+    int pendingRequests();
+    void clearCaches();
+
+private:
+    QSharedPointer<QtAWSPrivate>              d;
+    QScopedPointer<AsyncNetworkAccessManager> m_networkAccessManager;
+    QUrl                                      m_endpoint;
+    int                                       m_timeout;
+};
+
+
 #endif
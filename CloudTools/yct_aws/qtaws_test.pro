@@ -16,8 +16,10 @@ TEMPLATE = app
 
 SOURCES += main.cpp \
     qtaws.cpp \
+    qtawss3.cpp \
     qtawsqnam.cpp 
 
 HEADERS += \
     qtaws.h \
+    qtawss3.h \
     qtawsqnam.h 
@@ -34,9 +34,10 @@ ThreadsafeBlockingNetworkAccesManager::~ThreadsafeBlockingNetworkAccesManager()
 }
 
 
-// A synchronous, thread-safe sendCustomRequest.
+// A synchronous, thread-safe sendCustomRequest. If timeoutMsec is set, the request
+// is aborted when it has not finished in time (the reply then reports OperationCanceledError).
 QNetworkReply *ThreadsafeBlockingNetworkAccesManager::sendCustomRequest(
-    const QNetworkRequest &request, const QByteArray &verb, QIODevice *data)
+    const QNetworkRequest &request, const QByteArray &verb, QIODevice *data, int timeoutMsec)
 {
     // Maintain the active request count
     {
@@ -65,18 +66,22 @@ QNetworkReply *ThreadsafeBlockingNetworkAccesManager::sendCustomRequest(
 
     // Wait until the request completes, or is cancelled, or HEAD returns headers.
     {
+        QElapsedTimer timer;
+        timer.start();
+        bool timedOut = false;
+
         QMutexLocker lock(&m_mutex);
         while (!(reply->isFinished() || m_cancellAll || (isHead && reply->rawHeaderList().count() > 0)))
         {
             m_waitCompleted.wait(&m_mutex, 8000);
 
-            // TODO: Check if the reqest timed out, and if so terminate
-            /*
-            if (!reply->isFinished())
+            // Abort the request on the network thread. The reply then finishes with an error,
+            // which wakes this thread again.
+            if ((timeoutMsec > 0) && (!timedOut) && (timer.elapsed() >= timeoutMsec))
             {
-                m_cancellAll=true;
+                timedOut = true;
+                QMetaObject::invokeMethod(reply, "abort", Qt::QueuedConnection);
             }
-            */
         }
     }
 
@@ -134,3 +139,143 @@ void ThreadsafeBlockingNetworkAccesManager::wakeWaitingThreads()
     m_waitCompleted.wakeAll();
 }
 
+
+
+AsyncNetworkAccessManager::AsyncNetworkAccessManager(int maxRequests)
+{
+    m_activeRequests = 0;
+    m_maxRequests = qMax(1, maxRequests);
+
+    m_networkThread = new QThread;
+    m_networkThread->start();
+    m_networkAccessManager = new QNetworkAccessManager;
+    m_networkAccessManager->moveToThread(m_networkThread);
+    moveToThread(m_networkThread);
+}
+
+
+AsyncNetworkAccessManager::~AsyncNetworkAccessManager()
+{
+    m_networkThread->quit();
+    m_networkThread->wait();
+
+    // Requests that have not finished are dropped without calling their handlers
+    if (pendingRequests() > 0)
+    {
+        qWarning() << "QtAWS network manager deleted with pending requests";
+    }
+
+    qDeleteAll(m_queue);
+    qDeleteAll(m_requests);
+    m_queue.clear();
+    m_requests.clear();
+
+    delete m_networkAccessManager;
+    delete m_networkThread;
+}
+
+
+void AsyncNetworkAccessManager::send(AsyncNetworkRequest *request)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_queue.enqueue(request);
+    }
+
+    QMetaObject::invokeMethod(this, "startQueued", Qt::QueuedConnection);
+}
+
+
+void AsyncNetworkAccessManager::setMaxRequests(int maxRequests)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_maxRequests = qMax(1, maxRequests);
+    }
+
+    QMetaObject::invokeMethod(this, "startQueued", Qt::QueuedConnection);
+}
+
+
+// Returns the number of queued and running requests
+int AsyncNetworkAccessManager::pendingRequests()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_queue.count() + m_activeRequests;
+}
+
+
+// Starts queued requests until the limit of requests in flight is reached. Runs on the
+// network thread.
+void AsyncNetworkAccessManager::startQueued()
+{
+    while (true)
+    {
+        AsyncNetworkRequest *request = 0;
+
+        {
+            QMutexLocker lock(&m_mutex);
+            if ((m_queue.isEmpty()) || (m_activeRequests >= m_maxRequests))
+            {
+                return;
+            }
+
+            request = m_queue.dequeue();
+            ++m_activeRequests;
+        }
+
+        QBuffer *payloadBuffer = 0;
+
+        if (!request->payload.isEmpty())
+        {
+            payloadBuffer = new QBuffer;
+            payloadBuffer->setData(request->payload);
+            payloadBuffer->open(QIODevice::ReadOnly);
+        }
+
+        QNetworkReply *reply = m_networkAccessManager->sendCustomRequest(request->request, request->verb,
+                                                                         payloadBuffer);
+
+        // The buffer is read while the request is sent
+        if (payloadBuffer)
+        {
+            payloadBuffer->setParent(reply);
+        }
+
+        // The timer is cancelled when the reply is deleted
+        if (request->timeoutMsec > 0)
+        {
+            QTimer::singleShot(request->timeoutMsec, reply, SLOT(abort()));
+        }
+
+        m_requests.insert(reply, request);
+        connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    }
+}
+
+
+void AsyncNetworkAccessManager::replyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    AsyncNetworkRequest *request = m_requests.take(reply);
+
+    if (request == 0)
+    {
+        return;
+    }
+
+    if (request->completionHandler)
+    {
+        request->completionHandler(reply);
+    }
+
+    delete request;
+    reply->deleteLater();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        --m_activeRequests;
+    }
+
+    startQueued();
+}
@@ -2,9 +2,18 @@
 #define QTAWSQNAM_H
 
 #include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkRequest>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
+#include <QtCore/QQueue>
 #include <QtCore/QWaitCondition>
 
+#include <functional>
+
+
+#define QTAWS_MAX_REQUESTS     6
+#define QTAWS_REQUEST_TIMEOUT  60000
+
 
 class SlottetNetworkAccessManager : public QNetworkAccessManager
 {
@@ -23,7 +32,7 @@ public:
     ThreadsafeBlockingNetworkAccesManager();
     ~ThreadsafeBlockingNetworkAccesManager();
     QNetworkReply *sendCustomRequest(const QNetworkRequest &request, const QByteArray &verb,
-                                     QIODevice *data = 0);
+                                     QIODevice *data = 0, int timeoutMsec = 0);
     void waitForAll();
     int pendingRequests();
 
@@ -42,5 +51,55 @@ private:
 };
 
 
+// Request that is queued by the AsyncNetworkAccessManager. The completion handler is
+// called on the network thread when the reply has finished (or has been aborted), and
+// must not block. The reply is deleted afterwards.
+class AsyncNetworkRequest
+{
+public:
+    QNetworkRequest request;
+    QByteArray      verb;
+    QByteArray      payload;
+    int             timeoutMsec;
+
+    std::function<void(QNetworkReply*)> completionHandler;
+};
+
+
+// Non-blocking network access manager for long-lived clients. All requests are sent by one
+// QNetworkAccessManager on a network thread, so that the connections to a host are kept
+// alive and reused between requests. At most maxRequests requests are in flight, the
+// remaining requests are queued.
+class AsyncNetworkAccessManager : public QObject
+{
+    Q_OBJECT
+public:
+    AsyncNetworkAccessManager(int maxRequests = QTAWS_MAX_REQUESTS);
+    ~AsyncNetworkAccessManager();
+
+    // Thread-safe. The manager takes ownership of the request.
+    void send(AsyncNetworkRequest *request);
+
+    void setMaxRequests(int maxRequests);
+    int pendingRequests();
+
+private slots:
+    void startQueued();
+    void replyFinished();
+
+private:
+    QNetworkAccessManager *m_networkAccessManager;
+    QThread *m_networkThread;
+
+    QMutex m_mutex;
+    QQueue<AsyncNetworkRequest *> m_queue;
+    int m_activeRequests;
+    int m_maxRequests;
+
+    // Only accessed on the network thread
+    QHash<QNetworkReply *, AsyncNetworkRequest *> m_requests;
+};
+
+
 #endif
 
@@ -0,0 +1,973 @@
+#include "qtawss3.h"
+
+
+// Transfers one part of the file on a thread of the transfer's pool
+class QtAWSS3PartJob : public QRunnable
+{
+public:
+    QtAWSS3PartJob(QtAWSS3Transfer *transfer, int partNumber)
+        : m_transfer(transfer), m_partNumber(partNumber)
+    {
+    }
+
+    void run()
+    {
+        m_transfer->runPart(m_partNumber);
+    }
+
+protected:
+    QtAWSS3Transfer *m_transfer;
+    int              m_partNumber;
+};
+
+
+
+QtAWSS3FileRange::QtAWSS3FileRange(const QString &filename, qint64 offset, qint64 length)
+    : m_file(filename), m_offset(offset), m_length(length), m_position(0)
+{
+}
+
+
+bool QtAWSS3FileRange::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly)
+    {
+        return false;
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    if (!m_file.seek(m_offset))
+    {
+        setErrorString(m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    m_position = 0;
+
+    // Unbuffered, so that the position of the device and the file stay in sync
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+
+void QtAWSS3FileRange::close()
+{
+    m_file.close();
+    QIODevice::close();
+}
+
+
+bool QtAWSS3FileRange::isSequential() const
+{
+    return false;
+}
+
+
+qint64 QtAWSS3FileRange::size() const
+{
+    return m_length;
+}
+
+
+bool QtAWSS3FileRange::seek(qint64 pos)
+{
+    // The network stack rewinds the body when a request has to be resent
+    if ((pos < 0) || (pos > m_length) || (!m_file.seek(m_offset + pos)))
+    {
+        return false;
+    }
+
+    m_position = pos;
+    return QIODevice::seek(pos);
+}
+
+
+qint64 QtAWSS3FileRange::readData(char *data, qint64 maxSize)
+{
+    const qint64 remaining = m_length - m_position;
+
+    if (remaining <= 0)
+    {
+        return -1;
+    }
+
+    const qint64 bytesRead = m_file.read(data, qMin(maxSize, remaining));
+
+    if (bytesRead > 0)
+    {
+        m_position += bytesRead;
+    }
+
+    return bytesRead;
+}
+
+
+qint64 QtAWSS3FileRange::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+
+
+QtAWSS3Manifest::QtAWSS3Manifest()
+{
+    type = "";
+    bucket = "";
+    key = "";
+    uploadId = "";
+    etag = "";
+    size = 0;
+    modified = 0;
+    partSize = 0;
+}
+
+
+bool QtAWSS3Manifest::load(const QString &filename)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    file.close();
+
+    if ((parseError.error != QJsonParseError::NoError) || (!document.isObject()))
+    {
+        return false;
+    }
+
+    QJsonObject object = document.object();
+
+    type     = object["type"].toString();
+    bucket   = object["bucket"].toString().toLatin1();
+    key      = object["key"].toString();
+    uploadId = object["uploadId"].toString().toLatin1();
+    etag     = object["etag"].toString().toLatin1();
+    size     = object["size"].toString().toLongLong();
+    modified = object["modified"].toString().toLongLong();
+    partSize = object["partSize"].toString().toLongLong();
+
+    parts.clear();
+    QJsonObject partObject = object["parts"].toObject();
+
+    for (auto it = partObject.begin(); it != partObject.end(); ++it)
+    {
+        parts.insert(it.key().toInt(), it.value().toString().toLatin1());
+    }
+
+    return true;
+}
+
+
+bool QtAWSS3Manifest::save(const QString &filename)
+{
+    QJsonObject partObject;
+
+    for (auto it = parts.begin(); it != parts.end(); ++it)
+    {
+        partObject.insert(QString::number(it.key()), QString::fromLatin1(it.value()));
+    }
+
+    // The 64-bit values are stored as strings, because JSON numbers are doubles
+    QJsonObject object;
+    object.insert("type",     type);
+    object.insert("bucket",   QString::fromLatin1(bucket));
+    object.insert("key",      key);
+    object.insert("uploadId", QString::fromLatin1(uploadId));
+    object.insert("etag",     QString::fromLatin1(etag));
+    object.insert("size",     QString::number(size));
+    object.insert("modified", QString::number(modified));
+    object.insert("partSize", QString::number(partSize));
+    object.insert("parts",    partObject);
+
+    QSaveFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+
+bool QtAWSS3Manifest::matches(const QtAWSS3Manifest &other)
+{
+    return (type == other.type) && (bucket == other.bucket) && (key == other.key)
+           && (etag == other.etag) && (size == other.size) && (modified == other.modified)
+           && (partSize == other.partSize);
+}
+
+
+
+QtAWSS3Response::QtAWSS3Response()
+{
+    status = 0;
+    error = QNetworkReply::NoError;
+    errorString = "";
+}
+
+
+bool QtAWSS3Response::isSuccess()
+{
+    return (error == QNetworkReply::NoError) && (status >= 200) && (status < 300);
+}
+
+
+bool QtAWSS3Response::isRetryable()
+{
+    // Connection problems, timeouts, throttling and server errors are temporary.
+    // Other client errors (credentials, missing objects, changed objects) are not.
+    if ((status == 0) || (status >= 500) || (status == 408) || (status == 429))
+    {
+        return true;
+    }
+
+    return (status == 400) && (data.contains("RequestTimeout"));
+}
+
+
+QString QtAWSS3Response::describe()
+{
+    QString description = "HTTP " + QString::number(status);
+
+    if (!errorString.isEmpty())
+    {
+        description += " (" + errorString + ")";
+    }
+
+    const int codeStart = data.indexOf("<Code>");
+    const int codeEnd   = data.indexOf("</Code>");
+
+    if ((codeStart >= 0) && (codeEnd > codeStart))
+    {
+        description += " " + QString::fromUtf8(data.mid(codeStart + 6, codeEnd - codeStart - 6));
+    }
+
+    return description;
+}
+
+
+
+QtAWSS3Transfer::QtAWSS3Transfer(const QString &accessKeyId, const QString &secretAccessKey,
+                                 const QByteArray &region)
+    : d(new QtAWSPrivate(accessKeyId.toLatin1(), secretAccessKey.toLatin1()))
+{
+    d->setService("s3");
+
+    m_region = region;
+    m_partSize = QTAWS_S3_PARTSIZE;
+    m_parallelParts = QTAWS_S3_PARALLELPARTS;
+    m_retries = QTAWS_S3_RETRIES;
+    m_progressHandler = nullptr;
+    m_logHandler = nullptr;
+    m_cancel.storeRelease(0);
+
+    m_failed.storeRelease(0);
+    m_uploadUnknown.storeRelease(0);
+    m_transferred = 0;
+}
+
+
+void QtAWSS3Transfer::setEndpoint(const QUrl &endpoint)
+{
+    m_endpoint = endpoint;
+}
+
+
+void QtAWSS3Transfer::setPartSize(qint64 partSize)
+{
+    m_partSize = qMax(qint64(QTAWS_S3_MINPARTSIZE), partSize);
+}
+
+
+void QtAWSS3Transfer::setParallelParts(int parts)
+{
+    m_parallelParts = qMax(1, parts);
+}
+
+
+void QtAWSS3Transfer::setRetries(int retries)
+{
+    m_retries = qMax(0, retries);
+}
+
+
+void QtAWSS3Transfer::setProgressHandler(std::function<void(qint64, qint64)> handler)
+{
+    m_progressHandler = handler;
+}
+
+
+void QtAWSS3Transfer::setLogHandler(std::function<void(const QString &)> handler)
+{
+    m_logHandler = handler;
+}
+
+
+void QtAWSS3Transfer::cancel()
+{
+    m_cancel.storeRelease(1);
+}
+
+
+QByteArray QtAWSS3Transfer::encodeKey(const QString &key)
+{
+    // Each segment is escaped on its own, so that the slashes remain part of the path
+    QList<QByteArray> segments = key.toUtf8().split('/');
+
+    for (int i = 0; i < segments.count(); i++)
+    {
+        segments[i] = segments.at(i).toPercentEncoding();
+    }
+
+    return segments.join('/');
+}
+
+
+QByteArray QtAWSS3Transfer::xmlValue(const QByteArray &xml, const QString &element)
+{
+    QXmlStreamReader reader(xml);
+
+    while (!reader.atEnd())
+    {
+        reader.readNext();
+
+        if ((reader.isStartElement()) && (reader.name() == element))
+        {
+            return reader.readElementText().toUtf8();
+        }
+    }
+
+    return QByteArray();
+}
+
+
+bool QtAWSS3Transfer::execute(const QByteArray &verb, const QByteArray &bucket, const QString &key,
+                              const QByteArray &query, const QByteArray &payload, QIODevice *body,
+                              const QHash<QByteArray, QByteArray> &headers, int timeoutMsec,
+                              QtAWSS3Response &response)
+{
+    QByteArray host;
+    QByteArray url;
+    QByteArray path = key.isEmpty() ? QByteArray() : "/" + encodeKey(key);
+
+    if (m_endpoint.isEmpty())
+    {
+        // Virtual-hosted addressing on AWS
+        host = bucket + ".s3." + m_region + ".amazonaws.com";
+        url = "https://" + host + (path.isEmpty() ? QByteArray("/") : path);
+    }
+    else
+    {
+        // Path-style addressing on S3-compatible servers
+        host = m_endpoint.host().toLatin1();
+
+        if (m_endpoint.port() > 0)
+        {
+            host += ":" + QByteArray::number(m_endpoint.port());
+        }
+
+        url = m_endpoint.scheme().toLatin1() + "://" + host + "/" + bucket + path;
+    }
+
+    if (!query.isEmpty())
+    {
+        url += "?" + query;
+    }
+
+    // Small payloads are signed. The parts are not hashed, because that would require
+    // reading the data twice. The connection is protected by TLS.
+    QBuffer payloadBuffer;
+    QIODevice *data = body;
+    bool unsignedPayload = (body != 0);
+
+    if ((body == 0) && (!payload.isEmpty()))
+    {
+        payloadBuffer.setData(payload);
+        payloadBuffer.open(QIODevice::ReadOnly);
+        data = &payloadBuffer;
+    }
+
+    QNetworkReply *reply = d->sendStreamingRequest(verb, QUrl::fromEncoded(url), host, m_region, headers,
+                                                   data, data ? data->size() : 0, unsignedPayload,
+                                                   timeoutMsec);
+
+    if (reply == 0)
+    {
+        response.status = 0;
+        response.error = QNetworkReply::UnknownContentError;
+        response.errorString = "Unable to read request body";
+        return false;
+    }
+
+    response.status      = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    response.error       = reply->error();
+    response.errorString = (response.error == QNetworkReply::NoError) ? QString() : reply->errorString();
+    response.data        = reply->readAll();
+    response.headers.clear();
+
+    foreach (const QNetworkReply::RawHeaderPair &header, reply->rawHeaderPairs())
+    {
+        response.headers.insert(header.first.toLower(), header.second);
+    }
+
+    // The reply lives on the network thread
+    reply->deleteLater();
+
+    return response.isSuccess();
+}
+
+
+bool QtAWSS3Transfer::waitBeforeRetry(int attempt)
+{
+    // Exponential backoff. Sleep in slices, so that a cancel request is noticed.
+    const int delay = qMin(QTAWS_S3_RETRYDELAY << qMin(attempt, 10), QTAWS_S3_MAXRETRYDELAY);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed() < delay)
+    {
+        if (m_cancel.loadAcquire())
+        {
+            return false;
+        }
+
+        QThread::msleep(100);
+    }
+
+    return !m_cancel.loadAcquire();
+}
+
+
+bool QtAWSS3Transfer::executeWithRetry(const QByteArray &verb, const QByteArray &bucket,
+                                       const QString &key, const QByteArray &query,
+                                       const QByteArray &payload,
+                                       const QHash<QByteArray, QByteArray> &headers,
+                                       QtAWSS3Response &response)
+{
+    for (int attempt = 0; ; attempt++)
+    {
+        if (execute(verb, bucket, key, query, payload, 0, headers, QTAWS_S3_REQUESTTIMEOUT, response))
+        {
+            return true;
+        }
+
+        if ((!response.isRetryable()) || (attempt >= m_retries) || (!waitBeforeRetry(attempt)))
+        {
+            return false;
+        }
+    }
+}
+
+
+void QtAWSS3Transfer::setError(const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Keep the first error, the following ones are usually consequences
+    if (!m_failed.loadAcquire())
+    {
+        m_errorString = error;
+    }
+
+    m_failed.storeRelease(1);
+}
+
+
+void QtAWSS3Transfer::warn(const QString &message)
+{
+    if (m_logHandler)
+    {
+        m_logHandler(message);
+    }
+    else
+    {
+        qWarning().noquote() << message;
+    }
+}
+
+
+qint64 QtAWSS3Transfer::choosePartSize(qint64 fileSize)
+{
+    qint64 partSize = m_partSize;
+
+    // S3 limits the number of parts of an upload
+    while (fileSize / partSize >= QTAWS_S3_MAXPARTS)
+    {
+        partSize *= 2;
+    }
+
+    return partSize;
+}
+
+
+qint64 QtAWSS3Transfer::partLength(int partNumber)
+{
+    const qint64 offset = qint64(partNumber - 1) * m_manifest.partSize;
+    return qMax(qint64(0), qMin(m_manifest.partSize, m_manifest.size - offset));
+}
+
+
+bool QtAWSS3Transfer::runParts(int partCount)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_parallelParts);
+
+    for (int partNumber = 1; partNumber <= partCount; partNumber++)
+    {
+        if (!m_manifest.parts.contains(partNumber))
+        {
+            pool.start(new QtAWSS3PartJob(this, partNumber));
+        }
+    }
+
+    pool.waitForDone();
+
+    if ((!m_failed.loadAcquire()) && (m_cancel.loadAcquire()))
+    {
+        setError("Transfer cancelled");
+    }
+
+    return !m_failed.loadAcquire();
+}
+
+
+void QtAWSS3Transfer::runPart(int partNumber)
+{
+    // Don't start further parts once a part has failed for good
+    if ((m_failed.loadAcquire()) || (m_cancel.loadAcquire()))
+    {
+        return;
+    }
+
+    if (m_manifest.type == "upload")
+    {
+        uploadPart(partNumber);
+    }
+    else
+    {
+        downloadPart(partNumber);
+    }
+}
+
+
+void QtAWSS3Transfer::partFinished(int partNumber, qint64 bytes, const QByteArray &etag)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_manifest.parts.insert(partNumber, etag);
+    m_transferred += bytes;
+
+    if (!m_manifest.save(m_manifestFile))
+    {
+        warn("Unable to update transfer manifest " + m_manifestFile);
+    }
+
+    if (m_progressHandler)
+    {
+        m_progressHandler(m_transferred, m_manifest.size);
+    }
+}
+
+
+bool QtAWSS3Transfer::uploadPart(int partNumber)
+{
+    const qint64 offset = qint64(partNumber - 1) * m_manifest.partSize;
+    const qint64 length = partLength(partNumber);
+
+    const QByteArray query = "partNumber=" + QByteArray::number(partNumber)
+                             + "&uploadId=" + QUrl::toPercentEncoding(QString::fromLatin1(m_manifest.uploadId));
+
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert("Content-Type", "application/octet-stream");
+
+    for (int attempt = 0; ; attempt++)
+    {
+        // The file is read again for every attempt
+        QtAWSS3FileRange range(m_filename, offset, length);
+
+        if (!range.open(QIODevice::ReadOnly))
+        {
+            setError("Unable to read " + m_filename + " (" + range.errorString() + ")");
+            return false;
+        }
+
+        QtAWSS3Response response;
+
+        if (execute("PUT", m_manifest.bucket, m_manifest.key, query, QByteArray(), &range, headers,
+                    QTAWS_S3_PARTTIMEOUT, response))
+        {
+            QByteArray etag = response.headers.value("etag");
+
+            if (etag.isEmpty())
+            {
+                setError("No ETag returned for part " + QString::number(partNumber));
+                return false;
+            }
+
+            partFinished(partNumber, length, etag);
+            return true;
+        }
+
+        if ((!response.isRetryable()) || (attempt >= m_retries) || (!waitBeforeRetry(attempt)))
+        {
+            // The upload has been aborted or has expired on the server
+            if ((response.status == 404) || (response.data.contains("NoSuchUpload")))
+            {
+                m_uploadUnknown.storeRelease(1);
+            }
+
+            setError("Upload of part " + QString::number(partNumber) + " failed: " + response.describe());
+            return false;
+        }
+
+        warn("Retrying part " + QString::number(partNumber) + " of " + m_manifest.key + ": " + response.describe());
+    }
+}
+
+
+bool QtAWSS3Transfer::downloadPart(int partNumber)
+{
+    const qint64 offset = qint64(partNumber - 1) * m_manifest.partSize;
+    const qint64 length = partLength(partNumber);
+
+    // If-Match lets the request fail if the object has been replaced in the meantime
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert("Range", "bytes=" + QByteArray::number(offset) + "-" + QByteArray::number(offset + length - 1));
+    headers.insert("If-Match", m_manifest.etag);
+
+    for (int attempt = 0; ; attempt++)
+    {
+        QtAWSS3Response response;
+
+        if (execute("GET", m_manifest.bucket, m_manifest.key, QByteArray(), QByteArray(), 0, headers,
+                    QTAWS_S3_PARTTIMEOUT, response))
+        {
+            if (response.data.size() == length)
+            {
+                QFile file(m_filename);
+
+                // ReadWrite doesn't truncate the file, the other parts are kept
+                if ((!file.open(QIODevice::ReadWrite)) || (!file.seek(offset))
+                    || (file.write(response.data) != length))
+                {
+                    setError("Unable to write " + m_filename + " (" + file.errorString() + ")");
+                    return false;
+                }
+
+                file.close();
+
+                partFinished(partNumber, length, "1");
+                return true;
+            }
+
+            // Truncated response, treat like a connection problem
+            response.status = 0;
+            response.errorString = "Incomplete part received";
+        }
+
+        if ((!response.isRetryable()) || (attempt >= m_retries) || (!waitBeforeRetry(attempt)))
+        {
+            setError("Download of part " + QString::number(partNumber) + " failed: " + response.describe());
+            return false;
+        }
+
+        warn("Retrying part " + QString::number(partNumber) + " of " + m_manifest.key + ": " + response.describe());
+    }
+}
+
+
+bool QtAWSS3Transfer::uploadFile(const QString &filename, const QByteArray &bucket, const QString &key)
+{
+    m_failed.storeRelease(0);
+    m_uploadUnknown.storeRelease(0);
+    m_errorString = "";
+    m_transferred = 0;
+    m_filename = filename;
+    m_manifestFile = filename + QTAWS_S3_MANIFEST_EXT;
+
+    QFileInfo fileInfo(filename);
+
+    if (!fileInfo.exists())
+    {
+        setError("File not found: " + filename);
+        return false;
+    }
+
+    QtAWSS3Manifest current;
+    current.type     = "upload";
+    current.bucket   = bucket;
+    current.key      = key;
+    current.size     = fileInfo.size();
+    current.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    current.partSize = choosePartSize(fileInfo.size());
+
+    QtAWSS3Manifest stored;
+    bool resume = (stored.load(m_manifestFile)) && (stored.matches(current)) && (!stored.uploadId.isEmpty());
+
+    for (;;)
+    {
+        if (resume)
+        {
+            // Continue the upload from the last run
+            m_manifest = stored;
+        }
+        else
+        {
+            m_manifest = current;
+
+            QtAWSS3Response response;
+
+            if (executeWithRetry("POST", bucket, key, "uploads", QByteArray(), QHash<QByteArray, QByteArray>(), response))
+            {
+                m_manifest.uploadId = xmlValue(response.data, "UploadId");
+            }
+
+            if (m_manifest.uploadId.isEmpty())
+            {
+                setError("Unable to start upload of " + key + ": " + response.describe());
+                return false;
+            }
+
+            if (!m_manifest.save(m_manifestFile))
+            {
+                warn("Unable to write transfer manifest " + m_manifestFile);
+            }
+        }
+
+        const int partCount = qMax(1, int((m_manifest.size + m_manifest.partSize - 1) / m_manifest.partSize));
+
+        m_transferred = 0;
+
+        for (auto it = m_manifest.parts.begin(); it != m_manifest.parts.end(); ++it)
+        {
+            m_transferred += partLength(it.key());
+        }
+
+        if (runParts(partCount))
+        {
+            break;
+        }
+
+        if (!m_uploadUnknown.loadAcquire())
+        {
+            // The manifest is kept, the next attempt continues with the missing parts
+            return false;
+        }
+
+        // The upload ID of the manifest isn't valid anymore, so the uploaded parts are
+        // lost. Start a new upload if the manifest was taken from an earlier run.
+        QFile::remove(m_manifestFile);
+
+        if ((!resume) || (m_cancel.loadAcquire()))
+        {
+            return false;
+        }
+
+        resume = false;
+        m_failed.storeRelease(0);
+        m_uploadUnknown.storeRelease(0);
+        m_errorString = "";
+    }
+
+    QByteArray completeXml = "<CompleteMultipartUpload>";
+
+    for (auto it = m_manifest.parts.begin(); it != m_manifest.parts.end(); ++it)
+    {
+        completeXml += "<Part><PartNumber>" + QByteArray::number(it.key()) + "</PartNumber>"
+                       + "<ETag>" + it.value() + "</ETag></Part>";
+    }
+
+    completeXml += "</CompleteMultipartUpload>";
+
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert("Content-Type", "application/xml");
+
+    QtAWSS3Response response;
+    const QByteArray query = "uploadId=" + QUrl::toPercentEncoding(QString::fromLatin1(m_manifest.uploadId));
+
+    // S3 can report an error in the body of a successful response
+    if ((!executeWithRetry("POST", bucket, key, query, completeXml, headers, response))
+        || (response.data.contains("<Error>")))
+    {
+        // If the upload is unknown or the parts don't match, start from scratch next time
+        if ((response.status == 404) || (response.data.contains("NoSuchUpload")) || (response.data.contains("InvalidPart")))
+        {
+            QFile::remove(m_manifestFile);
+        }
+
+        setError("Unable to complete upload of " + key + ": " + response.describe());
+        return false;
+    }
+
+    QFile::remove(m_manifestFile);
+    return true;
+}
+
+
+bool QtAWSS3Transfer::downloadFile(const QByteArray &bucket, const QString &key, const QString &filename)
+{
+    m_failed.storeRelease(0);
+    m_errorString = "";
+    m_transferred = 0;
+    m_filename = filename + QTAWS_S3_PARTIAL_EXT;
+    m_manifestFile = filename + QTAWS_S3_MANIFEST_EXT;
+
+    QtAWSS3Response response;
+
+    if (!executeWithRetry("HEAD", bucket, key, QByteArray(), QByteArray(), QHash<QByteArray, QByteArray>(), response))
+    {
+        setError("Unable to query " + key + ": " + response.describe());
+        return false;
+    }
+
+    QtAWSS3Manifest current;
+    current.type     = "download";
+    current.bucket   = bucket;
+    current.key      = key;
+    current.etag     = response.headers.value("etag");
+    current.size     = response.headers.value("content-length").toLongLong();
+    current.partSize = choosePartSize(current.size);
+
+    QtAWSS3Manifest stored;
+
+    if ((stored.load(m_manifestFile)) && (stored.matches(current))
+        && (QFileInfo(m_filename).size() == current.size))
+    {
+        // Continue the download from the last run
+        m_manifest = stored;
+    }
+    else
+    {
+        m_manifest = current;
+
+        // The parts are written into the preallocated file at their offsets
+        QFile partialFile(m_filename);
+
+        if ((!partialFile.open(QIODevice::WriteOnly)) || (!partialFile.resize(current.size)))
+        {
+            setError("Unable to create " + m_filename + " (" + partialFile.errorString() + ")");
+            return false;
+        }
+
+        partialFile.close();
+
+        if (!m_manifest.save(m_manifestFile))
+        {
+            warn("Unable to write transfer manifest " + m_manifestFile);
+        }
+    }
+
+    const int partCount = int((m_manifest.size + m_manifest.partSize - 1) / m_manifest.partSize);
+
+    for (auto it = m_manifest.parts.begin(); it != m_manifest.parts.end(); ++it)
+    {
+        m_transferred += partLength(it.key());
+    }
+
+    if ((partCount > 0) && (!runParts(partCount)))
+    {
+        // If the object has changed, the partial file is useless
+        if (m_errorString.contains("PreconditionFailed") || m_errorString.contains("HTTP 412"))
+        {
+            QFile::remove(m_filename);
+            QFile::remove(m_manifestFile);
+        }
+
+        return false;
+    }
+
+    if (QFile::exists(filename))
+    {
+        QFile::remove(filename);
+    }
+
+    if (!QFile::rename(m_filename, filename))
+    {
+        setError("Unable to rename " + m_filename);
+        return false;
+    }
+
+    QFile::remove(m_manifestFile);
+    return true;
+}
+
+
+bool QtAWSS3Transfer::listObjects(const QByteArray &bucket, const QString &prefix, QStringList &keys)
+{
+    m_failed.storeRelease(0);
+    m_errorString = "";
+    keys.clear();
+
+    QByteArray continuationToken = "";
+    bool truncated = false;
+
+    do
+    {
+        QByteArray query = "list-type=2&prefix=" + QUrl::toPercentEncoding(prefix);
+
+        if (!continuationToken.isEmpty())
+        {
+            query += "&continuation-token=" + QUrl::toPercentEncoding(QString::fromUtf8(continuationToken));
+        }
+
+        QtAWSS3Response response;
+
+        if (!executeWithRetry("GET", bucket, "", query, QByteArray(), QHash<QByteArray, QByteArray>(), response))
+        {
+            setError("Unable to list " + prefix + ": " + response.describe());
+            return false;
+        }
+
+        continuationToken = "";
+        truncated = false;
+
+        QXmlStreamReader reader(response.data);
+
+        while (!reader.atEnd())
+        {
+            reader.readNext();
+
+            if (!reader.isStartElement())
+            {
+                continue;
+            }
+
+            if (reader.name() == "Key")
+            {
+                keys.append(reader.readElementText());
+            }
+            else
+            {
+                if (reader.name() == "IsTruncated")
+                {
+                    truncated = (reader.readElementText() == "true");
+                }
+                else
+                {
+                    if (reader.name() == "NextContinuationToken")
+                    {
+                        continuationToken = reader.readElementText().toUtf8();
+                    }
+                }
+            }
+        }
+    }
+    while ((truncated) && (!continuationToken.isEmpty()));
+
+    return true;
+}
@@ -0,0 +1,182 @@
+// S3 multipart transfers for the Qt AWS interface
+//
+// Uses the request signing of QtAWSPrivate with the "s3" service. Files are
+// uploaded with multipart uploads and downloaded with ranged GET requests. The
+// parts are transferred in parallel, each part is retried independently, and
+// the completed parts are recorded in a manifest file, so that an interrupted
+// transfer continues where it stopped.
+
+
+#ifndef QTAWSS3_H
+#define QTAWSS3_H
+
+#include "qtaws.h"
+
+#include <QtCore>
+#include <QtNetwork>
+
+#include <functional>
+
+
+#define QTAWS_S3_PARTSIZE         (16*1024*1024)
+#define QTAWS_S3_MINPARTSIZE      (5*1024*1024)
+#define QTAWS_S3_MAXPARTS         10000
+#define QTAWS_S3_PARALLELPARTS    4
+#define QTAWS_S3_RETRIES          5
+#define QTAWS_S3_RETRYDELAY       1000
+#define QTAWS_S3_MAXRETRYDELAY    30000
+#define QTAWS_S3_REQUESTTIMEOUT   60000
+#define QTAWS_S3_PARTTIMEOUT      600000
+#define QTAWS_S3_MANIFEST_EXT     ".s3m"
+#define QTAWS_S3_PARTIAL_EXT      ".s3part"
+
+
+// Read-only window into a file, used as request body for a part upload. The data
+// is read from the file while the request is sent.
+class QtAWSS3FileRange : public QIODevice
+{
+public:
+    QtAWSS3FileRange(const QString &filename, qint64 offset, qint64 length);
+
+    bool   open(OpenMode mode);
+    void   close();
+    bool   isSequential() const;
+    qint64 size() const;
+    bool   seek(qint64 pos);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+    QFile  m_file;
+    qint64 m_offset;
+    qint64 m_length;
+    qint64 m_position;
+};
+
+
+// Persistent state of a multipart transfer. The manifest is rewritten after every
+// completed part.
+class QtAWSS3Manifest
+{
+public:
+    QtAWSS3Manifest();
+
+    QString    type;
+    QByteArray bucket;
+    QString    key;
+    QByteArray uploadId;
+    QByteArray etag;
+    qint64     size;
+    qint64     modified;
+    qint64     partSize;
+
+    QMap<int, QByteArray> parts;    // part number -> ETag
+
+    bool load(const QString &filename);
+    bool save(const QString &filename);
+    bool matches(const QtAWSS3Manifest &other);
+};
+
+
+class QtAWSS3Response
+{
+public:
+    QtAWSS3Response();
+
+    int                         status;
+    QNetworkReply::NetworkError error;
+    QString                     errorString;
+    QByteArray                  data;
+    QHash<QByteArray, QByteArray> headers;
+
+    bool isSuccess();
+    bool isRetryable();
+    QString describe();
+};
+
+
+class QtAWSS3Transfer
+{
+public:
+    QtAWSS3Transfer(const QString &accessKeyId, const QString &secretAccessKey, const QByteArray &region);
+
+    // Sends the requests to an S3-compatible server (path-style addressing), e.g. for tests
+    void setEndpoint(const QUrl &endpoint);
+    void setPartSize(qint64 partSize);
+    void setParallelParts(int parts);
+    void setRetries(int retries);
+
+    // Called after each completed part with the transferred and total bytes of the file
+    void setProgressHandler(std::function<void(qint64, qint64)> handler);
+
+    // Called with warnings (retries, manifest problems), possibly from the part threads.
+    // Without a handler, the warnings are written with qWarning().
+    void setLogHandler(std::function<void(const QString &)> handler);
+
+    bool uploadFile  (const QString &filename, const QByteArray &bucket, const QString &key);
+    bool downloadFile(const QByteArray &bucket, const QString &key, const QString &filename);
+    bool listObjects (const QByteArray &bucket, const QString &prefix, QStringList &keys);
+
+    void    cancel();
+    QString errorString();
+
+    // Used by the part jobs
+    void runPart(int partNumber);
+
+protected:
+    bool execute(const QByteArray &verb, const QByteArray &bucket, const QString &key,
+                 const QByteArray &query, const QByteArray &payload, QIODevice *body,
+                 const QHash<QByteArray, QByteArray> &headers, int timeoutMsec,
+                 QtAWSS3Response &response);
+
+    bool executeWithRetry(const QByteArray &verb, const QByteArray &bucket, const QString &key,
+                          const QByteArray &query, const QByteArray &payload,
+                          const QHash<QByteArray, QByteArray> &headers, QtAWSS3Response &response);
+
+    bool waitBeforeRetry(int attempt);
+    bool runParts(int partCount);
+    void partFinished(int partNumber, qint64 bytes, const QByteArray &etag);
+    void setError(const QString &error);
+    void warn(const QString &message);
+
+    bool uploadPart  (int partNumber);
+    bool downloadPart(int partNumber);
+
+    qint64 choosePartSize(qint64 fileSize);
+    qint64 partLength(int partNumber);
+
+    static QByteArray encodeKey(const QString &key);
+    static QByteArray xmlValue(const QByteArray &xml, const QString &element);
+
+    QSharedPointer<QtAWSPrivate> d;
+    QByteArray m_region;
+    QUrl       m_endpoint;
+    qint64     m_partSize;
+    int        m_parallelParts;
+    int        m_retries;
+
+    std::function<void(qint64, qint64)> m_progressHandler;
+    std::function<void(const QString &)> m_logHandler;
+
+    QAtomicInt m_cancel;
+
+    // State of the running transfer
+    QMutex          m_mutex;
+    QString         m_errorString;
+    QAtomicInt      m_failed;
+    QAtomicInt      m_uploadUnknown;
+    QtAWSS3Manifest m_manifest;
+    QString         m_manifestFile;
+    QString         m_filename;
+    qint64          m_transferred;
+};
+
+
+inline QString QtAWSS3Transfer::errorString()
+{
+    return m_errorString;
+}
+
+
+#endif // QTAWSS3_H
@@ -0,0 +1,654 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "../yct_prepare/yct_twix_tagmatcher.h"
+#include "../yct_prepare/yct_twix_probe.h"
+#include "../yct_prepare/yct_twix_header.h"
+#include "../../Client/rds_raidparser.h"
+
+#define YCT_BENCHMARK_VER "0.3a"
+
+
+// Representative subset of the tags searched by the anonymizer
+static const char* const benchmarkTags[] =
+{
+    "<ParamString.\"tPatientName\">",
+    "<ParamString.\"PatientName\">",
+    "<ParamString.\"PatientsName\">",
+    "<ParamString.\"PatientBirthDay\">",
+    "<ParamString.\"PatientID\">",
+    "<ParamString.\"Patient\">",
+    "<ParamString.\"tPerfPhysiciansName\">",
+    "<ParamString.\"SoftwareVersions\">",
+    "<ParamArray.\"PatientRegistrationData\">",
+    "HEADER.tPatientName",
+    "IRIS.RECOMPOSE.tPatientName",
+    "IRIS.RECOMPOSE.PatientBirthDay",
+    "IRIS.RECOMPOSE.PatientID",
+    "PatientName",
+    "PatientsName",
+    "BirthDay",
+    "PatientID",
+    "PatientRegistrationData",
+    "<ParamString.\"DeviceSerialNumber\">",
+    "<ParamDouble.\"flUsedPatientWeight\">",
+    "<ParamLong.\"lPatientSex\">"
+};
+
+static const int benchmarkTagCount=sizeof(benchmarkTags)/sizeof(benchmarkTags[0]);
+
+
+QList<QByteArray> createSyntheticHeader(qint64 targetSize)
+{
+    QList<QByteArray> lines;
+    qint64 size=0;
+    int    counter=0;
+
+    lines.append("<XProtocol> \n");
+    lines.append("  <ParamString.\"SoftwareVersions\">  { \"syngo MR E11\"  }\n");
+
+    while (size < targetSize)
+    {
+        QByteArray line;
+
+        switch (counter % 50)
+        {
+        case 0:
+            line="      <ParamString.\"PatientName\">  { \"DOE^JOHN\"  }\n";
+            break;
+        case 1:
+            line="      <ParamString.\"PatientID\">  { \"1234567\"  }\n";
+            break;
+        case 2:
+            line="      <ParamString.\"PatientBirthDay\">  { \"19700101\"  }\n";
+            break;
+        default:
+            line="      <ParamLong.\"lParameter"+QByteArray::number(counter)+"\">  { "+QByteArray::number(counter*7)+"  }\n";
+            break;
+        }
+
+        size+=line.size();
+        lines.append(line);
+        counter++;
+    }
+
+    return lines;
+}
+
+
+int scanWithIndexOf(const QByteArray& line)
+{
+    for (int i=0; i<benchmarkTagCount; i++)
+    {
+        if (line.indexOf(benchmarkTags[i], 0) >= 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+int scanWithMatcher(const yctTagMatcher& matcher, const QByteArray& line)
+{
+    const quint32 matches=matcher.find(&line);
+
+    for (int i=0; i<benchmarkTagCount; i++)
+    {
+        if (yctTagMatcher::contains(matches, i))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+int benchmarkMatcher(int sizeMB, int iterations)
+{
+    QList<QByteArray> lines=createSyntheticHeader(qint64(sizeMB)*1024*1024);
+    printf("Synthetic header: %d lines, %d MB, %d iterations\n\n", lines.count(), sizeMB, iterations);
+
+    QElapsedTimer timer;
+    timer.start();
+    yctTagMatcher matcher(benchmarkTags, benchmarkTagCount);
+    printf("Automaton compiled in %lld ms\n", timer.elapsed());
+
+    // Check that both approaches find the same tag for every line
+    for (int i=0; i<lines.count(); i++)
+    {
+        if (scanWithIndexOf(lines.at(i))!=scanWithMatcher(matcher, lines.at(i)))
+        {
+            printf("Error! Results differ for line: %s\n", lines.at(i).constData());
+            return 1;
+        }
+    }
+
+    qint64 checksum=0;
+
+    timer.restart();
+    for (int j=0; j<iterations; j++)
+    {
+        for (int i=0; i<lines.count(); i++)
+        {
+            checksum+=scanWithIndexOf(lines.at(i));
+        }
+    }
+    qint64 indexOfTime=qMax(timer.elapsed(), (qint64) 1);
+
+    timer.restart();
+    for (int j=0; j<iterations; j++)
+    {
+        for (int i=0; i<lines.count(); i++)
+        {
+            checksum-=scanWithMatcher(matcher, lines.at(i));
+        }
+    }
+    qint64 matcherTime=qMax(timer.elapsed(), (qint64) 1);
+
+    const double totalMB=double(sizeMB)*iterations;
+
+    printf("indexOf:   %6lld ms  (%8.1f MB/s)\n", indexOfTime, totalMB/(indexOfTime/1000.0));
+    printf("Automaton: %6lld ms  (%8.1f MB/s)\n", matcherTime, totalMB/(matcherTime/1000.0));
+    printf("Speedup:   %.1fx\n", double(indexOfTime)/double(matcherTime));
+
+    if (checksum!=0)
+    {
+        printf("Error! Inconsistent results.\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// Directory header and entry format of the RaidTool, as printed by the RaidSimulator
+#define BENCHMARK_RAID_DIRHEAD " FileID     MeasID                        ProtName                         PatName   Status         Size   SizeOnDisk          CreationTime             CloseTime"
+
+
+QByteArray createRaidListing(int count)
+{
+    static const char* const protNames[] = { "T1 Post ax", "GRASP ax_YP8", "T2 HASTE cor", "AdjCoilSens", "DWI ax", "TSE T2 FS ax" };
+    static const char* const patNames[]  = { "Lebowski^Jeffrey", "Seavers^Colt", "Urkel^Steve", "Knight^Michael", "MacGyver^Angus" };
+
+    QByteArray listing;
+    listing.reserve((count+10)*200);
+
+    listing.append("MrParcThreadPrioImpl singleton created without singleton lock.\r\n");
+    listing.append("\r\nRAID device\r\n");
+    listing.append("   97980 Mbyte of  97990 MByte available for I/O\r\n\r\n");
+
+    char line[512];
+    qsnprintf(line, sizeof(line), "%7s%11s%32s%32s%9s%13s%13s%22s%22s\r\n\r\n",
+              "FileID", "MeasID", "ProtName", "PatName", "Status", "Size", "SizeOnDisk", "CreationTime", "CloseTime");
+    listing.append(line);
+
+    QDateTime time(QDate(2017, 3, 14), QTime(18, 30, 0));
+
+    for (int i=0; i<count; i++)
+    {
+        QByteArray timeString=time.addSecs(-83*i).toString("dd.MM.yyyy HH:mm:ss").toLatin1();
+
+        qsnprintf(line, sizeof(line), "%7u%11u%32s%32s%9s%13llu%13llu%22s%22s\r\n",
+                  count+100-i, count+100-i,
+                  protNames[i % 6], patNames[(i/4) % 5], "cld",
+                  (unsigned long long) 10240000+i, (unsigned long long) 10240000+i,
+                  timeString.constData(), timeString.constData());
+        listing.append(line);
+    }
+
+    return listing;
+}
+
+
+// Parsing approach used before the rdsRaidParser: One QString per output line,
+// fields are extracted with left/right/chop and converted from strings
+bool parseRaidListingStrings(const QByteArray& listing, QList<rdsRaidEntry>& entries)
+{
+    QStringList lines;
+    QBuffer buffer;
+    buffer.setData(listing);
+    buffer.open(QIODevice::ReadOnly);
+
+    char buf[1024];
+    qint64 lineLength=-1;
+
+    do
+    {
+        lineLength=buffer.readLine(buf, sizeof(buf));
+        if (lineLength!=-1)
+        {
+            lines << QString(buf);
+        }
+    } while (lineLength!=-1);
+
+    bool dirHeadFound=false;
+
+    for (int i=0; i<lines.count(); i++)
+    {
+        if (lines.at(i).contains(BENCHMARK_RAID_DIRHEAD))
+        {
+            dirHeadFound=true;
+            continue;
+        }
+
+        if ((!dirHeadFound) || (lines.at(i).length() <= 2))
+        {
+            continue;
+        }
+
+        rdsRaidEntry entry;
+        entry.attribute=RDS_SCANATTRIBUTE_OK;
+        bool res=true;
+
+        QString raidLine=lines.at(i);
+        raidLine.chop(2);
+
+        QString temp=raidLine.left(7);
+        raidLine.remove(0,7);
+        temp.remove(" ");
+        entry.fileID=temp.toInt(&res);
+
+        if (!res)
+        {
+            return false;
+        }
+
+        temp=raidLine.left(11);
+        raidLine.remove(0,11);
+        temp.remove(" ");
+        entry.measID=temp.toInt(&res);
+
+        if (!res)
+        {
+            return false;
+        }
+
+        temp=raidLine.left(32);
+        raidLine.remove(0,32);
+        entry.protName=temp.trimmed();
+
+        temp=raidLine.right(22);
+        raidLine.chop(22);
+        entry.closingTime=QDateTime::fromString(temp.trimmed(),"dd.MM.yyyy HH:mm:ss");
+
+        temp=raidLine.right(22);
+        raidLine.chop(22);
+        entry.creationTime=QDateTime::fromString(temp.trimmed(),"dd.MM.yyyy HH:mm:ss");
+
+        temp=raidLine.right(13);
+        raidLine.chop(13);
+        entry.sizeOnDisk=temp.trimmed().toLongLong();
+
+        temp=raidLine.right(13);
+        raidLine.chop(13);
+        entry.size=temp.trimmed().toLongLong();
+
+        temp=raidLine.right(9);
+        raidLine.chop(9);
+
+        if (temp.contains("wip"))
+        {
+            continue;
+        }
+
+        entry.patName=raidLine.trimmed();
+        entries.append(entry);
+    }
+
+    return dirHeadFound;
+}
+
+
+bool parseRaidListingBytes(const QByteArray& listing, QList<rdsRaidEntry>& entries)
+{
+    rdsRaidParser parser;
+    parser.setData(listing);
+
+    bool dirHeadFound=false;
+
+    while (parser.nextLine())
+    {
+        if (parser.lineContains(BENCHMARK_RAID_DIRHEAD))
+        {
+            dirHeadFound=true;
+            continue;
+        }
+
+        if ((!dirHeadFound) || (parser.getLineLength()==0))
+        {
+            continue;
+        }
+
+        rdsRaidEntry entry;
+        entry.attribute=RDS_SCANATTRIBUTE_OK;
+        bool scanOpen=false;
+
+        if ((!parser.readNumber(7, entry.fileID)) || (!parser.readNumber(11, entry.measID)))
+        {
+            return false;
+        }
+
+        parser.readColumns(&entry, scanOpen);
+
+        if (!scanOpen)
+        {
+            entries.append(entry);
+        }
+    }
+
+    return dirHeadFound;
+}
+
+
+bool isSameRaidEntry(const rdsRaidEntry& a, const rdsRaidEntry& b)
+{
+    return (a.fileID==b.fileID) && (a.measID==b.measID) && (a.protName==b.protName) && (a.patName==b.patName)
+        && (a.size==b.size) && (a.sizeOnDisk==b.sizeOnDisk)
+        && (a.creationTime==b.creationTime) && (a.closingTime==b.closingTime);
+}
+
+
+int benchmarkRaidListing(QByteArray listing, QString name, int iterations)
+{
+    QList<rdsRaidEntry> stringEntries;
+    QList<rdsRaidEntry> byteEntries;
+
+    // Check that both parsers produce the same entries
+    if ((!parseRaidListingStrings(listing, stringEntries)) || (!parseRaidListingBytes(listing, byteEntries)))
+    {
+        printf("Error! Unable to parse listing %s\n", qPrintable(name));
+        return 1;
+    }
+
+    if (stringEntries.count()!=byteEntries.count())
+    {
+        printf("Error! Entry count differs (%d vs. %d)\n", stringEntries.count(), byteEntries.count());
+        return 1;
+    }
+
+    for (int i=0; i<stringEntries.count(); i++)
+    {
+        if (!isSameRaidEntry(stringEntries.at(i), byteEntries.at(i)))
+        {
+            printf("Error! Results differ for fileID %d\n", stringEntries.at(i).fileID);
+            return 1;
+        }
+    }
+
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int j=0; j<iterations; j++)
+    {
+        stringEntries.clear();
+        parseRaidListingStrings(listing, stringEntries);
+    }
+    double stringTime=double(timer.nsecsElapsed())/1000000.0/iterations;
+
+    timer.restart();
+    for (int j=0; j<iterations; j++)
+    {
+        byteEntries.clear();
+        parseRaidListingBytes(listing, byteEntries);
+    }
+    double byteTime=double(timer.nsecsElapsed())/1000000.0/iterations;
+
+    printf("%-12s %7d entries   QString: %9.2f ms   Bytes: %9.2f ms   Speedup: %.1fx\n",
+           qPrintable(name), byteEntries.count(), stringTime, byteTime, stringTime/qMax(byteTime, 0.001));
+
+    return 0;
+}
+
+
+int benchmarkRaidParser(QString filename, int iterations)
+{
+    // Use a listing captured from the RaidSimulator (RaidSimulator -d -n 50000 > listing.txt)
+    // or the RaidTool if provided, otherwise generate listings in the same format
+    if (!filename.isEmpty())
+    {
+        QFile listingFile(filename);
+
+        if (!listingFile.open(QIODevice::ReadOnly))
+        {
+            printf("Error! Unable to open listing %s\n", qPrintable(filename));
+            return 1;
+        }
+
+        return benchmarkRaidListing(listingFile.readAll(), QFileInfo(filename).fileName(), iterations);
+    }
+
+    static const int counts[] = { 1000, 10000, 50000 };
+
+    for (int i=0; i<3; i++)
+    {
+        if (benchmarkRaidListing(createRaidListing(counts[i]), QString("Simulator %1k").arg(counts[i]/1000), iterations)!=0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// Approach used by the SAC before the yctTWIXProbe: The header of the last measurement
+// is read with readLine, and each line is searched for both tags with indexOf
+#define BENCHMARK_ANALYZE_MAXLINES  30000
+#define BENCHMARK_ANALYZE_MAXLENGTH 1024
+
+void analyzeWithReadLine(QString filename, QString& patientName, QString& protocolName)
+{
+    QByteArray protID="<ParamString.\"tProtocolName\">";
+    QByteArray patID ="<ParamString.\"tPatientName\">";
+
+    patientName ="";
+    protocolName="";
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    uint32_t x[2];
+    file.read((char*)x, 2*sizeof(uint32_t));
+
+    if ((x[0]==0) && (x[1]<=64))
+    {
+        uint32_t ndset=0;
+        file.read((char*)&ndset, sizeof(uint32_t));
+
+        if ((ndset>=1) && (ndset<=30))
+        {
+            std::vector<VD::EntryHeader> veh(ndset);
+
+            for (size_t i=0; i<ndset; ++i)
+            {
+                file.read((char*)&veh[i], VD::ENTRY_HEADER_LEN);
+            }
+            file.seek(veh.back().MeasOffset);
+        }
+    }
+    else
+    {
+        file.seek(0);
+    }
+
+    bool patientFound=false;
+    bool protocolFound=false;
+
+    for (int i=0; (i<BENCHMARK_ANALYZE_MAXLINES) && (!file.atEnd()); i++)
+    {
+        QByteArray line=file.readLine(BENCHMARK_ANALYZE_MAXLENGTH);
+        int idx=-1;
+
+        if ((!protocolFound) && ((idx=line.indexOf(protID))!=-1))
+        {
+            protocolFound=true;
+            line.remove(0, idx+protID.length());
+            line.remove(0, line.indexOf("\"")+1);
+            line.truncate(line.indexOf("\""));
+            protocolName=QString(line);
+        }
+
+        if ((!patientFound) && ((idx=line.indexOf(patID))!=-1))
+        {
+            patientFound=true;
+            line.remove(0, idx+patID.length());
+            line.remove(0, line.indexOf("\"")+1);
+            line.truncate(line.indexOf("\""));
+            patientName=QString(line);
+        }
+
+        if (patientFound && protocolFound)
+        {
+            break;
+        }
+    }
+}
+
+
+int benchmarkProbe(QString folder, int iterations)
+{
+    // Note: The files are read from the page cache after the first iteration, so the
+    // times mostly reflect the parsing and the number of read calls
+    QFileInfoList files=QDir(folder).entryInfoList(QStringList() << "*.dat", QDir::Files, QDir::Name);
+
+    if (files.isEmpty())
+    {
+        printf("Error! No TWIX files (*.dat) found in %s\n", qPrintable(folder));
+        return 1;
+    }
+
+    qint64 totalSize=0;
+
+    // Check that both approaches find the same names for every file
+    for (int i=0; i<files.count(); i++)
+    {
+        QString patientName, protocolName;
+        analyzeWithReadLine(files.at(i).absoluteFilePath(), patientName, protocolName);
+
+        yctTWIXProbe probe;
+        probe.probe(files.at(i).absoluteFilePath());
+
+        if ((probe.patientName!=patientName) || (probe.protocolName!=protocolName))
+        {
+            printf("Error! Results differ for file %s\n", qPrintable(files.at(i).fileName()));
+            return 1;
+        }
+
+        totalSize+=files.at(i).size();
+    }
+
+    printf("%d files, %.1f MB, %d iterations\n\n", files.count(), double(totalSize)/1048576.0, iterations);
+
+    QElapsedTimer timer;
+    QString       patientName, protocolName;
+
+    timer.start();
+    for (int j=0; j<iterations; j++)
+    {
+        for (int i=0; i<files.count(); i++)
+        {
+            analyzeWithReadLine(files.at(i).absoluteFilePath(), patientName, protocolName);
+        }
+    }
+    double readLineTime=double(timer.nsecsElapsed())/1000000.0/iterations;
+
+    timer.restart();
+    for (int j=0; j<iterations; j++)
+    {
+        for (int i=0; i<files.count(); i++)
+        {
+            yctTWIXProbe probe;
+            probe.probe(files.at(i).absoluteFilePath());
+        }
+    }
+    double probeTime=double(timer.nsecsElapsed())/1000000.0/iterations;
+
+    printf("readLine:  %9.2f ms  (%7.3f ms per file)\n", readLineTime, readLineTime/files.count());
+    printf("Probe:     %9.2f ms  (%7.3f ms per file)\n", probeTime, probeTime/files.count());
+    printf("Speedup:   %.1fx\n", readLineTime/qMax(probeTime, 0.001));
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    printf("\nYarra Client Tools - Benchmark %s\n", YCT_BENCHMARK_VER);
+    printf("-----------------------------------\n\n");
+
+    if (argc < 2)
+    {
+        printf("Usage:    yct_benchmark matcher [size in MB] [iterations]\n");
+        printf("Purpose:  Compare the tag search of the anonymizer with repeated indexOf calls on a\n");
+        printf("          synthetic XProtocol header (default: 5 MB, 10 iterations)\n\n");
+        printf("Usage:    yct_benchmark raidparser [iterations] [listing file]\n");
+        printf("Purpose:  Compare the RAID directory parser with the QString-based parsing for\n");
+        printf("          RaidSimulator listings of 1k/10k/50k entries (default: 10 iterations)\n\n");
+        printf("Usage:    yct_benchmark probe [folder] [iterations]\n");
+        printf("Purpose:  Compare the TWIX probe with the line-by-line header analysis for all\n");
+        printf("          TWIX files (*.dat) in the folder (default: 10 iterations)\n");
+        return 0;
+    }
+
+    std::string cmd(argv[1]);
+
+    if (cmd=="matcher")
+    {
+        int sizeMB    =5;
+        int iterations=10;
+
+        if (argc > 2)
+        {
+            sizeMB=qMax(1, atoi(argv[2]));
+        }
+        if (argc > 3)
+        {
+            iterations=qMax(1, atoi(argv[3]));
+        }
+
+        return benchmarkMatcher(sizeMB, iterations);
+    }
+
+    if (cmd=="raidparser")
+    {
+        int     iterations=10;
+        QString filename="";
+
+        if (argc > 2)
+        {
+            iterations=qMax(1, atoi(argv[2]));
+        }
+        if (argc > 3)
+        {
+            filename=QString::fromLocal8Bit(argv[3]);
+        }
+
+        return benchmarkRaidParser(filename, iterations);
+    }
+
+    if (cmd=="probe")
+    {
+        int iterations=10;
+
+        if (argc < 3)
+        {
+            printf("Error! Folder missing\n");
+            return 1;
+        }
+        if (argc > 3)
+        {
+            iterations=qMax(1, atoi(argv[3]));
+        }
+
+        return benchmarkProbe(QString::fromLocal8Bit(argv[2]), iterations);
+    }
+
+    printf("Error! Unknown option\n");
+    return 1;
+}
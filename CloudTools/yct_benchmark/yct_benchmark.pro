@@ -0,0 +1,25 @@
+QT += core
+QT -= gui
+
+CONFIG += c++11
+
+TARGET = yct_benchmark
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += main.cpp \
+           ../yct_prepare/yct_twix_tagmatcher.cpp \
+           ../yct_prepare/yct_twix_probe.cpp \
+           ../../Client/rds_raidparser.cpp
+
+HEADERS += \
+    ../yct_prepare/yct_twix_tagmatcher.h \
+    ../yct_prepare/yct_twix_probe.h \
+    ../yct_prepare/yct_twix_header.h \
+    ../../Client/rds_raidparser.h
+
+
+
+
@@ -7,6 +7,7 @@
 #define YCT_API_REGION          "us-east-1"
 #define YCT_INI_NAME            "/yct.ini"
 #define YCT_INCOMPLETE_FILE     "INCOMPLETE"
+#define YCT_DELIVERED_FILE      "DELIVERED"
 
 #define YCT_CLOUDFOLDER_OUT     "/cloud/out"
 #define YCT_CLOUDFOLDER_IN      "/cloud/in"
@@ -21,6 +22,15 @@
 #define YCT_HELPER_TIMEOUT          300000
 #define YCT_HELPER_TIMEOUT_TRANSFER 1800000
 
+#define YCT_WORKERS_UPLOAD   1
+#define YCT_WORKERS_DOWNLOAD 2
+#define YCT_WORKERS_STORAGE  1
+#define YCT_WORKERS_MAX      8
+
+#define YCT_TRANSFER_PARTS   4
+#define YCT_DRIVE_COPY_FILES 4
+#define YCT_DRIVE_FOLDER_RETRIES 5
+
 #define YCT_TIMEPT_CREATED            "LOG/CREATED"
 #define YCT_TIMEPT_COMPLETED          "LOG/COMPLETED"
 #define YCT_TIMEPT_UPLOAD_BEGIN       "LOG/UPLOAD_BEGIN"
@@ -13,6 +13,14 @@ yctConfiguration::yctConfiguration()
     proxyPort    =8000;
     proxyUsername="";
     proxyPassword="";
+
+    uploadWorkers  =YCT_WORKERS_UPLOAD;
+    downloadWorkers=YCT_WORKERS_DOWNLOAD;
+    storageWorkers =YCT_WORKERS_STORAGE;
+
+    nativeTransfer  =false;
+    transferEndpoint="";
+    transferParts   =YCT_TRANSFER_PARTS;
 }
 
 
@@ -32,6 +40,14 @@ bool yctConfiguration::loadConfiguration()
     proxyUsername=settings.value("Proxy/Username","").toString();
     proxyPassword=settings.value("Proxy/Password","").toString();
 
+    uploadWorkers  =settings.value("Workers/Upload",  YCT_WORKERS_UPLOAD).toInt();
+    downloadWorkers=settings.value("Workers/Download",YCT_WORKERS_DOWNLOAD).toInt();
+    storageWorkers =settings.value("Workers/Storage", YCT_WORKERS_STORAGE).toInt();
+
+    nativeTransfer  =settings.value("Transfer/Native",false).toBool();
+    transferEndpoint=settings.value("Transfer/Endpoint","").toString();
+    transferParts   =settings.value("Transfer/Parts",YCT_TRANSFER_PARTS).toInt();
+
     configureProxy();
 
     return true;
@@ -54,6 +70,14 @@ bool yctConfiguration::saveConfiguration()
     settings.setValue("Proxy/Username", proxyUsername);
     settings.setValue("Proxy/Password", proxyPassword);
 
+    settings.setValue("Workers/Upload",   uploadWorkers);
+    settings.setValue("Workers/Download", downloadWorkers);
+    settings.setValue("Workers/Storage",  storageWorkers);
+
+    settings.setValue("Transfer/Native",   nativeTransfer);
+    settings.setValue("Transfer/Endpoint", transferEndpoint);
+    settings.setValue("Transfer/Parts",    transferParts);
+
     configureProxy();
 
     return true;
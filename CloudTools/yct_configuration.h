@@ -19,6 +19,14 @@ public:
     QString proxyUsername;
     QString proxyPassword;
 
+    int     uploadWorkers;
+    int     downloadWorkers;
+    int     storageWorkers;
+
+    bool    nativeTransfer;
+    QString transferEndpoint;
+    int     transferParts;
+
     bool loadConfiguration();
     bool saveConfiguration();
 
@@ -0,0 +1,737 @@
+#include "yct_dicompatcher.h"
+
+
+#define YCT_DICOM_TAG_CHARSET      0x00080005
+#define YCT_DICOM_TAG_TRANSFERUID  0x00020010
+#define YCT_DICOM_TAG_ITEM         0xFFFEE000
+#define YCT_DICOM_TAG_ITEMEND      0xFFFEE00D
+#define YCT_DICOM_TAG_SEQEND       0xFFFEE0DD
+
+#define YCT_DICOM_TS_IMPLICIT      "1.2.840.10008.1.2"
+#define YCT_DICOM_TS_BIGENDIAN     "1.2.840.10008.1.2.2"
+#define YCT_DICOM_TS_DEFLATED      "1.2.840.10008.1.2.1.99"
+
+
+// Runnable for patching and verifying one file on the thread pool
+class yctDICOMPatchTask : public QRunnable
+{
+public:
+
+    yctDICOMPatchTask(const yctDICOMPatcher& settings, QString dicomFilename)
+    {
+        patcher =settings;
+        filename=dicomFilename;
+        result  =false;
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        result=patcher.patchFile(filename) && patcher.verifyFile(filename);
+    }
+
+    yctDICOMPatcher patcher;
+    QString         filename;
+    bool            result;
+};
+
+
+yctDICOMPatcher::yctDICOMPatcher()
+{
+    errorReason="";
+    failedFiles.clear();
+    targets.clear();
+}
+
+
+void yctDICOMPatcher::setValue(quint16 group, quint16 element, QString vr, QString value)
+{
+    Target target;
+    target.tag  =(quint32(group) << 16) | element;
+    target.vr   =vr;
+    target.value=value;
+
+    targets.insert(target.tag, target);
+}
+
+
+bool yctDICOMPatcher::patchFolder(QString path, QStringList nameFilters, int threadCount)
+{
+    errorReason="";
+    failedFiles.clear();
+
+    QDir dir(path);
+    QFileInfoList fileList=dir.entryInfoList(nameFilters, QDir::Files);
+
+    if (fileList.isEmpty())
+    {
+        errorReason="No DICOM files found in "+path;
+        return false;
+    }
+
+    QList<yctDICOMPatchTask*> tasks;
+
+    for (int i=0; i<fileList.count(); i++)
+    {
+        tasks.append(new yctDICOMPatchTask(*this, fileList.at(i).absoluteFilePath()));
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount>0 ? threadCount : qMax(QThread::idealThreadCount(), 1));
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        pool.start(tasks.at(i));
+    }
+    pool.waitForDone();
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        if (!tasks.at(i)->result)
+        {
+            failedFiles.append(tasks.at(i)->filename);
+
+            if (errorReason.isEmpty())
+            {
+                errorReason=tasks.at(i)->patcher.errorReason;
+            }
+        }
+
+        delete tasks.at(i);
+    }
+    tasks.clear();
+
+    return failedFiles.isEmpty();
+}
+
+
+bool yctDICOMPatcher::patchFile(QString filename)
+{
+    errorReason="";
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errorReason="Unable to open file "+filename;
+        return false;
+    }
+
+    QByteArray buffer;
+    qint64     datasetOffset=0;
+    bool       explicitVR=true;
+
+    if (!readHeader(file, buffer, datasetOffset, explicitVR))
+    {
+        errorReason+=" ("+filename+")";
+        return false;
+    }
+
+    qint64      fileSize=file.size();
+    QByteArray  output;
+    qint64      copyFrom=0;
+    ParseResult result=PARSE_MOREDATA;
+
+    while (result==PARSE_MOREDATA)
+    {
+        result=patchDataset(buffer, fileSize, datasetOffset, explicitVR, output, copyFrom);
+
+        if (result==PARSE_MOREDATA)
+        {
+            // The elements extend beyond the part that has been read. Read more and start again.
+            QByteArray data=file.read(qMax(buffer.size(), YCT_DICOMPATCHER_BUFFER));
+
+            if (data.isEmpty())
+            {
+                result=PARSE_ERROR;
+            }
+            buffer.append(data);
+        }
+    }
+
+    if (result==PARSE_ERROR)
+    {
+        if (errorReason.isEmpty())
+        {
+            errorReason="Unable to parse DICOM file";
+        }
+        errorReason+=" ("+filename+")";
+        return false;
+    }
+
+    // Write the patched beginning and copy the rest of the file. The original file
+    // is only replaced if everything has been written.
+    QSaveFile outFile(filename);
+
+    if (!outFile.open(QIODevice::WriteOnly))
+    {
+        errorReason="Unable to write file "+filename;
+        return false;
+    }
+
+    bool writeError=(outFile.write(output)!=output.size());
+
+    if ((!writeError) && (!file.seek(copyFrom)))
+    {
+        writeError=true;
+    }
+
+    while ((!writeError) && (!file.atEnd()))
+    {
+        QByteArray chunk=file.read(YCT_DICOMPATCHER_CHUNK);
+
+        if ((chunk.isEmpty()) || (outFile.write(chunk)!=chunk.size()))
+        {
+            writeError=true;
+        }
+    }
+
+    file.close();
+
+    if (writeError)
+    {
+        outFile.cancelWriting();
+        errorReason="Error while writing file "+filename;
+        return false;
+    }
+
+    if (!outFile.commit())
+    {
+        errorReason="Unable to replace file "+filename;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool yctDICOMPatcher::verifyFile(QString filename)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errorReason="Unable to open file for verification "+filename;
+        return false;
+    }
+
+    QByteArray buffer;
+    qint64     datasetOffset=0;
+    bool       explicitVR=true;
+
+    if (!readHeader(file, buffer, datasetOffset, explicitVR))
+    {
+        errorReason+=" ("+filename+")";
+        return false;
+    }
+
+    qint64      fileSize=file.size();
+    ParseResult result=PARSE_MOREDATA;
+
+    while (result==PARSE_MOREDATA)
+    {
+        result=verifyDataset(buffer, fileSize, datasetOffset, explicitVR);
+
+        if (result==PARSE_MOREDATA)
+        {
+            QByteArray data=file.read(qMax(buffer.size(), YCT_DICOMPATCHER_BUFFER));
+
+            if (data.isEmpty())
+            {
+                result=PARSE_ERROR;
+            }
+            buffer.append(data);
+        }
+    }
+
+    if (result!=PARSE_OK)
+    {
+        errorReason="Verification failed for file "+filename;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool yctDICOMPatcher::readHeader(QFile& file, QByteArray& buffer, qint64& datasetOffset, bool& explicitVR)
+{
+    buffer=file.read(YCT_DICOMPATCHER_BUFFER);
+
+    // 128 bytes preamble followed by the DICM prefix
+    if ((buffer.size()<132) || (buffer.mid(128,4)!="DICM"))
+    {
+        errorReason="File is not in DICOM format";
+        return false;
+    }
+
+    // The file meta information is always explicit VR little endian
+    qint64     pos=132;
+    QByteArray transferSyntax="";
+
+    while (true)
+    {
+        Element elem;
+        ParseResult result=readElement(buffer, pos, buffer.size(), true, elem);
+
+        if ((result!=PARSE_OK) || (elem.group!=0x0002))
+        {
+            break;
+        }
+
+        if (pos+elem.headerSize+elem.length>buffer.size())
+        {
+            errorReason="Invalid DICOM meta information";
+            return false;
+        }
+
+        if (elem.tag==YCT_DICOM_TAG_TRANSFERUID)
+        {
+            transferSyntax=buffer.mid(pos+elem.headerSize, elem.length);
+
+            while ((transferSyntax.endsWith('\0')) || (transferSyntax.endsWith(' ')))
+            {
+                transferSyntax.chop(1);
+            }
+        }
+
+        pos+=elem.headerSize+elem.length;
+    }
+
+    if (transferSyntax.isEmpty())
+    {
+        errorReason="Missing transfer syntax";
+        return false;
+    }
+
+    if ((transferSyntax==YCT_DICOM_TS_BIGENDIAN) || (transferSyntax==YCT_DICOM_TS_DEFLATED))
+    {
+        errorReason="Unsupported transfer syntax "+QString(transferSyntax);
+        return false;
+    }
+
+    explicitVR   =(transferSyntax!=YCT_DICOM_TS_IMPLICIT);
+    datasetOffset=pos;
+
+    return true;
+}
+
+
+yctDICOMPatcher::ParseResult yctDICOMPatcher::patchDataset(const QByteArray& buffer, qint64 fileSize, qint64 datasetOffset, bool explicitVR,
+                                                           QByteArray& output, qint64& copyFrom)
+{
+    output  =buffer.left(datasetOffset);
+    copyFrom=datasetOffset;
+
+    qint64 pos =datasetOffset;
+    bool   utf8=false;
+
+    // Output position of the (retired) group length elements and the change of the group lengths
+    QMap<quint16, qint64> groupLengthOffsets;
+    QMap<quint16, qint64> groupDeltas;
+
+    QMap<quint32, Target>::const_iterator target=targets.constBegin();
+
+    while (target!=targets.constEnd())
+    {
+        Element     elem;
+        ParseResult result=readElement(buffer, pos, fileSize, explicitVR, elem);
+
+        if ((result==PARSE_MOREDATA) || (result==PARSE_ERROR))
+        {
+            return result;
+        }
+
+        quint32 tag=(result==PARSE_END) ? 0xFFFFFFFF : elem.tag;
+
+        // Skipped elements might end beyond the part that has been read
+        if (pos>buffer.size())
+        {
+            return PARSE_MOREDATA;
+        }
+
+        output.append(buffer.mid(copyFrom, pos-copyFrom));
+        copyFrom=pos;
+
+        // Insert the missing elements that belong before the current one
+        while ((target!=targets.constEnd()) && (target.key()<tag))
+        {
+            QByteArray encoded=encodeElement(target.value(), explicitVR, utf8);
+
+            if (encoded.isEmpty())
+            {
+                return PARSE_ERROR;
+            }
+
+            output.append(encoded);
+            groupDeltas[quint16(target.key() >> 16)]+=encoded.size();
+            target++;
+        }
+
+        if (result==PARSE_END)
+        {
+            break;
+        }
+
+        if ((target!=targets.constEnd()) && (target.key()==tag))
+        {
+            // Replace the existing element
+            QByteArray encoded=encodeElement(target.value(), explicitVR, utf8);
+
+            if (encoded.isEmpty())
+            {
+                return PARSE_ERROR;
+            }
+
+            qint64 next=pos;
+            result=skipElement(buffer, next, fileSize, explicitVR);
+
+            if (result!=PARSE_OK)
+            {
+                return result;
+            }
+
+            output.append(encoded);
+            groupDeltas[elem.group]+=encoded.size()-(next-pos);
+
+            pos     =next;
+            copyFrom=next;
+            target++;
+            continue;
+        }
+
+        if ((elem.element==0x0000) && (elem.length==4))
+        {
+            groupLengthOffsets.insert(elem.group, output.size()+elem.headerSize);
+        }
+
+        if (elem.tag==YCT_DICOM_TAG_CHARSET)
+        {
+            if (pos+elem.headerSize+elem.length>buffer.size())
+            {
+                return PARSE_MOREDATA;
+            }
+
+            utf8=buffer.mid(pos+elem.headerSize, elem.length).contains("ISO_IR 192");
+        }
+
+        result=skipElement(buffer, pos, fileSize, explicitVR);
+
+        if (result!=PARSE_OK)
+        {
+            return result;
+        }
+    }
+
+    QMapIterator<quint16, qint64> i(groupLengthOffsets);
+    while (i.hasNext())
+    {
+        i.next();
+
+        quint32 groupLength=quint32(readUInt32(output, i.value())+groupDeltas.value(i.key(), 0));
+        qToLittleEndian<quint32>(groupLength, (uchar*) output.data()+i.value());
+    }
+
+    return PARSE_OK;
+}
+
+
+yctDICOMPatcher::ParseResult yctDICOMPatcher::verifyDataset(const QByteArray& buffer, qint64 fileSize, qint64 datasetOffset, bool explicitVR)
+{
+    qint64 pos  =datasetOffset;
+    bool   utf8 =false;
+    int    found=0;
+
+    while (found<targets.count())
+    {
+        Element     elem;
+        ParseResult result=readElement(buffer, pos, fileSize, explicitVR, elem);
+
+        if (result!=PARSE_OK)
+        {
+            return (result==PARSE_END) ? PARSE_ERROR : result;
+        }
+
+        if ((elem.tag==YCT_DICOM_TAG_CHARSET) || (targets.contains(elem.tag)))
+        {
+            if (pos+elem.headerSize+elem.length>buffer.size())
+            {
+                return PARSE_MOREDATA;
+            }
+
+            QByteArray value=buffer.mid(pos+elem.headerSize, elem.length);
+
+            if (elem.tag==YCT_DICOM_TAG_CHARSET)
+            {
+                utf8=value.contains("ISO_IR 192");
+            }
+            else
+            {
+                if (value!=encodeValue(targets.value(elem.tag), utf8))
+                {
+                    return PARSE_ERROR;
+                }
+                found++;
+            }
+        }
+
+        if (elem.tag>targets.lastKey())
+        {
+            return PARSE_ERROR;
+        }
+
+        result=skipElement(buffer, pos, fileSize, explicitVR);
+
+        if (result!=PARSE_OK)
+        {
+            return result;
+        }
+    }
+
+    return PARSE_OK;
+}
+
+
+yctDICOMPatcher::ParseResult yctDICOMPatcher::readElement(const QByteArray& buffer, qint64 pos, qint64 fileSize, bool explicitVR, Element& elem)
+{
+    if (pos>=fileSize)
+    {
+        return (pos==fileSize) ? PARSE_END : PARSE_ERROR;
+    }
+
+    if (pos+8>buffer.size())
+    {
+        return (buffer.size()<fileSize) ? PARSE_MOREDATA : PARSE_ERROR;
+    }
+
+    elem.group          =readUInt16(buffer, pos);
+    elem.element        =readUInt16(buffer, pos+2);
+    elem.tag            =(quint32(elem.group) << 16) | elem.element;
+    elem.vr             ="";
+    elem.headerSize     =8;
+    elem.undefinedLength=false;
+
+    if (elem.group==0xFFFE)
+    {
+        // Items and delimiters never have a VR
+        elem.length=readUInt32(buffer, pos+4);
+    }
+    else
+    {
+        if (explicitVR)
+        {
+            elem.vr=buffer.mid(pos+4, 2);
+
+            if (isLongVR(elem.vr))
+            {
+                if (pos+12>buffer.size())
+                {
+                    return (buffer.size()<fileSize) ? PARSE_MOREDATA : PARSE_ERROR;
+                }
+
+                elem.length    =readUInt32(buffer, pos+8);
+                elem.headerSize=12;
+            }
+            else
+            {
+                elem.length=readUInt16(buffer, pos+6);
+            }
+        }
+        else
+        {
+            elem.length=readUInt32(buffer, pos+4);
+        }
+    }
+
+    elem.undefinedLength=(elem.length==0xFFFFFFFF);
+
+    if ((!elem.undefinedLength) && (pos+elem.headerSize+qint64(elem.length)>fileSize))
+    {
+        return PARSE_ERROR;
+    }
+
+    return PARSE_OK;
+}
+
+
+yctDICOMPatcher::ParseResult yctDICOMPatcher::skipElement(const QByteArray& buffer, qint64& pos, qint64 fileSize, bool explicitVR)
+{
+    Element     elem;
+    ParseResult result=readElement(buffer, pos, fileSize, explicitVR, elem);
+
+    if (result!=PARSE_OK)
+    {
+        return (result==PARSE_END) ? PARSE_ERROR : result;
+    }
+
+    if (!elem.undefinedLength)
+    {
+        pos+=elem.headerSize+qint64(elem.length);
+        return PARSE_OK;
+    }
+
+    // Sequence or encapsulated pixel data with undefined length. The content of
+    // UN elements is always encoded as implicit VR.
+    bool   itemExplicitVR=explicitVR && (elem.vr!="UN");
+    qint64 itemPos=pos+elem.headerSize;
+
+    while (true)
+    {
+        Element item;
+        result=readElement(buffer, itemPos, fileSize, itemExplicitVR, item);
+
+        if (result!=PARSE_OK)
+        {
+            return (result==PARSE_END) ? PARSE_ERROR : result;
+        }
+
+        if (item.tag==YCT_DICOM_TAG_SEQEND)
+        {
+            pos=itemPos+8;
+            return PARSE_OK;
+        }
+
+        if (item.tag!=YCT_DICOM_TAG_ITEM)
+        {
+            return PARSE_ERROR;
+        }
+
+        if (!item.undefinedLength)
+        {
+            itemPos+=8+qint64(item.length);
+            continue;
+        }
+
+        // Item with undefined length ends with an item delimiter
+        itemPos+=8;
+
+        while (true)
+        {
+            Element nested;
+            result=readElement(buffer, itemPos, fileSize, itemExplicitVR, nested);
+
+            if (result!=PARSE_OK)
+            {
+                return (result==PARSE_END) ? PARSE_ERROR : result;
+            }
+
+            if (nested.tag==YCT_DICOM_TAG_ITEMEND)
+            {
+                itemPos+=8;
+                break;
+            }
+
+            result=skipElement(buffer, itemPos, fileSize, itemExplicitVR);
+
+            if (result!=PARSE_OK)
+            {
+                return result;
+            }
+        }
+    }
+}
+
+
+QByteArray yctDICOMPatcher::encodeValue(const Target& target, bool utf8)
+{
+    QByteArray value=utf8 ? target.value.toUtf8() : target.value.toLatin1();
+
+    // Values must have an even length. Text values are padded with a space.
+    if (value.size() % 2)
+    {
+        value.append(' ');
+    }
+
+    return value;
+}
+
+
+QByteArray yctDICOMPatcher::encodeElement(const Target& target, bool explicitVR, bool utf8)
+{
+    // Without the UTF-8 character set, the values are written as Latin-1. Other characters
+    // would be replaced, so the file is rejected and the caller falls back to dcmodify.
+    if ((!utf8) && (!isLatin1(target.value)))
+    {
+        errorReason="Value not representable in character set of file";
+        return QByteArray();
+    }
+
+    QByteArray value=encodeValue(target, utf8);
+    QByteArray vr   =target.vr.toLatin1();
+    QByteArray data;
+
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream << quint16(target.tag >> 16) << quint16(target.tag & 0xFFFF);
+
+    if (explicitVR)
+    {
+        stream.writeRawData(vr.constData(), 2);
+
+        if (isLongVR(vr))
+        {
+            stream << quint16(0) << quint32(value.size());
+        }
+        else
+        {
+            if (value.size()>0xFFFF)
+            {
+                errorReason="Value too long for element";
+                return QByteArray();
+            }
+
+            stream << quint16(value.size());
+        }
+    }
+    else
+    {
+        stream << quint32(value.size());
+    }
+
+    stream.writeRawData(value.constData(), value.size());
+
+    return data;
+}
+
+
+quint16 yctDICOMPatcher::readUInt16(const QByteArray& buffer, qint64 pos)
+{
+    return qFromLittleEndian<quint16>((const uchar*) buffer.constData()+pos);
+}
+
+
+quint32 yctDICOMPatcher::readUInt32(const QByteArray& buffer, qint64 pos)
+{
+    return qFromLittleEndian<quint32>((const uchar*) buffer.constData()+pos);
+}
+
+
+bool yctDICOMPatcher::isLatin1(const QString& value)
+{
+    for (int i=0; i<value.length(); i++)
+    {
+        if (value.at(i).unicode()>0xFF)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool yctDICOMPatcher::isLongVR(const QByteArray& vr)
+{
+    static const char* longVRs[]={ "OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV" };
+
+    for (unsigned int i=0; i<sizeof(longVRs)/sizeof(longVRs[0]); i++)
+    {
+        if (vr==longVRs[i])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
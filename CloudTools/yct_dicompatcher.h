@@ -0,0 +1,86 @@
+#ifndef YCTDICOMPATCHER_H
+#define YCTDICOMPATCHER_H
+
+#include <QtCore>
+
+
+#define YCT_DICOMPATCHER_BUFFER  65536
+#define YCT_DICOMPATCHER_CHUNK   1048576
+
+
+// Writes a few top-level elements (e.g., the patient module) into DICOM files without
+// calling dcmodify. Only the beginning of each file is parsed until the elements have
+// been written. The rest of the file (e.g., the pixel data) is copied unchanged, and the
+// file is replaced atomically when it has been written completely.
+//
+// Explicit and implicit VR little endian files are supported, including encapsulated
+// (compressed) pixel data. Big endian and deflated files are rejected, so that the
+// caller can fall back to dcmodify. The same applies to values with characters outside
+// of Latin-1 if the file doesn't use the UTF-8 character set (ISO_IR 192).
+class yctDICOMPatcher
+{
+public:
+
+    yctDICOMPatcher();
+
+    // Element to write. Existing elements are replaced, missing elements are inserted.
+    void setValue(quint16 group, quint16 element, QString vr, QString value);
+
+    bool patchFile(QString filename);
+    bool verifyFile(QString filename);
+
+    // Patches and verifies all matching files of the folder on a thread pool
+    bool patchFolder(QString path, QStringList nameFilters, int threadCount=0);
+
+    QString     errorReason;
+    QStringList failedFiles;
+
+protected:
+
+    class Target
+    {
+    public:
+        quint32 tag;
+        QString vr;
+        QString value;
+    };
+
+    class Element
+    {
+    public:
+        quint16    group;
+        quint16    element;
+        quint32    tag;
+        QByteArray vr;
+        quint32    length;
+        int        headerSize;
+        bool       undefinedLength;
+    };
+
+    enum ParseResult
+    {
+        PARSE_OK=0,
+        PARSE_MOREDATA,
+        PARSE_END,
+        PARSE_ERROR
+    };
+
+    bool        readHeader(QFile& file, QByteArray& buffer, qint64& datasetOffset, bool& explicitVR);
+    ParseResult patchDataset(const QByteArray& buffer, qint64 fileSize, qint64 datasetOffset, bool explicitVR,
+                             QByteArray& output, qint64& copyFrom);
+    ParseResult verifyDataset(const QByteArray& buffer, qint64 fileSize, qint64 datasetOffset, bool explicitVR);
+    ParseResult readElement(const QByteArray& buffer, qint64 pos, qint64 fileSize, bool explicitVR, Element& elem);
+    ParseResult skipElement(const QByteArray& buffer, qint64& pos, qint64 fileSize, bool explicitVR);
+    QByteArray  encodeElement(const Target& target, bool explicitVR, bool utf8);
+    QByteArray  encodeValue(const Target& target, bool utf8);
+
+    static quint16 readUInt16(const QByteArray& buffer, qint64 pos);
+    static quint32 readUInt32(const QByteArray& buffer, qint64 pos);
+    static bool    isLongVR(const QByteArray& vr);
+    static bool    isLatin1(const QString& value);
+
+    QMap<quint32, Target> targets;
+};
+
+
+#endif // YCTDICOMPATCHER_H
@@ -0,0 +1,382 @@
+#include <QtCore>
+#include <stdio.h>
+
+#include "yct_dicompatcher.h"
+
+
+// Test of the DICOM patcher with small explicit and implicit VR little endian files. The
+// files are written by the test, and the patched files are compared byte by byte with
+// files that contain the new values from the start.
+
+#define TEST_TS_EXPLICIT   "1.2.840.10008.1.2.1"
+#define TEST_TS_IMPLICIT   "1.2.840.10008.1.2"
+#define TEST_TS_BIGENDIAN  "1.2.840.10008.1.2.2"
+
+#define TEST_LARGESIZE     100000
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+static QByteArray uint16LE(quint16 value)
+{
+    QByteArray data(2, '\0');
+    qToLittleEndian<quint16>(value, (uchar*) data.data());
+    return data;
+}
+
+
+static QByteArray uint32LE(quint32 value)
+{
+    QByteArray data(4, '\0');
+    qToLittleEndian<quint32>(value, (uchar*) data.data());
+    return data;
+}
+
+
+static void appendElement(QByteArray& data, quint16 group, quint16 element, QByteArray vr, QByteArray value, bool explicitVR)
+{
+    // Values must have an even length
+    if (value.size() % 2)
+    {
+        value.append(' ');
+    }
+
+    data.append(uint16LE(group) + uint16LE(element));
+
+    if (explicitVR)
+    {
+        data.append(vr);
+
+        if ((vr=="OB") || (vr=="OW") || (vr=="SQ") || (vr=="UN") || (vr=="UT"))
+        {
+            data.append(uint16LE(0) + uint32LE(value.size()));
+        }
+        else
+        {
+            data.append(uint16LE(value.size()));
+        }
+    }
+    else
+    {
+        data.append(uint32LE(value.size()));
+    }
+
+    data.append(value);
+}
+
+
+static QByteArray createItem(QByteArray content, bool undefinedLength)
+{
+    QByteArray data=uint16LE(0xFFFE) + uint16LE(0xE000);
+
+    if (undefinedLength)
+    {
+        data.append(uint32LE(0xFFFFFFFF) + content);
+        data.append(uint16LE(0xFFFE) + uint16LE(0xE00D) + uint32LE(0));
+    }
+    else
+    {
+        data.append(uint32LE(content.size()) + content);
+    }
+
+    return data;
+}
+
+
+static void appendSequence(QByteArray& data, quint16 group, quint16 element, QByteArray items, bool explicitVR)
+{
+    data.append(uint16LE(group) + uint16LE(element));
+
+    if (explicitVR)
+    {
+        data.append(QByteArray("SQ") + uint16LE(0));
+    }
+
+    data.append(uint32LE(0xFFFFFFFF) + items);
+    data.append(uint16LE(0xFFFE) + uint16LE(0xE0DD) + uint32LE(0));
+}
+
+
+// Creates a file with a sequence of undefined length and a large private element in
+// front of the patient module. Elements with an empty value are left out.
+static QByteArray createFile(bool explicitVR, QByteArray charset, QByteArray name, QByteArray id, QByteArray sex)
+{
+    QByteArray dataset;
+    appendElement(dataset, 0x0008, 0x0005, "CS", charset, explicitVR);
+
+    // Referenced series with a patient name, which must not be patched
+    QByteArray nested;
+    appendElement(nested, 0x0010, 0x0010, "PN", "NESTED^NAME", explicitVR);
+    appendSequence(dataset, 0x0008, 0x1115, createItem(nested, true) + createItem(nested, false), explicitVR);
+
+    appendElement(dataset, 0x0009, 0x1010, "OB", QByteArray(TEST_LARGESIZE, '\x11'), explicitVR);
+
+    QByteArray patient;
+    appendElement(patient, 0x0010, 0x0010, "PN", name, explicitVR);
+
+    if (!id.isEmpty())
+    {
+        appendElement(patient, 0x0010, 0x0020, "LO", id, explicitVR);
+    }
+
+    appendElement(patient, 0x0010, 0x0030, "DA", "19700101", explicitVR);
+
+    if (!sex.isEmpty())
+    {
+        appendElement(patient, 0x0010, 0x0040, "CS", sex, explicitVR);
+    }
+
+    appendElement(dataset, 0x0010, 0x0000, "UL", uint32LE(patient.size()), explicitVR);
+    dataset.append(patient);
+
+    appendElement(dataset, 0x7FE0, 0x0010, "OW", QByteArray(64, '\x5A'), explicitVR);
+
+    // The file meta information is always explicit VR
+    QByteArray transferSyntax=explicitVR ? TEST_TS_EXPLICIT : TEST_TS_IMPLICIT;
+
+    if (transferSyntax.size() % 2)
+    {
+        transferSyntax.append('\0');
+    }
+
+    QByteArray meta;
+    appendElement(meta, 0x0002, 0x0010, "UI", transferSyntax, true);
+
+    QByteArray file(128, '\0');
+    file.append("DICM");
+    appendElement(file, 0x0002, 0x0000, "UL", uint32LE(meta.size()), true);
+    file.append(meta);
+    file.append(dataset);
+
+    return file;
+}
+
+
+static bool writeFile(QString filename, QByteArray data)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    bool success=(file.write(data)==data.size());
+    file.close();
+
+    return success;
+}
+
+
+static QByteArray readFile(QString filename)
+{
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+
+    return file.readAll();
+}
+
+
+static void setPatientValues(yctDICOMPatcher& patcher, QString name)
+{
+    patcher.setValue(0x0010, 0x0040, "CS", "F");
+    patcher.setValue(0x0010, 0x0010, "PN", name);
+    patcher.setValue(0x0010, 0x0020, "LO", "ID12345");
+}
+
+
+int testPatch(QDir tempDir, bool explicitVR)
+{
+    printf("%s\n", explicitVR ? "Explicit VR little endian" : "Implicit VR little endian");
+
+    QString filename=tempDir.absoluteFilePath(explicitVR ? "explicit.dcm" : "implicit.dcm");
+
+    if (!writeFile(filename, createFile(explicitVR, "ISO_IR 100", "OLD^NAME", "", "")))
+    {
+        check(false, "Test file written");
+        return 1;
+    }
+
+    yctDICOMPatcher patcher;
+    setPatientValues(patcher, "DOE^JANE");
+
+    bool patched=patcher.patchFile(filename);
+
+    if (!patched)
+    {
+        printf("  %s\n", qPrintable(patcher.errorReason));
+    }
+
+    // Name replaced, ID inserted between name and birth date, sex inserted behind the
+    // last element of the group, group length updated, and nested name left unchanged
+    QByteArray expected=createFile(explicitVR, "ISO_IR 100", "DOE^JANE", "ID12345", "F");
+    QByteArray result  =readFile(filename);
+
+    check(patched,                           "File patched");
+    check(result.size()==expected.size(),    "Size matches");
+    check(result==expected,                  "Elements replaced and inserted, group length updated");
+    check(patcher.verifyFile(filename),      "Verification passed");
+
+    // Patching again only replaces the elements
+    check(patcher.patchFile(filename) && (readFile(filename)==expected), "Patching again keeps the file");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testCharacterSet(QDir tempDir)
+{
+    printf("Character set\n");
+
+    // Latin-1 characters are written as Latin-1 if the file doesn't use UTF-8
+    QString latin1Name=QString::fromUtf8("M\xC3\xBCller^J\xC3\xB6rg");
+    QString otherName =QString::fromUtf8("Kowalczyk^\xC5\x81ukasz");
+
+    QString filename=tempDir.absoluteFilePath("latin1.dcm");
+    writeFile(filename, createFile(true, "ISO_IR 100", "OLD^NAME", "", ""));
+
+    yctDICOMPatcher patcher;
+    setPatientValues(patcher, latin1Name);
+
+    check(patcher.patchFile(filename) && (readFile(filename)==createFile(true, "ISO_IR 100", latin1Name.toLatin1(), "ID12345", "F")),
+          "Latin-1 value written as Latin-1");
+
+    // Other characters can't be written without UTF-8, so the caller has to fall back to dcmodify
+    QByteArray original=createFile(true, "ISO_IR 100", "OLD^NAME", "", "");
+    writeFile(filename, original);
+
+    setPatientValues(patcher, otherName);
+    bool patched=patcher.patchFile(filename);
+
+    printf("  %s\n", qPrintable(patcher.errorReason));
+
+    check(!patched,                                        "Non-Latin-1 value rejected");
+    check(patcher.errorReason.contains("character set"),   "Error reason set");
+    check(readFile(filename)==original,                    "File left unchanged");
+
+    // Files with UTF-8 character set take all values
+    filename=tempDir.absoluteFilePath("utf8.dcm");
+    writeFile(filename, createFile(false, "ISO_IR 192", "OLD^NAME", "", ""));
+
+    check(patcher.patchFile(filename) && (readFile(filename)==createFile(false, "ISO_IR 192", otherName.toUtf8(), "ID12345", "F")),
+          "Non-Latin-1 value written as UTF-8");
+    check(patcher.verifyFile(filename),                    "Verification passed");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testVerification(QDir tempDir)
+{
+    printf("Verification\n");
+
+    QString filename=tempDir.absoluteFilePath("verify.dcm");
+    writeFile(filename, createFile(true, "ISO_IR 100", "OLD^NAME", "", ""));
+
+    yctDICOMPatcher patcher;
+    setPatientValues(patcher, "DOE^JANE");
+
+    check(!patcher.verifyFile(filename),  "Unpatched file rejected");
+
+    patcher.patchFile(filename);
+
+    yctDICOMPatcher otherPatcher;
+    setPatientValues(otherPatcher, "DOE^JOHN");
+
+    check(patcher.verifyFile(filename),         "Patched file accepted");
+    check(!otherPatcher.verifyFile(filename),   "Mismatching value rejected");
+
+    // Big endian files are rejected, so that the caller falls back to dcmodify
+    QByteArray bigEndian=createFile(true, "ISO_IR 100", "OLD^NAME", "", "");
+    bigEndian.replace(TEST_TS_EXPLICIT, TEST_TS_BIGENDIAN);
+    writeFile(filename, bigEndian);
+
+    check(!patcher.patchFile(filename) && patcher.errorReason.contains("Unsupported transfer syntax"), "Big endian file rejected");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testFolder(QDir tempDir)
+{
+    printf("Folder on thread pool\n");
+
+    tempDir.mkdir("folder");
+    QDir folder(tempDir.absoluteFilePath("folder"));
+
+    for (int i=0; i<8; i++)
+    {
+        writeFile(folder.absoluteFilePath("image" + QString::number(i) + ".dcm"), createFile(i % 2, "ISO_IR 100", "OLD^NAME", "ID00000", ""));
+    }
+
+    yctDICOMPatcher patcher;
+    setPatientValues(patcher, "DOE^JANE");
+
+    bool patched=patcher.patchFolder(folder.absolutePath(), QStringList("*.dcm"), 3);
+    bool filesMatch=true;
+
+    for (int i=0; i<8; i++)
+    {
+        if (readFile(folder.absoluteFilePath("image" + QString::number(i) + ".dcm"))!=createFile(i % 2, "ISO_IR 100", "DOE^JANE", "ID12345", "F"))
+        {
+            filesMatch=false;
+        }
+    }
+
+    check(patched && patcher.failedFiles.isEmpty(), "Folder patched");
+    check(filesMatch,                               "All files patched");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    printf("\nYarra Cloud - DICOM Patcher Test\n");
+    printf("--------------------------------\n\n");
+
+    QTemporaryDir tempDir;
+
+    if (!tempDir.isValid())
+    {
+        printf("Unable to create temporary folder\n");
+        return 1;
+    }
+
+    QDir testDir(tempDir.path());
+
+    testPatch(testDir, true);
+    testPatch(testDir, false);
+    testCharacterSet(testDir);
+    testVerification(testDir);
+    testFolder(testDir);
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Test of the DICOM patcher with small explicit and implicit VR files
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = yct_dicompatcher_test
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += yct_dicompatcher_test.cpp \
+    yct_dicompatcher.cpp
+
+HEADERS += \
+    yct_dicompatcher.h
@@ -3,8 +3,9 @@
 #include <QString>
 
 #include "../yct_prepare/yct_twix_anonymizer.h"
+#include "../yct_prepare/yct_twix_probe.h"
 
-#define YCT_DUMPPROT_VER "0.1b5"
+#define YCT_DUMPPROT_VER "0.1b6"
 
 
 int main(int argc, char *argv[])
@@ -29,17 +30,52 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    yctTWIXAnonymizer anonymizer;
-    anonymizer.testing=true;
-    anonymizer.setStrictVersionChecking(false);
-
     std::string cmd(argv[1]);
     if (cmd=="info")
     {
-        anonymizer.showOnlyInfo=true;
+        // Only the measurement table and the header of the last measurement are read
         printf("Filename: %s\n",filename.toStdString().c_str());
+
+        yctTWIXProbe probe;
+        if (!probe.probe(filename))
+        {
+            printf("\nError! Unable to parse file %s (%s)\n",filename.toStdString().c_str(),probe.errorReason.toStdString().c_str());
+            return 1;
+        }
+
+        if (probe.fileVersion==yctTWIXProbe::VDVE)
+        {
+            printf("Format: VD/VE line\n");
+        }
+        else
+        {
+            printf("Format: VB line\n");
+        }
+        printf("Size: %.1f MB\n",double(probe.fileSize)/1048576.0);
+        printf("Protocols: %d\n",probe.measurements.count());
+
+        for (int i=0; i<probe.measurements.count(); i++)
+        {
+            if (probe.fileVersion==yctTWIXProbe::VDVE)
+            {
+                printf("- %s (MeasID %u, %.1f MB)\n",probe.measurements.at(i).protocolName.toStdString().c_str(),
+                       probe.measurements.at(i).measID,double(probe.measurements.at(i).length)/1048576.0);
+            }
+            else
+            {
+                printf("- Only main scan data\n");
+            }
+        }
+
+        printf("Header size: %lld bytes\n",probe.headerLength);
+        printf("Protocol name: %s\n",probe.protocolName.toStdString().c_str());
+        return 0;
     }
-    else
+
+    yctTWIXAnonymizer anonymizer;
+    anonymizer.testing=true;
+    anonymizer.setStrictVersionChecking(false);
+
     if (cmd=="dump")
     {
         anonymizer.dumpProtocol=true;
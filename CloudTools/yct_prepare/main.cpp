@@ -18,6 +18,8 @@ int main(int argc, char *argv[])
         printf("Options: --testing  Only test the processing but don't modify file\n");
         printf("         --debug    Output additional debug information\n");
         printf("         --dump     Dump the protocol from the TWIX file\n");
+        printf("         --nomap    Read the header line-by-line instead of memory-mapping it\n");
+        printf("         --serial   Process multiple measurements one after another\n");
         printf("\n");
 
         return 0;
@@ -68,6 +70,18 @@ int main(int argc, char *argv[])
             twixAnonymizer.dumpProtocol=true;
         }
 
+        if (options.contains("--nomap",Qt::CaseInsensitive))
+        {
+            printf("Using streaming mode.\n");
+            twixAnonymizer.useMemoryMapping=false;
+        }
+
+        if (options.contains("--serial",Qt::CaseInsensitive))
+        {
+            printf("Using serial processing.\n");
+            twixAnonymizer.useParallelProcessing=false;
+        }
+
         QString uuid=QUuid::createUuid().toString();
         QString acc=QString::fromLocal8Bit(argv[3]);
         QFileInfo filename(rawFilename);
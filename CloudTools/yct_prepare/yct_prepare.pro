@@ -16,8 +16,10 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp \
-    yct_twix_anonymizer.cpp
+    yct_twix_anonymizer.cpp \
+    yct_twix_tagmatcher.cpp
 
 HEADERS += \
     yct_twix_anonymizer.h \
+    yct_twix_tagmatcher.h \
     yct_twix_header.h
@@ -6,6 +6,7 @@
 
 #include "yct_twix_anonymizer.h"
 #include "yct_twix_header.h"
+#include "yct_twix_tagmatcher.h"
 #include "../yct_common.h"
 
 
@@ -15,6 +16,105 @@
 #define DBG(x) if (debug) {std::cout << x << std::endl;}
 
 
+// Tags searched by analyzeLine(). The order of the enum must match the pattern list.
+enum AnalyzeTag
+{
+    TAG_PARAM_TPATIENTNAME = 0,
+    TAG_PARAM_PATIENTNAME,
+    TAG_PARAM_PATIENTSNAME,
+    TAG_PARAM_PATIENTBIRTHDAY,
+    TAG_PARAM_PATIENTID,
+    TAG_PARAM_PATIENT,
+    TAG_PARAM_TPERFPHYSICIANSNAME,
+    TAG_PARAM_SOFTWAREVERSIONS,
+    TAG_PARAM_PATIENTREGISTRATIONDATA,
+    TAG_HEADER_TPATIENTNAME,
+    TAG_RECOMPOSE_TPATIENTNAME,
+    TAG_RECOMPOSE_PATIENTBIRTHDAY,
+    TAG_RECOMPOSE_PATIENTID,
+    TAG_PATIENTNAME,
+    TAG_PATIENTSNAME,
+    TAG_BIRTHDAY,
+    TAG_PATIENTID,
+    TAG_PATIENTREGISTRATIONDATA,
+    TAG_PARAM_DEVICESERIALNUMBER,
+    TAG_PARAM_FLUSEDPATIENTWEIGHT,
+    TAG_PARAM_LPATIENTSEX,
+    TAG_COUNT
+};
+
+static const char* const analyzeTags[TAG_COUNT] =
+{
+    "<ParamString.\"tPatientName\">",
+    "<ParamString.\"PatientName\">",
+    "<ParamString.\"PatientsName\">",
+    "<ParamString.\"PatientBirthDay\">",
+    "<ParamString.\"PatientID\">",
+    "<ParamString.\"Patient\">",
+    "<ParamString.\"tPerfPhysiciansName\">",
+    "<ParamString.\"SoftwareVersions\">",
+    "<ParamArray.\"PatientRegistrationData\">",
+    "HEADER.tPatientName",
+    "IRIS.RECOMPOSE.tPatientName",
+    "IRIS.RECOMPOSE.PatientBirthDay",
+    "IRIS.RECOMPOSE.PatientID",
+    "PatientName",
+    "PatientsName",
+    "BirthDay",
+    "PatientID",
+    "PatientRegistrationData",
+    "<ParamString.\"DeviceSerialNumber\">",
+    "<ParamDouble.\"flUsedPatientWeight\">",
+    "<ParamLong.\"lPatientSex\">"
+};
+
+// Runnable for processing one measurement of a VD/VE file on the thread pool
+class yctMeasurementTask : public QRunnable
+{
+public:
+
+    yctMeasurementTask(yctTWIXAnonymizer* anonymizer, QString twixFilename, qint64 measOffset)
+    {
+        worker  =anonymizer;
+        filename=twixFilename;
+        offset  =measOffset;
+        result  =false;
+        setAutoDelete(false);
+    }
+
+    ~yctMeasurementTask()
+    {
+        delete worker;
+        worker=0;
+    }
+
+    void run()
+    {
+        QFile file(filename);
+
+        if (!file.open(worker->testing ? QIODevice::ReadOnly : QIODevice::ReadWrite))
+        {
+            worker->errorReason="Unable to open raw-data file for parallel processing";
+            result=false;
+            return;
+        }
+
+        file.seek(offset);
+        result=worker->processMeasurement(&file);
+        file.close();
+    }
+
+    yctTWIXAnonymizer* worker;
+    QString            filename;
+    qint64             offset;
+    bool               result;
+};
+
+
+// The automaton is compiled once per process and shared by all anonymizer instances
+Q_GLOBAL_STATIC_WITH_ARGS(yctTagMatcher, analyzeTagMatcher, (analyzeTags, TAG_COUNT))
+
+
 yctTWIXAnonymizer::yctTWIXAnonymizer()
 {
     errorReason="";
@@ -22,6 +122,8 @@ yctTWIXAnonymizer::yctTWIXAnonymizer()
     testing=false;
     dumpProtocol=false;
     showOnlyInfo=false;
+    useMemoryMapping=true;
+    useParallelProcessing=true;
 
     fileVersion=UNKNOWN;
     strictVersionChecking=true;
@@ -165,17 +267,34 @@ bool yctTWIXAnonymizer::processFile(QString twixFilename, QString phiPath,
         }
         DBG("");
 
-        // Process the individual measurements in the file
-        for (size_t i=0; i<ndset; ++i)
+        // Process the individual measurements in the file. The headers of the measurements
+        // don't overlap, so they can be processed concurrently if there are several.
+        if (useParallelProcessing && (ndset>1) && (!dumpProtocol))
         {
-            // Jump to ith measurement
-            file.seek(veh.at(i).MeasOffset);
-            result=processMeasurement(&file);
+            QList<qint64> measOffsets;
+            for (size_t i=0; i<ndset; ++i)
+            {
+                measOffsets.append((qint64) veh.at(i).MeasOffset);
+            }
 
-            if (!result)
+            // Make sure that the cleaned measurement table has been written before
+            // the workers open their own file handles
+            file.flush();
+            result=processMeasurementsParallel(twixFilename, measOffsets);
+        }
+        else
+        {
+            for (size_t i=0; i<ndset; ++i)
             {
-                LOG("ERROR: Error while processing section " << i);
-                break;
+                // Jump to ith measurement
+                file.seek(veh.at(i).MeasOffset);
+                result=processMeasurement(&file);
+
+                if (!result)
+                {
+                    LOG("ERROR: Error while processing section " << i);
+                    break;
+                }
             }
         }
 
@@ -247,11 +366,191 @@ bool yctTWIXAnonymizer::processMeasurement(QFile* file)
 
     headerEnd=headerStart + (qint64) headerLength;
 
+    if (useMemoryMapping)
+    {
+        // Map the complete header into memory, so that it can be scanned and patched
+        // in a single pass without seek/write round-trips for every modified line
+        uchar* header=file->map(headerStart, (qint64) headerLength);
+
+        if (header!=0)
+        {
+            bool result=processMappedHeader(header, (qint64) headerLength);
+            file->unmap(header);
+            file->seek(headerEnd);
+            return result;
+        }
+
+        DBG("Unable to map header into memory. Falling back to streaming mode.");
+        file->seek(headerStart + (qint64) sizeof(uint32_t));
+    }
+
+    return processStreamedHeader(file, headerEnd);
+}
+
+
+bool yctTWIXAnonymizer::processMeasurementsParallel(QString twixFilename, QList<qint64> measOffsets)
+{
+    // Each measurement is processed by a separate anonymizer instance with its own file handle
+    QList<yctMeasurementTask*> tasks;
+
+    for (int i=0; i<measOffsets.count(); i++)
+    {
+        yctTWIXAnonymizer* worker=new yctTWIXAnonymizer();
+        worker->debug                           =debug;
+        worker->testing                         =testing;
+        worker->useMemoryMapping                =useMemoryMapping;
+        worker->strictVersionChecking           =strictVersionChecking;
+        worker->readAdditionalPatientInformation=readAdditionalPatientInformation;
+        worker->fileVersion                     =fileVersion;
+        worker->patientInformation.fillStr      =patientInformation.fillStr;
+
+        tasks.append(new yctMeasurementTask(worker, twixFilename, measOffsets.at(i)));
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(measOffsets.count(), qMax(QThread::idealThreadCount(), 1)));
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        pool.start(tasks.at(i));
+    }
+    pool.waitForDone();
+
+    // Merge the results in the order of the measurement table, so that the same patient
+    // information is kept as with sequential processing (the first value found wins).
+    // Results of measurements after a failed one are ignored, as they would not have
+    // been processed sequentially.
+    bool result=true;
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        yctTWIXAnonymizer* worker=tasks.at(i)->worker;
+
+        if (worker->versionStringSeen)
+        {
+            versionStringSeen=true;
+        }
+
+        if (patientInformation.name.isEmpty())
+        {
+            patientInformation.name=worker->patientInformation.name;
+        }
+        if (patientInformation.dateOfBirth.isEmpty())
+        {
+            patientInformation.dateOfBirth=worker->patientInformation.dateOfBirth;
+        }
+        if (patientInformation.mrn.isEmpty())
+        {
+            patientInformation.mrn=worker->patientInformation.mrn;
+        }
+        if (patientInformation.serialNumber.isEmpty())
+        {
+            patientInformation.serialNumber=worker->patientInformation.serialNumber;
+        }
+        if (patientInformation.patientWeight.isEmpty())
+        {
+            patientInformation.patientWeight=worker->patientInformation.patientWeight;
+        }
+        if (patientInformation.patientSex.isEmpty())
+        {
+            patientInformation.patientSex=worker->patientInformation.patientSex;
+        }
+
+        if (!tasks.at(i)->result)
+        {
+            LOG("ERROR: Error while processing section " << i);
+            if (!worker->errorReason.isEmpty())
+            {
+                errorReason=worker->errorReason;
+            }
+            result=false;
+            break;
+        }
+    }
+
+    qDeleteAll(tasks);
+    tasks.clear();
+
+    return result;
+}
+
+
+bool yctTWIXAnonymizer::processMappedHeader(uchar* header, qint64 headerLength)
+{
+    // The line buffer is allocated only once per measurement. Each line is copied into it,
+    // so that the analysis functions can be used unchanged. Changed lines are copied back
+    // into the mapped region, which updates the file when the region is unmapped.
+    QByteArray line;
+    line.reserve(MAX_LINE_LENGTH);
+
+    bool   waitingForSensitiveData=false;
+    bool   lineModified=false;
+    qint64 lineStart=sizeof(uint32_t);
+
+    while (lineStart < headerLength)
+    {
+        qint64 charsToRead=MAX_LINE_LENGTH;
+        if (lineStart+charsToRead>=headerLength)
+        {
+            charsToRead=headerLength-lineStart;
+        }
+
+        const uchar* lineData=header+lineStart;
+        const uchar* lineBreak=(const uchar*) memchr(lineData, '\n', (size_t) charsToRead);
+
+        qint64 lineLength=charsToRead;
+        if (lineBreak!=0)
+        {
+            lineLength=(lineBreak-lineData)+1;
+        }
+
+        if (lineLength>=MAX_LINE_LENGTH)
+        {
+            LOG("ERROR: Incomplete line read (exceeds buffer size)");
+            LOG("ERROR: Anonymization not possible. Report error to Yarra team.");
+            return false;
+        }
+
+        line.resize((int) lineLength);
+        memcpy(line.data(), lineData, (size_t) lineLength);
+
+        if (dumpProtocol)
+        {
+            dumpFile.write(line);
+        }
+
+        if (!processHeaderLine(&line, &waitingForSensitiveData, &lineModified))
+        {
+            return false;
+        }
+
+        if (lineModified && (!testing))
+        {
+            // Check whether the anonymized line still fits into the original line
+            if (line.size()!=lineLength)
+            {
+                LOG("WARNING: File inconsistency detected during anonymization!");
+                LOG("WARNING: Anonymization might not be complete. Discard file.");
+            }
+
+            memcpy(header+lineStart, line.constData(), (size_t) qMin((qint64) line.size(), lineLength));
+        }
+
+        lineStart+=lineLength;
+    }
+
+    return true;
+}
+
+
+bool yctTWIXAnonymizer::processStreamedHeader(QFile* file, qint64 headerEnd)
+{
     QByteArray line="";
     qint64     lineStart=0;
     qint64     lineEnd  =0;
     bool       isLineValid=false;
     bool       waitingForSensitiveData=false;
+    bool       lineModified=false;
     bool       terminateParsing=false;
     int        charsToRead=0;
     //int      maxRead=0;
@@ -304,48 +603,14 @@ bool yctTWIXAnonymizer::processMeasurement(QFile* file)
         }
         lineEnd=file->pos();
 
-        int result=NO_SENSITIVE_INFORMATION;
-
         if (isLineValid)
         {
-            if (waitingForSensitiveData)
+            if (!processHeaderLine(&line, &waitingForSensitiveData, &lineModified))
             {
-                // It is expected that this line contains sensitive information following a line break
-                result=analyzeFollowLine(&line);
-
-                if (result==PROCESSING_ERROR)
-                {
-                    LOG("Error while processing follow line:");
-                    LOG(line.data());
-                    return false;
-                }
-
-                if ((result==SENSITIVE_INFORMATION_CLEARED) || (result==NO_SENSITIVE_INFORMATION))
-                {
-                    // Sensitive information cleared, continue normally for next line
-                    waitingForSensitiveData=false;
-                }
-            }
-            else
-            {
-                // Process line
-                result=analyzeLine(&line);
-
-                if (result==PROCESSING_ERROR)
-                {
-                    LOG("Error while processing line:");
-                    LOG(line.data());
-                    return false;
-                }
-
-                if ((result==SENSITIVE_INFORMATION_FOLLOWS) || (result==SENSITIVE_INFORMATION_CLEARED_FOLLOWS))
-                {
-                    // Sensitive information follows in the next lines
-                    waitingForSensitiveData=true;
-                }
+                return false;
             }
 
-            if ((result==SENSITIVE_INFORMATION_CLEARED) || (result==SENSITIVE_INFORMATION_CLEARED_FOLLOWS))
+            if (lineModified)
             {
                 // Line contains information that has been anonymized.
                 // Write anonymized line back to file.
@@ -377,6 +642,57 @@ bool yctTWIXAnonymizer::processMeasurement(QFile* file)
 }
 
 
+bool yctTWIXAnonymizer::processHeaderLine(QByteArray* line, bool* waitingForSensitiveData, bool* lineModified)
+{
+    int result=NO_SENSITIVE_INFORMATION;
+    *lineModified=false;
+
+    if (*waitingForSensitiveData)
+    {
+        // It is expected that this line contains sensitive information following a line break
+        result=analyzeFollowLine(line);
+
+        if (result==PROCESSING_ERROR)
+        {
+            LOG("Error while processing follow line:");
+            LOG(line->data());
+            return false;
+        }
+
+        if ((result==SENSITIVE_INFORMATION_CLEARED) || (result==NO_SENSITIVE_INFORMATION))
+        {
+            // Sensitive information cleared, continue normally for next line
+            *waitingForSensitiveData=false;
+        }
+    }
+    else
+    {
+        // Process line
+        result=analyzeLine(line);
+
+        if (result==PROCESSING_ERROR)
+        {
+            LOG("Error while processing line:");
+            LOG(line->data());
+            return false;
+        }
+
+        if ((result==SENSITIVE_INFORMATION_FOLLOWS) || (result==SENSITIVE_INFORMATION_CLEARED_FOLLOWS))
+        {
+            // Sensitive information follows in the next lines
+            *waitingForSensitiveData=true;
+        }
+    }
+
+    if ((result==SENSITIVE_INFORMATION_CLEARED) || (result==SENSITIVE_INFORMATION_CLEARED_FOLLOWS))
+    {
+        *lineModified=true;
+    }
+
+    return true;
+}
+
+
 bool yctTWIXAnonymizer::checkAndStorePatientData(QString twixFilename, QString phiPath)
 {
     DBG("");
@@ -436,74 +752,84 @@ bool yctTWIXAnonymizer::checkAndStorePatientData(QString twixFilename, QString p
 
 int yctTWIXAnonymizer::analyzeLine(QByteArray* line)
 {
-    if (line->indexOf("<ParamString.\"tPatientName\">", 0) >= 0)
+    // Find all tags of interest with a single pass over the line. The checks below are
+    // evaluated in the original order, so that the same tag wins if a line contains
+    // more than one of them.
+    const quint32 tags=analyzeTagMatcher()->find(line);
+
+    if (tags==0)
+    {
+        return NO_SENSITIVE_INFORMATION;
+    }
+
+    if (yctTagMatcher::contains(tags, TAG_PARAM_TPATIENTNAME))
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientName\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENTNAME))
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientsName\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENTSNAME))
     {
         expectedContent=CONTENT_NAME;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientBirthDay\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENTBIRTHDAY))
     {
         expectedContent=CONTENT_BIRTHDAY;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"PatientID\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENTID))
     {
         expectedContent=CONTENT_ID;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"Patient\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENT))
     {
         expectedContent=CONTENT_ID;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"tPerfPhysiciansName\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_TPERFPHYSICIANSNAME))
     {
         expectedContent=CONTENT_REFPHYSICIAN;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamString.\"SoftwareVersions\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_SOFTWAREVERSIONS))
     {
         expectedContent=CONTENT_VERSIONSTRING;
         return clearLine(line);
     }
 
-    if (line->indexOf("<ParamArray.\"PatientRegistrationData\">", 0) >= 0)
+    if (yctTagMatcher::contains(tags, TAG_PARAM_PATIENTREGISTRATIONDATA))
     {
         expectedContent=CONTENT_PATIENTREGISTRATION;
         return clearLine(line);
     }
 
-    if (   (line->indexOf("HEADER.tPatientName")            >= 0)
-        || (line->indexOf("IRIS.RECOMPOSE.tPatientName")    >= 0)
-        || (line->indexOf("IRIS.RECOMPOSE.PatientBirthDay") >= 0)
-        || (line->indexOf("IRIS.RECOMPOSE.PatientID")       >= 0))
+    if (   (yctTagMatcher::contains(tags, TAG_HEADER_TPATIENTNAME))
+        || (yctTagMatcher::contains(tags, TAG_RECOMPOSE_TPATIENTNAME))
+        || (yctTagMatcher::contains(tags, TAG_RECOMPOSE_PATIENTBIRTHDAY))
+        || (yctTagMatcher::contains(tags, TAG_RECOMPOSE_PATIENTID)))
     {
         // These two entries don't contain the PHI
         return NO_SENSITIVE_INFORMATION;
     }
 
-    if (   (line->indexOf("PatientName")             >= 0)
-        || (line->indexOf("PatientsName")            >= 0)
-        || (line->indexOf("BirthDay")                >= 0)
-        || (line->indexOf("PatientID")               >= 0)
-        || (line->indexOf("PatientRegistrationData") >= 0))
+    if (   (yctTagMatcher::contains(tags, TAG_PATIENTNAME))
+        || (yctTagMatcher::contains(tags, TAG_PATIENTSNAME))
+        || (yctTagMatcher::contains(tags, TAG_BIRTHDAY))
+        || (yctTagMatcher::contains(tags, TAG_PATIENTID))
+        || (yctTagMatcher::contains(tags, TAG_PATIENTREGISTRATIONDATA)))
     {
         // If unexpected fields with the patient name occur, raise an error
         return PROCESSING_ERROR;
@@ -516,7 +842,7 @@ int yctTWIXAnonymizer::analyzeLine(QByteArray* line)
         QString temp = "";
 
         if ((patientInformation.serialNumber.isEmpty()) &&
-            (line->indexOf("<ParamString.\"DeviceSerialNumber\">", 0) >= 0))
+            (yctTagMatcher::contains(tags, TAG_PARAM_DEVICESERIALNUMBER)))
         {
             if ((startPos >= 0) && (endPos >= 0))
             {
@@ -527,7 +853,7 @@ int yctTWIXAnonymizer::analyzeLine(QByteArray* line)
         }
 
         if ((patientInformation.patientWeight.isEmpty()) &&
-            (line->indexOf("<ParamDouble.\"flUsedPatientWeight\">", 0) >= 0))
+            (yctTagMatcher::contains(tags, TAG_PARAM_FLUSEDPATIENTWEIGHT)))
         {
             if ((startPos >= 0) && (endPos >= 0))
             {
@@ -538,7 +864,7 @@ int yctTWIXAnonymizer::analyzeLine(QByteArray* line)
         }
 
         if ((patientInformation.patientSex.isEmpty()) &&
-            (line->indexOf("<ParamLong.\"lPatientSex\">", 0) >= 0))
+            (yctTagMatcher::contains(tags, TAG_PARAM_LPATIENTSEX)))
         {
             if ((startPos >= 0) && (endPos >= 0))
             {
@@ -4,7 +4,7 @@
 #include <QtCore>
 
 
-#define YCT_TWIXANONYMIZER_VER "0.1e"
+#define YCT_TWIXANONYMIZER_VER "0.1f"
 
 
 class yctPatientInformation
@@ -80,6 +80,10 @@ public:
 
     bool processFile(QString twixFilename, QString phiPath, QString acc, QString taskid, QString uuid, QString mode, bool storePHI=true);
     bool processMeasurement(QFile* file);
+    bool processMeasurementsParallel(QString twixFilename, QList<qint64> measOffsets);
+    bool processMappedHeader(uchar* header, qint64 headerLength);
+    bool processStreamedHeader(QFile* file, qint64 headerEnd);
+    bool processHeaderLine(QByteArray* line, bool* waitingForSensitiveData, bool* lineModified);
     bool checkAndStorePatientData(QString twixFilename, QString phiPath);
 
     int analyzeLine(QByteArray* line);
@@ -95,6 +99,8 @@ public:
     bool    testing;
     bool    dumpProtocol;
     bool    showOnlyInfo;
+    bool    useMemoryMapping;
+    bool    useParallelProcessing;
 
     bool    strictVersionChecking;
     void    setStrictVersionChecking(bool useStrictChecking);
@@ -0,0 +1,250 @@
+#include "yct_twix_probe.h"
+#include "yct_twix_header.h"
+#include "yct_twix_tagmatcher.h"
+
+
+// Tags searched in the XProtocol header. The order must match the pattern list.
+enum ProbeTag
+{
+    PROBE_TAG_PROTOCOLNAME = 0,
+    PROBE_TAG_PATIENTNAME,
+    PROBE_TAG_COUNT
+};
+
+static const char* const probeTags[PROBE_TAG_COUNT] =
+{
+    "<ParamString.\"tProtocolName\">",
+    "<ParamString.\"tPatientName\">"
+};
+
+
+yctTWIXProbe::yctTWIXProbe()
+{
+    fileVersion=UNKNOWN;
+    fileSize=0;
+    headerLength=0;
+
+    protocolName="";
+    patientName="";
+    protocolFound=false;
+    patientFound=false;
+
+    errorReason="";
+}
+
+
+bool yctTWIXProbe::probe(QString filename)
+{
+    fileVersion=UNKNOWN;
+    headerLength=0;
+    protocolName="";
+    patientName="";
+    protocolFound=false;
+    patientFound=false;
+    measurements.clear();
+    errorReason="";
+
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errorReason="Unable to open raw-data file for reading";
+        return false;
+    }
+
+    fileSize=file.size();
+
+    // Determine TWIX file type: VA/VB or VD/VE?
+    uint32_t x[2]={ 0, 0 };
+
+    if (file.read((char*)x, 2*sizeof(uint32_t))!=2*sizeof(uint32_t))
+    {
+        errorReason="File is invalid (too short)";
+        return false;
+    }
+
+    qint64 headerStart=0;
+
+    if ((x[0]==0) && (x[1]<=64))
+    {
+        fileVersion=VDVE;
+
+        if (!readMeasurementTable(file))
+        {
+            return false;
+        }
+
+        // The imaging scan is the last measurement in the file
+        headerStart=measurements.last().offset;
+    }
+    else
+    {
+        fileVersion=VAVB;
+
+        yctTWIXMeasurement measurement;
+        measurement.length=fileSize;
+        measurements.append(measurement);
+    }
+
+    return scanHeader(file, headerStart);
+}
+
+
+bool yctTWIXProbe::readMeasurementTable(QFile& file)
+{
+    uint32_t ndset=0;
+
+    file.seek(sizeof(uint32_t));
+    file.read((char*)&ndset, sizeof(uint32_t));
+
+    if ((ndset<1) || (ndset>YCT_TWIXPROBE_MAXMEAS))
+    {
+        // If there are more than 30 measurements, it's unlikely that the
+        // file is a valid TWIX file
+        errorReason="File is invalid (invalid number of measurements)";
+        return false;
+    }
+
+    // Read the whole table at once
+    QByteArray table=file.read(qint64(ndset)*VD::ENTRY_HEADER_LEN);
+
+    if (table.size()!=int(ndset*VD::ENTRY_HEADER_LEN))
+    {
+        errorReason="File is invalid (measurement table truncated)";
+        return false;
+    }
+
+    for (uint32_t i=0; i<ndset; i++)
+    {
+        VD::EntryHeader entry;
+        memcpy(&entry, table.constData()+i*VD::ENTRY_HEADER_LEN, VD::ENTRY_HEADER_LEN);
+
+        if (entry.MeasOffset>=quint64(fileSize))
+        {
+            errorReason="File is invalid (measurement outside of file)";
+            return false;
+        }
+
+        yctTWIXMeasurement measurement;
+        measurement.measID      =entry.MeasID;
+        measurement.fileID      =entry.FieldID;
+        measurement.offset      =(qint64) entry.MeasOffset;
+        measurement.length      =(qint64) entry.MeasLen;
+        measurement.patientName =readFixedString(entry.PatientName,  sizeof(entry.PatientName));
+        measurement.protocolName=readFixedString(entry.ProtocolName, sizeof(entry.ProtocolName));
+        measurements.append(measurement);
+    }
+
+    return true;
+}
+
+
+bool yctTWIXProbe::scanHeader(QFile& file, qint64 headerStart)
+{
+    uint32_t length=0;
+
+    file.seek(headerStart);
+    file.read((char*)&length, sizeof(uint32_t));
+
+    if ((length<=sizeof(uint32_t)) || (length>YCT_TWIXPROBE_MAXHEADER) || (headerStart+length>fileSize))
+    {
+        errorReason="File is invalid (unusual header size)";
+        return false;
+    }
+
+    headerLength=length;
+
+    // Only the header of the measurement is mapped, not the raw data that follows
+    uchar* header=file.map(headerStart, headerLength);
+
+    if (header!=0)
+    {
+        scanHeaderBlock((const char*) header, (int) headerLength);
+        file.unmap(header);
+    }
+    else
+    {
+        QByteArray buffer;
+        file.seek(headerStart);
+        buffer=file.read(headerLength);
+        scanHeaderBlock(buffer.constData(), buffer.size());
+    }
+
+    if ((!protocolFound) || (!patientFound))
+    {
+        errorReason="Protocol or patient name not found";
+    }
+
+    return true;
+}
+
+
+void yctTWIXProbe::scanHeaderBlock(const char* data, int length)
+{
+    static const yctTagMatcher matcher(probeTags, PROBE_TAG_COUNT);
+
+    // Search the header in blocks, so that the rest of the header isn't touched once
+    // both tags have been found. The blocks overlap, so that tags crossing the block
+    // border are found as well.
+    const int overlap=(int) qMax(strlen(probeTags[0]), strlen(probeTags[1]))-1;
+
+    int blockStart=0;
+
+    while ((blockStart<length) && ((!protocolFound) || (!patientFound)))
+    {
+        const int blockLength=qMin(YCT_TWIXPROBE_CHUNKSIZE, length-blockStart);
+
+        int           positions[PROBE_TAG_COUNT];
+        const quint32 matches=matcher.find(data+blockStart, blockLength, positions);
+
+        if ((!protocolFound) && (yctTagMatcher::contains(matches, PROBE_TAG_PROTOCOLNAME)))
+        {
+            protocolFound=true;
+            protocolName=readValue(data, length, blockStart+positions[PROBE_TAG_PROTOCOLNAME]+int(strlen(probeTags[PROBE_TAG_PROTOCOLNAME])));
+        }
+
+        if ((!patientFound) && (yctTagMatcher::contains(matches, PROBE_TAG_PATIENTNAME)))
+        {
+            patientFound=true;
+            patientName=readValue(data, length, blockStart+positions[PROBE_TAG_PATIENTNAME]+int(strlen(probeTags[PROBE_TAG_PATIENTNAME])));
+        }
+
+        if (blockStart+blockLength>=length)
+        {
+            break;
+        }
+
+        blockStart+=blockLength-overlap;
+    }
+}
+
+
+QString yctTWIXProbe::readValue(const char* data, int length, int pos)
+{
+    // The value is the first quoted string in the rest of the line, e.g.
+    // <ParamString."tProtocolName">  { "t1_mprage"  }
+    int valueStart=-1;
+
+    for (int i=pos; (i<length) && (data[i]!='\n'); i++)
+    {
+        if (data[i]=='"')
+        {
+            if (valueStart==-1)
+            {
+                valueStart=i+1;
+            }
+            else
+            {
+                return QString::fromUtf8(data+valueStart, i-valueStart);
+            }
+        }
+    }
+
+    return "";
+}
+
+
+QString yctTWIXProbe::readFixedString(const char* data, int length)
+{
+    return QString::fromLatin1(data, (int) qstrnlen(data, length));
+}
@@ -0,0 +1,84 @@
+#ifndef YCT_TWIX_PROBE_H
+#define YCT_TWIX_PROBE_H
+
+#include <QtCore>
+
+
+#define YCT_TWIXPROBE_MAXMEAS     30
+#define YCT_TWIXPROBE_MAXHEADER   5000000
+#define YCT_TWIXPROBE_CHUNKSIZE   65536
+
+
+class yctTWIXMeasurement
+{
+public:
+
+    yctTWIXMeasurement()
+    {
+        measID=0;
+        fileID=0;
+        offset=0;
+        length=0;
+        patientName="";
+        protocolName="";
+    }
+
+    quint32 measID;
+    quint32 fileID;
+    qint64  offset;
+    qint64  length;
+
+    // Names from the measurement table (VD/VE only)
+    QString patientName;
+    QString protocolName;
+};
+
+
+// Reads the metadata of a TWIX file without scanning it line by line. For VD/VE files,
+// the measurement table is read with a single read call, and only the XProtocol header
+// of the last measurement (the imaging scan) is mapped into memory. The header is
+// searched for the protocol and patient name in blocks with the tag automaton, and the
+// search stops as soon as both have been found. The file is opened read-only, and the
+// probe can be used from several threads with separate instances.
+class yctTWIXProbe
+{
+public:
+
+    enum FileVersionType
+    {
+        UNKNOWN=0,
+        VAVB,
+        VDVE
+    };
+
+    yctTWIXProbe();
+
+    bool probe(QString filename);
+
+    FileVersionType fileVersion;
+    qint64          fileSize;
+    qint64          headerLength;
+
+    // Values from the XProtocol header of the last measurement
+    QString protocolName;
+    QString patientName;
+    bool    protocolFound;
+    bool    patientFound;
+
+    QList<yctTWIXMeasurement> measurements;
+
+    QString errorReason;
+
+protected:
+
+    bool readMeasurementTable(QFile& file);
+    bool scanHeader(QFile& file, qint64 headerStart);
+    void scanHeaderBlock(const char* data, int length);
+
+    static QString readValue(const char* data, int length, int pos);
+    static QString readFixedString(const char* data, int length);
+
+};
+
+
+#endif // YCT_TWIX_PROBE_H
@@ -0,0 +1,140 @@
+#include "yct_twix_tagmatcher.h"
+
+
+yctTagMatcher::yctTagMatcher(const char* const* patterns, int count)
+{
+    patternCount=qMin(count, (int) MAX_PATTERNS);
+
+    // Reduce the alphabet to the characters that actually occur in the patterns. All
+    // other characters share class 0, which keeps the transition table small enough
+    // to stay in the cache while scanning.
+    memset(charClass, 0, sizeof(charClass));
+    classCount=1;
+
+    for (int i=0; i<patternCount; i++)
+    {
+        for (const char* c=patterns[i]; *c!=0; c++)
+        {
+            if (charClass[(uchar) *c]==0)
+            {
+                charClass[(uchar) *c]=(uchar) classCount;
+                classCount++;
+            }
+        }
+    }
+
+    // Build the trie of all patterns. State 0 is the root.
+    transitions.fill(-1, classCount);
+    output.fill(0, 1);
+    patternLength.resize(patternCount);
+
+    for (int i=0; i<patternCount; i++)
+    {
+        int state=0;
+        int length=0;
+
+        for (const char* c=patterns[i]; *c!=0; c++)
+        {
+            const int index=state*classCount+charClass[(uchar) *c];
+
+            if (transitions.at(index)<0)
+            {
+                transitions[index]=output.count();
+                transitions+=QVector<qint32>(classCount, -1);
+                output.append(0);
+            }
+            state=transitions.at(index);
+            length++;
+        }
+
+        output[state] |= quint32(1) << i;
+        patternLength[i]=length;
+    }
+
+    // Compute the failure links in breadth-first order and turn the trie into a complete
+    // automaton, so that scanning needs exactly one table lookup per character
+    QVector<int> failure(output.count(), 0);
+    QQueue<int>  queue;
+
+    for (int c=0; c<classCount; c++)
+    {
+        const int child=transitions.at(c);
+
+        if (child<0)
+        {
+            transitions[c]=0;
+        }
+        else
+        {
+            failure[child]=0;
+            queue.enqueue(child);
+        }
+    }
+
+    while (!queue.isEmpty())
+    {
+        const int state=queue.dequeue();
+
+        for (int c=0; c<classCount; c++)
+        {
+            const int index=state*classCount+c;
+            const int child=transitions.at(index);
+            const int fallback=transitions.at(failure.at(state)*classCount+c);
+
+            if (child<0)
+            {
+                transitions[index]=fallback;
+            }
+            else
+            {
+                failure[child]=fallback;
+                output[child] |= output.at(fallback);
+                queue.enqueue(child);
+            }
+        }
+    }
+}
+
+
+quint32 yctTagMatcher::find(const char* data, int length, int* firstPositions) const
+{
+    quint32 matches=0;
+    int     state=0;
+
+    const qint32*  table=transitions.constData();
+    const quint32* found=output.constData();
+
+    if (firstPositions!=0)
+    {
+        for (int i=0; i<patternCount; i++)
+        {
+            firstPositions[i]=-1;
+        }
+    }
+
+    for (int i=0; i<length; i++)
+    {
+        state=table[state*classCount+charClass[(uchar) data[i]]];
+
+        if (found[state]!=0)
+        {
+            if (firstPositions!=0)
+            {
+                // Store the start position for patterns that haven't been seen before
+                const quint32 newMatches=found[state] & ~matches;
+
+                for (int j=0; j<patternCount; j++)
+                {
+                    if (contains(newMatches, j))
+                    {
+                        firstPositions[j]=i-patternLength.at(j)+1;
+                    }
+                }
+            }
+
+            matches |= found[state];
+        }
+    }
+
+    return matches;
+}
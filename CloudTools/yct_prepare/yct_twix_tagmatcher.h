@@ -0,0 +1,56 @@
+#ifndef YCT_TWIX_TAGMATCHER_H
+#define YCT_TWIX_TAGMATCHER_H
+
+#include <QtCore>
+
+
+// Multi-pattern matcher (Aho-Corasick automaton) for finding a fixed set of literal
+// tags in the lines of the XProtocol header with a single pass over each line. The
+// automaton is compiled once in the constructor and is read-only afterwards, so that
+// one instance can be shared between threads.
+class yctTagMatcher
+{
+public:
+
+    static const int MAX_PATTERNS=32;
+
+    yctTagMatcher(const char* const* patterns, int count);
+
+    quint32 find(const QByteArray* line, int* firstPositions=0) const;
+    quint32 find(const char* data, int length, int* firstPositions=0) const;
+
+    int getPatternCount() const;
+
+    static bool contains(quint32 matches, int patternID);
+
+protected:
+
+    int              patternCount;
+    int              classCount;
+    uchar            charClass[256];
+    QVector<int>     patternLength;
+    QVector<qint32>  transitions;
+    QVector<quint32> output;
+
+};
+
+
+inline quint32 yctTagMatcher::find(const QByteArray* line, int* firstPositions) const
+{
+    return find(line->constData(), line->size(), firstPositions);
+}
+
+
+inline int yctTagMatcher::getPatternCount() const
+{
+    return patternCount;
+}
+
+
+inline bool yctTagMatcher::contains(quint32 matches, int patternID)
+{
+    return (matches & (quint32(1) << patternID)) != 0;
+}
+
+
+#endif // YCT_TWIX_TAGMATCHER_H
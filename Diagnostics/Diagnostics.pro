@@ -16,11 +16,18 @@ SOURCES += main.cpp \
     ../Client/rds_runtimeinformation.cpp \
     ../Client/rds_configuration.cpp \
     ../Client/rds_raid.cpp \
+    ../Client/rds_raidparser.cpp \
+    ../Client/rds_raidindex.cpp \
     ../Client/rds_log.cpp \
     ../Client/rds_exechelper.cpp \
+    ../Client/rds_processrunner.cpp \
     ../Client/rds_network.cpp \
+    ../Client/rds_copyengine.cpp \
+    ../Client/rds_checksum.cpp \
     ../Client/rds_anonymizeVB17.cpp \
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.cpp \
     ../NetLogger/netlogger.cpp \
+    ../NetLogger/netlog_sender.cpp \
     ../OfflineReconClient/ort_configuration.cpp \
     ../OfflineReconClient/ort_serverlist.cpp \
     yd_mainwindow.cpp \
@@ -38,12 +45,19 @@ HEADERS  += \
     ../Client/rds_runtimeinformation.h \
     ../Client/rds_configuration.h \
     ../Client/rds_raid.h \
+    ../Client/rds_raidparser.h \
+    ../Client/rds_raidindex.h \
     ../Client/rds_log.h \
     ../Client/rds_exechelper.h \
+    ../Client/rds_processrunner.h \
     ../Client/rds_network.h \
+    ../Client/rds_copyengine.h \
+    ../Client/rds_checksum.h \
     ../Client/rds_anonymizeVB17.h \
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.h \
     ../NetLogger/netlogger.h \
     ../NetLogger/netlog_events.h \
+    ../NetLogger/netlog_sender.h \
     ../OfflineReconClient/ort_configuration.h \
     ../OfflineReconClient/ort_serverlist.h \
     yd_mainwindow.h \
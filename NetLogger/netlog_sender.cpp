@@ -0,0 +1,693 @@
+#include "netlog_sender.h"
+#include "netlogger.h"
+
+#include <algorithm>
+
+#ifdef YARRA_APP_RDS
+    #include "rds_global.h"
+#endif
+
+#ifdef YARRA_APP_ORT
+    #include "ort_global.h"
+#endif
+
+#ifdef YARRA_APP_SAC
+    #include "sac_global.h"
+#endif
+
+#ifdef YARRA_APP_DIAGNOSTICS
+    #include "yd_global.h"
+#endif
+
+
+NetLogSender::NetLogSender(NetLogger* parent)
+    : QObject()
+{
+    logger=parent;
+
+    queue.resize(NETLOG_QUEUE_SIZE);
+    queueHead=0;
+    queueCount=0;
+
+    batchFromSpool=false;
+    batchSpoolEnd=0;
+    batchFailed=false;
+
+    spoolFile="";
+    spoolPosition=0;
+
+    offline=false;
+    shuttingDown=false;
+
+    sendTimer.setSingleShot(true);
+    connect(&sendTimer, SIGNAL(timeout()), this, SLOT(sendBatch()));
+
+    timeoutTimer.setSingleShot(true);
+    timeoutTimer.setInterval(NETLOG_POST_TIMEOUT);
+    connect(&timeoutTimer, SIGNAL(timeout()), this, SLOT(batchTimeout()));
+}
+
+
+NetLogSender::~NetLogSender()
+{
+    shutdown();
+}
+
+
+void NetLogSender::setSpoolFile(QString filename)
+{
+    if (filename==spoolFile)
+    {
+        return;
+    }
+
+    spoolFile=filename;
+    spoolPosition=0;
+    spoolDelivered.clear();
+
+    if (spoolFile.isEmpty())
+    {
+        return;
+    }
+
+    // Continue at the first record that has not been delivered during the last run
+    QFile positionFile(spoolFile+NETLOG_SPOOLPOS_EXT);
+
+    if (positionFile.open(QIODevice::ReadOnly))
+    {
+        // The first line is the position, the following lines are the positions of
+        // records behind it that have already been delivered
+        QStringList lines=QString::fromLatin1(positionFile.readAll()).split('\n', QString::SkipEmptyParts);
+        positionFile.close();
+
+        for (int i=0; i<lines.count(); i++)
+        {
+            qint64 position=lines.at(i).trimmed().toLongLong();
+
+            if (i==0)
+            {
+                spoolPosition=position;
+            }
+            else
+            {
+                spoolDelivered.insert(position);
+            }
+        }
+    }
+
+    if ((spoolPosition<0) || (spoolPosition>QFileInfo(spoolFile).size()))
+    {
+        spoolPosition=0;
+        spoolDelivered.clear();
+    }
+
+    // Send the events left from the last run
+    if (QFile::exists(spoolFile))
+    {
+        scheduleBatch(NETLOG_FLUSH_DELAY);
+    }
+}
+
+
+NetLogRecord NetLogSender::createRecord(QString endpoint, QUrlQuery query)
+{
+    // The API key is added when sending, so that it is not written into the
+    // spool and a changed key is used for events that are sent later
+    query.removeAllQueryItems("api_key");
+
+    NetLogRecord record;
+    record.endpoint=endpoint;
+    record.data=NetLogger::encodeQuery(query);
+
+    return record;
+}
+
+
+void NetLogSender::enqueue(QString endpoint, QUrlQuery query)
+{
+    if (shuttingDown)
+    {
+        return;
+    }
+
+    NetLogRecord record=createRecord(endpoint, query);
+
+    // Write directly to the disk while the server is unreachable, so that the
+    // event is kept even if the application is terminated
+    if ((offline) && (appendToSpool(QList<NetLogRecord>() << record)))
+    {
+        return;
+    }
+
+    pushRecord(record);
+    scheduleBatch(NETLOG_FLUSH_DELAY);
+}
+
+
+bool NetLogSender::spool(QString endpoint, QUrlQuery query)
+{
+    if (!appendToSpool(QList<NetLogRecord>() << createRecord(endpoint, query)))
+    {
+        return false;
+    }
+
+    if (!offline)
+    {
+        scheduleBatch(NETLOG_FLUSH_DELAY);
+    }
+
+    return true;
+}
+
+
+void NetLogSender::scheduleBatch(int delayMsec)
+{
+    // If a batch is in progress or a retry is pending, the next batch is
+    // started from there
+    if ((shuttingDown) || (!replies.isEmpty()) || (sendTimer.isActive()))
+    {
+        return;
+    }
+
+    sendTimer.start(delayMsec);
+}
+
+
+void NetLogSender::sendBatch()
+{
+    if ((shuttingDown) || (!replies.isEmpty()) || (!logger->isConfigured()))
+    {
+        return;
+    }
+
+    sendTimer.stop();
+
+    batch.clear();
+    failedRecords.clear();
+    batchFailed=false;
+
+    // Events from the spool are older, so they are sent first
+    batchFromSpool=readFromSpool(batch, batchSpoolOffsets, batchSpoolEnd);
+
+    if (!batchFromSpool)
+    {
+        NetLogRecord record;
+
+        while ((batch.count()<NETLOG_BATCH_SIZE) && (popRecord(record)))
+        {
+            batch.append(record);
+        }
+    }
+
+    if (batch.isEmpty())
+    {
+        return;
+    }
+
+    for (int i=0; i<batch.count(); i++)
+    {
+        QNetworkReply* reply=logger->postEncodedAsync(batch.at(i).data, batch.at(i).endpoint, true);
+
+        if (reply==0)
+        {
+            batchFailed=true;
+            failedRecords.append(i);
+            continue;
+        }
+
+        reply->setProperty("netlogRecord", i);
+        connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+        replies.append(reply);
+    }
+
+    if (replies.isEmpty())
+    {
+        finishBatch();
+        return;
+    }
+
+    timeoutTimer.start();
+}
+
+
+void NetLogSender::replyFinished()
+{
+    QNetworkReply* reply=qobject_cast<QNetworkReply*>(sender());
+
+    if ((reply==0) || (!replies.contains(reply)))
+    {
+        return;
+    }
+
+    int httpStatus=reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if ((reply->error()!=QNetworkReply::NoError) || (httpStatus!=200))
+    {
+        batchFailed=true;
+
+        int index=reply->property("netlogRecord").toInt();
+
+        if ((index>=0) && (index<batch.count()))
+        {
+            failedRecords.append(index);
+        }
+    }
+
+    replies.removeOne(reply);
+    reply->disconnect(this);
+    reply->deleteLater();
+
+    if (replies.isEmpty())
+    {
+        finishBatch();
+    }
+}
+
+
+void NetLogSender::batchTimeout()
+{
+    // Aborting emits finished(), so the replies are released in replyFinished()
+    QList<QNetworkReply*> pendingReplies=replies;
+
+    for (int i=0; i<pendingReplies.count(); i++)
+    {
+        pendingReplies.at(i)->abort();
+    }
+}
+
+
+void NetLogSender::finishBatch()
+{
+    timeoutTimer.stop();
+
+    if (batchFromSpool)
+    {
+        // The spool is advanced up to the first record that failed. Delivered records
+        // behind it are remembered, so that only the failed records are sent again.
+        std::sort(failedRecords.begin(), failedRecords.end());
+
+        if (failedRecords.isEmpty())
+        {
+            advanceSpool(batchSpoolEnd);
+        }
+        else
+        {
+            for (int i=failedRecords.first()+1; i<batch.count(); i++)
+            {
+                if (!failedRecords.contains(i))
+                {
+                    spoolDelivered.insert(batchSpoolOffsets.at(i));
+                }
+            }
+
+            advanceSpool(batchSpoolOffsets.at(failedRecords.first()));
+        }
+    }
+    else
+    {
+        QList<NetLogRecord> records=takeFailedRecords();
+
+        if ((!records.isEmpty()) && (!prependToSpool(records)))
+        {
+            RTI->log("WARNING: Unable to spool " + QString::number(records.count()) + " log server events.");
+        }
+    }
+
+    batch.clear();
+    batchSpoolOffsets.clear();
+    failedRecords.clear();
+
+    if (batchFailed)
+    {
+        if (!offline)
+        {
+            RTI->log("WARNING: Log server not reachable. Spooling events.");
+        }
+
+        offline=true;
+        spillQueue();
+        sendTimer.start(NETLOG_RETRY_INTERVAL);
+    }
+    else
+    {
+        if (offline)
+        {
+            RTI->log("Log server reachable again. Sending spooled events.");
+        }
+
+        offline=false;
+
+        if ((queueCount>0) || (QFile::exists(spoolFile)))
+        {
+            scheduleBatch(0);
+        }
+    }
+
+    emit batchFinished();
+}
+
+
+bool NetLogSender::flush(int timeoutMsec)
+{
+    QElapsedTimer ti;
+    ti.start();
+
+    while (((queueCount>0) || (!replies.isEmpty()) || (QFile::exists(spoolFile))) && (ti.elapsed()<timeoutMsec))
+    {
+        if (replies.isEmpty())
+        {
+            // Don't wait for the retry interval if the server is still down
+            if (offline)
+            {
+                break;
+            }
+
+            sendBatch();
+
+            if (replies.isEmpty())
+            {
+                break;
+            }
+        }
+
+        QEventLoop loop;
+        connect(this, SIGNAL(batchFinished()), &loop, SLOT(quit()));
+        QTimer::singleShot(int(timeoutMsec-ti.elapsed()), &loop, SLOT(quit()));
+        loop.exec();
+    }
+
+    return ((queueCount==0) && (replies.isEmpty()) && (!QFile::exists(spoolFile)));
+}
+
+
+void NetLogSender::shutdown()
+{
+    if (shuttingDown)
+    {
+        return;
+    }
+
+    sendTimer.stop();
+    timeoutTimer.stop();
+
+    // Stop the running requests. Events that have not been confirmed are
+    // written into the spool and sent during the next run.
+    for (int i=0; i<replies.count(); i++)
+    {
+        QNetworkReply* reply=replies.at(i);
+        int index=reply->property("netlogRecord").toInt();
+
+        if ((!batchFromSpool) && (index>=0) && (index<batch.count()))
+        {
+            failedRecords.append(index);
+        }
+
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    if (!batchFromSpool)
+    {
+        QList<NetLogRecord> records=takeFailedRecords();
+
+        if (!records.isEmpty())
+        {
+            prependToSpool(records);
+        }
+    }
+
+    replies.clear();
+    batch.clear();
+    batchSpoolOffsets.clear();
+    failedRecords.clear();
+
+    spillQueue();
+
+    shuttingDown=true;
+}
+
+
+bool NetLogSender::pushRecord(const NetLogRecord& record)
+{
+    // If the buffer is full, the oldest event is moved into the spool
+    if (queueCount==queue.size())
+    {
+        NetLogRecord oldest;
+        popRecord(oldest);
+        appendToSpool(QList<NetLogRecord>() << oldest);
+    }
+
+    queue[(queueHead+queueCount) % queue.size()]=record;
+    queueCount++;
+
+    return true;
+}
+
+
+bool NetLogSender::popRecord(NetLogRecord& record)
+{
+    if (queueCount==0)
+    {
+        return false;
+    }
+
+    record=queue.at(queueHead);
+    queue[queueHead]=NetLogRecord();
+    queueHead=(queueHead+1) % queue.size();
+    queueCount--;
+
+    return true;
+}
+
+
+void NetLogSender::spillQueue()
+{
+    if ((queueCount==0) || (spoolFile.isEmpty()))
+    {
+        return;
+    }
+
+    QList<NetLogRecord> records;
+    NetLogRecord record;
+
+    while (popRecord(record))
+    {
+        records.append(record);
+    }
+
+    if (!appendToSpool(records))
+    {
+        RTI->log("WARNING: Unable to spool " + QString::number(records.count()) + " log server events.");
+    }
+}
+
+
+bool NetLogSender::appendToSpool(const QList<NetLogRecord>& records)
+{
+    if (spoolFile.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(spoolFile);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+
+    QByteArray buffer=encodeRecords(records);
+
+    bool success=(file.write(buffer)==buffer.size());
+    file.close();
+
+    return success;
+}
+
+
+bool NetLogSender::prependToSpool(const QList<NetLogRecord>& records)
+{
+    if (spoolFile.isEmpty())
+    {
+        return false;
+    }
+
+    // A batch from the queue is only sent if the spool is empty. Events in the spool
+    // have been written while the batch was sent, so they are newer than the records.
+    QByteArray spooled;
+    QFile file(spoolFile);
+
+    if (file.exists())
+    {
+        if ((!file.open(QIODevice::ReadOnly)) || (!file.seek(spoolPosition)))
+        {
+            return false;
+        }
+
+        spooled=file.readAll();
+        file.close();
+    }
+
+    QSaveFile newFile(spoolFile);
+
+    if (!newFile.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QByteArray buffer=encodeRecords(records)+spooled;
+
+    if ((newFile.write(buffer)!=buffer.size()) || (!newFile.commit()))
+    {
+        return false;
+    }
+
+    spoolPosition=0;
+    spoolDelivered.clear();
+    QFile::remove(spoolFile+NETLOG_SPOOLPOS_EXT);
+
+    return true;
+}
+
+
+QList<NetLogRecord> NetLogSender::takeFailedRecords()
+{
+    // Keep the order in which the events have been posted
+    std::sort(failedRecords.begin(), failedRecords.end());
+
+    QList<NetLogRecord> records;
+
+    for (int i=0; i<failedRecords.count(); i++)
+    {
+        records.append(batch.at(failedRecords.at(i)));
+    }
+
+    failedRecords.clear();
+    return records;
+}
+
+
+QByteArray NetLogSender::encodeRecords(const QList<NetLogRecord>& records)
+{
+    // One record per line. The data is URL-encoded and cannot contain spaces or line breaks.
+    QByteArray buffer;
+
+    for (int i=0; i<records.count(); i++)
+    {
+        buffer.append(records.at(i).endpoint.toLatin1());
+        buffer.append(' ');
+        buffer.append(records.at(i).data);
+        buffer.append('\n');
+    }
+
+    return buffer;
+}
+
+
+bool NetLogSender::readFromSpool(QList<NetLogRecord>& records, QList<qint64>& offsets, qint64& endPosition)
+{
+    offsets.clear();
+
+    if ((spoolFile.isEmpty()) || (!QFile::exists(spoolFile)))
+    {
+        return false;
+    }
+
+    QFile file(spoolFile);
+
+    if ((!file.open(QIODevice::ReadOnly)) || (!file.seek(spoolPosition)))
+    {
+        return false;
+    }
+
+    while ((records.count()<NETLOG_BATCH_SIZE) && (!file.atEnd()))
+    {
+        qint64     offset=file.pos();
+        QByteArray line=file.readLine().trimmed();
+        int separator=line.indexOf(' ');
+
+        // Skip damaged lines, e.g. if the application was terminated while writing
+        if (separator<=0)
+        {
+            continue;
+        }
+
+        // Skip records that have been delivered with an earlier batch
+        if (spoolDelivered.contains(offset))
+        {
+            continue;
+        }
+
+        NetLogRecord record;
+        record.endpoint=QString::fromLatin1(line.left(separator));
+        record.data=line.mid(separator+1);
+        records.append(record);
+        offsets.append(offset);
+    }
+
+    endPosition=file.pos();
+    file.close();
+
+    if (records.isEmpty())
+    {
+        // Everything has been sent
+        removeSpool();
+        return false;
+    }
+
+    return true;
+}
+
+
+void NetLogSender::advanceSpool(qint64 position)
+{
+    if (position>=QFileInfo(spoolFile).size())
+    {
+        removeSpool();
+        return;
+    }
+
+    spoolPosition=position;
+
+    // Delivered records in front of the position are not needed anymore
+    QMutableSetIterator<qint64> delivered(spoolDelivered);
+
+    while (delivered.hasNext())
+    {
+        if (delivered.next()<spoolPosition)
+        {
+            delivered.remove();
+        }
+    }
+
+    writeSpoolPosition();
+}
+
+
+void NetLogSender::writeSpoolPosition()
+{
+    QByteArray content=QByteArray::number(spoolPosition);
+
+    foreach (qint64 offset, spoolDelivered)
+    {
+        content+="\n"+QByteArray::number(offset);
+    }
+
+    QSaveFile positionFile(spoolFile+NETLOG_SPOOLPOS_EXT);
+
+    if (positionFile.open(QIODevice::WriteOnly))
+    {
+        positionFile.write(content);
+        positionFile.commit();
+    }
+}
+
+
+void NetLogSender::removeSpool()
+{
+    QFile::remove(spoolFile);
+    QFile::remove(spoolFile+NETLOG_SPOOLPOS_EXT);
+    spoolPosition=0;
+    spoolDelivered.clear();
+}
@@ -0,0 +1,126 @@
+#ifndef NETLOG_SENDER_H
+#define NETLOG_SENDER_H
+
+#include <QtCore>
+#include <QtNetwork>
+
+#define NETLOG_QUEUE_SIZE      256
+#define NETLOG_BATCH_SIZE      16
+#define NETLOG_FLUSH_DELAY     1000
+#define NETLOG_RETRY_INTERVAL  120000
+#define NETLOG_SPOOL_EXT       ".yls"
+#define NETLOG_SPOOLPOS_EXT    ".pos"
+
+
+class NetLogger;
+
+
+class NetLogRecord
+{
+public:
+    QString    endpoint;
+    QByteArray data;        // URL-encoded form data without the API key
+};
+
+
+// Event pipeline of the NetLogger. Events are collected in a ring buffer and are sent
+// in batches from the event loop, so that postEvent() never waits for the server. All
+// requests of a batch are posted at once over the same connection, and each reply is
+// deleted as soon as it has finished (or has been aborted by the batch timeout).
+//
+// If the server cannot be reached, the events are appended to a spool file. The spool
+// is append-only: The position of the first unsent record is kept in a second file,
+// together with the records behind it that have already been delivered, and the spool
+// is removed once all records have been delivered. When the server is available again,
+// the spool is sent before any new events. Events of a failed batch are written into
+// the spool ahead of the events that have been spooled while the batch was sent.
+class NetLogSender : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetLogSender(NetLogger* parent);
+    ~NetLogSender();
+
+    void setSpoolFile(QString filename);
+
+    void enqueue(QString endpoint, QUrlQuery query);
+    bool spool(QString endpoint, QUrlQuery query);
+
+    void scheduleBatch(int delayMsec);
+    bool flush(int timeoutMsec);
+    void shutdown();
+
+    int  getQueueCount();
+    bool isOffline();
+
+signals:
+    void batchFinished();
+
+public slots:
+    void sendBatch();
+
+protected slots:
+    void replyFinished();
+    void batchTimeout();
+
+protected:
+    NetLogRecord createRecord(QString endpoint, QUrlQuery query);
+    void finishBatch();
+
+    bool pushRecord(const NetLogRecord& record);
+    bool popRecord(NetLogRecord& record);
+    void spillQueue();
+
+    QList<NetLogRecord> takeFailedRecords();
+
+    bool appendToSpool(const QList<NetLogRecord>& records);
+    bool prependToSpool(const QList<NetLogRecord>& records);
+    bool readFromSpool(QList<NetLogRecord>& records, QList<qint64>& offsets, qint64& endPosition);
+    void advanceSpool(qint64 position);
+    void writeSpoolPosition();
+    void removeSpool();
+
+    static QByteArray encodeRecords(const QList<NetLogRecord>& records);
+
+    NetLogger* logger;
+
+    // Ring buffer with the events that have not been sent yet
+    QVector<NetLogRecord> queue;
+    int                   queueHead;
+    int                   queueCount;
+
+    // Requests of the batch that is currently sent
+    QList<NetLogRecord>    batch;
+    QList<QNetworkReply*>  replies;
+    QList<int>             failedRecords;       // Indices into the batch
+    bool                   batchFromSpool;
+    QList<qint64>          batchSpoolOffsets;   // Spool position of each record of the batch
+    qint64                 batchSpoolEnd;
+    bool                   batchFailed;
+
+    QTimer sendTimer;
+    QTimer timeoutTimer;
+
+    QString      spoolFile;
+    qint64       spoolPosition;
+    QSet<qint64> spoolDelivered;
+
+    bool offline;
+    bool shuttingDown;
+};
+
+
+inline int NetLogSender::getQueueCount()
+{
+    return queueCount;
+}
+
+
+inline bool NetLogSender::isOffline()
+{
+    return offline;
+}
+
+
+#endif // NETLOG_SENDER_H
@@ -1,4 +1,5 @@
 #include "netlogger.h"
+#include "../Client/rds_processrunner.h"
 
 #ifdef YARRA_APP_RDS
     #include "rds_global.h"
@@ -45,11 +46,21 @@ NetLogger::NetLogger()
 
     networkManager=new QNetworkAccessManager();
     networkManager->setProxy(QNetworkProxy::NoProxy);
+
+    sender=new NetLogSender(this);
 }
 
 
 NetLogger::~NetLogger()
 {
+    // Events that could not be sent are kept in the spool for the next run
+    if (sender!=0)
+    {
+        sender->shutdown();
+        delete sender;
+        sender=0;
+    }
+
     if (networkManager!=0)
     {
         delete networkManager;
@@ -207,6 +218,10 @@ void NetLogger::configure(QString path, EventInfo::SourceType sourceType, QStrin
     }
     else
     {
+        // Only the main instance uses the spool, so that test instances don't
+        // send or modify the stored events
+        sender->setSpoolFile(qApp->applicationDirPath() + "/" + QFileInfo(qApp->applicationFilePath()).completeBaseName() + NETLOG_SPOOL_EXT);
+
         if (!serverPath.isEmpty())
         {
             // Check if local host and server path are on the same domain
@@ -235,6 +250,11 @@ bool NetLogger::retryDomainValidation()
         {
             configurationError=true;
         }
+        else
+        {
+            // Send the events that have been spooled in the meantime
+            sender->scheduleBatch(NETLOG_FLUSH_DELAY);
+        }
     }
 
     return !configurationError;
@@ -273,8 +293,27 @@ void NetLogger::postEvent(EventInfo::Type type, EventInfo::Detail detail, EventI
         return;
     }
 
+    // The event is sent by the background sender together with other pending events
     QUrlQuery query=buildEventQuery(type,detail,severity,info,data);
-    postDataAsync(query,NETLOG_ENDPT_EVENT);
+    sender->enqueue(NETLOG_ENDPT_EVENT,query);
+}
+
+
+bool NetLogger::spoolData(QUrlQuery query, QString endpt)
+{
+    // Store the data on the disk. It is sent in the background when the server is reachable.
+    return sender->spool(endpt,query);
+}
+
+
+bool NetLogger::flushEvents(int timeoutMsec)
+{
+    if (!configured)
+    {
+        return false;
+    }
+
+    return sender->flush(timeoutMsec);
 }
 
 
@@ -300,13 +339,38 @@ bool NetLogger::postEventSync(QNetworkReply::NetworkError& error, int& status_co
 }
 
 
+QByteArray NetLogger::encodeQuery(QUrlQuery query)
+{
+    QUrl params;
+    params.setQuery(query);
+    QByteArray postData = params.toEncoded(QUrl::RemoveFragment);
+    postData = postData.remove(0,1); // pop off extraneous "?"
+
+    return postData;
+}
+
+
 QNetworkReply* NetLogger::postDataAsync(QUrlQuery query, QString endpt)
+{
+    return postEncodedAsync(encodeQuery(query), endpt);
+}
+
+
+QNetworkReply* NetLogger::postEncodedAsync(QByteArray data, QString endpt, bool addApiKey)
 {
     if (serverPath.isEmpty())
     {
         return 0;
     }
 
+    // Spooled data is stored without the API key
+    if ((addApiKey) && (!apiKey.isEmpty()))
+    {
+        QUrlQuery keyQuery;
+        keyQuery.addQueryItem("api_key",apiKey);
+        data=encodeQuery(keyQuery) + "&" + data;
+    }
+
     QUrl serviceUrl = QUrl("https://" + serverPath + "/" + endpt);
     serviceUrl.setScheme("https");
     //RTI->log(serviceUrl.toString());
@@ -314,12 +378,7 @@ QNetworkReply* NetLogger::postDataAsync(QUrlQuery query, QString endpt)
     QNetworkRequest req(serviceUrl);
     req.setHeader(QNetworkRequest::ContentTypeHeader,"application/x-www-form-urlencoded");
 
-    QUrl params;
-    params.setQuery(query);
-    QByteArray postData = params.toEncoded(QUrl::RemoveFragment);
-    postData = postData.remove(0,1); // pop off extraneous "?"
-
-    return networkManager->post(req,postData);
+    return networkManager->post(req,data);
 }
 
 
@@ -436,104 +495,34 @@ bool NetLogger::postData(QUrlQuery query, QString endpt, QNetworkReply::NetworkE
 
 QString NetLogger::dnsLookup(QString address)
 {
-    const int nslTimeout=NETLOG_NSLOOKUP_TIMEOUT;
-    bool success=false;
     QString nameFound="";
 
     QStringList args;
     args << address;
 
-    QProcess *nslProcess = new QProcess(0);
-    nslProcess->setReadChannel(QProcess::StandardOutput);
-
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(nslTimeout);
-    QEventLoop q;
-    QObject::connect(nslProcess, SIGNAL(finished(int , QProcess::ExitStatus)), &q, SLOT(quit()));
-    QObject::connect(&timeoutTimer, SIGNAL(timeout()), &q, SLOT(quit()));
-
-    // Time measurement to diagnose RaidTool calling problems
-    QElapsedTimer ti;
-    ti.start();
-    timeoutTimer.start();
-    nslProcess->start("nslookup", args);
-    q.exec();
-
-    // Check for problems with the event loop: Sometimes it seems to return to quickly!
-    // In this case, start a second while loop to check when the process is really finished.
-    if ((timeoutTimer.isActive()) && (nslProcess->state()==QProcess::Running))
+    // Evaluate the output while nslookup is running. All lines after the name are ignored.
+    rdsProcessRunner runner;
+    runner.setTimeout(NETLOG_NSLOOKUP_TIMEOUT);
+    runner.setLineHandler([&nameFound](const QByteArray& line)
     {
-        timeoutTimer.stop();
-        RTI->log("Warning: QEventLoop returned too early. Starting secondary loop.");
-
-        while ((nslProcess->state()==QProcess::Running) && (ti.elapsed()<nslTimeout))
+        if (line.startsWith("Name:"))
         {
-            RTI->processEvents();
-            Sleep(10);
+            nameFound=QString::fromLocal8Bit(line.mid(5)).trimmed();
+            return false;
         }
+        return true;
+    });
 
-        // If the process did not finish within the timeout duration
-        if (nslProcess->state()==QProcess::Running)
-        {
-            RTI->log("Warning: Process is still active. Killing process.");
-            nslProcess->kill();
-            success=false;
-        }
-        else
-        {
-            success=true;
-        }
-    }
-    else
+    if (!runner.run("nslookup", args))
     {
-        // Normal timeout-handling if QEventLoop works normally
-        if (timeoutTimer.isActive())
-        {
-            success=true;
-            timeoutTimer.stop();
-        }
-        else
+        if (runner.isTimeout())
         {
-            RTI->log("Warning: Process event loop timed out.");
-            RTI->log("Warning: Duration since start "+QString::number(ti.elapsed())+" ms");
-            success=false;
-            if (nslProcess->state()==QProcess::Running)
-            {
-                RTI->log("Warning: Process is still active. Killing process.");
-                nslProcess->kill();
-            }
+            RTI->log("Warning: Process timed out after "+QString::number(runner.getDuration())+" ms");
         }
-    }
 
-    if (!success)
-    {
         RTI->log("ERROR: Problems running nslookup.");
+        nameFound="";
     }
-    else
-    {
-        char buf[1024];
-        qint64 lineLength = -1;
-
-        do
-        {
-            lineLength=nslProcess->readLine(buf, sizeof(buf));
-            if (lineLength != -1)
-            {
-                QString line=QString(buf);
-                if  (line.startsWith("Name:"))
-                {
-                    line.remove(0,5);
-                    line=line.trimmed();
-                    nameFound=line;
-                    break;
-                }
-            }
-        } while (lineLength!=-1);
-    }
-
-    delete nslProcess;
-    nslProcess=0;
 
     return nameFound;
 }
@@ -5,6 +5,7 @@
 #include <QUrlQuery>
 #include <QtNetwork>
 #include "netlog_events.h"
+#include "netlog_sender.h"
 #include <functional>
 
 class NetLogger
@@ -21,6 +22,8 @@ public:
     bool retryDomainValidation();
 
     QNetworkReply* postDataAsync(QUrlQuery query, QString endpt);
+    QNetworkReply* postEncodedAsync(QByteArray data, QString endpt, bool addApiKey=false);
+    static QByteArray encodeQuery(QUrlQuery query);
     QUrlQuery buildEventQuery(EventInfo::Type type, EventInfo::Detail detail, EventInfo::Severity severity, QString info, QString data);
 
     bool postData(QUrlQuery query, QString endpt, QNetworkReply::NetworkError& error, int &http_status, QString &errorString, int timeoutMsec=NETLOG_POST_TIMEOUT);
@@ -28,6 +31,10 @@ public:
     bool postEventSync(EventInfo::Type type, EventInfo::Detail detail=EventInfo::Detail::Information, EventInfo::Severity severity=EventInfo::Severity::Success, QString info=QString(""), QString data=QString(""), int timeoutMsec=NETLOG_EVENT_TIMEOUT);
     bool postEventSync(QNetworkReply::NetworkError& error, int& status_code, EventInfo::Type type, EventInfo::Detail detail=EventInfo::Detail::Information, EventInfo::Severity severity=EventInfo::Severity::Success, QString info=QString(""), QString data=QString(""), int timeoutMsec=NETLOG_POST_TIMEOUT);
 
+    bool spoolData(QUrlQuery query, QString endpt);
+    bool flushEvents(int timeoutMsec=NETLOG_POST_TIMEOUT);
+    int  getPendingEventCount();
+
 //    template <typename F>
     bool doRequest(QString endpoint, const std::function<void(QNetworkReply*)> fn, int timeout = 2000);
 //    template <typename F>
@@ -46,6 +53,7 @@ protected:
     QString source_id;
     EventInfo::SourceType source_type;
 
+    NetLogSender* sender;
 };
 
 
@@ -61,4 +69,10 @@ inline bool NetLogger::isConfigurationError()
 }
 
 
+inline int NetLogger::getPendingEventCount()
+{
+    return sender->getQueueCount();
+}
+
+
 #endif // NETLOGGER_H
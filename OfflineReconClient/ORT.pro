@@ -22,6 +22,8 @@ SOURCES += main.cpp \
     ../Client/rds_anonymizeVB17.cpp \
     ../Client/rds_configuration.cpp \
     ../Client/rds_raid.cpp \
+    ../Client/rds_raidparser.cpp \
+    ../Client/rds_raidindex.cpp \
     ../Client/rds_log.cpp \
     ort_confirmationdialog.cpp \
     ort_modelist.cpp \
@@ -30,20 +32,28 @@ SOURCES += main.cpp \
     ort_copydialog.cpp \
     ort_network.cpp \
     ../Client/rds_exechelper.cpp \
+    ../Client/rds_processrunner.cpp \
     ../Client/rds_network.cpp \
+    ../Client/rds_copyengine.cpp \
+    ../Client/rds_checksum.cpp \
     ort_recontask.cpp \
     ort_bootdialog.cpp \
     ort_serverlist.cpp \
     ort_configuration.cpp \
     ort_configurationdialog.cpp \
     ../NetLogger/netlogger.cpp \
+    ../NetLogger/netlog_sender.cpp \
     ../CloudTools/yct_configuration.cpp \
     ../CloudTools/yct_aws/qtawsqnam.cpp \
     ../CloudTools/yct_aws/qtaws.cpp \
+    ../CloudTools/yct_aws/qtawss3.cpp \
     ../CloudTools/yct_api.cpp \
+    ../CloudTools/yct_dicompatcher.cpp \
     ../CloudTools/yct_prepare/yct_twix_anonymizer.cpp \
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.cpp \
     ../CloudAgent/yca_threadlog.cpp \
-    ort_remotefilehelper.cpp
+    ort_remotefilehelper.cpp \
+    ort_winscpsession.cpp
 
 
 HEADERS  += \
@@ -53,6 +63,8 @@ HEADERS  += \
     ../Client/rds_anonymizeVB17.h \
     ../Client/rds_configuration.h \
     ../Client/rds_raid.h \
+    ../Client/rds_raidparser.h \
+    ../Client/rds_raidindex.h \
     ../Client/rds_log.h \
     ort_confirmationdialog.h \
     ort_modelist.h \
@@ -61,7 +73,10 @@ HEADERS  += \
     ort_copydialog.h \
     ort_network.h \
     ../Client/rds_exechelper.h \
+    ../Client/rds_processrunner.h \
     ../Client/rds_network.h \
+    ../Client/rds_copyengine.h \
+    ../Client/rds_checksum.h \
     ort_recontask.h \
     ort_bootdialog.h \
     ort_returnonfocus.h \
@@ -70,12 +85,17 @@ HEADERS  += \
     ort_configurationdialog.h \
     ../NetLogger/netlogger.h \
     ../NetLogger/netlog_events.h \
+    ../NetLogger/netlog_sender.h \
     ../CloudTools/yct_common.h \
     ../CloudTools/yct_aws/qtawsqnam.h \
     ../CloudTools/yct_aws/qtaws.h \
+    ../CloudTools/yct_aws/qtawss3.h \
     ../CloudTools/yct_prepare/yct_twix_anonymizer.h \
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.h \
     ../CloudTools/yct_api.h \
-    ort_remotefilehelper.h
+    ../CloudTools/yct_dicompatcher.h \
+    ort_remotefilehelper.h \
+    ort_winscpsession.h
 
     
 FORMS    += \
@@ -1,5 +1,6 @@
 #include "ort_copydialog.h"
 #include "ui_ort_copydialog.h"
+#include "../Client/rds_copyengine.h"
 
 #include <QDesktopWidget>
 #include <QStyle>
@@ -22,6 +23,9 @@ ortCopyDialog::ortCopyDialog(QWidget *parent) :
 
     setGeometry(QStyle::alignedRect(Qt::LeftToRight, Qt::AlignRight | Qt::AlignBottom, size(), qApp->desktop()->availableGeometry()));
 
+    // Show the progress of the copy operation running in the background
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    progressTimer.start(RDS_COPY_PROGRESSINTERVAL);
 }
 
 
@@ -29,3 +33,23 @@ ortCopyDialog::~ortCopyDialog()
 {
     delete ui;
 }
+
+
+void ortCopyDialog::updateProgress()
+{
+    int     permille=0;
+    QString progressText="";
+
+    // Show the busy indicator if no file is being copied at the moment
+    if (!rdsCopyEngine::getActiveProgress(permille, progressText))
+    {
+        ui->progressBar->setMaximum(0);
+        ui->progressBar->setTextVisible(false);
+        return;
+    }
+
+    ui->progressBar->setMaximum(1000);
+    ui->progressBar->setValue(permille);
+    ui->progressBar->setFormat(progressText);
+    ui->progressBar->setTextVisible(true);
+}
@@ -2,6 +2,7 @@
 #define ORT_COPYDIALOG_H
 
 #include <QDialog>
+#include <QTimer>
 
 namespace Ui {
 class ortCopyDialog;
@@ -17,6 +18,11 @@ public:
 
 private:
     Ui::ortCopyDialog *ui;
+
+    QTimer progressTimer;
+
+private slots:
+    void updateProgress();
 };
 
 #endif // ORT_COPYDIALOG_H
@@ -33,6 +33,13 @@
 
 #define ORT_CONNECT_TIMEOUT      10000
 
+#define ORT_PROBE_TIMEOUT        3000
+#define ORT_PROBE_WAITSTEP       50
+#define ORT_PROBE_MAXTHREADS     8
+#define ORT_PROBE_TTL            30000
+#define ORT_BREAKER_THRESHOLD    2
+#define ORT_BREAKER_COOLDOWN     300
+
 #define ORT_DIR_QUEUE            "recoqueue"
 
 #define ORT_CONNECTION_SMB       "SMB"
@@ -45,6 +45,9 @@ ortMainWindow::ortMainWindow(QWidget *parent) :
 
     // Tell the raid class to not use the LPFI mechanism (which was designed for RDS).
     raid.setIgnoreLPFI();
+
+    // Keep the parsed RAID directory on the disk, so that only new scans need to be parsed
+    raid.setUseRaidIndex();
     isRaidListAvaible=false;
 
     // Load the configuration for getting the information where the ORT directory is located.
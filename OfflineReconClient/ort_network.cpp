@@ -429,6 +429,9 @@ bool ortNetwork::reconnectToMatchingServer(QString requiredServerType)
         }
     }
 
+    // Order the servers by load and skip servers that are known to be down
+    serverCount=serverList.rankMatchingServers(currentServer);
+
     // Select which of the available servers should be used
     ortServerEntry* selectedEntry=serverList.getNextMatchingServer();
     if (selectedEntry==0)
@@ -474,6 +477,7 @@ bool ortNetwork::reconnectToMatchingServer(QString requiredServerType)
         selectedServer=selectedEntry->name;
         connectCmd=selectedEntry->connectCmd;
         bool success = doReconnectServerEntry(selectedEntry);
+        serverList.reportConnectResult(selectedEntry->name, success);
 
         // OK, everything looks good. New server is connected.
         if (success)
@@ -634,6 +638,22 @@ bool ortNetwork::copyFile()
         }
 
         copyError=!copyThread.success;
+
+        if (!copyError)
+        {
+            if (copyThread.engine.getResumedBytes()>0)
+            {
+                RTI->log("Resumed transfer of partial file after " + QString::number(copyThread.engine.getResumedBytes()) + " bytes");
+            }
+            RTI->log("Transfer rate: " + rdsCopyEngine::formatThroughput(copyThread.engine.getThroughput()));
+
+            netLogger.postEvent(EventInfo::Type::Transfer,EventInfo::Detail::FileTransfer,EventInfo::Severity::Success,
+                                currentFilename, copyThread.engine.getTransferData());
+        }
+        else
+        {
+            RTI->log("ERROR: " + copyThread.fileErrorString);
+        }
     }
 
     if (copyError)
@@ -38,9 +38,10 @@ bool ortNetworkSftp::copyFile()
 
 bool ortNetworkSftp::verifyTransfer()
 {
-    bool exists = helper.exists(currentFilename);
+    // A single stat call returns both, whether the file exists and its size
+    qlonglong remote_size = helper.size(currentFilename);
 
-    if (!exists)
+    if (remote_size < 0)
     {
         RTI->log("ERROR: Copied file does not exist at target position: " + currentFilename);
         RTI->log("ERROR: Transferring the file was not successful.");
@@ -48,8 +49,6 @@ bool ortNetworkSftp::verifyTransfer()
         return false;
     }
 
-//  TODO: verify file size
-    qlonglong remote_size = helper.size(currentFilename);
     if (remote_size != currentFilesize)
     {
         RTI->log("ERROR: File size of copied file does not match!");
@@ -63,6 +62,13 @@ bool ortNetworkSftp::verifyTransfer()
 }
 
 
+void ortNetworkSftp::closeConnection()
+{
+    helper.closeSession();
+    ortNetwork::closeConnection();
+}
+
+
 bool ortNetworkSftp::doReconnectServerEntry(ortServerEntry *selectedEntry)
 {
     if(serverPath.isEmpty())
@@ -80,8 +86,16 @@ bool ortNetworkSftp::syncServerList()
 {
     bool result = serverList.removeLocalServerList();
 
-    // Check if server list exists in remote directory
-    if (!helper.exists(ORT_SERVERLISTFILE))
+    QString lockFilename=ORT_SERVERLISTFILE;
+    lockFilename.truncate(lockFilename.indexOf("."));
+    lockFilename+=ORT_LOCK_EXTENSION;
+
+    // Check if server list and lock file exist in remote directory (with one call)
+    QList<bool> found;
+    QList<qlonglong> sizes;
+    bool checked = helper.statFiles(QStringList{ORT_SERVERLISTFILE, lockFilename}, found, sizes);
+
+    if ((!checked) || (!found.at(0)))
     {
         if (result)
         {
@@ -93,11 +107,7 @@ bool ortNetworkSftp::syncServerList()
         return true;
     }
 
-    QString lockFilename=ORT_SERVERLISTFILE;
-    lockFilename.truncate(lockFilename.indexOf("."));
-    lockFilename+=ORT_LOCK_EXTENSION;
-
-    if (helper.exists(lockFilename))
+    if (found.at(1))
     {
         {
             int retries=0;
@@ -18,6 +18,7 @@ public:
     bool prepare();
     bool doReconnectServerEntry(ortServerEntry *selectedEntry);
     bool syncServerList();
+    void closeConnection();
     QSettings* readModelist(QString &error);
 };
 
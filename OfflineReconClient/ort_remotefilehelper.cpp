@@ -7,11 +7,30 @@
 
 ortRemoteFileHelper::ortRemoteFileHelper(QObject *parent) : QObject(parent)
 {
+    sessionFailed = false;
+    timeout = ORT_CONNECT_TIMEOUT;
+}
+
+
+ortRemoteFileHelper::~ortRemoteFileHelper()
+{
+    closeSession();
 }
 
 
 void ortRemoteFileHelper::init(QString server, QString hostKey)
 {
+    if (hostKey.isEmpty())
+    {
+        hostKey = "acceptnew";
+    }
+
+    // An open session can only be reused if it is connected to the same server
+    if ((server != serverURI) || (hostKey != hostkey))
+    {
+        closeSession();
+    }
+
     serverURI = server;
     if (server.startsWith("ftp://"))
     {
@@ -30,20 +49,30 @@ void ortRemoteFileHelper::init(QString server, QString hostKey)
             else {
                 connectionType = UNKNOWN;
             }
-    if (hostKey.isEmpty())
-    {
-        hostkey = "acceptnew";
-    }
-    else
-    {
-        hostkey = hostKey;
-    }
+    hostkey = hostKey;
     winSCPPath = QDir(qApp->applicationDirPath()).filePath(ORT_WINSCP_BINARY);
     RTI->log("Set server URI to " + server);
     remoteBasePath = "/YarraServer";
 }
 
 
+void ortRemoteFileHelper::closeSession()
+{
+    if (session.isRunning())
+    {
+        RTI->log("Closing WinSCP session.");
+    }
+    session.stop();
+}
+
+
+void ortRemoteFileHelper::setTimeout(int timeoutMs)
+{
+    timeout = timeoutMs;
+    exec.setTimeout(timeoutMs);
+}
+
+
 bool ortRemoteFileHelper::testConnection(QString& error)
 {
     if (serverURI.isEmpty())
@@ -52,11 +81,11 @@ bool ortRemoteFileHelper::testConnection(QString& error)
         return false;
     }
     QStringList output;
-    exec.setTimeout(ORT_CONNECT_TIMEOUT);
+    setTimeout(ORT_CONNECT_TIMEOUT);
     bool success = runServerOperations(QStringList{}, output);
     if (!success)
     {
-        error = output.mid(output.count()-3,3).join("").trimmed();
+        error = output.mid(output.count()-3,3).join("\n").trimmed();
         return false;
     }
     success = exists("");
@@ -72,19 +101,19 @@ bool ortRemoteFileHelper::testConnection(QString& error)
 bool ortRemoteFileHelper::exists(QString path)
 {
     QStringList output;
-    exec.setTimeout(ORT_CONNECT_TIMEOUT);
-    return runServerOperations(QStringList("stat \"\"" + remoteBasePath + "/"+path+"\"\""),output);
+    setTimeout(ORT_CONNECT_TIMEOUT);
+    return runServerOperations(QStringList("stat \"" + remoteBasePath + "/"+path+"\""),output);
 }
 
 
 bool ortRemoteFileHelper::exists(QStringList paths)
 {
     QStringList output;
-    exec.setTimeout(ORT_CONNECT_TIMEOUT);
+    setTimeout(ORT_CONNECT_TIMEOUT);
     QStringList statCommands;
     for ( const QString& i : static_cast<const QStringList&>(paths))
     {
-        statCommands.append("stat \"\"" + remoteBasePath + "/"+i+"\"\"");
+        statCommands.append("stat \"" + remoteBasePath + "/"+i+"\"");
     }
     return runServerOperations(statCommands, output);
 }
@@ -93,16 +122,76 @@ bool ortRemoteFileHelper::exists(QStringList paths)
 qlonglong ortRemoteFileHelper::size(QString path)
 {
     QStringList output;
-    exec.setTimeout(ORT_CONNECT_TIMEOUT);
-    bool success = runServerOperations(QStringList("stat \"\"" + remoteBasePath + "/"+path+"\"\""),output);
+    setTimeout(ORT_CONNECT_TIMEOUT);
+    bool success = runServerOperations(QStringList("stat \"" + remoteBasePath + "/"+path+"\""),output);
     if (!success)
     {
         return -1;
     }
+    return parseStatSize(output);
+}
+
+
+// Checks several files with one round trip if the session is available. A missing file
+// doesn't abort the other checks. Returns false if the server couldn't be reached.
+bool ortRemoteFileHelper::statFiles(QStringList paths, QList<bool>& found, QList<qlonglong>& sizes)
+{
+    found.clear();
+    sizes.clear();
+    setTimeout(ORT_CONNECT_TIMEOUT);
+
+    if (!sessionFailed)
+    {
+        QStringList statCommands;
+        for ( const QString& i : static_cast<const QStringList&>(paths))
+        {
+            statCommands.append("stat \"" + remoteBasePath + "/"+i+"\"");
+        }
+
+        QList<bool> results;
+        QList<QStringList> outputs;
+        QStringList output;
+        if (runSessionOperations(statCommands, results, outputs, output))
+        {
+            for (int i=0; i<paths.count(); i++)
+            {
+                found.append(results.at(i));
+                sizes.append(results.at(i) ? parseStatSize(outputs.at(i)) : -1);
+            }
+            return true;
+        }
+        if (!sessionFailed)
+        {
+            return false;
+        }
+    }
+
+    // Without session, WinSCP aborts the script at the first missing file, so the
+    // files need to be checked with separate calls
+    for ( const QString& i : static_cast<const QStringList&>(paths))
+    {
+        qlonglong fileSize = size(i);
+        found.append(fileSize >= 0);
+        sizes.append(fileSize);
+    }
+    return true;
+}
+
+
+qlonglong ortRemoteFileHelper::parseStatSize(QStringList output)
+{
+    if (output.isEmpty())
+    {
+        return -1;
+    }
     QString stat_string = output.back();
-    QString size_string = stat_string.split(" ",QString::SkipEmptyParts).at(2);
+    QStringList stat_parts = stat_string.split(" ",QString::SkipEmptyParts);
+    if (stat_parts.count() < 3)
+    {
+        return -1;
+    }
     bool ok;
-    qlonglong size = size_string.toLongLong(&ok);
+    qlonglong size = stat_parts.at(2).toLongLong(&ok);
     if (ok)
     {
         return size;
@@ -114,11 +203,11 @@ qlonglong ortRemoteFileHelper::size(QString path)
 bool ortRemoteFileHelper::get(QStringList paths, QDir dest)
 {
    QStringList output;
-   exec.setTimeout(RDS_COPY_TIMEOUT);
+   setTimeout(RDS_COPY_TIMEOUT);
    QStringList getCommands;
    for ( const QString& i : static_cast<const QStringList&>(paths))
    {
-       getCommands.append("get \"\"" + remoteBasePath + "/"+i+"\"\" \"\""+QDir::toNativeSeparators(dest.absolutePath())+"\\\"\"");
+       getCommands.append("get \"" + remoteBasePath + "/"+i+"\" \""+QDir::toNativeSeparators(dest.absolutePath())+"\\\"");
    }
    return runServerOperations(getCommands, output);
 }
@@ -127,22 +216,22 @@ bool ortRemoteFileHelper::get(QStringList paths, QDir dest)
 bool ortRemoteFileHelper::get(QString path, QDir dest)
 {
    QStringList output;
-   exec.setTimeout(RDS_COPY_TIMEOUT);
-   return runServerOperation("get \"\"" + remoteBasePath + "/"+path+"\"\" \"\""+QDir::toNativeSeparators(dest.absolutePath())+"\\\"\"", output);
+   setTimeout(RDS_COPY_TIMEOUT);
+   return runServerOperation("get \"" + remoteBasePath + "/"+path+"\" \""+QDir::toNativeSeparators(dest.absolutePath())+"\\\"", output);
 }
 
 
 bool ortRemoteFileHelper::put(QString path)
 {
    QStringList output;
-   exec.setTimeout(RDS_COPY_TIMEOUT);
-   return runServerOperation("put \"\""+QDir::toNativeSeparators(path)+"\"\" " + remoteBasePath + "/", output);
+   setTimeout(RDS_COPY_TIMEOUT);
+   return runServerOperation("put \""+QDir::toNativeSeparators(path)+"\" " + remoteBasePath + "/", output);
 }
 
 
 //bool ortRemoteFileHelper::read(QString path, QString& output) {
 //   QStringList lines;
-//   exec.setTimeout(RDS_COPY_TIMEOUT);
+//   setTimeout(RDS_COPY_TIMEOUT);
 //   bool success = runServerOperation("get "+path+" -", lines);
 //   if (!success) return false;
 //   output = lines.join("");
@@ -156,7 +245,7 @@ bool ortRemoteFileHelper::runServerOperation(QString operation, QStringList &out
 }
 
 
-bool ortRemoteFileHelper::runServerOperations(QStringList operations, QStringList &output)
+QString ortRemoteFileHelper::getOpenCommand()
 {
     QString openCommand = "open " + serverURI;
     if (connectionType == SFTP || connectionType == SCP)
@@ -166,16 +255,93 @@ bool ortRemoteFileHelper::runServerOperations(QStringList operations, QStringLis
             openCommand += " -hostkey=acceptnew";
         } else
         {
-            openCommand += " -hostkey=\"\"" + hostkey + "\"\"";
+            openCommand += " -hostkey=\"" + hostkey + "\"";
         }
     }
-    QStringList allOperations = QStringList(openCommand) + operations;
+    return openCommand;
+}
+
+
+bool ortRemoteFileHelper::runServerOperations(QStringList operations, QStringList &output)
+{
+    if (!sessionFailed)
+    {
+        QList<bool> results;
+        QList<QStringList> outputs;
+        if (runSessionOperations(operations, results, outputs, output))
+        {
+            // Same as the exit code of WinSCP: fail if any of the commands failed
+            return !results.contains(false);
+        }
+        if (!sessionFailed)
+        {
+            return false;
+        }
+    }
+
+    QStringList allOperations = QStringList(getOpenCommand()) + operations;
     return callWinSCP(allOperations, output);
 }
 
 
+// Runs the operations in the persistent session, which is opened with the first call and
+// after the connection has been lost. If WinSCP doesn't behave as expected by the session,
+// the session is disabled and WinSCP is called once per operation from then on.
+bool ortRemoteFileHelper::runSessionOperations(QStringList operations, QList<bool>& results, QList<QStringList>& outputs, QStringList &output)
+{
+    output.clear();
+
+    if (!session.isRunning())
+    {
+        RTI->log("Opening WinSCP session to " + serverURI);
+        if (!session.start(winSCPPath, getOpenCommand(), ORT_CONNECT_TIMEOUT, output))
+        {
+            RTI->log(output.join("; "));
+            if (session.isProtocolError())
+            {
+                RTI->log("WinSCP session not available. Calling WinSCP for each operation.");
+                sessionFailed = true;
+            }
+            return false;
+        }
+    }
+
+    if (operations.isEmpty())
+    {
+        return true;
+    }
+
+    RTI->log("WinSCP session: " + operations.join("; "));
+
+    if (!session.execute(operations, timeout, results, outputs))
+    {
+        if (session.isProtocolError())
+        {
+            RTI->log("WinSCP session not available. Calling WinSCP for each operation.");
+            sessionFailed = true;
+        }
+        return false;
+    }
+
+    for (int i=0; i<outputs.count(); i++)
+    {
+        output.append(outputs.at(i));
+    }
+
+    // The output is only needed to find out why an operation failed
+    if (results.contains(false))
+    {
+        RTI->log("Session output: ");
+        RTI->log(output.join("; "));
+    }
+    return true;
+}
+
+
 bool ortRemoteFileHelper::callWinSCP(QStringList commands, QStringList &output)
 {
+    // Quotes inside of the commands need to be doubled for the command line
+    commands.replaceInStrings("\"", "\"\"");
     QString cmdString = "/ini=nul /command \"" + commands.join("\" \"") +"\""+
             " \"exit\"";
     RTI->log(cmdString);
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QtCore>
 #include "../Client/rds_exechelper.h"
+#include "ort_winscpsession.h"
 
 
 enum ortConnectionType
@@ -22,12 +23,22 @@ class ortRemoteFileHelper: public QObject
     QString serverURI;
     QString winSCPPath;
     QString hostkey;
+    ortWinSCPSession session;
+    bool sessionFailed;
+    int timeout;
+
+    void setTimeout(int timeoutMs);
+    QString getOpenCommand();
+    bool runSessionOperations(QStringList operations, QList<bool>& results, QList<QStringList>& outputs, QStringList &output);
+    static qlonglong parseStatSize(QStringList output);
 
 public:
     ortConnectionType connectionType;
     QString remoteBasePath;
     explicit ortRemoteFileHelper(QObject *parent = nullptr);
+    ~ortRemoteFileHelper();
     void init(QString server, QString hostKey="acceptnew");
+    void closeSession();
     bool testConnection(QString& error);
     bool callWinSCP(QStringList str, QStringList &output);
     bool runServerOperation(QString operation, QStringList &output);
@@ -35,6 +46,7 @@ public:
     qlonglong size(QString path);
     bool exists(QString path);
     bool exists(QStringList path);
+    bool statFiles(QStringList paths, QList<bool>& found, QList<qlonglong>& sizes);
 
     bool get(QString path, QDir dest);
     bool get(QStringList path, QDir dest);
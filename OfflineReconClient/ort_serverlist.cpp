@@ -2,6 +2,8 @@
 #include "ort_global.h"
 
 #include <time.h>
+#include <climits>
+#include <algorithm>
 
 
 ortServerList::ortServerList()
@@ -10,12 +12,25 @@ ortServerList::ortServerList()
     appPath=qApp->applicationDirPath();
     selectedIndex=0;
     servers.clear();
+
+    probePool=new QThreadPool();
+    probePool->setMaxThreadCount(ORT_PROBE_MAXTHREADS);
 }
 
 
 ortServerList::~ortServerList()
 {
     clearList();
+
+    // Probes that still block on an unreachable share can't be interrupted. Deleting the
+    // pool would wait for them, so the pool is left behind in this case.
+    probePool->clear();
+
+    if (probePool->activeThreadCount()==0)
+    {
+        delete probePool;
+    }
+    probePool=0;
 }
 
 
@@ -151,6 +166,9 @@ bool ortServerList::readServerList(QString filePath)
                 entry->connectCmd=serverListIni.value("ConnectCmd","").toString();
                 entry->serverPath=serverListIni.value("ServerPath","").toString();
                 entry->hostKey   =serverListIni.value("HostKey","").toString();
+                // Optional folder that can be read without connecting to the server (e.g.,
+                // UNC path of the share). Used to check the health and queue of the server.
+                entry->statusPath=serverListIni.value("StatusPath","").toString();
                 // If a Base64 encoded version is available, decode it and overwrite
                 // the other setting.
                 QString connectCmdE=serverListIni.value("ConnectCmdE","").toString();
@@ -272,5 +290,304 @@ void ortServerList::getLoadBalancingIndex(QString type)
 }
 
 
+int ortServerList::rankMatchingServers(QString currentServer)
+{
+    // Orders the matching servers by their queue length, so that getNextMatchingServer()
+    // returns the least-loaded healthy server first. Servers without status path keep the
+    // round-robin order behind the probed servers. Servers that are blocked by the circuit
+    // breaker or didn't respond to the probe are dropped from the list, unless no other
+    // server is left.
+    if (matchingServers.count()<=1)
+    {
+        return matchingServers.count();
+    }
+
+    QMap<QString, ortServerHealth> health;
+    QList<ortServerEntry*>         probeList;
+    QDateTime                      now=QDateTime::currentDateTime();
+
+    // The health of all servers is read and written with the same settings object
+    QSettings lbiFile(RTI->getAppPath()+"/"+ORT_LBI_NAME, QSettings::IniFormat);
+
+    for (int i=0; i<matchingServers.count(); i++)
+    {
+        ortServerEntry* entry=matchingServers.at(i);
+        readHealth(lbiFile, entry->name, health[entry->name]);
+
+        const ortServerHealth& entryHealth=health[entry->name];
+
+        // Use the cached result if the last probe was recent
+        if ((!entry->statusPath.isEmpty()) && (!isBlocked(entryHealth))
+            && ((!entryHealth.probeTime.isValid()) || (entryHealth.probeTime.msecsTo(now)>ORT_PROBE_TTL)))
+        {
+            probeList.append(entry);
+        }
+    }
+
+    probeServers(probeList, health, lbiFile);
+
+    // Start with the round-robin order, which decides between servers with the same load
+    QList<ortServerEntry*> availableServers;
+    QList<ortServerEntry*> unavailableServers;
+
+    for (int i=0; i<matchingServers.count(); i++)
+    {
+        ortServerEntry* entry=matchingServers.at((selectedIndex+i) % matchingServers.count());
+        const ortServerHealth& entryHealth=health[entry->name];
+
+        if ((isBlocked(entryHealth)) || ((!entry->statusPath.isEmpty()) && (!entryHealth.reachable)))
+        {
+            unavailableServers.append(entry);
+        }
+        else
+        {
+            availableServers.append(entry);
+        }
+    }
+
+    std::stable_sort(availableServers.begin(), availableServers.end(),
+                     [&health, &currentServer](ortServerEntry* a, ortServerEntry* b)
+    {
+        int loadA=health[a->name].queueLength;
+        int loadB=health[b->name].queueLength;
+
+        // Servers without status information are sorted behind the probed servers
+        if (a->statusPath.isEmpty())
+        {
+            loadA=INT_MAX;
+        }
+        if (b->statusPath.isEmpty())
+        {
+            loadB=INT_MAX;
+        }
+
+        if (loadA!=loadB)
+        {
+            return loadA<loadB;
+        }
+
+        // Prefer the connected server with the same load, which saves remapping the drive
+        return (a->name==currentServer) && (b->name!=currentServer);
+    });
+
+    for (int i=0; i<availableServers.count(); i++)
+    {
+        if (!availableServers.at(i)->statusPath.isEmpty())
+        {
+            RTI->log("Server " + availableServers.at(i)->name + ": " + QString::number(health[availableServers.at(i)->name].queueLength) + " tasks in queue");
+        }
+    }
+
+    for (int i=0; i<unavailableServers.count(); i++)
+    {
+        RTI->log("Server " + unavailableServers.at(i)->name + " is currently not available. Skipping.");
+    }
+
+    if (availableServers.isEmpty())
+    {
+        // Try all servers anyway, as the servers might have recovered in the meantime
+        RTI->log("WARNING: No healthy server found. Trying all matching servers.");
+        availableServers=unavailableServers;
+    }
+
+    matchingServers=availableServers;
+    selectedIndex=0;
+
+    return matchingServers.count();
+}
+
+
+void ortServerList::probeServers(QList<ortServerEntry*> entries, QMap<QString, ortServerHealth>& health, QSettings& lbiFile)
+{
+    if (entries.isEmpty())
+    {
+        return;
+    }
+
+    // Probe all servers concurrently, so that the total wait time is limited by the
+    // timeout instead of adding up the timeouts of unreachable servers
+    QList<QSharedPointer<ortServerProbeResult>> results;
+    QSharedPointer<QSemaphore> probesDone(new QSemaphore(0));
+    int startedProbes=0;
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        QString statusPath=entries.at(i)->statusPath;
+
+        // A probe from an earlier call that still blocks on the share keeps its thread.
+        // Its result is used if it returns in the meantime.
+        if ((pendingProbes.contains(statusPath)) && (!pendingProbes.value(statusPath)->finished.loadAcquire()))
+        {
+            results.append(pendingProbes.value(statusPath));
+            continue;
+        }
+
+        QSharedPointer<ortServerProbeResult> result(new ortServerProbeResult());
+        results.append(result);
+        pendingProbes.insert(statusPath, result);
+
+        probePool->start(new ortServerProbeTask(statusPath, result, probesDone));
+        startedProbes++;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int finishedProbes=0;
+
+    while ((finishedProbes<startedProbes) && (timer.elapsed()<ORT_PROBE_TIMEOUT))
+    {
+        // Block until the next probe has finished, but keep the UI responsive in between
+        if (probesDone->tryAcquire(1, ORT_PROBE_WAITSTEP))
+        {
+            finishedProbes++;
+        }
+        else
+        {
+            RTI->processEvents();
+        }
+    }
+
+    QDateTime now=QDateTime::currentDateTime();
+
+    for (int i=0; i<entries.count(); i++)
+    {
+        ortServerHealth& entryHealth=health[entries.at(i)->name];
+        entryHealth.probeTime=now;
+
+        // Probes that haven't returned within the timeout count as unreachable
+        if ((results.at(i)->finished.loadAcquire()) && (results.at(i)->reachable))
+        {
+            entryHealth.reachable=true;
+            entryHealth.queueLength=results.at(i)->queueLength;
+            entryHealth.failures=0;
+            entryHealth.blockedUntil=QDateTime();
+        }
+        else
+        {
+            RTI->log("WARNING: Server " + entries.at(i)->name + " not reachable at " + entries.at(i)->statusPath);
+            entryHealth.reachable=false;
+            entryHealth.queueLength=-1;
+            registerFailure(entries.at(i)->name, entryHealth);
+        }
+
+        writeHealth(lbiFile, entries.at(i)->name, entryHealth);
+    }
+
+    // Only probes that are still blocked are kept
+    QMutableMapIterator<QString, QSharedPointer<ortServerProbeResult>> probe(pendingProbes);
+
+    while (probe.hasNext())
+    {
+        probe.next();
+
+        if (probe.value()->finished.loadAcquire())
+        {
+            probe.remove();
+        }
+    }
+}
+
+
+void ortServerList::reportConnectResult(QString name, bool success)
+{
+    QSettings lbiFile(RTI->getAppPath()+"/"+ORT_LBI_NAME, QSettings::IniFormat);
+
+    ortServerHealth health;
+    readHealth(lbiFile, name, health);
+
+    if (success)
+    {
+        health.failures=0;
+        health.blockedUntil=QDateTime();
+    }
+    else
+    {
+        registerFailure(name, health);
+
+        // Probe the server again before it's used next time
+        health.probeTime=QDateTime();
+    }
+
+    writeHealth(lbiFile, name, health);
+}
+
+
+void ortServerList::registerFailure(QString name, ortServerHealth& health)
+{
+    health.failures++;
+
+    // After repeated failures, the server is skipped for a while, so that it doesn't
+    // cost a connect timeout with every task. Once the time has passed, the server is
+    // probed again, and a successful probe or connection resets the counter.
+    if (health.failures>=ORT_BREAKER_THRESHOLD)
+    {
+        health.blockedUntil=QDateTime::currentDateTime().addSecs(ORT_BREAKER_COOLDOWN);
+        RTI->log("Server " + name + " failed " + QString::number(health.failures) + " times. Skipping it until " + health.blockedUntil.toString(Qt::ISODate));
+    }
+}
+
+
+bool ortServerList::isBlocked(const ortServerHealth& health)
+{
+    return (health.blockedUntil.isValid()) && (health.blockedUntil>QDateTime::currentDateTime());
+}
+
+
+void ortServerList::readHealth(QSettings& lbiFile, QString name, ortServerHealth& health)
+{
+    lbiFile.beginGroup("ServerHealth");
+
+    health.reachable   =lbiFile.value(name+"/Reachable", false).toBool();
+    health.queueLength =lbiFile.value(name+"/QueueLength", -1).toInt();
+    health.probeTime   =lbiFile.value(name+"/ProbeTime", QDateTime()).toDateTime();
+    health.failures    =lbiFile.value(name+"/Failures", 0).toInt();
+    health.blockedUntil=lbiFile.value(name+"/BlockedUntil", QDateTime()).toDateTime();
+
+    lbiFile.endGroup();
+}
+
+
+void ortServerList::writeHealth(QSettings& lbiFile, QString name, const ortServerHealth& health)
+{
+    lbiFile.beginGroup("ServerHealth");
+
+    lbiFile.setValue(name+"/Reachable",    health.reachable);
+    lbiFile.setValue(name+"/QueueLength",  health.queueLength);
+    lbiFile.setValue(name+"/ProbeTime",    health.probeTime);
+    lbiFile.setValue(name+"/Failures",     health.failures);
+    lbiFile.setValue(name+"/BlockedUntil", health.blockedUntil);
+
+    lbiFile.endGroup();
+}
+
+
+ortServerProbeTask::ortServerProbeTask(QString path, QSharedPointer<ortServerProbeResult> result, QSharedPointer<QSemaphore> done)
+{
+    setAutoDelete(true);
+    statusPath=path;
+    probeResult=result;
+    probeDone=done;
+}
+
+
+void ortServerProbeTask::run()
+{
+    QDir statusDir(statusPath);
+
+    if (statusDir.exists())
+    {
+        // Task files that haven't been picked up by the server yet (all priorities)
+        QStringList taskFilters;
+        taskFilters << "*" ORT_TASK_EXTENSION << "*" ORT_TASK_EXTENSION ORT_TASK_EXTENSION_PRIO << "*" ORT_TASK_EXTENSION ORT_TASK_EXTENSION_NIGHT;
+
+        probeResult->queueLength=statusDir.entryList(taskFilters, QDir::Files).count();
+        probeResult->reachable=true;
+    }
+
+    probeResult->finished.storeRelease(1);
+    probeDone->release();
+}
+
 
 
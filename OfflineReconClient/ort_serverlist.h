@@ -11,10 +11,65 @@ public:
     QString     connectCmd;
     QString     serverPath;
     QString     hostKey;
+    QString     statusPath;
     bool        acceptsUndefined;
 };
 
 
+// Load and health of a server, as seen by the last probe or connection attempt.
+// Stored in the load-balancing file, so that it's shared between ORT runs.
+class ortServerHealth
+{
+public:
+    ortServerHealth()
+    {
+        reachable=false;
+        queueLength=-1;
+        failures=0;
+    }
+
+    bool      reachable;
+    int       queueLength;
+    QDateTime probeTime;
+    int       failures;
+    QDateTime blockedUntil;
+};
+
+
+// Reads the queue length of one server from its status path. Runs on the probe pool
+// of the server list, because the access to an unreachable share can block for a long
+// time and the caller shouldn't have to wait for it. The result is shared with the caller
+// and is only evaluated if finished has been set before the probe timeout. The semaphore
+// is released when the probe is done, so that the caller can wait without polling.
+class ortServerProbeResult
+{
+public:
+    ortServerProbeResult()
+    {
+        reachable=false;
+        queueLength=-1;
+        finished=0;
+    }
+
+    bool       reachable;
+    int        queueLength;
+    QAtomicInt finished;
+};
+
+
+class ortServerProbeTask : public QRunnable
+{
+public:
+    ortServerProbeTask(QString path, QSharedPointer<ortServerProbeResult> result, QSharedPointer<QSemaphore> done);
+    void run();
+
+protected:
+    QString statusPath;
+    QSharedPointer<ortServerProbeResult> probeResult;
+    QSharedPointer<QSemaphore>           probeDone;
+};
+
+
 class ortServerList
 {
 public:
@@ -37,13 +92,27 @@ public:
 
     void getLoadBalancingIndex(QString type);
 
+    int  rankMatchingServers(QString currentServer);
+    void reportConnectResult(QString name, bool success);
+
 protected:
 
+    void probeServers(QList<ortServerEntry*> entries, QMap<QString, ortServerHealth>& health, QSettings& lbiFile);
+    void readHealth(QSettings& lbiFile, QString name, ortServerHealth& health);
+    void writeHealth(QSettings& lbiFile, QString name, const ortServerHealth& health);
+    void registerFailure(QString name, ortServerHealth& health);
+    bool isBlocked(const ortServerHealth& health);
+
     bool    serverListAvailable;
     QString appPath;
 
     int selectedIndex;
 
+    // Separate pool, so that probes blocking on an unreachable share don't hold threads
+    // of the global pool. Probes that are still running are not started again.
+    QThreadPool* probePool;
+    QMap<QString, QSharedPointer<ortServerProbeResult>> pendingProbes;
+
 };
 
 
@@ -0,0 +1,199 @@
+#include <QtWidgets>
+#include <stdio.h>
+
+#include "ort_global.h"
+#include "ort_serverlist.h"
+
+
+// Test of the load-aware server selection. Local folders stand in for the status
+// paths of the servers, so that the queue length can be set by creating task files
+// and an unreachable server can be simulated by a missing folder.
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+static void addTasks(QDir serverDir, QString server, int count)
+{
+    QDir statusDir(serverDir.absoluteFilePath(server));
+
+    for (int i=0; i<count; i++)
+    {
+        QFile taskFile(statusDir.absoluteFilePath("task" + QString::number(statusDir.count()) + ORT_TASK_EXTENSION));
+        taskFile.open(QIODevice::WriteOnly);
+        taskFile.close();
+    }
+}
+
+
+static bool writeServerList(QDir serverDir, QStringList servers, QStringList statusServers)
+{
+    QSettings serverListIni(serverDir.absoluteFilePath(ORT_SERVERLISTFILE), QSettings::IniFormat);
+
+    for (int i=0; i<servers.count(); i++)
+    {
+        serverListIni.beginGroup(servers.at(i));
+        serverListIni.setValue("ServerPath", serverDir.absoluteFilePath(servers.at(i)));
+
+        if (statusServers.contains(servers.at(i)))
+        {
+            serverListIni.setValue("StatusPath", serverDir.absoluteFilePath(servers.at(i)));
+        }
+        serverListIni.endGroup();
+    }
+
+    serverListIni.sync();
+    return (serverListIni.status()==QSettings::NoError);
+}
+
+
+static QStringList rankServers(ortServerList& serverList)
+{
+    QStringList order;
+
+    serverList.findMatchingServers("");
+    serverList.rankMatchingServers("");
+
+    ortServerEntry* entry=serverList.getNextMatchingServer();
+
+    while (entry!=0)
+    {
+        order.append(entry->name);
+        entry=serverList.getNextMatchingServer();
+    }
+
+    return order;
+}
+
+
+int testRanking(QDir serverDir)
+{
+    printf("Ranking by queue length\n");
+
+    // ServerD has a status path that doesn't exist, ServerE has no status path
+    serverDir.mkdir("ServerA");
+    serverDir.mkdir("ServerB");
+    serverDir.mkdir("ServerC");
+    addTasks(serverDir, "ServerA", 3);
+    addTasks(serverDir, "ServerB", 1);
+
+    writeServerList(serverDir, QStringList() << "ServerA" << "ServerB" << "ServerC" << "ServerD" << "ServerE",
+                    QStringList() << "ServerA" << "ServerB" << "ServerC" << "ServerD");
+
+    ortServerList serverList;
+    check(serverList.readServerList(serverDir.absolutePath()), "Server list read");
+
+    QStringList order=rankServers(serverList);
+    printf("  Order: %s\n", qPrintable(order.join(", ")));
+
+    check(order==(QStringList() << "ServerC" << "ServerB" << "ServerA" << "ServerE"), "Least-loaded server first, unprobed server last");
+    check(!order.contains("ServerD"),                                                  "Unreachable server skipped");
+
+    // Within the TTL, the cached queue lengths are used
+    addTasks(serverDir, "ServerC", 5);
+    order=rankServers(serverList);
+
+    check(order.value(0)=="ServerC", "Cached probe result used within TTL");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testCircuitBreaker(QDir serverDir)
+{
+    printf("Circuit breaker\n");
+
+    ortServerList serverList;
+    serverList.readServerList(serverDir.absolutePath());
+
+    // ServerD has failed the probe before. A failed connection blocks it, even if
+    // the share is available again.
+    serverDir.mkdir("ServerD");
+    serverList.reportConnectResult("ServerD", false);
+
+    QStringList order=rankServers(serverList);
+    check(!order.contains("ServerD"), "Blocked server skipped");
+
+    // A successful connection resets the breaker, and the server is probed again
+    serverList.reportConnectResult("ServerD", true);
+
+    // ServerD has an empty queue now, ServerB has one task
+    order=rankServers(serverList);
+    printf("  Order: %s\n", qPrintable(order.join(", ")));
+    check(order.contains("ServerD") && (order.indexOf("ServerD")<order.indexOf("ServerB")), "Recovered server probed and used");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testNoHealthyServer(QDir serverDir)
+{
+    printf("No healthy server\n");
+
+    writeServerList(serverDir, QStringList() << "ServerX" << "ServerY", QStringList() << "ServerX" << "ServerY");
+
+    ortServerList serverList;
+    serverList.readServerList(serverDir.absolutePath());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList order=rankServers(serverList);
+
+    check(order.count()==2,                            "All servers tried anyway");
+    check(timer.elapsed()<ORT_PROBE_TIMEOUT+1000,      "Ranking returns within probe timeout");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    printf("\nYarra ORT - Server List Test\n");
+    printf("----------------------------\n\n");
+
+    // The server health is stored in the load-balancing file of the application folder
+    QString lbiFilename=RTI->getAppPath()+"/"+ORT_LBI_NAME;
+    QFile::remove(lbiFilename);
+
+    QTemporaryDir tempDir;
+
+    if (!tempDir.isValid())
+    {
+        printf("Unable to create temporary folder\n");
+        return 1;
+    }
+
+    QDir serverDir(tempDir.path());
+
+    testRanking(serverDir);
+    testCircuitBreaker(serverDir);
+
+    QTemporaryDir emptyDir;
+    testNoHealthyServer(QDir(emptyDir.path()));
+
+    QFile::remove(lbiFilename);
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
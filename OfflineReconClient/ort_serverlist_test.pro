@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Test of the server ranking with local folders as servers
+#
+#-------------------------------------------------
+
+QT       += core widgets gui network
+
+TARGET = ort_serverlist_test
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += YARRA_APP_ORT
+
+
+SOURCES += ort_serverlist_test.cpp \
+    ort_serverlist.cpp \
+    ../Client/rds_runtimeinformation.cpp \
+    ../Client/rds_log.cpp
+
+HEADERS += \
+    ort_global.h \
+    ort_serverlist.h \
+    ../Client/rds_runtimeinformation.h \
+    ../Client/rds_log.h
@@ -0,0 +1,300 @@
+#include "ort_winscpsession.h"
+
+#include "../Client/rds_global.h"
+
+
+ortWinSCPSession::ortWinSCPSession()
+{
+    xmlLogFilename="";
+    xmlLogOffset=0;
+    pendingOutput.clear();
+    outputLines.clear();
+    markerCounter=0;
+    protocolError=false;
+    terminated=false;
+}
+
+
+ortWinSCPSession::~ortWinSCPSession()
+{
+    stop();
+}
+
+
+bool ortWinSCPSession::isRunning()
+{
+    return (process.state()==QProcess::Running);
+}
+
+
+bool ortWinSCPSession::start(QString winSCPPath, QString openCommand, int timeoutMs, QStringList& output)
+{
+    stop();
+
+    protocolError=false;
+    markerCounter=0;
+    output.clear();
+
+    // Several helpers can have a session open at the same time, so each needs its own log
+    xmlLogFilename=QDir::temp().absoluteFilePath("ort_winscp_" + QString::number(QCoreApplication::applicationPid())
+                                                 + "_" + QUuid::createUuid().toString().mid(1,36) + ".xml");
+    xmlLogOffset=0;
+    QFile::remove(xmlLogFilename);
+
+    QStringList arguments;
+    arguments << "/ini=nul" << "/xmllog=" + QDir::toNativeSeparators(xmlLogFilename) << "/xmlgroups";
+
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(winSCPPath, arguments);
+
+    if (!process.waitForStarted(timeoutMs))
+    {
+        RTI->log("ERROR: Unable to start WinSCP session: " + winSCPPath);
+        protocolError=true;
+        return false;
+    }
+
+    // Answer all prompts automatically, so that the session never waits for user input.
+    // A failing command (e.g., stat of a missing file) doesn't end the session but is
+    // reported as failed result in the XML log.
+    process.write("option batch continue\noption confirm off\n");
+
+    QList<bool>        results;
+    QList<QStringList> outputs;
+
+    if (!execute(QStringList(openCommand), timeoutMs, results, outputs))
+    {
+        // If WinSCP ended before the session was open, it can't be used to run commands
+        // over the standard input, and the caller should not use it
+        output=outputLines;
+        protocolError=(protocolError || terminated);
+        return false;
+    }
+
+    output=outputs.at(0);
+
+    if (!results.at(0))
+    {
+        RTI->log("ERROR: Unable to open WinSCP session");
+        stop();
+        return false;
+    }
+
+    RTI->log("WinSCP session opened.");
+    return true;
+}
+
+
+void ortWinSCPSession::stop()
+{
+    if (process.state()!=QProcess::NotRunning)
+    {
+        process.write("exit\n");
+        process.closeWriteChannel();
+
+        if (!process.waitForFinished(ORT_SESSION_EXITTIMEOUT))
+        {
+            process.kill();
+            process.waitForFinished(ORT_SESSION_EXITTIMEOUT);
+        }
+    }
+
+    pendingOutput.clear();
+
+    if (!xmlLogFilename.isEmpty())
+    {
+        QFile::remove(xmlLogFilename);
+        xmlLogFilename="";
+    }
+}
+
+
+bool ortWinSCPSession::execute(QStringList commands, int timeoutMs, QList<bool>& results, QList<QStringList>& outputs)
+{
+    results.clear();
+    outputs.clear();
+    outputLines.clear();
+    terminated=false;
+
+    if (!isRunning())
+    {
+        return false;
+    }
+
+    // Send all commands at once. The echo after each command marks the end of its output.
+    QByteArray script;
+
+    for (int i=0; i<commands.count(); i++)
+    {
+        markerCounter++;
+        script += commands.at(i).toLocal8Bit() + "\n";
+        script += "echo " + QByteArray(ORT_SESSION_MARKER) + QByteArray::number(markerCounter) + "\n";
+    }
+
+    process.write(script);
+
+    if (!readOutput(ORT_SESSION_MARKER + QString::number(markerCounter), timeoutMs))
+    {
+        // The session is opened again with the next call (e.g., if the connection was lost)
+        if (!isRunning())
+        {
+            RTI->log("ERROR: WinSCP session terminated unexpectedly.");
+            terminated=true;
+        }
+        else
+        {
+            RTI->log("ERROR: WinSCP session did not respond.");
+        }
+        RTI->log(outputLines.join("; "));
+        stop();
+        return false;
+    }
+
+    splitOutput(commands.count(), outputs);
+
+    if (!readResults(commands.count(), results))
+    {
+        RTI->log("ERROR: Unable to read command results from WinSCP log.");
+        protocolError=true;
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool ortWinSCPSession::readOutput(QString marker, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed()<timeoutMs)
+    {
+        if (!isRunning())
+        {
+            return false;
+        }
+
+        process.waitForReadyRead(100);
+        pendingOutput += process.readAll();
+
+        int lineEnd=pendingOutput.indexOf('\n');
+
+        while (lineEnd!=-1)
+        {
+            QString line=QString::fromLocal8Bit(pendingOutput.left(lineEnd)).trimmed();
+            pendingOutput.remove(0, lineEnd+1);
+
+            // The prompt is written without line break before each command is read
+            while (line.startsWith("winscp>"))
+            {
+                line=line.mid(7).trimmed();
+            }
+
+            outputLines.append(line);
+
+            if (line==marker)
+            {
+                return true;
+            }
+
+            lineEnd=pendingOutput.indexOf('\n');
+        }
+
+        RTI->processEvents();
+    }
+
+    return false;
+}
+
+
+void ortWinSCPSession::splitOutput(int count, QList<QStringList>& outputs)
+{
+    QStringList commandOutput;
+
+    for (int i=0; i<outputLines.count(); i++)
+    {
+        if (outputLines.at(i).startsWith(ORT_SESSION_MARKER))
+        {
+            outputs.append(commandOutput);
+            commandOutput.clear();
+        }
+        else
+        {
+            if (!outputLines.at(i).isEmpty())
+            {
+                commandOutput.append(outputLines.at(i));
+            }
+        }
+    }
+
+    while (outputs.count()<count)
+    {
+        outputs.append(QStringList());
+    }
+}
+
+
+bool ortWinSCPSession::readResults(int count, QList<bool>& results)
+{
+    // Each command is written as <group name="..."> with a <result success="..."/>
+    // element into the log when it has finished. Groups of the echo and option
+    // commands are skipped. Incomplete groups are read again with the next call.
+    QElapsedTimer timer;
+    timer.start();
+
+    while (true)
+    {
+        QFile xmlLog(xmlLogFilename);
+
+        if (xmlLog.open(QIODevice::ReadOnly))
+        {
+            const qint64 readOffset=xmlLogOffset;
+            xmlLog.seek(readOffset);
+            QByteArray data=xmlLog.readAll();
+            xmlLog.close();
+
+            int pos=0;
+            int groupStart=data.indexOf("<group", pos);
+
+            while (groupStart!=-1)
+            {
+                int groupEnd=data.indexOf("</group>", groupStart);
+
+                if (groupEnd==-1)
+                {
+                    break;
+                }
+
+                QByteArray group=data.mid(groupStart, groupEnd-groupStart);
+                pos=groupEnd+8;
+                xmlLogOffset=readOffset+pos;
+
+                int nameStart=group.indexOf("name=\"");
+                QByteArray name=group.mid(nameStart+6, group.indexOf('"', nameStart+6)-nameStart-6).trimmed().toLower();
+
+                if ((!name.startsWith("echo")) && (!name.startsWith("option")))
+                {
+                    results.append(group.contains("<result success=\"true\""));
+                }
+
+                groupStart=data.indexOf("<group", pos);
+            }
+        }
+
+        if (results.count()>=count)
+        {
+            break;
+        }
+
+        if (timer.elapsed()>ORT_SESSION_LOGWAIT)
+        {
+            break;
+        }
+
+        QThread::msleep(50);
+    }
+
+    return (results.count()==count);
+}
@@ -0,0 +1,61 @@
+#ifndef ORT_WINSCPSESSION_H
+#define ORT_WINSCPSESSION_H
+
+#include <QtCore>
+
+
+#define ORT_SESSION_MARKER      "ORT-SESSION-MARK-"
+#define ORT_SESSION_LOGWAIT     1000
+#define ORT_SESSION_EXITTIMEOUT 2000
+
+
+// Keeps one WinSCP process with an open connection to the server, so that the SSH
+// connection and the host-key exchange are done once per submission instead of once
+// per file operation. The commands are written to the standard input of WinSCP.com,
+// each followed by an echo of a marker to find the end of its output. Whether a
+// command succeeded is read from the XML log of WinSCP, which contains one group with
+// a result element for every command.
+//
+// If the XML log doesn't match the commands (e.g., an unexpected WinSCP version),
+// execute() reports a protocol error and the caller should fall back to running
+// WinSCP once per operation.
+class ortWinSCPSession
+{
+public:
+    ortWinSCPSession();
+    ~ortWinSCPSession();
+
+    bool start(QString winSCPPath, QString openCommand, int timeoutMs, QStringList& output);
+    void stop();
+    bool isRunning();
+
+    // Runs the commands in the session. Returns false if the session has failed (e.g.,
+    // timeout or protocol error), in which case it has been stopped. Otherwise, the
+    // result and output of each command are returned in the lists.
+    bool execute(QStringList commands, int timeoutMs, QList<bool>& results, QList<QStringList>& outputs);
+
+    bool isProtocolError();
+
+protected:
+    bool readOutput(QString marker, int timeoutMs);
+    bool readResults(int count, QList<bool>& results);
+    void splitOutput(int count, QList<QStringList>& outputs);
+
+    QProcess   process;
+    QString    xmlLogFilename;
+    qint64     xmlLogOffset;
+    QByteArray pendingOutput;
+    QStringList outputLines;
+    int        markerCounter;
+    bool       protocolError;
+    bool       terminated;
+};
+
+
+inline bool ortWinSCPSession::isProtocolError()
+{
+    return protocolError;
+}
+
+
+#endif // ORT_WINSCPSESSION_H
@@ -0,0 +1,343 @@
+#include <QtWidgets>
+#include <stdio.h>
+
+#include "ort_global.h"
+#include "ort_winscpsession.h"
+
+
+// Test of the WinSCP session. The test binary itself stands in for WinSCP.com (started
+// with the arguments that the session passes to WinSCP). It reads the commands from the
+// standard input, writes the output behind the prompt like WinSCP, and writes groups
+// copied from logs of WinSCP into the XML log.
+
+#define TEST_TIMEOUT 10000
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+static void writeLog(QFile& xmlLog, QString text)
+{
+    xmlLog.write(text.toUtf8());
+    xmlLog.flush();
+}
+
+
+static void writeOutput(QString text)
+{
+    fputs(text.toLocal8Bit().constData(), stdout);
+    fflush(stdout);
+}
+
+
+static int runFakeWinSCP(int argc, char *argv[])
+{
+    QString xmlLogFilename="";
+
+    for (int i=1; i<argc; i++)
+    {
+        if (QString(argv[i]).startsWith("/xmllog="))
+        {
+            xmlLogFilename=QString(argv[i]).mid(8);
+        }
+    }
+
+    QFile xmlLog(xmlLogFilename);
+
+    if (!xmlLog.open(QIODevice::WriteOnly))
+    {
+        return 1;
+    }
+
+    writeLog(xmlLog, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<session xmlns=\"http://winscp.net/schema/session/1.0\" name=\"test@localhost\" start=\"2024-05-02T09:12:40.512Z\">\n");
+
+    // The end of an upload group is written after the output of the following echo,
+    // so that the session finds an incomplete group in the log
+    QString pendingGroupEnd="";
+    char buffer[4096];
+
+    while (true)
+    {
+        writeOutput("winscp> ");
+
+        if (fgets(buffer, sizeof(buffer), stdin)==0)
+        {
+            return 2;
+        }
+
+        QString command=QString::fromLocal8Bit(buffer).trimmed();
+        QString group="<group name=\"" + command.toHtmlEscaped() + "\" start=\"2024-05-02T09:12:44.123Z\">\n";
+
+        if (command=="exit")
+        {
+            writeLog(xmlLog, "</session>\n");
+            return 0;
+        }
+        else if (command.startsWith("option"))
+        {
+            writeLog(xmlLog, group + "</group>\n");
+        }
+        else if (command.startsWith("echo "))
+        {
+            writeOutput(command.mid(5) + "\n");
+
+            if (!pendingGroupEnd.isEmpty())
+            {
+                QThread::msleep(300);
+                writeLog(xmlLog, pendingGroupEnd);
+                pendingGroupEnd="";
+            }
+
+            writeLog(xmlLog, group + "</group>\n");
+        }
+        else if (command.startsWith("open ") && command.contains("unknownhost"))
+        {
+            writeOutput("Searching for host...\nNetwork error: Connection to \"unknownhost\" refused.\n");
+            writeLog(xmlLog, group +
+                     "  <failure>\n"
+                     "    <message>Network error: Connection to &quot;unknownhost&quot; refused.</message>\n"
+                     "  </failure>\n"
+                     "</group>\n");
+        }
+        else if (command.startsWith("open "))
+        {
+            writeOutput("Searching for host...\nConnecting to host...\nAuthenticating...\nSession started.\nActive session: [1] test@localhost\n");
+            writeLog(xmlLog, group +
+                     "  <result success=\"true\" />\n"
+                     "</group>\n");
+        }
+        else if (command.startsWith("stat ") && command.contains("missing"))
+        {
+            // With "option batch continue", the failed command doesn't end the session
+            writeOutput("Can't get attributes of file '/data/missing.dat'.\nNo such file or directory.\n");
+            writeLog(xmlLog, group +
+                     "  <stat>\n"
+                     "    <filename value=\"/data/missing.dat\" />\n"
+                     "    <result success=\"false\">\n"
+                     "      <message>Can't get attributes of file '/data/missing.dat'.</message>\n"
+                     "      <message>No such file or directory.</message>\n"
+                     "    </result>\n"
+                     "  </stat>\n"
+                     "  <failure>\n"
+                     "    <message>Can't get attributes of file '/data/missing.dat'.</message>\n"
+                     "  </failure>\n"
+                     "</group>\n");
+        }
+        else if (command.startsWith("stat "))
+        {
+            writeOutput("-rw-r--r--   1 test     test     10240000 May  2 09:12:44 2024 scan.dat\n");
+            writeLog(xmlLog, group +
+                     "  <stat>\n"
+                     "    <filename value=\"/data/scan.dat\" />\n"
+                     "    <file>\n"
+                     "      <type value=\"-\" />\n"
+                     "      <size value=\"10240000\" />\n"
+                     "      <modification value=\"2024-05-02T09:12:44.000Z\" />\n"
+                     "      <permissions value=\"rw-r--r--\" />\n"
+                     "    </file>\n"
+                     "    <result success=\"true\" />\n"
+                     "  </stat>\n"
+                     "</group>\n");
+        }
+        else if (command.startsWith("put "))
+        {
+            writeOutput("scan.dat                  |       10000 KB |  51200.0 KB/s | binary | 100%\n");
+            writeLog(xmlLog, group +
+                     "  <upload>\n"
+                     "    <filename value=\"C:\\scan.dat\" />\n"
+                     "    <destination value=\"/data/scan.dat\" />\n");
+            pendingGroupEnd="    <size value=\"10240000\" />\n"
+                            "    <result success=\"true\" />\n"
+                            "  </upload>\n"
+                            "</group>\n";
+        }
+        else if (command=="crash")
+        {
+            writeOutput("Fatal error\n");
+            return 3;
+        }
+        else if (command=="hang")
+        {
+            QThread::msleep(60000);
+        }
+        else
+        {
+            // Log format of another WinSCP version, which the session can't read
+            writeOutput("Done\n");
+            writeLog(xmlLog, "<command name=\"" + command.toHtmlEscaped() + "\">\n"
+                             "  <result success=\"true\" />\n"
+                             "</command>\n");
+        }
+    }
+}
+
+
+static bool isClean(const QList<QStringList>& outputs)
+{
+    for (int i=0; i<outputs.count(); i++)
+    {
+        for (int j=0; j<outputs.at(i).count(); j++)
+        {
+            if ((outputs.at(i).at(j).startsWith("winscp>")) || (outputs.at(i).at(j).contains(ORT_SESSION_MARKER)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+int testCommands(QString winSCPPath)
+{
+    printf("Commands in one session\n");
+
+    ortWinSCPSession session;
+    QStringList output;
+
+    bool started=session.start(winSCPPath, "open sftp://test@localhost/", TEST_TIMEOUT, output);
+
+    check(started && session.isRunning(),     "Session opened");
+    check(output.contains("Session started."), "Output of open command returned");
+
+    QList<bool>        results;
+    QList<QStringList> outputs;
+
+    bool success=session.execute(QStringList() << "stat /data/scan.dat" << "stat /data/missing.dat" << "put C:\\scan.dat /data/",
+                                 TEST_TIMEOUT, results, outputs);
+
+    check(success,                                              "Commands executed");
+    check(results==(QList<bool>() << true << false << true),   "Failed command doesn't affect following commands");
+    check(outputs.count()==3,                                   "Output split by command");
+    check(outputs.value(0).join(" ").contains("10240000"),      "Output of first command");
+    check(outputs.value(1).contains("No such file or directory."), "Output of failed command");
+    check(isClean(outputs),                                     "Prompts and markers removed");
+
+    // The groups of the earlier commands must not be read again
+    success=session.execute(QStringList("stat /data/scan.dat"), TEST_TIMEOUT, results, outputs);
+
+    check(success && (results==(QList<bool>() << true)),       "Results of next call read from log offset");
+    check(session.isRunning(),                                  "Session still running");
+
+    session.stop();
+    check(!session.isRunning(),                                 "Session stopped");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testOpenFailure(QString winSCPPath)
+{
+    printf("Failed connection\n");
+
+    ortWinSCPSession session;
+    QStringList output;
+
+    bool started=session.start(winSCPPath, "open sftp://test@unknownhost/", TEST_TIMEOUT, output);
+
+    check(!started,                                       "Start reports failure");
+    check(!session.isProtocolError(),                     "No protocol error reported");
+    check(!session.isRunning(),                           "Session stopped");
+    check(output.join(" ").contains("Network error"),    "Output of open command returned");
+
+    started=session.start(QDir::temp().absoluteFilePath("yarra_missing_winscp_1234"), "open sftp://test@localhost/", TEST_TIMEOUT, output);
+
+    check(!started && session.isProtocolError(),          "Missing WinSCP reported as protocol error");
+
+    printf("\n");
+    return 0;
+}
+
+
+int testSessionFailures(QString winSCPPath)
+{
+    printf("Session failures\n");
+
+    ortWinSCPSession session;
+    QStringList        output;
+    QList<bool>        results;
+    QList<QStringList> outputs;
+
+    // WinSCP ends while the commands are executed (e.g., connection lost)
+    session.start(winSCPPath, "open sftp://test@localhost/", TEST_TIMEOUT, output);
+    bool success=session.execute(QStringList("crash"), TEST_TIMEOUT, results, outputs);
+
+    check(!success,                                       "Terminated session reported");
+    check(!session.isProtocolError(),                     "No protocol error reported");
+    check(!session.isRunning(),                           "Session stopped");
+
+    // The session can be opened again afterwards
+    bool started=session.start(winSCPPath, "open sftp://test@localhost/", TEST_TIMEOUT, output);
+    check(started,                                        "Session opened again");
+
+    // The log doesn't contain the groups that the session expects
+    success=session.execute(QStringList("call ls"), TEST_TIMEOUT, results, outputs);
+
+    check(!success,                                       "Unreadable log reported");
+    check(session.isProtocolError(),                      "Protocol error reported");
+    check(!session.isRunning(),                           "Session stopped");
+
+    // WinSCP doesn't respond
+    session.start(winSCPPath, "open sftp://test@localhost/", TEST_TIMEOUT, output);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    success=session.execute(QStringList("hang"), 1000, results, outputs);
+
+    printf("  Returned after %lld ms\n", timer.elapsed());
+
+    check(!success,                                       "Timeout reported");
+    check(!session.isProtocolError(),                     "No protocol error reported");
+    check(!session.isRunning(),                           "Session stopped");
+    check(timer.elapsed()<1000+2*ORT_SESSION_EXITTIMEOUT+2000, "Hanging WinSCP killed");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    // Started by the session as stand-in for WinSCP.com
+    if ((argc>1) && (QString(argv[1])=="/ini=nul"))
+    {
+        return runFakeWinSCP(argc, argv);
+    }
+
+    QApplication app(argc, argv);
+
+    printf("\nYarra ORT - WinSCP Session Test\n");
+    printf("-------------------------------\n\n");
+
+    QString winSCPPath=app.applicationFilePath();
+
+    testCommands(winSCPPath);
+    testOpenFailure(winSCPPath);
+    testSessionFailures(winSCPPath);
+
+    QStringList xmlLogs=QDir::temp().entryList(QStringList("ort_winscp_" + QString::number(QCoreApplication::applicationPid()) + "_*.xml"), QDir::Files);
+    check(xmlLogs.isEmpty(), "XML logs removed");
+    printf("\n");
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Test of the WinSCP session with a stand-in for WinSCP
+#
+#-------------------------------------------------
+
+QT       += core widgets gui network
+
+TARGET = ort_winscpsession_test
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += YARRA_APP_ORT
+
+
+SOURCES += ort_winscpsession_test.cpp \
+    ort_winscpsession.cpp \
+    ../Client/rds_runtimeinformation.cpp \
+    ../Client/rds_log.cpp
+
+HEADERS += \
+    ort_global.h \
+    ort_winscpsession.h \
+    ../Client/rds_runtimeinformation.h \
+    ../Client/rds_log.h
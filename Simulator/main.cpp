@@ -24,6 +24,12 @@ int filesize=10240000;
 int fileIDOffset=5100;
 int measIDOffset=300;
 
+// Number of entries in the directory listing (can be increased for benchmarking the parser)
+int fileCount=23;
+
+// Delay in ms after each directory line (can be set for simulating a slow RaidTool)
+int lineDelay=0;
+
 // 0=info, 1=directory, 2=filecopy
 int mode=0;
 
@@ -31,6 +37,8 @@ int main(int argc, char *argv[])
 {
 
     bool nextIsFilename=false;
+    bool nextIsCount=false;
+    bool nextIsDelay=false;
 
 
     for (int i=0; i<argc; i++)
@@ -41,6 +49,28 @@ int main(int argc, char *argv[])
             nextIsFilename=false;
         }
 
+        if (nextIsCount)
+        {
+            fileCount=atoi(argv[i]);
+            nextIsCount=false;
+        }
+
+        if (nextIsDelay)
+        {
+            lineDelay=atoi(argv[i]);
+            nextIsDelay=false;
+        }
+
+        if (strcmp(argv[i], "-n")==0)
+        {
+            nextIsCount=true;
+        }
+
+        if (strcmp(argv[i], "-w")==0)
+        {
+            nextIsDelay=true;
+        }
+
         if (strcmp(argv[i], "-d")==0)
         {
             mode=1;
@@ -90,7 +120,16 @@ int main(int argc, char *argv[])
         char cTimeString[32];
         char fTimeString[32];
 
-        int fileCount=23;
+        // Keep the file and meas IDs positive for long listings
+        if (fileIDOffset<=fileCount)
+        {
+            fileIDOffset=fileCount+100;
+        }
+        if (measIDOffset<=fileCount)
+        {
+            measIDOffset=fileCount+100;
+        }
+
         for (int i=0; i<fileCount; i++)
         {
             time ( &rawtime );
@@ -100,7 +139,7 @@ int main(int argc, char *argv[])
             sprintf(fTimeString, "%02d.%02d.%4d %02d:%02d:%02d", timeinfo->tm_mday, timeinfo->tm_mon+1, timeinfo->tm_year+1900, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
             sprintf(cTimeString, "%02d.%02d.%4d %02d:%02d:%02d", timeinfo->tm_mday, timeinfo->tm_mon+1, timeinfo->tm_year+1900, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
 
-#define ENRTY(j,a,b) if (i%fileCount==j) { strcpy(patName, a); strcpy(protName, b); };
+#define ENRTY(j,a,b) if (i%23==j) { strcpy(patName, a); strcpy(protName, b); };
 
             ENRTY(0 ,"Lebowski^Jeffrey","T1 Post ax")
             ENRTY(1 ,"Lebowski^Jeffrey","GRASP ax_YP8")
@@ -137,6 +176,12 @@ int main(int argc, char *argv[])
               cTimeString,
               fTimeString);
             printf("\n");
+
+            if (lineDelay>0)
+            {
+                fflush(stdout);
+                QThread::msleep(lineDelay);
+            }
         }
     }
 
@@ -17,27 +17,41 @@ SOURCES += main.cpp\
     ../Client/rds_runtimeinformation.cpp \
     ../Client/rds_log.cpp \
     ../Client/rds_exechelper.cpp \
+    ../Client/rds_processrunner.cpp \
     ../Client/rds_network.cpp \
+    ../Client/rds_copyengine.cpp \
+    ../Client/rds_checksum.cpp \
     ../OfflineReconClient/ort_modelist.cpp \
     sac_bootdialog.cpp \
     sac_batchdialog.cpp \
     sac_network.cpp \
     sac_copydialog.cpp \
     sac_configurationdialog.cpp \
+    sac_batchsubmitter.cpp \
     ../NetLogger/netlogger.cpp \
+    ../NetLogger/netlog_sender.cpp \
     ../CloudAgent/yca_threadlog.cpp \
     ../CloudTools/yct_configuration.cpp \
     ../CloudTools/yct_aws/qtawsqnam.cpp \
     ../CloudTools/yct_aws/qtaws.cpp \
+    ../CloudTools/yct_aws/qtawss3.cpp \
     ../CloudTools/yct_api.cpp \
-    ../CloudTools/yct_prepare/yct_twix_anonymizer.cpp
+    ../CloudTools/yct_dicompatcher.cpp \
+    ../CloudTools/yct_prepare/yct_twix_anonymizer.cpp \
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.cpp \
+    ../CloudTools/yct_prepare/yct_twix_probe.cpp
 
 
 HEADERS  += sac_mainwindow.h \
     ../Client/rds_runtimeinformation.h \
     ../Client/rds_log.h \
     ../Client/rds_exechelper.h \
+    ../NetLogger/netlogger.h \
+    ../NetLogger/netlog_sender.h \
+    ../Client/rds_processrunner.h \
     ../Client/rds_network.h \
+    ../Client/rds_copyengine.h \
+    ../Client/rds_checksum.h \
     ../OfflineReconClient/ort_modelist.h \
     ../OfflineReconClient/ort_returnonfocus.h \
     sac_global.h \
@@ -46,12 +60,16 @@ HEADERS  += sac_mainwindow.h \
     sac_network.h \
     sac_copydialog.h \
     sac_configurationdialog.h \
-    sac_twixheader.h \
+    sac_batchsubmitter.h \
     ../CloudTools/yct_common.h \
     ../CloudTools/yct_aws/qtawsqnam.h \
     ../CloudTools/yct_aws/qtaws.h \
+    ../CloudTools/yct_aws/qtawss3.h \
     ../CloudTools/yct_prepare/yct_twix_anonymizer.h \
-    ../CloudTools/yct_api.h
+    ../CloudTools/yct_prepare/yct_twix_tagmatcher.h \
+    ../CloudTools/yct_prepare/yct_twix_probe.h \
+    ../CloudTools/yct_api.h \
+    ../CloudTools/yct_dicompatcher.h
 
 
 FORMS    += sac_mainwindow.ui \
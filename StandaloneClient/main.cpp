@@ -4,6 +4,7 @@
 #include <QApplication>
 #include <QStyleFactory>
 #include "sac_batchdialog.h"
+#include "sac_batchsubmitter.h"
 
 
 int main(int argc, char *argv[])
@@ -16,9 +17,18 @@ int main(int argc, char *argv[])
     parser.addHelpOption();
     QCommandLineOption batchSubmitOption("b","batch file name","batch","");
     parser.addOption(batchSubmitOption);
+    QCommandLineOption parallelOption("j","number of parallel transfers in batch mode","count",QString::number(SAC_BATCH_PARALLEL));
+    parser.addOption(parallelOption);
+    QCommandLineOption serverOption("s","server path for batch mode (overrides configuration)","path","");
+    parser.addOption(serverOption);
     parser.process(a);
     bool batchSubmit = parser.isSet(batchSubmitOption);
 
+    if ((batchSubmit) && (parser.isSet(serverOption)))
+    {
+        sacNetwork::serverPathOverride=parser.value(serverOption);
+    }
+
     // Set color scheme
     qApp->setStyle(QStyleFactory::create("Fusion"));
     QPalette palette=QPalette(QColor(240,240,240),QColor(240,240,240));
@@ -85,7 +95,14 @@ int main(int argc, char *argv[])
             }
 
             qInfo() << "Done reading batch file.";
-            w->submitBatch(files_l,modes_l,notify,priority);
+
+            sacBatchSubmitter submitter(w);
+            submitter.setParallelTransfers(parser.value(parallelOption).toInt());
+
+            if (!submitter.run(file,files_l,modes_l,notify,priority))
+            {
+                returnValue=1;
+            }
         }
     }
 
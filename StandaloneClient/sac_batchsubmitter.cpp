@@ -0,0 +1,752 @@
+#include "sac_batchsubmitter.h"
+#include "../Client/rds_copyengine.h"
+#include "../Client/rds_runtimeinformation.h"
+
+
+sacBatchTransfer::sacBatchTransfer()
+{
+    setAutoDelete(false);
+
+    sourceName="";
+    targetNames.clear();
+    presentTargets.clear();
+    duplicateOnServer=true;
+
+    success=false;
+    errorString="";
+    bytes=0;
+    resumedBytes=0;
+    throughput=0;
+
+    finished=0;
+}
+
+
+void sacBatchTransfer::run()
+{
+    success=false;
+
+    QFileInfo    srcinfo(sourceName);
+    QStorageInfo storage(QFileInfo(targetNames.at(0)).absolutePath());
+
+    qint64 requiredSpace=srcinfo.size()*(targetNames.count()-presentTargets.count());
+
+    if ((storage.isValid()) && (storage.isReady()) && (requiredSpace>storage.bytesAvailable()))
+    {
+        errorString="Not enough diskspace on server available.";
+        finished.storeRelease(1);
+        return;
+    }
+
+    bool copyError=false;
+    int  i=0;
+
+    for (i=0; i<targetNames.count(); i++)
+    {
+        // Complete copy from an interrupted run
+        if (presentTargets.contains(targetNames.at(i)))
+        {
+            continue;
+        }
+
+        if ((i==0) || (!duplicateOnServer))
+        {
+            rdsCopyEngine engine;
+            engine.setResume(true);
+
+            if (engine.copy(sourceName, targetNames.at(i)))
+            {
+                bytes       +=engine.getBytesCopied()-engine.getResumedBytes();
+                resumedBytes+=engine.getResumedBytes();
+
+                if (i==0)
+                {
+                    throughput=engine.getThroughput();
+                }
+            }
+            else
+            {
+                errorString=engine.getErrorString();
+                copyError=true;
+            }
+        }
+        else
+        {
+            if (QFile::exists(targetNames.at(i)))
+            {
+                errorString="Filename already exists on server.";
+                copyError=true;
+            }
+            else
+            {
+                // Like the copy engine, write the duplicate under a partial name first. A
+                // duplicate that is interrupted can't be mistaken for a complete copy then.
+                QString partName=targetNames.at(i)+RDS_COPY_PARTIAL_EXT;
+                QFile::remove(partName);
+
+                if ((!QFile::copy(targetNames.at(0), partName)) || (!QFile::rename(partName, targetNames.at(i))))
+                {
+                    errorString="Unable to duplicate file on server.";
+                    QFile::remove(partName);
+                    copyError=true;
+                }
+            }
+        }
+
+        if (copyError)
+        {
+            break;
+        }
+    }
+
+    if (copyError)
+    {
+        // Remove the complete copies, so that all scan files are transferred again with the
+        // next attempt. A partial file of the first copy is kept to resume the transfer.
+        for (int j=0; j<i; j++)
+        {
+            QFile::remove(targetNames.at(j));
+        }
+    }
+    else
+    {
+        success=true;
+    }
+
+    finished.storeRelease(1);
+}
+
+
+sacBatchItem::sacBatchItem()
+{
+    filename="";
+    scanBasename="";
+    pendingModes.clear();
+    scanFiles.clear();
+    failedModes.clear();
+    interruptedScanFiles.clear();
+    presentScanFiles.clear();
+    tasks.clear();
+
+    state=Pending;
+    attempts=0;
+    nextAttempt=QDateTime();
+
+    bytes=0;
+    throughput=0;
+
+    transfer=0;
+}
+
+
+sacBatchSubmitter::sacBatchSubmitter(sacMainWindow* mainWindow)
+{
+    parent=mainWindow;
+    parallelTransfers=SAC_BATCH_PARALLEL;
+
+    journalFilename="";
+    notification="";
+    taskPriority=TaskPriority::Normal;
+}
+
+
+sacBatchSubmitter::~sacBatchSubmitter()
+{
+    transferPool.waitForDone();
+
+    for (int i=0; i<items.count(); i++)
+    {
+        if (items.at(i).transfer!=0)
+        {
+            delete items.at(i).transfer;
+            items[i].transfer=0;
+        }
+    }
+}
+
+
+void sacBatchSubmitter::setParallelTransfers(int count)
+{
+    parallelTransfers=qBound(1, count, SAC_BATCH_PARALLEL_MAX);
+}
+
+
+bool sacBatchSubmitter::run(QString batchFilename, QStringList files, QStringList modes, QString notify, TaskPriority priority)
+{
+    journalFilename=batchFilename+SAC_BATCH_JOURNAL_EXT;
+    notification=notify;
+    taskPriority=priority;
+
+    items.clear();
+    reservedNames.clear();
+
+    for (int i=0; i<files.count(); i++)
+    {
+        QFileInfo fileinfo(files.at(i));
+
+        sacBatchItem item;
+        item.filename    =fileinfo.absoluteFilePath();
+        item.scanBasename=fileinfo.fileName();
+        item.pendingModes=modes;
+        items.append(item);
+    }
+
+    readJournal();
+
+    transferPool.setMaxThreadCount(parallelTransfers);
+
+    RTI->log("Submitting batch with " + QString::number(items.count()) + " files (" + QString::number(parallelTransfers) + " parallel transfers)");
+    qInfo() << "Submitting" << items.count() << "files with" << parallelTransfers << "parallel transfers...";
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (true)
+    {
+        int  activeTransfers=0;
+        bool busy=false;
+
+        // Evaluate the transfers that have finished
+        for (int i=0; i<items.count(); i++)
+        {
+            if (items.at(i).state==sacBatchItem::Transferring)
+            {
+                if (items.at(i).transfer->finished.loadAcquire())
+                {
+                    finishTransfer(i);
+                }
+                else
+                {
+                    activeTransfers++;
+                }
+            }
+        }
+
+        // Start the next transfers (or submit files that were transferred by an interrupted run)
+        QDateTime now=QDateTime::currentDateTime();
+
+        for (int i=0; i<items.count(); i++)
+        {
+            if (items.at(i).state==sacBatchItem::Transferred)
+            {
+                // Count as attempt, so that failing to write the task files is retried
+                items[i].attempts++;
+
+                if (prepareTasks(i))
+                {
+                    writeTaskFiles(i);
+                }
+            }
+
+            if ((items.at(i).state==sacBatchItem::Pending) && (activeTransfers<parallelTransfers)
+                && ((!items.at(i).nextAttempt.isValid()) || (items.at(i).nextAttempt<=now)))
+            {
+                startTransfer(i);
+
+                if (items.at(i).state==sacBatchItem::Transferring)
+                {
+                    activeTransfers++;
+                }
+            }
+
+            if ((items.at(i).state==sacBatchItem::Pending) || (items.at(i).state==sacBatchItem::Transferring)
+                || (items.at(i).state==sacBatchItem::Transferred))
+            {
+                busy=true;
+            }
+        }
+
+        if (!busy)
+        {
+            break;
+        }
+
+        RTI->processEvents();
+        QThread::msleep(SAC_BATCH_POLLINTERVAL);
+    }
+
+    transferPool.waitForDone();
+
+    printSummary(timer.elapsed());
+
+    bool success=true;
+
+    for (int i=0; i<items.count(); i++)
+    {
+        if (items.at(i).state!=sacBatchItem::Done)
+        {
+            success=false;
+        }
+    }
+
+    // Keep the journal if files are missing, so that running the batch again only submits these
+    if (success)
+    {
+        QFile::remove(journalFilename);
+    }
+
+    return success;
+}
+
+
+void sacBatchSubmitter::readJournal()
+{
+    if (!QFile::exists(journalFilename))
+    {
+        return;
+    }
+
+    QSettings journal(journalFilename, QSettings::IniFormat);
+
+    int matchedCount=0;
+    int submittedCount=0;
+
+    for (int i=0; i<items.count(); i++)
+    {
+        journal.beginGroup("File"+QString::number(i));
+
+        // Only use the entry if the batch file hasn't been changed
+        if (journal.value("Path","").toString()==items.at(i).filename)
+        {
+            matchedCount++;
+
+            int state=journal.value("State",sacBatchItem::Pending).toInt();
+
+            items[i].pendingModes=journal.value("PendingModes",QStringList()).toStringList();
+            items[i].scanFiles   =journal.value("ScanFiles",QStringList()).toStringList();
+
+            switch (state)
+            {
+            case sacBatchItem::Done:
+                items[i].state=sacBatchItem::Done;
+                submittedCount++;
+                break;
+
+            case sacBatchItem::Transferred:
+                items[i].state=sacBatchItem::Transferred;
+
+                // Transfer the file again if the scan files are incomplete
+                if (items.at(i).scanFiles.count()!=items.at(i).pendingModes.count())
+                {
+                    items[i].state=sacBatchItem::Pending;
+                }
+                for (int j=0; (j<items.at(i).scanFiles.count()) && (items.at(i).state==sacBatchItem::Transferred); j++)
+                {
+                    if (!parent->network.fileExistsOnServer(items.at(i).scanFiles.at(j)))
+                    {
+                        items[i].state=sacBatchItem::Pending;
+                    }
+                }
+                break;
+
+            default:
+                // Scan files of a transfer that was interrupted. They might have been copied
+                // completely before the run ended, which is checked when the file is prepared.
+                items[i].interruptedScanFiles=items.at(i).scanFiles;
+
+                // Failed modes are tried again
+                items[i].state=sacBatchItem::Pending;
+                items[i].pendingModes.append(journal.value("FailedModes",QStringList()).toStringList());
+                break;
+            }
+
+            if (items.at(i).state==sacBatchItem::Pending)
+            {
+                items[i].scanFiles.clear();
+            }
+        }
+
+        journal.endGroup();
+    }
+
+    if (matchedCount==0)
+    {
+        return;
+    }
+
+    RTI->log("Continuing batch from journal " + journalFilename + " (" + QString::number(submittedCount) + " files already submitted)");
+    qInfo() << "Continuing interrupted batch," << submittedCount << "of" << items.count() << "files already submitted.";
+}
+
+
+void sacBatchSubmitter::writeJournal(int index)
+{
+    const sacBatchItem& item=items.at(index);
+
+    // Running transfers start again from the beginning (resuming the partial file)
+    int state=item.state;
+
+    if (state==sacBatchItem::Transferring)
+    {
+        state=sacBatchItem::Pending;
+    }
+
+    QSettings journal(journalFilename, QSettings::IniFormat);
+
+    journal.beginGroup("File"+QString::number(index));
+    journal.setValue("Path",         item.filename);
+    journal.setValue("State",        state);
+    journal.setValue("PendingModes", item.pendingModes);
+    journal.setValue("ScanFiles",    item.scanFiles);
+    journal.setValue("FailedModes",  item.failedModes);
+    journal.endGroup();
+
+    journal.sync();
+
+    if (journal.status()!=QSettings::NoError)
+    {
+        RTI->log("WARNING: Unable to write batch journal " + journalFilename);
+    }
+}
+
+
+QString sacBatchSubmitter::reserveScanFilename(QString filename, int index)
+{
+    // Files with the same name can be transferred at the same time, so the names are
+    // reserved before the transfer (the check for existing files on the server doesn't
+    // see files that are still being copied). A retry gets the same name again, so that
+    // the partial file of the failed attempt is resumed.
+    QFileInfo fileinfo(filename);
+    QString   candidate=filename;
+
+    for (int i=2; reservedNames.value(candidate.toLower(), index)!=index; i++)
+    {
+        candidate=fileinfo.completeBaseName() + "_" + QString::number(i) + "." + fileinfo.suffix();
+    }
+
+    reservedNames.insert(candidate.toLower(), index);
+    return candidate;
+}
+
+
+bool sacBatchSubmitter::isCompleteCopy(int index, QString scanFilename)
+{
+    // Copies and duplicates are written to a partial file first and renamed when complete,
+    // so a scan file with the size of the source file is a complete copy
+    QFileInfo scanFile(parent->network.serverDir.absoluteFilePath(scanFilename));
+
+    return ((scanFile.exists()) && (scanFile.size()==QFileInfo(items.at(index).filename).size()));
+}
+
+
+bool sacBatchSubmitter::prepareTasks(int index)
+{
+    sacBatchItem& item=items[index];
+
+    bool transferred=(item.state==sacBatchItem::Transferred);
+
+    QString patientName="";
+    QString protocolName="";
+    parent->analyzeDatFile(item.filename, patientName, protocolName);
+
+    QFileInfo   fileinfo(item.scanBasename);
+    QStringList validModes;
+    QStringList validScanFiles;
+
+    item.tasks.clear();
+    item.presentScanFiles.clear();
+
+    for (int i=0; i<item.pendingModes.count(); i++)
+    {
+        Task the_task;
+        the_task.patientName =patientName;
+        the_task.protocolName=protocolName;
+
+        QString scanFilename="";
+        bool    present=false;
+
+        if (transferred)
+        {
+            scanFilename=item.scanFiles.at(i);
+        }
+        else
+        {
+            if ((i<item.interruptedScanFiles.count()) && (isCompleteCopy(index, item.interruptedScanFiles.at(i))))
+            {
+                // The copy of the interrupted run completed but wasn't written into the journal.
+                // Use it instead of copying the file again with a new name.
+                scanFilename=reserveScanFilename(item.interruptedScanFiles.at(i), index);
+                present=(scanFilename==item.interruptedScanFiles.at(i));
+
+                if (present)
+                {
+                    RTI->log("Using complete copy of interrupted run: " + scanFilename);
+                }
+            }
+            else
+            {
+                scanFilename=item.scanBasename;
+
+                if (i>0)
+                {
+                    scanFilename=fileinfo.completeBaseName() + "_" + QString::number(i+1) + "." + fileinfo.suffix();
+                }
+
+                scanFilename=reserveScanFilename(scanFilename, index);
+            }
+        }
+
+        if (parent->prepareBatchTask(item.filename, scanFilename, item.pendingModes.at(i), notification, taskPriority, the_task, (!transferred) && (!present)))
+        {
+            reservedNames.insert(the_task.scanFilename.toLower(), index);
+            item.tasks.append(the_task);
+            validModes.append(item.pendingModes.at(i));
+            validScanFiles.append(the_task.scanFilename);
+
+            if (present)
+            {
+                item.presentScanFiles.append(the_task.scanFilename);
+            }
+        }
+        else
+        {
+            // The mode doesn't exist on the server, so retrying won't help
+            RTI->log("ERROR: Unable to submit " + item.filename + " for mode " + item.pendingModes.at(i));
+            item.failedModes.append(item.pendingModes.at(i));
+
+            if ((transferred) || (present))
+            {
+                QFile::remove(parent->network.serverDir.absoluteFilePath(scanFilename));
+            }
+        }
+    }
+
+    item.pendingModes=validModes;
+    item.scanFiles   =validScanFiles;
+    item.interruptedScanFiles.clear();
+
+    if (item.tasks.isEmpty())
+    {
+        item.state=sacBatchItem::Failed;
+        writeJournal(index);
+        return false;
+    }
+
+    return true;
+}
+
+
+void sacBatchSubmitter::startTransfer(int index)
+{
+    sacBatchItem& item=items[index];
+
+    if (!QFile::exists(item.filename))
+    {
+        RTI->log("ERROR: File of batch not found " + item.filename);
+        qCritical() << "File not found:" << item.filename;
+        item.state=sacBatchItem::Failed;
+        writeJournal(index);
+        return;
+    }
+
+    if (!prepareTasks(index))
+    {
+        return;
+    }
+
+    item.attempts++;
+
+    if (item.presentScanFiles.count()==item.tasks.count())
+    {
+        // All scan files have been copied completely by an interrupted run
+        item.presentScanFiles.clear();
+        item.state=sacBatchItem::Transferred;
+        writeJournal(index);
+        writeTaskFiles(index);
+        return;
+    }
+
+    item.transfer=new sacBatchTransfer();
+    item.transfer->sourceName=item.filename;
+    item.transfer->duplicateOnServer=parent->network.deduplicateBatch;
+
+    for (int i=0; i<item.tasks.count(); i++)
+    {
+        item.transfer->targetNames.append(parent->network.serverDir.absoluteFilePath(item.tasks.at(i).scanFilename));
+    }
+
+    for (int i=0; i<item.presentScanFiles.count(); i++)
+    {
+        item.transfer->presentTargets.append(parent->network.serverDir.absoluteFilePath(item.presentScanFiles.at(i)));
+    }
+    item.presentScanFiles.clear();
+
+    item.state=sacBatchItem::Transferring;
+
+    // Note the scan files in the journal, so that a complete copy can be found if the
+    // run is interrupted before the transfer has been journaled as finished
+    writeJournal(index);
+
+    RTI->log("Transferring " + item.filename + " (attempt " + QString::number(item.attempts) + ")");
+    qInfo() << "Transferring" << item.filename;
+
+    transferPool.start(item.transfer);
+}
+
+
+void sacBatchSubmitter::finishTransfer(int index)
+{
+    sacBatchItem& item=items[index];
+
+    sacBatchTransfer* transfer=item.transfer;
+    item.transfer=0;
+
+    if (transfer->success)
+    {
+        item.bytes+=transfer->bytes;
+        item.throughput=transfer->throughput;
+
+        if (transfer->resumedBytes>0)
+        {
+            RTI->log("Resumed transfer of partial file after " + QString::number(transfer->resumedBytes) + " bytes");
+        }
+        RTI->log("Transferred " + item.filename + ". Transfer rate: " + rdsCopyEngine::formatThroughput(transfer->throughput));
+
+        parent->network.netLogger.postEvent(EventInfo::Type::Transfer,EventInfo::Detail::FileTransfer,EventInfo::Severity::Success, item.filename,
+                                            rdsCopyEngine::formatTransferData(QFileInfo(transfer->sourceName).size(), transfer->resumedBytes, item.attempts, transfer->throughput));
+
+        item.state=sacBatchItem::Transferred;
+        writeJournal(index);
+        writeTaskFiles(index);
+    }
+    else
+    {
+        item.tasks.clear();
+        item.scanFiles.clear();
+        scheduleRetry(index, transfer->errorString);
+    }
+
+    delete transfer;
+}
+
+
+void sacBatchSubmitter::writeTaskFiles(int index)
+{
+    sacBatchItem& item=items[index];
+
+    // The tasks have the same order as the pending modes and scan files. Submitted modes
+    // are removed one by one, so that the journal never lists a mode twice.
+    int  pos=0;
+    bool taskError=false;
+
+    for (int i=0; i<item.tasks.count(); i++)
+    {
+        if (parent->generateTaskFile(item.tasks[i]))
+        {
+            item.pendingModes.removeAt(pos);
+            item.scanFiles.removeAt(pos);
+            writeJournal(index);
+        }
+        else
+        {
+            RTI->log("ERROR: Unable to generate task file for " + item.filename + " (" + item.tasks.at(i).mode + ")");
+
+            // Task-file creation failed, so remove scan file
+            QFile::remove(parent->network.serverDir.absoluteFilePath(item.tasks.at(i).scanFilename));
+            taskError=true;
+            pos++;
+        }
+    }
+
+    item.tasks.clear();
+
+    if (taskError)
+    {
+        item.scanFiles.clear();
+        scheduleRetry(index, "Unable to generate task file.");
+        return;
+    }
+
+    if (item.failedModes.isEmpty())
+    {
+        item.state=sacBatchItem::Done;
+        qInfo() << "Submitted" << item.filename;
+    }
+    else
+    {
+        item.state=sacBatchItem::Failed;
+        qCritical() << "Submitting" << item.filename << "<" << item.failedModes.join(", ") << "> failed.";
+    }
+
+    writeJournal(index);
+}
+
+
+void sacBatchSubmitter::scheduleRetry(int index, QString reason)
+{
+    sacBatchItem& item=items[index];
+
+    RTI->log("ERROR: Submitting " + item.filename + " failed: " + reason);
+
+    if (item.attempts>=SAC_BATCH_RETRIES)
+    {
+        RTI->log("ERROR: Giving up on " + item.filename + " after " + QString::number(item.attempts) + " attempts");
+        qCritical() << "Submitting" << item.filename << "<" << item.pendingModes.join(", ") << "> failed.";
+        item.state=sacBatchItem::Failed;
+    }
+    else
+    {
+        // Double the delay with every attempt, so that a busy server or network has time to recover
+        int delay=qMin(SAC_BATCH_BACKOFF << qMax(item.attempts-1,0), SAC_BATCH_BACKOFF_MAX);
+
+        RTI->log("Retrying in " + QString::number(delay/1000) + " sec");
+        qWarning() << "Submitting" << item.filename << "failed, retrying in" << delay/1000 << "sec.";
+
+        item.state=sacBatchItem::Pending;
+        item.nextAttempt=QDateTime::currentDateTime().addMSecs(delay);
+    }
+
+    writeJournal(index);
+}
+
+
+void sacBatchSubmitter::printSummary(qint64 elapsed)
+{
+    int    submittedCount=0;
+    int    failedCount=0;
+    qint64 totalBytes=0;
+
+    for (int i=0; i<items.count(); i++)
+    {
+        totalBytes+=items.at(i).bytes;
+
+        if (items.at(i).state==sacBatchItem::Done)
+        {
+            submittedCount++;
+        }
+        else
+        {
+            failedCount++;
+        }
+    }
+
+    double throughput=0;
+
+    if (elapsed>0)
+    {
+        throughput=double(totalBytes)*1000.0/double(elapsed);
+    }
+
+    QString summary=QString::number(submittedCount) + " of " + QString::number(items.count()) + " files submitted, "
+                    + QString::number(failedCount) + " failed. Transferred " + QString::number(double(totalBytes)/1048576.0, 'f', 1)
+                    + " MB in " + QString::number(double(elapsed)/1000.0, 'f', 1) + " sec (" + rdsCopyEngine::formatThroughput(throughput) + ")";
+
+    RTI->log("Batch summary: " + summary);
+    qInfo().noquote() << summary;
+
+    for (int i=0; i<items.count(); i++)
+    {
+        if (items.at(i).state!=sacBatchItem::Done)
+        {
+            QStringList modes=items.at(i).pendingModes+items.at(i).failedModes;
+            qInfo().noquote() << "  Failed:" << items.at(i).filename << "<" << modes.join(", ") << ">";
+        }
+        else
+        {
+            if (items.at(i).bytes>0)
+            {
+                qInfo().noquote() << "  " << items.at(i).filename << "(" + rdsCopyEngine::formatThroughput(items.at(i).throughput) + ")";
+            }
+        }
+    }
+}
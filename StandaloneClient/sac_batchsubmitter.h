@@ -0,0 +1,121 @@
+#ifndef SAC_BATCHSUBMITTER_H
+#define SAC_BATCHSUBMITTER_H
+
+#include <QtCore>
+
+#include "sac_mainwindow.h"
+
+#define SAC_BATCH_PARALLEL     2
+#define SAC_BATCH_PARALLEL_MAX 8
+#define SAC_BATCH_RETRIES      5
+#define SAC_BATCH_BACKOFF      10000
+#define SAC_BATCH_BACKOFF_MAX  300000
+#define SAC_BATCH_POLLINTERVAL 100
+#define SAC_BATCH_JOURNAL_EXT  ".journal"
+
+
+// Transfers one file of the batch to the server. The first scan file is copied with
+// the copy engine (resuming a partial file from an interrupted run), the scan files
+// for the other modes are duplicated on the server or copied again if deduplication
+// has been disabled. Runs on the thread pool of the batch submitter, so it must not
+// write to the log. The results are evaluated by the submitter when finished is set.
+class sacBatchTransfer : public QRunnable
+{
+public:
+    sacBatchTransfer();
+    void run();
+
+    QString     sourceName;
+    QStringList targetNames;
+    QStringList presentTargets;
+    bool        duplicateOnServer;
+
+    bool    success;
+    QString errorString;
+    qint64  bytes;
+    qint64  resumedBytes;
+    double  throughput;
+
+    QAtomicInt finished;
+};
+
+
+// State of one file of the batch
+class sacBatchItem
+{
+public:
+    enum State
+    {
+        Pending=0,
+        Transferring,
+        Transferred,
+        Done,
+        Failed
+    };
+
+    sacBatchItem();
+
+    QString     filename;
+    QString     scanBasename;
+    QStringList pendingModes;
+    QStringList scanFiles;
+    QStringList failedModes;
+    QStringList interruptedScanFiles;
+    QStringList presentScanFiles;
+    QList<Task> tasks;
+
+    State     state;
+    int       attempts;
+    QDateTime nextAttempt;
+
+    qint64    bytes;
+    double    throughput;
+
+    sacBatchTransfer* transfer;
+};
+
+
+// Submits the files of a batch without user interaction (console mode). Several files
+// are transferred at once on a thread pool, while the task files are written from the
+// calling thread as soon as the transfer of a file has finished. Failed transfers are
+// retried with increasing delay. The state of each file is written into a journal next
+// to the batch file, so that a batch that has been interrupted continues with the files
+// and modes that haven't been submitted yet when it is started again.
+class sacBatchSubmitter
+{
+public:
+    sacBatchSubmitter(sacMainWindow* mainWindow);
+    ~sacBatchSubmitter();
+
+    void setParallelTransfers(int count);
+
+    bool run(QString batchFilename, QStringList files, QStringList modes, QString notify, TaskPriority priority);
+
+protected:
+    void readJournal();
+    void writeJournal(int index);
+
+    bool prepareTasks(int index);
+    void startTransfer(int index);
+    void finishTransfer(int index);
+    void writeTaskFiles(int index);
+    void scheduleRetry(int index, QString reason);
+    void printSummary(qint64 elapsed);
+
+    QString reserveScanFilename(QString filename, int index);
+    bool    isCompleteCopy(int index, QString scanFilename);
+
+    sacMainWindow* parent;
+    int            parallelTransfers;
+
+    QString      journalFilename;
+    QString      notification;
+    TaskPriority taskPriority;
+
+    QList<sacBatchItem> items;
+    QHash<QString, int> reservedNames;
+    QThreadPool         transferPool;
+};
+
+
+#endif // SAC_BATCHSUBMITTER_H
@@ -0,0 +1,231 @@
+#include <QtCore>
+#include <stdio.h>
+
+#include "sac_global.h"
+#include "../Client/rds_copyengine.h"
+
+
+// Test of the headless batch submission. SAC is started in batch mode against a local
+// folder that stands in for the server, killed while the batch is transferred, and
+// started again. Every scan has to be submitted exactly once for every mode. The SAC
+// binary is expected next to the test binary, or it can be passed as first argument.
+
+#define TEST_SCANS     6
+#define TEST_SCANSIZE  (48*1024*1024)
+
+static int failedChecks=0;
+
+static void check(bool condition, QString description)
+{
+    printf("  %s %s\n", condition ? "[OK]    " : "[FAILED]", qPrintable(description));
+
+    if (!condition)
+    {
+        failedChecks++;
+    }
+}
+
+
+static bool prepareServer(QDir serverDir)
+{
+    QSettings serverFile(serverDir.absoluteFilePath(ORT_SERVERFILE), QSettings::IniFormat);
+    serverFile.setValue("YarraServer/Name", "TestServer");
+    serverFile.sync();
+
+    QSettings modeFile(serverDir.absoluteFilePath(ORT_MODEFILE), QSettings::IniFormat);
+    modeFile.setValue("Modes/0", "ModeA");
+    modeFile.setValue("Modes/1", "ModeB");
+    modeFile.setValue("ModeA/Name", "Mode A");
+    modeFile.setValue("ModeA/RequiresACC", false);
+    modeFile.setValue("ModeB/Name", "Mode B");
+    modeFile.setValue("ModeB/RequiresACC", false);
+    modeFile.sync();
+
+    return (serverFile.status()==QSettings::NoError) && (modeFile.status()==QSettings::NoError);
+}
+
+
+static bool prepareBatch(QDir scanDir, QString batchFilename)
+{
+    QSettings batchFile(batchFilename, QSettings::IniFormat);
+    batchFile.setValue("Info/Priority", "Normal");
+    batchFile.setValue("ReconModes/Mode0", "ModeA");
+    batchFile.setValue("ReconModes/Mode1", "ModeB");
+
+    // The scans have different sizes, so that the tasks can be assigned to them
+    QByteArray block(1024*1024, 'X');
+
+    for (int i=0; i<TEST_SCANS; i++)
+    {
+        QString scanFilename=scanDir.absoluteFilePath("meas_MID0000" + QString::number(i) + "_FID0000" + QString::number(i) + ".dat");
+        QFile scanFile(scanFilename);
+
+        if (!scanFile.open(QIODevice::WriteOnly))
+        {
+            return false;
+        }
+
+        for (int j=0; j<TEST_SCANSIZE/block.size(); j++)
+        {
+            scanFile.write(block);
+        }
+
+        scanFile.write(QByteArray(i+1, 'Y'));
+        scanFile.close();
+
+        batchFile.setValue("Scans/Scan" + QString::number(i), scanFilename);
+    }
+
+    batchFile.sync();
+    return (batchFile.status()==QSettings::NoError);
+}
+
+
+static int countTaskFiles(QDir serverDir)
+{
+    serverDir.refresh();
+    return serverDir.entryList(QStringList("*" ORT_TASK_EXTENSION), QDir::Files).count();
+}
+
+
+int testInterruptedBatch(QString sacPath, QDir serverDir, QDir scanDir)
+{
+    printf("Interrupted batch\n");
+
+    QString batchFilename=scanDir.absoluteFilePath("batch.ini");
+
+    if ((!prepareServer(serverDir)) || (!prepareBatch(scanDir, batchFilename)))
+    {
+        check(false, "Test data prepared");
+        return 1;
+    }
+
+    QStringList arguments;
+    arguments << "-b" << batchFilename << "-s" << serverDir.absolutePath() << "-j" << "2";
+
+    // Kill the first run as soon as the first tasks have been submitted
+    QProcess firstRun;
+    firstRun.start(sacPath, arguments);
+
+    if (!firstRun.waitForStarted())
+    {
+        printf("  Unable to start %s\n", qPrintable(sacPath));
+        check(false, "SAC started");
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while ((firstRun.state()!=QProcess::NotRunning) && (countTaskFiles(serverDir)==0) && (timer.elapsed()<120000))
+    {
+        QThread::msleep(20);
+    }
+
+    bool interrupted=(firstRun.state()!=QProcess::NotRunning);
+    firstRun.kill();
+    firstRun.waitForFinished();
+
+    printf("  Tasks submitted before kill: %d\n", countTaskFiles(serverDir));
+    check(interrupted, "First run killed while running");
+
+    QProcess secondRun;
+    secondRun.start(sacPath, arguments);
+
+    bool finished=secondRun.waitForFinished(300000);
+
+    check(finished && (secondRun.exitStatus()==QProcess::NormalExit) && (secondRun.exitCode()==0), "Second run completed");
+
+    // Every combination of scan (identified by the size) and mode has to be submitted once
+    QSet<QString> submitted;
+    QSet<QString> referencedScans;
+    bool duplicateTask=false;
+    bool scanMissing=false;
+
+    serverDir.refresh();
+    QStringList taskFiles=serverDir.entryList(QStringList("*" ORT_TASK_EXTENSION), QDir::Files);
+
+    for (int i=0; i<taskFiles.count(); i++)
+    {
+        QSettings taskFile(serverDir.absoluteFilePath(taskFiles.at(i)), QSettings::IniFormat);
+
+        QString scanFilename=taskFile.value("Task/ScanFile", "").toString();
+        QString combination=taskFile.value("Information/ScanFileSize", 0).toString() + "/" + taskFile.value("Task/ReconMode", "").toString();
+
+        if (submitted.contains(combination))
+        {
+            duplicateTask=true;
+        }
+
+        submitted.insert(combination);
+        referencedScans.insert(scanFilename.toLower());
+
+        if (QFileInfo(serverDir.absoluteFilePath(scanFilename)).size()!=taskFile.value("Information/ScanFileSize", 0).toLongLong())
+        {
+            scanMissing=true;
+        }
+    }
+
+    // Scan files without task would be reconstructed never, but fill up the server
+    QStringList scanFiles=serverDir.entryList(QStringList("*" ORT_TWIX_EXTENSION), QDir::Files);
+    int orphanedScans=0;
+
+    for (int i=0; i<scanFiles.count(); i++)
+    {
+        if (!referencedScans.contains(scanFiles.at(i).toLower()))
+        {
+            orphanedScans++;
+        }
+    }
+
+    printf("  Task files: %d, scan files: %d\n", taskFiles.count(), scanFiles.count());
+
+    check(submitted.count()==TEST_SCANS*2, "All scans submitted for all modes");
+    check(!duplicateTask,                  "No scan submitted twice");
+    check(!scanMissing,                    "Scan files complete");
+    check(orphanedScans==0,                "No orphaned scan files");
+    check(serverDir.entryList(QStringList("*" RDS_COPY_PARTIAL_EXT), QDir::Files).isEmpty(), "No partial files left");
+    check(!QFile::exists(batchFilename + ".journal"), "Journal removed");
+
+    printf("\n");
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    printf("\nYarra SAC - Batch Submission Test\n");
+    printf("---------------------------------\n\n");
+
+    QString sacPath=QDir(app.applicationDirPath()).filePath("SAC");
+
+    if (argc>1)
+    {
+        sacPath=QString(argv[1]);
+    }
+
+    QTemporaryDir tempDir;
+
+    if (!tempDir.isValid())
+    {
+        printf("Unable to create temporary folder\n");
+        return 1;
+    }
+
+    QDir testDir(tempDir.path());
+    testDir.mkdir("server");
+    testDir.mkdir("scans");
+
+    testInterruptedBatch(sacPath, QDir(testDir.absoluteFilePath("server")), QDir(testDir.absoluteFilePath("scans")));
+
+    if (failedChecks>0)
+    {
+        printf("%d checks failed.\n\n", failedChecks);
+        return 1;
+    }
+
+    printf("All checks passed.\n\n");
+    return 0;
+}
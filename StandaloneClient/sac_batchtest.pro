@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Test of the batch submission with an interrupted run
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+DEFINES  += YARRA_APP_SAC
+
+TARGET = sac_batchtest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += sac_batchtest.cpp
+
+HEADERS += \
+    sac_global.h \
+    ../Client/rds_copyengine.h
@@ -1,5 +1,6 @@
 #include "sac_copydialog.h"
 #include "ui_sac_copydialog.h"
+#include "../Client/rds_copyengine.h"
 
 #include <QtWidgets>
 
@@ -21,6 +22,10 @@ sacCopyDialog::sacCopyDialog(QWidget *parent) :
     ui->progressBar->setPalette(p);
 
     setGeometry(QStyle::alignedRect(Qt::LeftToRight, Qt::AlignRight | Qt::AlignBottom, size(), qApp->desktop()->availableGeometry()));
+
+    // Show the progress of the copy operation running in the background
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    progressTimer.start(RDS_COPY_PROGRESSINTERVAL);
 }
 
 
@@ -35,3 +40,22 @@ sacCopyDialog::~sacCopyDialog()
     delete ui;
 }
 
+
+void sacCopyDialog::updateProgress()
+{
+    int     permille=0;
+    QString progressText="";
+
+    // Show the busy indicator if no file is being copied at the moment
+    if (!rdsCopyEngine::getActiveProgress(permille, progressText))
+    {
+        ui->progressBar->setMaximum(0);
+        ui->progressBar->setTextVisible(false);
+        return;
+    }
+
+    ui->progressBar->setMaximum(1000);
+    ui->progressBar->setValue(permille);
+    ui->progressBar->setFormat(progressText);
+    ui->progressBar->setTextVisible(true);
+}
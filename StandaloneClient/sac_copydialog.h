@@ -2,6 +2,7 @@
 #define SAC_COPYDIALOG_H
 
 #include <QDialog>
+#include <QTimer>
 
 namespace Ui {
 class sacCopyDialog;
@@ -19,6 +20,11 @@ public:
 
 private:
     Ui::sacCopyDialog *ui;
+
+    QTimer progressTimer;
+
+private slots:
+    void updateProgress();
 };
 
 #endif // SAC_COPYDIALOG_H
@@ -7,8 +7,5 @@
 #define SAC_VERSION    "0.28b1"
 #define SAC_ICON QIcon(":/images/sacicon_256.png")
 
-#define SAC_ANALYZE_MAXLINES  30000
-#define SAC_ANALYZE_MAXLENGTH 1024
-
 
 #endif // SAC_GLOBAL_H
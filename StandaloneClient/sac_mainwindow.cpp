@@ -10,9 +10,10 @@
 #include "sac_copydialog.h"
 #include "sac_configurationdialog.h"
 #include "sac_batchdialog.h"
-#include "sac_twixheader.h"
 #include "ui_sac_batchdialog.h"
 
+#include "../CloudTools/yct_prepare/yct_twix_probe.h"
+
 
 sacMainWindow::sacMainWindow(QWidget *parent, bool isConsole) :
     QMainWindow(parent),
@@ -968,112 +969,29 @@ int sacMainWindow::detectMode(QString protocol)
 
 void sacMainWindow::analyzeDatFile(QString filename, QString& detectedPatname, QString& detectedProtocol)
 {
-    QString protID="<ParamString.\"tProtocolName\">";
-    QString patID ="<ParamString.\"tPatientName\">";
-
     detectedPatname ="";
     detectedProtocol="";
 
-    QFile file;
-    file.setFileName(filename);
-    file.open(QIODevice::ReadOnly);
-
-    // Determine whether file is VB or VD
-    uint32_t x[2];
-    file.read((char*)x, 2*sizeof(uint32_t));
+    // Reads the protocol and patient name from the header of the last measurement
+    // without scanning the file line by line
+    yctTWIXProbe probe;
 
-    bool isVDVE=false;
-
-    if ((x[0]==0) && (x[1]<=64))
+    if (probe.probe(filename))
     {
-        isVDVE=true;
+        detectedPatname =probe.patientName;
+        detectedProtocol=probe.protocolName;
     }
-    file.seek(0);
 
-    // If file version is VD, then jump to the last measurement in the file
-    if (isVDVE)
+    if (!probe.patientFound || !probe.protocolFound)
     {
-        uint32_t id=0, ndset=0;
-        std::vector<VD::EntryHeader> veh;
-
-        file.read((char*)&id,   sizeof(uint32_t));  // ID
-        file.read((char*)&ndset,sizeof(uint32_t));  // # data sets
-
-        if (ndset>30)
-        {
-            // If there are more than 30 measurements, it's unlikely that the
-            // file is a valid TWIX file
-        }
-        else
-        {
-            veh.resize(ndset);
-
-            for (size_t i=0; i<ndset; ++i)
-            {
-                file.read((char*)&veh[i], VD::ENTRY_HEADER_LEN);
-            }
-
-            // Go to last measurement
-            file.seek(veh.back().MeasOffset);
-        }
-    }
-
-    bool patientFound=false;
-    bool protocolFound=false;
-
-    int linesToProcess=SAC_ANALYZE_MAXLINES;
-
-    int idx=0;
-
-    for (int i=0; i<linesToProcess; i++)
-    {
-        QByteArray line=file.readLine(SAC_ANALYZE_MAXLENGTH);
-
-        if (!protocolFound)
-        {
-            idx=line.indexOf(protID);
-            if (idx!=-1)
-            {
-                protocolFound=true;
-                line.remove(idx, protID.length());
-                line.remove(0, line.indexOf("\"")+1);
-                line.truncate(line.indexOf("\""));
-                detectedProtocol=QString(line);
-                //RTI->log("Protocol: " + detectedProtocol);
-            }
-        }
-
-        if (!patientFound)
-        {
-            idx=line.indexOf(patID);
-            if (idx!=-1)
-            {
-                patientFound=true;
-                line.remove(idx, protID.length());
-                line.remove(0, line.indexOf("\"")+1);
-                line.truncate(line.indexOf("\""));
-                detectedPatname=QString(line);
-                //RTI->log("Patient: " + detectedPatname);
-            }
-        }
+        RTI->log("WARNING: Could not find protocol or patient information.");
+        RTI->log("WARNING: File " + filename);
 
-        if (patientFound && protocolFound)
-        {
-            break;
-        }
-        if (file.atEnd())
+        if (!probe.errorReason.isEmpty())
         {
-            break;
+            RTI->log("WARNING: " + probe.errorReason);
         }
     }
-
-    if (!patientFound || !protocolFound)
-    {
-        RTI->log("WARNING: Could not find protocol or patient information.");
-        RTI->log("WARNING: File " + filename);
-    }
-
-    file.close();
 }
 
 
@@ -1147,10 +1065,135 @@ bool sacMainWindow::submitFileOfBatch(QString file_path, QString file_name, QStr
 
     analyzeDatFile(the_file, the_task.patientName, the_task.protocolName);
 
+    if (!prepareBatchTask(the_file, file_name, mode, notification, priority, the_task))
+    {
+        return false;
+    }
+
+    sacCopyDialog copyDialog;
+    copyDialog.show();
+
+    if (!network.copyMeasurementFile(the_file,the_task.scanFilename))
+    {
+        RTI->log("ERROR: Unable to copy file " + the_file);
+        copyDialog.hide();
+        return false;
+    }
+
+    copyDialog.hide();
+
+    if (!generateTaskFile(the_task))
+    {        
+        RTI->log("ERROR: Unable to generate task file for " + the_file);
+
+        // Task-file creation failed, so remove scan file
+        QFile::remove(network.serverDir.absoluteFilePath(the_task.scanFilename));
+        return false;
+    }
+
+    return true;
+}
+
+
+bool sacMainWindow::submitFileOfBatch(QString file_path, QString file_name, QStringList& modes, QString notification, TaskPriority priority)
+{
+    // Submits the file for all modes, but transfers it only once. The other scan files are
+    // duplicated on the server before the task files are written, because the server takes
+    // the scan file of a task when it starts the reconstruction. On return, the list only
+    // contains the modes that could not be submitted.
+    QString the_file = QDir(file_path).filePath(file_name);
+
+    QString patientName="";
+    QString protocolName="";
+    analyzeDatFile(the_file, patientName, protocolName);
+
+    QFileInfo   fileinfo(file_name);
+    QList<Task> tasks;
+    QStringList failedModes;
+
+    for (int i=0; i<modes.count(); i++)
+    {
+        Task the_task;
+        the_task.patientName =patientName;
+        the_task.protocolName=protocolName;
+
+        QString scanFilename=file_name;
+
+        if (i>0)
+        {
+            scanFilename=fileinfo.completeBaseName() + "_" + QString::number(i+1) + "." + fileinfo.suffix();
+        }
+
+        if (prepareBatchTask(the_file, scanFilename, modes.at(i), notification, priority, the_task))
+        {
+            tasks.append(the_task);
+        }
+        else
+        {
+            failedModes.append(modes.at(i));
+        }
+    }
+
+    if (tasks.isEmpty())
+    {
+        modes=failedModes;
+        return false;
+    }
+
+    sacCopyDialog copyDialog;
+    copyDialog.show();
+
+    bool copyError=!network.copyMeasurementFile(the_file,tasks.at(0).scanFilename);
+
+    if (copyError)
+    {
+        RTI->log("ERROR: Unable to copy file " + the_file);
+    }
+
+    for (int i=1; (i<tasks.count()) && (!copyError); i++)
+    {
+        if (!network.duplicateMeasurementFile(tasks.at(0).scanFilename, tasks.at(i).scanFilename))
+        {
+            RTI->log("ERROR: Unable to duplicate file " + tasks.at(0).scanFilename);
+            copyError=true;
+        }
+    }
+
+    copyDialog.hide();
+
+    if (copyError)
+    {
+        // No task has been created, so remove all copies and try again with all modes
+        for (int i=0; i<tasks.count(); i++)
+        {
+            QFile::remove(network.serverDir.absoluteFilePath(tasks.at(i).scanFilename));
+        }
+        return false;
+    }
+
+    for (int i=0; i<tasks.count(); i++)
+    {
+        if (!generateTaskFile(tasks[i]))
+        {
+            RTI->log("ERROR: Unable to generate task file for " + the_file + " (" + tasks.at(i).mode + ")");
+
+            // Task-file creation failed, so remove scan file
+            QFile::remove(network.serverDir.absoluteFilePath(tasks.at(i).scanFilename));
+            failedModes.append(tasks.at(i).mode);
+        }
+    }
+
+    modes=failedModes;
+    return failedModes.isEmpty();
+}
+
+
+bool sacMainWindow::prepareBatchTask(QString the_file, QString scanFilename, QString mode, QString notification, TaskPriority priority, Task& the_task, bool checkExisting)
+{
     the_task.mode = mode;
 
     QString modeNotification="";
-    bool   foundMode;
+    bool   foundMode=false;
     for (auto &modeInfo: modeList.modes)
     {
         if (modeInfo->idName == mode)
@@ -1184,12 +1227,12 @@ bool sacMainWindow::submitFileOfBatch(QString file_path, QString file_name, QStr
     QFileInfo fileinfo(the_file);
 
 
-    the_task.scanFilename = file_name;
+    the_task.scanFilename = scanFilename;
 
     // Check if the file already exists on the server. If so, add a timestamp and check again.
     // Do this 5 times. If that can't resolve it, then go on and fail with error message during
-    // the copy procedure.
-    for (int i=0; i<5; i++)
+    // the copy procedure. The check is skipped if the scan file has already been transferred.
+    for (int i=0; (i<5) && (checkExisting); i++)
     {
         if (network.fileExistsOnServer(the_task.scanFilename))
         {
@@ -1213,13 +1256,13 @@ bool sacMainWindow::submitFileOfBatch(QString file_path, QString file_name, QStr
 
     if (priority == TaskPriority::Night)
     {
-        task.taskFilename+=ORT_TASK_EXTENSION_NIGHT;
+        the_task.taskFilename+=ORT_TASK_EXTENSION_NIGHT;
     }
     else
     {
         if (priority == TaskPriority::HighPriority)
         {
-            task.taskFilename+=ORT_TASK_EXTENSION_PRIO;
+            the_task.taskFilename+=ORT_TASK_EXTENSION_PRIO;
         }
     }
 
@@ -1227,28 +1270,7 @@ bool sacMainWindow::submitFileOfBatch(QString file_path, QString file_name, QStr
     newtaskID.truncate(newtaskID.indexOf("."+fileinfo.completeSuffix()));
 
     the_task.taskID=newtaskID;
-    the_task.lockFilename=task.scanFilename+ORT_LOCK_EXTENSION;
-
-    sacCopyDialog copyDialog;
-    copyDialog.show();
-
-    if (!network.copyMeasurementFile(the_file,the_task.scanFilename))
-    {
-        RTI->log("ERROR: Unable to copy file " + the_file);
-        copyDialog.hide();
-        return false;
-    }
-
-    copyDialog.hide();
-
-    if (!generateTaskFile(the_task))
-    {        
-        RTI->log("ERROR: Unable to generate task file for " + the_file);
-
-        // Task-file creation failed, so remove scan file
-        QFile::remove(network.serverDir.absoluteFilePath(the_task.scanFilename));
-        return false;
-    }
+    the_task.lockFilename=the_task.scanFilename+ORT_LOCK_EXTENSION;
 
     return true;
 }
@@ -1336,33 +1358,41 @@ bool sacMainWindow::submitBatch(QStringList files, QStringList modes, QString no
     {
         QFileInfo fi(file);
 
-        for (QString mode: modes)
+        if (network.deduplicateBatch)
         {
-            while (!submitFileOfBatch(fi.absolutePath(), fi.fileName(), mode, notify, priority))
+            // Transfer the file once for all modes. After an error, only the failed modes are submitted again.
+            QStringList pendingModes=modes;
+
+            while (!submitFileOfBatch(fi.absolutePath(), fi.fileName(), pendingModes, notify, priority))
             {
-                int reply;
-                if (!isConsole)
+                int reply=askBatchRetry(file, pendingModes.join(", "));
+
+                if (reply == QMessageBox::Abort)
                 {
-                    reply = QMessageBox::question(this, "Transfer Error", "Submitting " + file + " for mode < " + mode + " > failed. Retry?",
-                                                  QMessageBox::Yes|QMessageBox::Ignore|QMessageBox::Abort);
+                    return false;
+                }
+                if (reply == QMessageBox::Ignore)
+                {
+                    break;
                 }
+            }
+
+            continue;
+        }
 
-                if(reply == QMessageBox::Abort || isConsole)
+        for (QString mode: modes)
+        {
+            while (!submitFileOfBatch(fi.absolutePath(), fi.fileName(), mode, notify, priority))
+            {
+                int reply=askBatchRetry(file, mode);
+
+                if (reply == QMessageBox::Abort)
                 {
-                    RTI->log("ERROR: Submitting file failed " + file + " for mode " + mode);
-                    qCritical() << "Submitting " << file << " < " << mode << " > failed.";
                     return false;
                 }
-                else
+                if (reply == QMessageBox::Ignore)
                 {
-                    if (reply == QMessageBox::Ignore)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        continue;
-                    }
+                    break;
                 }
             }
         }
@@ -1372,6 +1402,26 @@ bool sacMainWindow::submitBatch(QStringList files, QStringList modes, QString no
 }
 
 
+int sacMainWindow::askBatchRetry(QString file, QString mode)
+{
+    int reply=QMessageBox::Abort;
+
+    if (!isConsole)
+    {
+        reply = QMessageBox::question(this, "Transfer Error", "Submitting " + file + " for mode < " + mode + " > failed. Retry?",
+                                      QMessageBox::Yes|QMessageBox::Ignore|QMessageBox::Abort);
+    }
+
+    if (reply == QMessageBox::Abort)
+    {
+        RTI->log("ERROR: Submitting file failed " + file + " for mode " + mode);
+        qCritical() << "Submitting " << file << " < " << mode << " > failed.";
+    }
+
+    return reply;
+}
+
+
 bool sacMainWindow::readBatchFile(QString fileName, QStringList& files, QStringList& modes, QString& notify, TaskPriority& priority)
 {
     QFileInfo fileInfo = QFileInfo(fileName);
@@ -88,6 +88,9 @@ public:
     bool generateTaskFile(Task& a_task, bool cloudRecon=false);
     void analyzeDatFile(QString filename, QString& detectedPatname, QString& detectedProtocol);
     bool submitFileOfBatch(QString file_path, QString file_name, QString mode, QString notification, TaskPriority priority);
+    bool submitFileOfBatch(QString file_path, QString file_name, QStringList& modes, QString notification, TaskPriority priority);
+    bool prepareBatchTask(QString the_file, QString scanFilename, QString mode, QString notification, TaskPriority priority, Task& the_task, bool checkExisting=true);
+    int  askBatchRetry(QString file, QString mode);
     bool handleBatchFile(QString file);
     bool submitBatch(QStringList files, QStringList modes, QString notify, TaskPriority priority);
     void updateDialogHeight();
@@ -6,6 +6,9 @@
 #include "../Client/rds_network.h"
 
 
+QString sacNetwork::serverPathOverride="";
+
+
 sacNetwork::sacNetwork()
 {
     connectCmd="";
@@ -16,6 +19,9 @@ sacNetwork::sacNetwork()
     copyErrorMsg="";
     showConfigurationAfterError=false;
     cloudSupportEnabled=false;
+    deduplicateBatch=false;
+    logServerAddress="";
+    logServerAPIKey="";
 }
 
 
@@ -33,6 +39,19 @@ bool sacNetwork::readConfiguration()
         defaultNotification=config.value("Configuration/DefaultNotification","").toString();
         preferredMode      =config.value("Configuration/PreferredMode","").toString();
         cloudSupportEnabled=config.value("Configuration/CloudSupport",false).toBool();
+        deduplicateBatch   =config.value("Configuration/DeduplicateBatch",false).toBool();
+        logServerAddress   =config.value("LogServer/ServerAddress","").toString();
+        logServerAPIKey    =config.value("LogServer/APIKey","").toString();
+
+        // Transfers are only reported if a log server has been configured
+        netLogger.configure(logServerAddress, EventInfo::SourceType::SAC, systemName, logServerAPIKey);
+
+        if (!serverPathOverride.isEmpty())
+        {
+            serverPath=serverPathOverride;
+            connectCmd="";
+            disconnectCmd="";
+        }
 
         if ((serverPath.length()==0) && (!cloudSupportEnabled))
         {
@@ -56,6 +75,9 @@ void sacNetwork::writeConfiguration()
         config.setValue("Configuration/DefaultNotification",defaultNotification);
         config.setValue("Configuration/PreferredMode",preferredMode);
         config.setValue("Configuration/CloudSupport",cloudSupportEnabled);
+        config.setValue("Configuration/DeduplicateBatch",deduplicateBatch);
+        config.setValue("LogServer/ServerAddress",logServerAddress);
+        config.setValue("LogServer/APIKey",logServerAPIKey);
     }
 }
 
@@ -209,6 +231,51 @@ bool sacNetwork::fileExistsOnServer(QString filename)
 }
 
 
+bool sacNetwork::duplicateMeasurementFile(QString serverFile, QString targetFile)
+{
+    copyErrorMsg="";
+    serverDir.refresh();
+
+    QString sourceName=serverDir.absoluteFilePath(serverFile);
+    QString destName=serverDir.absoluteFilePath(targetFile);
+
+    RTI->log("Duplicating measurement on server.");
+    RTI->log("Source: " + sourceName);
+    RTI->log("Target: " + destName);
+
+    QFileInfo srcinfo(sourceName);
+    qint64 diskSpace=RTI->getFreeDiskSpace(serverDir.absolutePath());
+
+    if (srcinfo.size() > diskSpace)
+    {
+        RTI->log("ERROR: Not enough diskspace on network drive to duplicate file.");
+        copyErrorMsg="Not enough diskspace on server available.";
+        return false;
+    }
+
+    if (QFile::exists(destName))
+    {
+        RTI->log("WARNING: File already exists in target folder: " + destName);
+        copyErrorMsg="Filename already exists on server.";
+        return false;
+    }
+
+    RTI->processEvents();
+
+    // Both files are on the same share, so Windows copies the file on the server
+    // (SMB server-side copy) without transferring the data through the client
+    if (!QFile::copy(sourceName, destName))
+    {
+        RTI->log("ERROR: Unable to duplicate file on server.");
+        copyErrorMsg="Unable to duplicate file on server.";
+        QFile::remove(destName);
+        return false;
+    }
+
+    return true;
+}
+
+
 bool sacNetwork::copyMeasurementFile(QString sourceFile, QString targetFile)
 {
     copyErrorMsg="";
@@ -287,6 +354,22 @@ bool sacNetwork::copyMeasurementFile(QString sourceFile, QString targetFile)
         }
 
         copyError=!copyThread.success;
+
+        if (!copyError)
+        {
+            if (copyThread.engine.getResumedBytes()>0)
+            {
+                RTI->log("Resumed transfer of partial file after " + QString::number(copyThread.engine.getResumedBytes()) + " bytes");
+            }
+            RTI->log("Transfer rate: " + rdsCopyEngine::formatThroughput(copyThread.engine.getThroughput()));
+
+            netLogger.postEvent(EventInfo::Type::Transfer,EventInfo::Detail::FileTransfer,EventInfo::Severity::Success,
+                                targetFile, copyThread.engine.getTransferData());
+        }
+        else
+        {
+            RTI->log("ERROR: " + copyThread.fileErrorString);
+        }
     }
 
     if (copyError)
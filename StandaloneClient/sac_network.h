@@ -2,6 +2,7 @@
 #define SAC_NETWORK_H
 
 #include <QtCore>
+#include "../NetLogger/netlogger.h"
 
 
 class sacNetwork: public QObject
@@ -25,6 +26,18 @@ public:
 
     bool cloudSupportEnabled;
 
+    // Upload each file of a batch once and duplicate it on the server for the other modes.
+    // Off by default: this is only faster if the share supports SMB server-side copy,
+    // otherwise the duplicate is read and written again through the client.
+    bool deduplicateBatch;
+
+    QString logServerAddress;
+    QString logServerAPIKey;
+    NetLogger netLogger;
+
+    // Server path given on the command line (e.g., a local folder for testing batches)
+    static QString serverPathOverride;
+
     QString copyErrorMsg;
     bool showConfigurationAfterError;
 
@@ -38,6 +51,7 @@ public:
     virtual QSettings* readModelist(QString& error);
 
     bool copyMeasurementFile(QString sourceFile, QString targetFile);
+    bool duplicateMeasurementFile(QString serverFile, QString targetFile);
     bool fileExistsOnServer(QString filename);
 
 };